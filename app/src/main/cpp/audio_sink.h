@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Where the guest's played samples go. A sink takes interleaved 16-bit PCM and reports
+// presentation positions: frame N of everything written is heard at time T. That pair
+// is all SinkLatency needs, so the latency model runs the same against an AudioTrack
+// (positions from AudioTrack.getTimestamp, passed in over JNI) and against
+// SimulatedSink on Linux.
+class AudioSink {
+public:
+    struct Position {
+        int64_t framePosition;   // frames since the sink started (or was last flushed)
+        int64_t presentedNs;     // CLOCK_MONOTONIC when that frame is heard
+    };
+
+    virtual ~AudioSink() = default;
+
+    virtual int sampleRate() const = 0;
+    // Frames accepted; 0 when the sink is full.
+    virtual int write(const int16_t* pcm, int frames) = 0;
+    virtual int64_t framesWritten() const = 0;
+    // False until the sink has presented anything.
+    virtual bool position(Position* out) = 0;
+};
@@ -0,0 +1,192 @@
+#include "clock_sync.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "futex.h"
+
+HostClock::HostClock() : HostClock(Config()) {}
+
+HostClock::HostClock(const Config& cfg)
+        : cfg_(cfg),
+          fastPollNs_((int64_t)(cfg.fastPollMs * 1e6)),
+          pollNs_((int64_t)(cfg.pollMs * 1e6)),
+          segment_(std::max(cfg.segment, 1)) {
+    window_.reserve((size_t)std::max(cfg.window, 1));
+    points_.reserve((size_t)std::max(cfg.window, 1));
+}
+
+// ---------------- rx thread ----------------
+
+void HostClock::onRequestSent(int64_t nowNs) {
+    nextRequestNs_ = nowNs + ((int)window_.size() < cfg_.fastExchanges ? fastPollNs_ : pollNs_);
+}
+
+void HostClock::onMedia(int32_t seq, uint32_t pts) {
+    anchor_.store((uint64_t(uint32_t(seq)) << 32) | pts, std::memory_order_release);
+}
+
+void HostClock::onReply(const wspacket::ClockExchange& c, int64_t t4) {
+    const int64_t delay = (t4 - c.t1) - (c.t3 - c.t2);
+    if (t4 <= c.t1 || delay < 0 || delay > (int64_t)(cfg_.maxDelayMs * 1e6)) return;
+    const int64_t offset = ((c.t2 - c.t1) + (c.t3 - t4)) / 2;
+
+    if (current_.valid) {
+        const double slack = cfg_.delaySlackMs * 1e6 + cfg_.delaySlackShare * (double)current_.minDelayNs;
+        if ((double)delay <= (double)current_.minDelayNs + slack) {
+            const double predicted = (double)current_.offsetNs +
+                                     current_.skewPpm * 1e-6 * (double)(t4 - current_.refNs);
+            if (std::fabs((double)offset - predicted) > cfg_.restartMs * 1e6) {
+                // A quick exchange that disagrees: either a glitch or a different host
+                if (++offLine_ < cfg_.restartAfter) return;
+                window_.clear();
+                next_ = 0;
+                ++current_.restarts;
+            }
+            offLine_ = 0;
+        }
+    }
+
+    const Exchange e{t4, offset, delay};
+    if ((int)window_.size() < cfg_.window) {
+        window_.push_back(e);
+    } else {
+        window_[next_] = e;
+        next_ = (next_ + 1) % cfg_.window;
+    }
+    ++current_.exchanges;
+    fit(t4);
+}
+
+void HostClock::fit(int64_t nowNs) {
+    int64_t minDelay = window_[0].delayNs;
+    for (const Exchange& e : window_) minDelay = std::min(minDelay, e.delayNs);
+    const double limit = (double)minDelay + cfg_.delaySlackMs * 1e6 + cfg_.delaySlackShare * (double)minDelay;
+
+    // Clock filter: the quickest exchange of each segment, oldest first, if it is close
+    // to the window's quickest. Spreads the line's points over the whole window.
+    const int size = (int)window_.size();
+    const int oldest = size < cfg_.window ? 0 : next_;
+    points_.clear();
+    for (int start = 0; start < size; start += segment_) {
+        const Exchange* best = nullptr;
+        for (int i = start; i < std::min(start + segment_, size); ++i) {
+            const Exchange& e = window_[(oldest + i) % size];
+            if (!best || e.delayNs < best->delayNs) best = &e;
+        }
+        if ((double)best->delayNs <= limit) points_.push_back(*best);
+    }
+
+    // Relative to the newest exchange, so the sums stay small
+    const Exchange& base = window_[(oldest + size - 1) % size];
+    const int n = (int)points_.size();
+    double sumT = 0, sumO = 0;
+    for (const Exchange& e : points_) {
+        sumT += (double)(e.atNs - base.atNs);
+        sumO += (double)(e.offsetNs - base.offsetNs);
+    }
+    const int64_t first = n > 0 ? points_.front().atNs : 0;
+    const int64_t last = n > 0 ? points_.back().atNs : 0;
+    const double meanT = sumT / n;
+    const double meanO = sumO / n;
+
+    double skew = 0;
+    if (n >= cfg_.minSkewPoints && (double)(last - first) >= cfg_.minSkewSpanMs * 1e6) {
+        double sxx = 0, sxy = 0;
+        for (const Exchange& e : points_) {
+            const double dt = (double)(e.atNs - base.atNs) - meanT;
+            sxx += dt * dt;
+            sxy += dt * ((double)(e.offsetNs - base.offsetNs) - meanO);
+        }
+        const double maxSkew = cfg_.maxSkewPpm * 1e-6;
+        if (sxx > 0) skew = std::clamp(sxy / sxx, -maxSkew, maxSkew);
+    }
+
+    // Line through the trusted mean, anchored at the newest reply
+    const double atRef = meanO + skew * ((double)(nowNs - base.atNs) - meanT);
+    current_.offsetNs = base.offsetNs + (int64_t)std::llround(atRef);
+    current_.refNs = nowNs;
+    current_.skewPpm = skew * 1e6;
+    current_.minDelayNs = minDelay;
+    current_.trusted = n;
+    current_.valid = (int)window_.size() >= cfg_.minExchanges;
+    publish(current_);
+}
+
+void HostClock::publish(const Estimate& e) {
+    const uint32_t v = version_.load(std::memory_order_relaxed);
+    version_.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    valid_.store(e.valid, std::memory_order_relaxed);
+    offsetNs_.store(e.offsetNs, std::memory_order_relaxed);
+    refNs_.store(e.refNs, std::memory_order_relaxed);
+    skew_.store(e.skewPpm * 1e-6, std::memory_order_relaxed);
+    minDelayNs_.store(e.minDelayNs, std::memory_order_relaxed);
+    exchanges_.store(e.exchanges, std::memory_order_relaxed);
+    trusted_.store(e.trusted, std::memory_order_relaxed);
+    restarts_.store(e.restarts, std::memory_order_relaxed);
+    version_.store(v + 2, std::memory_order_release);
+}
+
+// ---------------- any thread ----------------
+
+bool HostClock::estimate(Estimate* out) const {
+    for (;;) {
+        const uint32_t v = version_.load(std::memory_order_acquire);
+        if (v & 1) continue;
+        out->valid = valid_.load(std::memory_order_relaxed);
+        out->offsetNs = offsetNs_.load(std::memory_order_relaxed);
+        out->refNs = refNs_.load(std::memory_order_relaxed);
+        out->skewPpm = skew_.load(std::memory_order_relaxed) * 1e6;
+        out->minDelayNs = minDelayNs_.load(std::memory_order_relaxed);
+        out->exchanges = exchanges_.load(std::memory_order_relaxed);
+        out->trusted = trusted_.load(std::memory_order_relaxed);
+        out->restarts = restarts_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) == v) return out->valid;
+    }
+}
+
+bool HostClock::line(Line* out) const {
+    for (;;) {
+        const uint32_t v = version_.load(std::memory_order_acquire);
+        if (v & 1) continue;
+        const bool valid = valid_.load(std::memory_order_relaxed);
+        out->offsetNs = offsetNs_.load(std::memory_order_relaxed);
+        out->refNs = refNs_.load(std::memory_order_relaxed);
+        out->skew = skew_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) == v) return valid;
+    }
+}
+
+bool HostClock::toHost(int64_t guestNs, int64_t* hostNs) const {
+    Line l{};
+    if (!line(&l)) return false;
+    *hostNs = guestNs + l.offsetNs + (int64_t)std::llround(l.skew * (double)(guestNs - l.refNs));
+    return true;
+}
+
+bool HostClock::toGuest(int64_t hostNs, int64_t* guestNs) const {
+    Line l{};
+    if (!line(&l)) return false;
+    // The offset is a function of guest time; one fixed-point step is exact to < 1 ns
+    const int64_t g0 = hostNs - l.offsetNs;
+    *guestNs = hostNs - l.offsetNs - (int64_t)std::llround(l.skew * (double)(g0 - l.refNs));
+    return true;
+}
+
+bool HostClock::presentationNs(int32_t seq, int frameTicks, int64_t delayNs,
+                               int64_t* guestNs) const {
+    const uint64_t anchor = anchor_.load(std::memory_order_acquire);
+    int64_t hostNow = 0;
+    if (anchor == 0 || !toHost(futex::monotonicNs(), &hostNow)) return false;
+
+    const int32_t anchorSeq = (int32_t)(uint32_t)(anchor >> 32);
+    const uint32_t pts = (uint32_t)anchor + ((uint32_t)seq - (uint32_t)anchorSeq) * (uint32_t)frameTicks;
+    // Unwrap against the host's current time: pts is within a few seconds of it
+    const int64_t nowTicks = wspacket::ptsTicks(hostNow);
+    const int64_t ticks = nowTicks + (int32_t)(pts - (uint32_t)nowTicks);
+    return toGuest(wspacket::ptsNs(ticks) + delayNs, guestNs);
+}
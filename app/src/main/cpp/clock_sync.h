@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "packet_codec.h"
+
+// Guest-side view of the host's CLOCK_MONOTONIC, estimated NTP style over the
+// stream's UDP socket, plus the host media timeline carried in packet pts.
+//
+// The rx thread sends a clock request every pollMs (fastPollMs until the first few
+// replies are in) and feeds each reply with its kernel arrival time t4. An exchange
+// gives offset = ((t2 - t1) + (t3 - t4)) / 2 and round-trip delay (t4 - t1) - (t3 - t2).
+// Queueing only ever adds delay, so the window is cut into segments and only the
+// quickest exchange of each, if it is close to the smallest delay in the window, is
+// trusted; offset and skew are a least-squares line through those, which lets a guest
+// extrapolate between exchanges. Trusted exchanges far off the line (the
+// host changed) restart the estimate.
+//
+// The rx thread also records the newest (seq, pts) from media packets. pts advances by
+// exactly one frame per seq, so the host time of any frame follows from that anchor.
+// Estimates are published through a seqlock: readers on any thread never block.
+class HostClock {
+public:
+    struct Config {
+        int window = 128;                // exchanges kept
+        int segment = 8;                 // exchanges per trusted point at most
+        double fastPollMs = 50;          // until fastExchanges replies arrived
+        int fastExchanges = 8;
+        double pollMs = 250;
+        int minExchanges = 3;            // before the estimate is valid
+        double delaySlackMs = 1.0;       // trusted above the window's smallest delay ...
+        double delaySlackShare = 0.5;    // ... plus this share of it
+        double minSkewSpanMs = 8000;     // trusted exchanges span this before skew is fitted
+        int minSkewPoints = 4;
+        double maxSkewPpm = 500;
+        double maxDelayMs = 500;         // longer exchanges are dropped
+        double restartMs = 50;           // trusted exchanges this far off the line ...
+        int restartAfter = 3;            // ... this many times in a row restart
+    };
+
+    struct Estimate {
+        bool valid = false;
+        int64_t offsetNs = 0;            // host - guest, at refNs
+        int64_t refNs = 0;               // guest time the line is anchored at
+        double skewPpm = 0;              // host clock rate relative to the guest's, - 1
+        int64_t minDelayNs = 0;          // smallest round trip in the window
+        int exchanges = 0;               // replies accepted
+        int trusted = 0;                 // points behind the current line
+        int restarts = 0;
+    };
+
+    HostClock();
+    explicit HostClock(const Config& cfg);
+
+    // ---- rx thread ----
+
+    bool requestDue(int64_t nowNs) const { return nowNs >= nextRequestNs_; }
+    void onRequestSent(int64_t nowNs);
+    // t4 = guest arrival time of the reply
+    void onReply(const wspacket::ClockExchange& c, int64_t t4);
+    void onMedia(int32_t seq, uint32_t pts);
+
+    // ---- any thread ----
+
+    bool estimate(Estimate* out) const;
+    bool toHost(int64_t guestNs, int64_t* hostNs) const;
+    bool toGuest(int64_t hostNs, int64_t* guestNs) const;
+
+    // Guest time at which frame seq's first sample is due: its host pts + delayNs.
+    // frameTicks is the frame length in pts ticks. False until both the clock and a
+    // media anchor are known.
+    bool presentationNs(int32_t seq, int frameTicks, int64_t delayNs, int64_t* guestNs) const;
+
+private:
+    struct Exchange {
+        int64_t atNs;       // t4
+        int64_t offsetNs;
+        int64_t delayNs;
+    };
+
+    struct Line {
+        int64_t offsetNs;
+        int64_t refNs;
+        double skew;        // ppm / 1e6
+    };
+
+    void fit(int64_t nowNs);
+    void publish(const Estimate& e);
+    bool line(Line* out) const;
+
+    const Config cfg_;
+    const int64_t fastPollNs_;
+    const int64_t pollNs_;
+    const int segment_;
+
+    // rx thread
+    std::vector<Exchange> window_;
+    std::vector<Exchange> points_;      // fit() scratch
+    int next_ = 0;
+    int64_t nextRequestNs_ = 0;
+    int replies_ = 0;
+    int offLine_ = 0;
+    Estimate current_;
+
+    // Published (seqlock: odd while writing)
+    std::atomic<uint32_t> version_{0};
+    std::atomic<bool> valid_{false};
+    std::atomic<int64_t> offsetNs_{0};
+    std::atomic<int64_t> refNs_{0};
+    std::atomic<double> skew_{0};
+    std::atomic<int64_t> minDelayNs_{0};
+    std::atomic<int> exchanges_{0};
+    std::atomic<int> trusted_{0};
+    std::atomic<int> restarts_{0};
+
+    // Media anchor: seq << 32 | pts, 0 = none yet (a real (0, 0) anchor is replaced
+    // by the next packet)
+    std::atomic<uint64_t> anchor_{0};
+};
@@ -0,0 +1,54 @@
+#include <jni.h>
+#include <android/log.h>
+#include <climits>
+#include <new>
+
+#include "clock_sync.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_HOST_CLOCK(ptr) reinterpret_cast<HostClock*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostClock_createHostClock(
+        JNIEnv* /*env*/, jobject /*thiz*/) {
+    auto* c = new (std::nothrow) HostClock();
+    if (!c) LOGE("createHostClock: out of memory");
+    return reinterpret_cast<jlong>(c);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostClock_destroyHostClock(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_HOST_CLOCK(pointer);
+}
+
+// System.nanoTime() at which frame seq is due, or Long.MIN_VALUE while unknown.
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostClock_presentationNs(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint seq, jint frameTicks,
+        jlong delayNs) {
+    HostClock* c = GET_HOST_CLOCK(pointer);
+    int64_t at = 0;
+    if (!c || frameTicks <= 0 || !c->presentationNs(seq, frameTicks, delayNs, &at)) return LLONG_MIN;
+    return (jlong)at;
+}
+
+// out[0..6] = valid, offsetNs, skew (ppb), min round trip ns, exchanges, trusted, restarts
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostClock_estimate(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    HostClock* c = GET_HOST_CLOCK(pointer);
+    if (!c || !out || env->GetArrayLength(out) < 7) return JNI_FALSE;
+    HostClock::Estimate e;
+    const bool valid = c->estimate(&e);
+    const jlong v[7] = {valid ? 1 : 0, e.offsetNs, (jlong)(e.skewPpm * 1000.0), e.minDelayNs,
+                        e.exchanges, e.trusted, e.restarts};
+    env->SetLongArrayRegion(out, 0, 7, v);
+    return valid ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
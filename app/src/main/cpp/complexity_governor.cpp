@@ -0,0 +1,78 @@
+#include "complexity_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+static int framesIn(double ms, double frameMs) {
+    return std::max(1, (int)std::lround(ms / frameMs));
+}
+
+ComplexityGovernor::ComplexityGovernor(const Config& cfg)
+    : cfg_(cfg),
+      targetUs_(cfg.frameMs * 1000.0 * cfg.targetShare),
+      window_(framesIn(cfg.windowMs, cfg.frameMs)),
+      evaluateEvery_(framesIn(cfg.evaluateMs, cfg.frameMs)),
+      raiseAfter_(framesIn(cfg.raiseAfterMs, cfg.frameMs)),
+      cooldown_(framesIn(cfg.cooldownMs, cfg.frameMs)),
+      complexity_(std::clamp(cfg.startComplexity, cfg.minComplexity, cfg.maxComplexity)),
+      ring_(window_, 0.0f),
+      sorted_(window_, 0.0f) {
+    metrics_.complexity = complexity_;
+}
+
+int ComplexityGovernor::onFrame(double encodeUs) {
+    ring_[next_] = (float)encodeUs;
+    next_ = next_ + 1 == window_ ? 0 : next_ + 1;
+    if (filled_ < window_) ++filled_;
+    ++frame_;
+    ++metrics_.samples;
+
+    if (++sinceEvaluate_ >= evaluateEvery_) {
+        sinceEvaluate_ = 0;
+        evaluate();
+    }
+    return complexity_;
+}
+
+void ComplexityGovernor::evaluate() {
+    // Only judge a setting on samples taken with it
+    const int64_t sinceChange = frame_ - lastChange_;
+    const int n = (int)std::min<int64_t>(filled_, sinceChange);
+    if (n < evaluateEvery_) return;
+
+    // Newest n samples, walking back from next_
+    for (int i = 0; i < n; ++i) {
+        const int idx = (next_ - 1 - i + window_) % window_;
+        sorted_[i] = ring_[idx];
+    }
+    auto at = [&](double q) {
+        const int k = std::min(n - 1, (int)(q * (n - 1) + 0.5));
+        std::nth_element(sorted_.begin(), sorted_.begin() + k, sorted_.begin() + n);
+        return (double)sorted_[k];
+    };
+    metrics_.p50Us = at(0.50);
+    const double p = at(cfg_.percentile);
+    metrics_.p95Us = p;
+    metrics_.p99Us = at(0.99);
+    metrics_.maxUs = *std::max_element(sorted_.begin(), sorted_.begin() + n);
+
+    int next = complexity_;
+    if (p > targetUs_) {
+        next -= p > targetUs_ * 1.5 ? 2 : 1;
+    } else if (p < targetUs_ * cfg_.raiseBelow && sinceChange >= raiseAfter_ &&
+               frame_ - lastLower_ >= cooldown_) {
+        next += 1;
+    }
+    next = std::clamp(next, cfg_.minComplexity, cfg_.maxComplexity);
+    if (next == complexity_) return;
+
+    if (next < complexity_) {
+        ++metrics_.lowers;
+        lastLower_ = frame_;
+    } else {
+        ++metrics_.raises;
+    }
+    complexity_ = next;
+    metrics_.complexity = next;
+    lastChange_ = frame_;
+}
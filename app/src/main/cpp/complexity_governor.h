@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Host-side encoder CPU governor: picks OPUS_SET_COMPLEXITY from measured encode time.
+//
+// Every frame's encode time (monotonic wall time of the slowest opus_encode, so
+// preemption by other apps counts) goes into a sliding window of the last windowMs of
+// audio. Every evaluateMs the window's p95 is compared with the target, a share of the
+// frame period:
+//   - over the target: complexity steps down at once (two steps when far over);
+//   - under raiseBelow of the target for raiseAfterMs since the last change, and no
+//     step down for cooldownMs: complexity steps up by one.
+// The gap between the two thresholds and the timers keep it from oscillating between
+// two settings whose costs straddle the target.
+//
+// Plain numbers in, complexity out; the caller applies it between encodes. Send thread only.
+class ComplexityGovernor {
+public:
+    struct Config {
+        double frameMs = 20;
+        double targetShare = 0.25;     // p95 encode time / frame period to hold
+        double raiseBelow = 0.6;       // of the target
+        double percentile = 0.95;
+        int minComplexity = 2;
+        int maxComplexity = 10;
+        int startComplexity = 5;
+        double windowMs = 2000;        // of audio
+        double evaluateMs = 500;
+        double raiseAfterMs = 5000;
+        double cooldownMs = 10000;     // after a step down, before any step up
+    };
+
+    // Encode-time distribution over the current window, microseconds
+    struct Metrics {
+        int complexity = 0;
+        double p50Us = 0;
+        double p95Us = 0;
+        double p99Us = 0;
+        double maxUs = 0;
+        int64_t samples = 0;           // total frames measured
+        int64_t lowers = 0;
+        int64_t raises = 0;
+    };
+
+    explicit ComplexityGovernor(const Config& cfg);
+
+    // Adds one frame's encode time. Returns the complexity to use from the next frame on.
+    int onFrame(double encodeUs);
+
+    int complexity() const { return complexity_; }
+    bool atFloor() const { return complexity_ <= cfg_.minComplexity; }
+    double targetUs() const { return targetUs_; }
+    const Metrics& metrics() const { return metrics_; }
+
+private:
+    void evaluate();
+
+    const Config cfg_;
+    const double targetUs_;
+    const int window_;        // frames
+    const int evaluateEvery_; // frames
+    const int raiseAfter_;    // frames
+    const int cooldown_;      // frames
+
+    int complexity_;
+    std::vector<float> ring_;
+    std::vector<float> sorted_;   // scratch for the percentiles
+    int filled_ = 0;
+    int next_ = 0;
+    int sinceEvaluate_ = 0;
+    int64_t frame_ = 0;
+    int64_t lastChange_ = 0;
+    int64_t lastLower_ = INT64_MIN / 2;
+    Metrics metrics_;
+};
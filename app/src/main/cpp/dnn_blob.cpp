@@ -0,0 +1,82 @@
+#include "dnn_blob.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <new>
+
+// The full DRED + PLC + OSCE model set is a few MB; anything far beyond is not a blob
+static constexpr off_t kMaxBytes = 64 << 20;
+
+// WeightHead: "DNNw", version, type, size, block_size, name[44]
+namespace {
+struct RecordHead {
+    char magic[4];
+    int32_t version;
+    int32_t type;
+    int32_t size;
+    int32_t blockSize;
+    char name[44];
+};
+static_assert(sizeof(RecordHead) == DnnBlob::kRecordBytes, "WeightHead layout");
+}
+
+DnnBlob* DnnBlob::load(const char* path, const char** error) {
+    const char* unused;
+    const char*& why = error ? *error : unused;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        why = "cannot open";
+        return nullptr;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > kMaxBytes) {
+        close(fd);
+        why = "bad size";
+        return nullptr;
+    }
+    // The mapping keeps the file alive: a newer blob renamed over it later does not
+    // disturb codecs still reading this one
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        why = "mmap failed";
+        return nullptr;
+    }
+
+    const auto* data = static_cast<const uint8_t*>(map);
+    const int size = (int)st.st_size;
+    const int records = validate(data, size);
+    DnnBlob* blob = records > 0 ? new (std::nothrow) DnnBlob(data, size, records) : nullptr;
+    if (!blob) {
+        munmap(map, (size_t)size);
+        why = records > 0 ? "out of memory" : "malformed blob";
+    }
+    return blob;
+}
+
+// The checks parse_record() makes on every OPUS_SET_DNN_BLOB, plus magic, version and
+// record alignment, so a truncated or foreign file is refused before any codec sees it
+int DnnBlob::validate(const uint8_t* data, int size) {
+    int records = 0;
+    int offset = 0;
+    while (offset < size) {
+        if (size - offset < kRecordBytes) return -1;
+        RecordHead h;
+        memcpy(&h, data + offset, sizeof h);
+        if (memcmp(h.magic, "DNNw", 4) != 0 || h.version != kRecordVersion) return -1;
+        if (h.size <= 0 || h.blockSize < h.size || h.blockSize % kRecordBytes != 0) return -1;
+        if (h.blockSize > size - offset - kRecordBytes) return -1;
+        if (h.name[sizeof h.name - 1] != 0) return -1;
+        offset += kRecordBytes + h.blockSize;
+        ++records;
+    }
+    return records;
+}
+
+DnnBlob::~DnnBlob() {
+    munmap(const_cast<uint8_t*>(data_), (size_t)size_);
+}
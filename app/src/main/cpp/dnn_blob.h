@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Opus DNN weights (the weights_blob.bin written by Opus' write_lpcnet_weights for the
+// model the bundled libopus was built against), mapped from a file at runtime.
+//
+// With WAVESYNCH_DRED the library is built with USE_WEIGHTS_FILE: the DRED encoder,
+// the DRED decoder and deep PLC get no compiled-in weights and each OpusEncoder /
+// OpusDecoder / OpusDREDDecoder is handed this blob through OPUS_SET_DNN_BLOB. Opus
+// parses it in place and keeps pointers into it, so it must outlive every codec it
+// was given to.
+//
+// The file is mapped read-only and validated once here: every record header is
+// walked, nothing else is read. Codecs then share the same clean, file-backed pages,
+// which the kernel faults in as layers first run and may drop again under memory
+// pressure, so weights cost no heap and only the parts in use count towards RSS.
+class DnnBlob {
+public:
+    // Record format of opus/dnn/nnet.h (WeightHead)
+    static constexpr int kRecordBytes = 64;       // WEIGHT_BLOCK_SIZE
+    static constexpr int kRecordVersion = 0;      // WEIGHT_BLOB_VERSION
+
+    // nullptr if the file cannot be mapped or is not a well-formed blob; `error`
+    // (may be null) then says why.
+    static DnnBlob* load(const char* path, const char** error = nullptr);
+    ~DnnBlob();
+
+    DnnBlob(const DnnBlob&) = delete;
+    DnnBlob& operator=(const DnnBlob&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    int size() const { return size_; }
+    int records() const { return records_; }
+
+private:
+    DnnBlob(const uint8_t* data, int size, int records)
+        : data_(data), size_(size), records_(records) {}
+
+    // Number of records, or -1 if the blob is malformed
+    static int validate(const uint8_t* data, int size);
+
+    const uint8_t* data_;
+    int size_;
+    int records_;
+};
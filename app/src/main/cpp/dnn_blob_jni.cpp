@@ -0,0 +1,39 @@
+#include <jni.h>
+#include <android/log.h>
+
+#include "dnn_blob.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_DNN_BLOB(ptr) reinterpret_cast<DnnBlob*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024DnnBlob_loadBlob(
+        JNIEnv* env, jobject /*thiz*/, jstring path) {
+    if (!path) return 0;
+    const char* p = env->GetStringUTFChars(path, nullptr);
+    if (!p) return 0;
+    const char* error = nullptr;
+    DnnBlob* blob = DnnBlob::load(p, &error);
+    if (!blob) LOGE("loadBlob: DNN weights %s: %s", p, error);
+    env->ReleaseStringUTFChars(path, p);
+    return reinterpret_cast<jlong>(blob);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024DnnBlob_destroyBlob(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_DNN_BLOB(pointer);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024DnnBlob_size(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    DnnBlob* b = GET_DNN_BLOB(pointer);
+    return b ? b->size() : 0;
+}
+
+} // extern "C"
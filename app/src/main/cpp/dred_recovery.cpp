@@ -0,0 +1,71 @@
+#include "dred_recovery.h"
+
+#include <opus.h>
+#include <algorithm>
+
+#include "jitter_buffer.h"
+
+DredRecovery::DredRecovery(int sampleRate) : sampleRate_(sampleRate) {
+    int err = 0;
+    // Both fail with OPUS_UNIMPLEMENTED when libopus was built without DRED
+    dredDec_ = opus_dred_decoder_create(&err);
+    if (err != OPUS_OK) dredDec_ = nullptr;
+    dred_ = opus_dred_alloc(&err);
+    if (err != OPUS_OK) dred_ = nullptr;
+}
+
+DredRecovery::~DredRecovery() {
+    if (dred_) opus_dred_free(dred_);
+    if (dredDec_) opus_dred_decoder_destroy(dredDec_);
+}
+
+int DredRecovery::loadWeights(const uint8_t* blob, int length) {
+    if (!dredDec_ || !dred_) return OPUS_UNIMPLEMENTED;
+    if (!blob || length <= 0) return OPUS_BAD_ARG;
+    const int rc = opus_dred_decoder_ctl(dredDec_, OPUS_SET_DNN_BLOB(blob, length));
+    loaded_ = rc == OPUS_OK;
+    sourceValid_ = false;
+    return rc;
+}
+
+int DredRecovery::recover(OpusDecoder* dec, JitterBuffer& jb, int32_t seq, int frameSize,
+                          int16_t* pcm) {
+    if (!loaded_ || !dec || frameSize <= 0) return 0;
+    ++stats_.attempts;
+
+    // The nearest packet after the gap: its redundancy is the freshest and reaches
+    // back over the whole gap with the fewest samples decoded
+    const int maxAhead = std::max(1, sampleRate_ / frameSize);
+    int32_t source = seq;
+    for (int k = 1; k <= maxAhead; ++k) {
+        const int32_t s = (int32_t)((uint32_t)seq + (uint32_t)k);
+        if (jb.contains(s)) {
+            source = s;
+            break;
+        }
+    }
+    if (source == seq) return 0;
+
+    // Samples between the start of the lost frame and the start of the source packet
+    const int offset = (int)((uint32_t)source - (uint32_t)seq) * frameSize;
+    if (!sourceValid_ || sourceSeq_ != source) {
+        const int n = jb.copyPayload(source, packet_, kMaxPacketBytes, false);
+        if (n <= 0) return 0;
+        // Only as much as this gap needs: the RDOVAE decode is the costly part
+        int dredEnd = 0;
+        const int rc = opus_dred_parse(dredDec_, dred_, packet_, n, std::min(offset, sampleRate_),
+                                       sampleRate_, &dredEnd, 0);
+        ++stats_.parses;
+        sourceValid_ = true;
+        sourceSeq_ = source;
+        available_ = rc > 0 ? rc : 0;
+    }
+    if (available_ < offset) {
+        ++stats_.uncovered;
+        return 0;
+    }
+
+    const int n = opus_decoder_dred_decode(dec, dred_, offset, pcm, frameSize);
+    if (n > 0) ++stats_.recovered;
+    return n;
+}
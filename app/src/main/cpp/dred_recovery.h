@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+class JitterBuffer;
+struct OpusDecoder;
+struct OpusDREDDecoder;
+struct OpusDRED;
+
+// Guest-side Deep REDundancy (DRED, Opus 1.5): every packet of a host encoding with
+// OPUS_SET_DRED_DURATION carries a compressed history of the audio before it. When a
+// frame is lost and in-band FEC (which only covers the single frame before a packet)
+// cannot help, the first packet buffered after the gap is parsed and the lost frame
+// is synthesized from its redundancy, so a burst of several frames plays back as a
+// low-rate rendition of the real signal instead of extrapolated concealment.
+//
+// One parse serves a whole gap: the source packet's redundancy is kept until recovery
+// moves to another packet. Playout thread only, next to its OpusDecoder.
+class DredRecovery {
+public:
+    struct Stats {
+        int64_t attempts = 0;    // lost frames asked for
+        int64_t recovered = 0;   // synthesized from DRED
+        int64_t parses = 0;      // source packets parsed
+        int64_t uncovered = 0;   // a later packet was buffered but its DRED did not reach back
+    };
+
+    // sampleRate is the decoder's; frames further than a second from the next
+    // buffered packet are never searched.
+    explicit DredRecovery(int sampleRate);
+    ~DredRecovery();
+
+    DredRecovery(const DredRecovery&) = delete;
+    DredRecovery& operator=(const DredRecovery&) = delete;
+
+    // Hands the DRED decoder its weights (see DnnBlob); blob must outlive this object.
+    // Returns OPUS_OK, or an Opus error: OPUS_UNIMPLEMENTED when libopus has no DRED.
+    int loadWeights(const uint8_t* blob, int length);
+    bool ok() const { return loaded_; }
+
+    // Decodes lost frame `seq` (frameSize samples per channel) into pcm through dec,
+    // from the DRED of the first packet buffered after it; that packet stays buffered.
+    // Returns samples per channel, 0 if no buffered packet covers seq, or an Opus error.
+    int recover(OpusDecoder* dec, JitterBuffer& jb, int32_t seq, int frameSize, int16_t* pcm);
+
+    // Forgets the parsed packet (decoder reset or resync)
+    void reset() { sourceValid_ = false; }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    static constexpr int kMaxPacketBytes = 1500;
+
+    const int sampleRate_;
+    OpusDREDDecoder* dredDec_ = nullptr;
+    OpusDRED* dred_ = nullptr;
+    bool loaded_ = false;
+
+    bool sourceValid_ = false;
+    int32_t sourceSeq_ = 0;
+    int available_ = 0;          // samples of redundancy before the source packet
+    Stats stats_;
+
+    uint8_t packet_[kMaxPacketBytes];
+};
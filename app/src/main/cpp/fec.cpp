@@ -0,0 +1,374 @@
+#include "fec.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// =========================
+// GF(256) tables
+// =========================
+namespace {
+
+struct Tables {
+    uint8_t exp[512];
+    uint8_t log[256];
+    // c * x for x = low nibble / high nibble, per constant c (split-nibble lookup)
+    alignas(16) uint8_t lo[256][16];
+    alignas(16) uint8_t hi[256][16];
+};
+
+Tables buildTables() {
+    Tables t{};
+    unsigned x = 1;
+    for (int i = 0; i < 255; ++i) {
+        t.exp[i] = (uint8_t)x;
+        t.log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11d;
+    }
+    for (int i = 255; i < 512; ++i) t.exp[i] = t.exp[i - 255];
+
+    auto mul = [&t](int a, int b) -> uint8_t {
+        if (a == 0 || b == 0) return 0;
+        return t.exp[t.log[a] + t.log[b]];
+    };
+    for (int c = 0; c < 256; ++c) {
+        for (int n = 0; n < 16; ++n) {
+            t.lo[c][n] = mul(c, n);
+            t.hi[c][n] = mul(c, n << 4);
+        }
+    }
+    return t;
+}
+
+const Tables& tables() {
+    static const Tables t = buildTables();
+    return t;
+}
+
+} // namespace
+
+namespace gf256 {
+
+uint8_t mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+    const Tables& t = tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+uint8_t inv(uint8_t a) {
+    const Tables& t = tables();
+    return t.exp[255 - t.log[a]];
+}
+
+void xorInto(uint8_t* dst, const uint8_t* src, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, s));
+    }
+#endif
+    for (; i < n; ++i) dst[i] ^= src[i];
+}
+
+void mulAddInto(uint8_t* dst, const uint8_t* src, uint8_t c, int n) {
+    if (c == 0) return;
+    if (c == 1) {
+        xorInto(dst, src, n);
+        return;
+    }
+    const Tables& t = tables();
+    const uint8_t* lo = t.lo[c];
+    const uint8_t* hi = t.hi[c];
+
+    int i = 0;
+#if defined(__aarch64__)
+    const uint8x16_t tlo = vld1q_u8(lo);
+    const uint8x16_t thi = vld1q_u8(hi);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t s = vld1q_u8(src + i);
+        const uint8x16_t p = veorq_u8(vqtbl1q_u8(tlo, vandq_u8(s, mask)),
+                                      vqtbl1q_u8(thi, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+    }
+#elif defined(__SSSE3__)
+    const __m128i tlo = _mm_load_si128(reinterpret_cast<const __m128i*>(lo));
+    const __m128i thi = _mm_load_si128(reinterpret_cast<const __m128i*>(hi));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (; i + 16 <= n; i += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i p = _mm_xor_si128(
+                _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask)),
+                _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, p));
+    }
+#endif
+    for (; i < n; ++i) dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+
+} // namespace gf256
+
+namespace wsfec {
+
+uint8_t coefficient(int scheme, int j, int i) {
+    if (scheme == kXor) return 1;
+    // Cauchy: x_j = kMaxK + j, y_i = i are all distinct, so every square
+    // submatrix is invertible (any m losses are recoverable)
+    return gf256::inv((uint8_t)((kMaxK + j) ^ i));
+}
+
+} // namespace wsfec
+
+// =========================
+// Encoder
+// =========================
+FecEncoder::FecEncoder()
+    : acc_((size_t)wsfec::kMaxM * wsfec::kMaxBlock),
+      done_((size_t)2 * wsfec::kMaxM * kSlot) {}
+
+bool FecEncoder::configure(int scheme, int k, int m) {
+    const bool ok = (scheme == wsfec::kXor && m == 1) ||
+                    (scheme == wsfec::kReedSolomon && m >= 1 && m <= wsfec::kMaxM);
+    if (!ok || k < 2 || k > wsfec::kMaxK || m > k) {
+        disable();
+        return false;
+    }
+    scheme_ = scheme;
+    k_ = k;
+    m_ = m;
+    count_ = 0;
+    doneCount_ = doneNext_ = 0;
+    return true;
+}
+
+void FecEncoder::startGroup(int32_t seq) {
+    base_ = seq;
+    count_ = 0;
+    blockLen_ = 0;
+    std::memset(acc_.data(), 0, (size_t)m_ * wsfec::kMaxBlock);
+}
+
+void FecEncoder::finishGroup() {
+    const int bank = doneBank_ ^ 1;
+    for (int j = 0; j < m_; ++j) {
+        uint8_t* p = doneSlot(bank, j);
+        p[0] = wspacket::kMagic0;
+        p[1] = wsfec::kMagic1;
+        p[2] = wspacket::kVersion;
+        p[3] = (uint8_t)scheme_;
+        wspacket::putIntBE(p + 4, base_);
+        p[8] = (uint8_t)k_;
+        p[9] = (uint8_t)m_;
+        p[10] = (uint8_t)j;
+        p[11] = 0;
+        std::memcpy(p + wsfec::kHeaderSize, acc_.data() + (size_t)j * wsfec::kMaxBlock,
+                    (size_t)blockLen_);
+    }
+    doneBank_ = bank;
+    doneCount_ = m_;
+    doneNext_ = 0;
+    doneLen_ = wsfec::kHeaderSize + blockLen_;
+    count_ = 0;
+}
+
+bool FecEncoder::addMedia(const uint8_t* datagram, int length) {
+    ready_ = nullptr;
+    wspacket::Header h{};
+    if (k_ == 0 || length + 2 > wsfec::kMaxBlock || !wspacket::parseHeader(datagram, length, &h)) {
+        return false;
+    }
+
+    // Groups are runs of consecutive seqs; anything else starts a new one
+    if (count_ == 0 || h.seq != (int32_t)((uint32_t)base_ + (uint32_t)count_)) startGroup(h.seq);
+
+    const int blk = 2 + length;
+    block_[0] = (uint8_t)(length >> 8);
+    block_[1] = (uint8_t)length;
+    std::memcpy(block_ + 2, datagram, (size_t)length);
+    if (blk > blockLen_) blockLen_ = blk;
+
+    for (int j = 0; j < m_; ++j) {
+        gf256::mulAddInto(acc_.data() + (size_t)j * wsfec::kMaxBlock, block_,
+                          wsfec::coefficient(scheme_, j, count_), blk);
+    }
+
+    // One parity of the previous group rides behind this media datagram
+    if (doneNext_ < doneCount_) {
+        ready_ = doneSlot(doneBank_, doneNext_++);
+        readyLen_ = doneLen_;
+    }
+    if (++count_ == k_) finishGroup();   // fills the other bank
+    return ready_ != nullptr;
+}
+
+// =========================
+// Decoder
+// =========================
+FecDecoder::FecDecoder()
+    : media_((size_t)kHistory * wsfec::kMaxBlock),
+      rebuilt_((size_t)wsfec::kMaxM * wsfec::kMaxBlock),
+      syndrome_((size_t)wsfec::kMaxM * wsfec::kMaxBlock) {
+    for (int i = 0; i < kHistory; ++i) {
+        mediaSeq_[i] = 0;
+        mediaLen_[i] = 0;   // 0 = empty
+    }
+    for (Group& g : groups_) g.parity.resize((size_t)wsfec::kMaxM * wsfec::kMaxBlock);
+}
+
+void FecDecoder::onMedia(int32_t seq, const uint8_t* datagram, int length) {
+    if ((int64_t)seq - (int64_t)highest_ > 0 || !active_) highest_ = seq;
+    if (!active_ || length <= 0 || length + 2 > wsfec::kMaxBlock) return;
+    const int idx = (int)((uint32_t)seq & (kHistory - 1));
+    mediaSeq_[idx] = seq;
+    mediaLen_[idx] = length;
+    uint8_t* dst = media_.data() + (size_t)idx * wsfec::kMaxBlock;
+    std::memcpy(dst, datagram, (size_t)length);
+    // Parity covers the datagram as first sent, before any resend marking
+    dst[3] = (uint8_t)(dst[3] & ~wspacket::kFlagRetransmit);
+}
+
+bool FecDecoder::hasMedia(int32_t seq) const {
+    const int idx = (int)((uint32_t)seq & (kHistory - 1));
+    return mediaLen_[idx] > 0 && mediaSeq_[idx] == seq;
+}
+
+int FecDecoder::buildBlock(int32_t seq, uint8_t* dst, int blockLen) const {
+    const int idx = (int)((uint32_t)seq & (kHistory - 1));
+    const int len = mediaLen_[idx];
+    if (len + 2 > blockLen) return -1;
+    dst[0] = (uint8_t)(len >> 8);
+    dst[1] = (uint8_t)len;
+    std::memcpy(dst + 2, media_.data() + (size_t)idx * wsfec::kMaxBlock, (size_t)len);
+    std::memset(dst + 2 + len, 0, (size_t)(blockLen - 2 - len));
+    return blockLen;
+}
+
+bool FecDecoder::onParity(const uint8_t* datagram, int length) {
+    if (!wsfec::isParity(datagram, length)) return false;
+    const int scheme = datagram[3];
+    const int32_t base = wspacket::getIntBE(datagram + 4);
+    const int k = datagram[8];
+    const int m = datagram[9];
+    const int j = datagram[10];
+    const int blockLen = length - wsfec::kHeaderSize;
+    if ((scheme != wsfec::kXor && scheme != wsfec::kReedSolomon) || k < 2 || k > wsfec::kMaxK ||
+        m < 1 || m > wsfec::kMaxM || m > k || j >= m || blockLen < 2 + wspacket::kHeaderSize ||
+        blockLen > wsfec::kMaxBlock) {
+        return false;
+    }
+    active_ = true;   // start keeping media from now on
+
+    Group* g = nullptr;
+    Group* victim = &groups_[0];
+    for (Group& c : groups_) {
+        if (c.used && c.base == base && c.k == k && c.m == m && c.scheme == scheme) {
+            g = &c;
+            break;
+        }
+        if (!c.used) victim = &c;
+        else if (victim->used && (int64_t)c.base - (int64_t)victim->base < 0) victim = &c;
+    }
+    if (!g) {
+        if (victim->used) ++stats_.unrecoverable;
+        g = victim;
+        g->used = true;
+        g->scheme = scheme;
+        g->base = base;
+        g->k = k;
+        g->m = m;
+        g->blockLen = blockLen;
+        g->have = 0;
+    }
+    if (blockLen != g->blockLen) return false;
+
+    std::memcpy(g->parity.data() + (size_t)j * wsfec::kMaxBlock, datagram + wsfec::kHeaderSize,
+                (size_t)blockLen);
+    g->have |= 1u << j;
+    ++stats_.parity;
+    return true;
+}
+
+int FecDecoder::decode(Group& g, const int32_t* missing, int e) {
+    const int L = g.blockLen;
+
+    // Use the first e parity rows held
+    int rows[wsfec::kMaxM];
+    int r = 0;
+    for (int j = 0; j < g.m && r < e; ++j) {
+        if (g.have & (1u << j)) rows[r++] = j;
+    }
+
+    // Syndromes: parity minus the contribution of every media datagram present
+    uint8_t* s = syndrome_.data();
+    for (int a = 0; a < e; ++a) {
+        std::memcpy(&s[(size_t)a * L], g.parity.data() + (size_t)rows[a] * wsfec::kMaxBlock,
+                    (size_t)L);
+    }
+    for (int i = 0; i < g.k; ++i) {
+        const int32_t seq = (int32_t)((uint32_t)g.base + (uint32_t)i);
+        if (!hasMedia(seq)) continue;
+        if (buildBlock(seq, block_, L) < 0) return 0;
+        for (int a = 0; a < e; ++a) {
+            gf256::mulAddInto(&s[(size_t)a * L], block_, wsfec::coefficient(g.scheme, rows[a], i), L);
+        }
+    }
+
+    // Invert the e x e submatrix A[a][b] = C[rows[a]][missing index b] (Gauss-Jordan)
+    uint8_t A[wsfec::kMaxM][wsfec::kMaxM];
+    uint8_t Inv[wsfec::kMaxM][wsfec::kMaxM];
+    for (int a = 0; a < e; ++a) {
+        for (int b = 0; b < e; ++b) {
+            const int col = (int)((uint32_t)missing[b] - (uint32_t)g.base);
+            A[a][b] = wsfec::coefficient(g.scheme, rows[a], col);
+            Inv[a][b] = (uint8_t)(a == b);
+        }
+    }
+    for (int c = 0; c < e; ++c) {
+        int p = c;
+        while (p < e && A[p][c] == 0) ++p;
+        if (p == e) return 0;   // singular (XOR with e > 1 never gets here)
+        if (p != c) {
+            for (int b = 0; b < e; ++b) {
+                std::swap(A[p][b], A[c][b]);
+                std::swap(Inv[p][b], Inv[c][b]);
+            }
+        }
+        const uint8_t f = gf256::inv(A[c][c]);
+        for (int b = 0; b < e; ++b) {
+            A[c][b] = gf256::mul(A[c][b], f);
+            Inv[c][b] = gf256::mul(Inv[c][b], f);
+        }
+        for (int a = 0; a < e; ++a) {
+            if (a == c || A[a][c] == 0) continue;
+            const uint8_t g2 = A[a][c];
+            for (int b = 0; b < e; ++b) {
+                A[a][b] ^= gf256::mul(g2, A[c][b]);
+                Inv[a][b] ^= gf256::mul(g2, Inv[c][b]);
+            }
+        }
+    }
+
+    // missing block b = sum_a Inv[b][a] * s_a
+    for (int b = 0; b < e; ++b) {
+        uint8_t* out = rebuilt_.data() + (size_t)b * wsfec::kMaxBlock;
+        std::memset(out, 0, (size_t)L);
+        for (int a = 0; a < e; ++a) gf256::mulAddInto(out, &s[(size_t)a * L], Inv[b][a], L);
+    }
+    return e;
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packet_codec.h"
+
+// GF(2^8) arithmetic (polynomial 0x11d) and the bulk kernels used by the FEC codes.
+// mulAddInto uses split-nibble table lookups: 16-byte shuffles on AArch64 NEON
+// (vqtbl1q_u8) and SSSE3 (pshufb), a scalar table walk elsewhere.
+namespace gf256 {
+
+uint8_t mul(uint8_t a, uint8_t b);
+uint8_t inv(uint8_t a);   // a != 0
+
+// dst[i] ^= src[i]
+void xorInto(uint8_t* dst, const uint8_t* src, int n);
+
+// dst[i] ^= c * src[i]
+void mulAddInto(uint8_t* dst, const uint8_t* src, uint8_t c, int n);
+
+} // namespace gf256
+
+// Transport FEC over groups of K consecutive media datagrams.
+//
+// Each media datagram is protected as a block [len (u16 BE)][datagram bytes],
+// zero-padded to the longest block L of the group. Parity datagram j carries
+// sum_i C[j][i] * block_i:
+//   - kXor:          C = 1, one parity (m == 1), recovers any single loss;
+//   - kReedSolomon:  Cauchy matrix C[j][i] = 1 / (x_j + y_i), recovers any m losses.
+//
+// Parity datagram (PacketCodec version byte):
+// [0]  'W'
+// [1]  'F'
+// [2]  version
+// [3]  scheme
+// [4..7]  base seq (first media seq of the group, BE)
+// [8]  k
+// [9]  m
+// [10] parity index
+// [11] reserved (0)
+// [12..]  parity block (L bytes)
+namespace wsfec {
+
+static constexpr uint8_t kMagic1 = 'F';
+static constexpr int kHeaderSize = 12;
+static constexpr int kMaxK = 16;
+static constexpr int kMaxM = 4;
+static constexpr int kMaxBlock = 2 + 1500;   // length prefix + largest datagram
+
+enum Scheme : int { kXor = 0, kReedSolomon = 1 };
+
+inline bool isParity(const uint8_t* in, int length) {
+    return length >= kHeaderSize && in[0] == wspacket::kMagic0 && in[1] == kMagic1 &&
+           in[2] == wspacket::kVersion;
+}
+
+// Coefficient of media i in parity j.
+uint8_t coefficient(int scheme, int j, int i);
+
+} // namespace wsfec
+
+// Host side: accumulates parity while media datagrams are sent. Send thread only.
+//
+// A finished group's m parity datagrams are paced out one per following media
+// datagram instead of back to back, so the burst that took the media out does
+// not take the parity with it (m <= k keeps one group's parity ahead of the next).
+class FecEncoder {
+public:
+    FecEncoder();
+
+    // Returns false (and disables FEC) for an invalid combination.
+    bool configure(int scheme, int k, int m);
+    void disable() { k_ = 0; }
+    bool enabled() const { return k_ > 0; }
+
+    // Feeds one media datagram. Returns true if a parity datagram is due to be
+    // sent right after it; read it with parity() / parityLength().
+    bool addMedia(const uint8_t* datagram, int length);
+
+    const uint8_t* parity() const { return ready_; }
+    int parityLength() const { return readyLen_; }
+
+private:
+    static constexpr int kSlot = wsfec::kHeaderSize + wsfec::kMaxBlock;
+
+    void startGroup(int32_t seq);
+    void finishGroup();
+    uint8_t* doneSlot(int bank, int j) {
+        return done_.data() + ((size_t)bank * wsfec::kMaxM + j) * kSlot;
+    }
+
+    int scheme_ = wsfec::kXor;
+    int k_ = 0;
+    int m_ = 0;
+
+    int32_t base_ = 0;
+    int count_ = 0;
+    int blockLen_ = 0;
+    std::vector<uint8_t> acc_;    // m accumulators for the group being sent
+
+    // Finished parity, double-buffered so the datagram handed out stays valid
+    std::vector<uint8_t> done_;
+    int doneBank_ = 0;
+    int doneCount_ = 0;
+    int doneNext_ = 0;
+    int doneLen_ = 0;
+    const uint8_t* ready_ = nullptr;
+    int readyLen_ = 0;
+
+    uint8_t block_[wsfec::kMaxBlock];
+};
+
+// Guest side: keeps recent media and pending parity, rebuilds missing media
+// datagrams when a group has enough pieces. rx thread only.
+class FecDecoder {
+public:
+    struct Stats {
+        int64_t parity = 0;         // parity datagrams accepted
+        int64_t recovered = 0;      // media datagrams rebuilt
+        int64_t unrecoverable = 0;  // groups dropped with media still missing
+    };
+
+    FecDecoder();
+
+    void onMedia(int32_t seq, const uint8_t* datagram, int length);
+
+    // Returns false if the datagram is not a usable parity datagram.
+    bool onParity(const uint8_t* datagram, int length);
+
+    // Rebuilds every group that can be completed; emit(datagram, length) is called
+    // for each recovered media datagram. Returns the number recovered.
+    template <typename Emit>
+    int recover(Emit emit);
+
+    bool active() const { return active_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    static constexpr int kHistory = 64;   // media kept, power of two
+    static constexpr int kMaxGroups = 8;
+
+    struct Group {
+        bool used = false;
+        int scheme = 0;
+        int32_t base = 0;
+        int k = 0;
+        int m = 0;
+        int blockLen = 0;
+        uint32_t have = 0;     // parity indexes held
+        std::vector<uint8_t> parity;   // kMaxM blocks of kMaxBlock
+    };
+
+    bool hasMedia(int32_t seq) const;
+    int buildBlock(int32_t seq, uint8_t* dst, int blockLen) const;
+    int decode(Group& g, const int32_t* missing, int e);
+
+    bool active_ = false;
+    int32_t highest_ = 0;
+    int32_t mediaSeq_[kHistory];
+    int mediaLen_[kHistory];
+    std::vector<uint8_t> media_;
+    Group groups_[kMaxGroups];
+    Stats stats_;
+
+    // decode scratch
+    std::vector<uint8_t> rebuilt_;    // kMaxM blocks
+    std::vector<uint8_t> syndrome_;   // e blocks of blockLen, packed
+    uint8_t block_[wsfec::kMaxBlock];
+};
+
+template <typename Emit>
+int FecDecoder::recover(Emit emit) {
+    int total = 0;
+    for (Group& g : groups_) {
+        if (!g.used) continue;
+
+        int32_t missing[wsfec::kMaxK];
+        int e = 0;
+        for (int i = 0; i < g.k; ++i) {
+            const int32_t seq = (int32_t)((uint32_t)g.base + (uint32_t)i);
+            if (!hasMedia(seq)) missing[e++] = seq;
+        }
+        if (e == 0) {
+            g.used = false;
+            continue;
+        }
+
+        int held = 0;
+        for (int j = 0; j < g.m; ++j) held += (g.have >> j) & 1u;
+        if (e > held) {
+            // Too far behind the newest media to ever complete
+            if ((int64_t)highest_ - (int64_t)g.base >= kHistory - wsfec::kMaxK) {
+                g.used = false;
+                ++stats_.unrecoverable;
+            }
+            continue;
+        }
+
+        const int n = decode(g, missing, e);
+        for (int b = 0; b < n; ++b) {
+            const uint8_t* blk = rebuilt_.data() + (size_t)b * wsfec::kMaxBlock;
+            const int len = (blk[0] << 8) | blk[1];
+            if (len <= 0 || len > g.blockLen - 2) continue;
+            wspacket::Header h{};
+            if (!wspacket::parseHeader(blk + 2, len, &h) || h.seq != missing[b]) continue;
+            onMedia(h.seq, blk + 2, len);
+            emit(blk + 2, len);
+            ++stats_.recovered;
+            ++total;
+        }
+        g.used = false;
+    }
+    return total;
+}
@@ -0,0 +1,117 @@
+#include "frame_aggregator.h"
+
+#include <cstring>
+
+#include <opus.h>
+
+using wspacket::kHeaderSize;
+
+// Aggregate datagram bound: header, TOC and frame count byte, then per frame its bytes
+// and up to two length bytes. A held datagram's payload counts its own TOC, so each
+// frame adds payloadLen + 1.
+static constexpr int kBaseBytes = kHeaderSize + 2;
+
+namespace wsaggregate {
+
+int parse(const uint8_t* datagram, int length, Frames* out) {
+    if (!wspacket::parseHeader(datagram, length, &out->header)) return -1;
+    if (!(out->header.flags & wspacket::kFlagAggregate) || out->header.payloadLen <= 0) return -1;
+    const uint8_t* packet = datagram + kHeaderSize;
+    int offset = 0;
+    const int n = opus_packet_parse(packet, out->header.payloadLen, &out->toc, out->data,
+                                    out->size, &offset);
+    if (n <= 0) return -1;
+    out->count = n;
+    out->ticks = opus_packet_get_samples_per_frame(packet, wspacket::kPtsRate);
+    return n;
+}
+
+int frameDatagram(const Frames& f, int i, uint8_t* out) {
+    wspacket::writeHeader(out, (int32_t)((uint32_t)f.header.seq + (uint32_t)i),
+                          f.header.pts + (uint32_t)(i * f.ticks),
+                          f.header.flags & ~wspacket::kFlagAggregate);
+    out[kHeaderSize] = (uint8_t)(f.toc & 0xFC);   // code 0: one frame
+    if (f.size[i] > 0) memcpy(out + kHeaderSize + 1, f.data[i], (size_t)f.size[i]);
+    return kHeaderSize + 1 + f.size[i];
+}
+
+} // namespace wsaggregate
+
+FrameAggregator::FrameAggregator() : rp_(opus_repacketizer_create()) {}
+
+FrameAggregator::~FrameAggregator() {
+    if (rp_) opus_repacketizer_destroy(rp_);
+}
+
+void FrameAggregator::setFrames(int frames) {
+    frames_ = frames < 1 ? 1 : (frames > wsaggregate::kMaxFrames ? wsaggregate::kMaxFrames : frames);
+    count_ = 0;
+}
+
+int FrameAggregator::add(const uint8_t* datagram, int length) {
+    wspacket::Header h{};
+    // Not a datagram this host produced
+    if (length > kMaxBytes || !wspacket::parseHeader(datagram, length, &h)) return 0;
+
+    if (count_ > 0 && join(h, datagram, length)) {
+        return count_ < frames_ ? 0 : flush();
+    }
+    const int ready = flush();
+    hold(h, datagram, length);
+    if (ready > 0) return ready;
+    return count_ < frames_ ? 0 : flush();
+}
+
+int FrameAggregator::flush() {
+    if (count_ == 0) return 0;
+    int length;
+    if (count_ == 1) {
+        memcpy(out_, held_[0], (size_t)heldLen_[0]);
+        length = heldLen_[0];
+    } else {
+        memcpy(out_, held_[0], kHeaderSize);
+        out_[3] = (uint8_t)(out_[3] | wspacket::kFlagAggregate);
+        // Cannot run short: join() kept bytes_ within kMaxBytes
+        const int n = opus_repacketizer_out(rp_, out_ + kHeaderSize, kMaxBytes - kHeaderSize);
+        length = n > 0 ? kHeaderSize + n : 0;
+    }
+    count_ = 0;
+    return length;
+}
+
+void FrameAggregator::hold(const wspacket::Header& h, const uint8_t* datagram, int length) {
+    memcpy(held_[0], datagram, (size_t)length);
+    heldLen_[0] = length;
+    count_ = 1;
+    lastSeq_ = h.seq;
+    lastPts_ = h.pts;
+    bytes_ = kBaseBytes + h.payloadLen + 1;
+
+    // Only a single-frame packet can be split back into the same datagram on the guest
+    joinable_ = false;
+    if (!rp_ || frames_ < 2 || h.payloadLen <= 0 || (held_[0][kHeaderSize] & 0x3) != 0) return;
+    opus_repacketizer_init(rp_);
+    ticks_ = opus_packet_get_samples_per_frame(held_[0] + kHeaderSize, wspacket::kPtsRate);
+    joinable_ = opus_repacketizer_cat(rp_, held_[0] + kHeaderSize, h.payloadLen) == OPUS_OK;
+}
+
+bool FrameAggregator::join(const wspacket::Header& h, const uint8_t* datagram, int length) {
+    // The guest rebuilds seq and pts from the first frame: both must run on exactly
+    if (!joinable_ || h.seq != (int32_t)((uint32_t)lastSeq_ + 1u) ||
+        h.pts != lastPts_ + (uint32_t)ticks_ || h.flags != held_[0][3]) {
+        return false;
+    }
+    if (h.payloadLen <= 0 || (datagram[kHeaderSize] & 0x3) != 0) return false;
+    if (bytes_ + h.payloadLen + 1 > kMaxBytes) return false;
+
+    uint8_t* copy = held_[count_];
+    memcpy(copy, datagram, (size_t)length);
+    // Fails (and leaves rp_ as it was) on a different TOC configuration
+    if (opus_repacketizer_cat(rp_, copy + kHeaderSize, h.payloadLen) != OPUS_OK) return false;
+
+    heldLen_[count_++] = length;
+    lastSeq_ = h.seq;
+    lastPts_ = h.pts;
+    bytes_ += h.payloadLen + 1;
+    return true;
+}
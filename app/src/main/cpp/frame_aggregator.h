@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+#include "packet_codec.h"
+
+struct OpusRepacketizer;
+
+// Packet aggregation: up to kMaxFrames consecutive frames of one stream in a single
+// datagram, as one multi-frame Opus packet (RFC 6716 code 1-3), so a 20 ms stream
+// costs a third of the datagrams and their per-packet airtime on a busy hotspot.
+//
+// An aggregate datagram carries the PacketCodec header of its first frame with
+// kFlagAggregate set. Frame i of it is seq + i and starts at pts + i * its samples (at
+// kPtsRate). Only single-frame (code 0) packets are aggregated, so splitting gives back
+// the exact per-frame datagrams the host cached and fed to FEC: resends and parity
+// stay per frame, and a guest handles the split frames like any others.
+namespace wsaggregate {
+
+static constexpr int kMaxFrames = 3;
+static constexpr int kMaxOpusFrames = 48;   // per Opus packet (opus_packet_parse)
+
+struct Frames {
+    wspacket::Header header;       // of the datagram: first frame's seq / pts
+    uint8_t toc = 0;
+    int count = 0;
+    int ticks = 0;                 // per frame, kPtsRate
+    const uint8_t* data[kMaxOpusFrames];
+    int16_t size[kMaxOpusFrames];
+};
+
+// Parses an aggregate datagram; the frame pointers point into it. Returns the frame
+// count, or -1 if it is not a valid aggregate.
+int parse(const uint8_t* datagram, int length, Frames* out);
+
+// Writes the single-frame datagram of frame i to out (kHeaderSize + 1 + size[i] bytes).
+// Returns its length.
+int frameDatagram(const Frames& f, int i, uint8_t* out);
+
+} // namespace wsaggregate
+
+// Host side, one per stream (simulcast tier): collects the datagrams of consecutive
+// frames and hands out one aggregate per frames() of them. A frame that cannot join the
+// held ones (a TOC change, a gap in seq, a datagram that would outgrow kMaxBytes) sends
+// them out early and starts the next aggregate. A lone frame goes out unchanged.
+// Send thread only.
+class FrameAggregator {
+public:
+    static constexpr int kMaxBytes = 1500;
+
+    FrameAggregator();
+    ~FrameAggregator();
+
+    FrameAggregator(const FrameAggregator&) = delete;
+    FrameAggregator& operator=(const FrameAggregator&) = delete;
+
+    bool ok() const { return rp_ != nullptr; }
+
+    // 1 .. kMaxFrames; 1 turns aggregation off. Frames held are dropped, flush() first.
+    void setFrames(int frames);
+    int frames() const { return frames_; }
+
+    // Takes the PacketCodec datagram of the next frame (at most kMaxBytes). Returns the
+    // length of a datagram now ready in datagram(), or 0 if the frame is held.
+    int add(const uint8_t* datagram, int length);
+
+    // Readies whatever is held. Returns its length, 0 if nothing was held.
+    int flush();
+
+    const uint8_t* datagram() const { return out_; }
+    int held() const { return count_; }
+
+private:
+    bool join(const wspacket::Header& h, const uint8_t* datagram, int length);
+    void hold(const wspacket::Header& h, const uint8_t* datagram, int length);
+
+    OpusRepacketizer* rp_ = nullptr;
+    int frames_ = 1;
+
+    int count_ = 0;                // frames held
+    bool joinable_ = false;        // the held frames are in rp_
+    int32_t lastSeq_ = 0;
+    uint32_t lastPts_ = 0;
+    int ticks_ = 0;                // per held frame, kPtsRate
+    int bytes_ = 0;                // bound on the aggregate datagram so far
+    uint8_t held_[wsaggregate::kMaxFrames][kMaxBytes];
+    int heldLen_[wsaggregate::kMaxFrames] = {};
+
+    uint8_t out_[kMaxBytes];
+};
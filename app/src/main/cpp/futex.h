@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Minimal futex wrappers for the native SPSC structures. Waiters sleep in the
+// kernel on a 32-bit sequence word instead of spinning or taking a monitor.
+namespace futex {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex word must be a plain 32-bit integer");
+
+// Sleeps while *word == expected, for at most timeoutNs. Spurious wakeups are possible.
+inline void wait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeoutNs) {
+    if (timeoutNs <= 0) return;
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(timeoutNs / 1000000000LL);
+    ts.tv_nsec = static_cast<long>(timeoutNs % 1000000000LL);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, &ts,
+            nullptr, 0);
+}
+
+inline void wakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+            nullptr, 0);
+}
+
+inline int64_t monotonicNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace futex
@@ -0,0 +1,285 @@
+#include "host_pipeline.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "futex.h"
+#include "packet_codec.h"
+
+// Per-frame smoothing of the stage latencies
+static constexpr double kSmoothing = 0.05;
+
+HostPipeline::HostPipeline(const Config& cfg)
+    : cfg_(cfg),
+      encoder_(cfg.encoder),
+      ring_(cfg.ringFrames, cfg.encoder.frameSize * cfg.encoder.channels),
+      assembly_((size_t)cfg.encoder.frameSize * cfg.encoder.channels, 0),
+      mediaClock_((int)((int64_t)cfg.encoder.frameSize * wspacket::kPtsRate /
+                        (cfg.encoder.sampleRate > 0 ? cfg.encoder.sampleRate : wspacket::kPtsRate))) {
+    if (!ok()) return;
+    if (cfg_.retransmitFrames > 0 && sender_.enableRetransmit(cfg_.retransmitFrames, cfg_.port) &&
+        cfg_.minBitrate > 0) {
+        sender_.enableRateControl(cfg_.minBitrate, cfg_.maxBitrate, cfg_.encoder.tiers);
+    }
+    for (int t = 0; t < cfg_.encoder.tiers; ++t) {
+        sender_.setFec(t, cfg_.fec[t].scheme, cfg_.fec[t].k, cfg_.fec[t].m);
+    }
+    sender_.setAggregation(aggregationFor(cfg_.aggregateFrames));
+}
+
+// Longer frames are multi-frame Opus packets already and would cost too much latency
+int HostPipeline::aggregationFor(int frames) const {
+    const SimulcastEncoder::Config& e = cfg_.encoder;
+    if ((int64_t)e.frameSize * 50 > e.sampleRate) return 1;
+    return std::max(1, std::min(frames, wsaggregate::kMaxFrames));
+}
+
+HostPipeline::~HostPipeline() {
+    stop();
+}
+
+bool HostPipeline::start() {
+    if (!ok() || started_) return false;
+    started_ = true;
+    running_.store(true, std::memory_order_release);
+    sendThread_ = std::thread(&HostPipeline::sendLoop, this);
+    if (sender_.retransmitEnabled()) nackThread_ = std::thread(&HostPipeline::nackLoop, this);
+    return true;
+}
+
+void HostPipeline::stop() {
+    running_.store(false, std::memory_order_release);
+    ring_.close();
+    if (sendThread_.joinable()) sendThread_.join();
+    if (nackThread_.joinable()) nackThread_.join();
+}
+
+void HostPipeline::push(const int16_t* pcm, int shorts) {
+    const int frameShorts = (int)assembly_.size();
+    while (shorts > 0) {
+        const int n = std::min(frameShorts - filled_, shorts);
+        memcpy(assembly_.data() + filled_, pcm, (size_t)n * sizeof(int16_t));
+        filled_ += n;
+        pcm += n;
+        shorts -= n;
+
+        if (filled_ == frameShorts) {
+            filled_ = 0;
+            const int64_t now = futex::monotonicNs();
+            ring_.write(assembly_.data(), PcmRing::Frame{seq_++, mediaClock_.next(now), now});
+            frames_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool HostPipeline::setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports,
+                              int count, int64_t generation) {
+    bool valid = count >= 0 && count <= kMaxTargets;
+    if (!valid) count = 0;
+    std::lock_guard<std::mutex> lock(controlLock_);
+    stagedIps_.assign((size_t)std::max(count, 0) * 16, 0);
+    stagedLens_.assign(ipLens, ipLens + std::max(count, 0));
+    stagedPorts_.assign(ports, ports + std::max(count, 0));
+    for (int i = 0; i < count; ++i) {
+        if (ipLens[i] != 4 && ipLens[i] != 16) {
+            valid = false;
+            continue;
+        }
+        memcpy(&stagedIps_[(size_t)i * 16], ips[i], ipLens[i]);
+    }
+    stagedGeneration_ = generation;
+    targetsStaged_ = true;
+    controlDirty_.store(true, std::memory_order_release);
+    return valid;
+}
+
+void HostPipeline::setGroupInterface(const uint8_t* ipv4) {
+    std::lock_guard<std::mutex> lock(controlLock_);
+    memcpy(stagedIface_, ipv4, 4);
+    ifaceStaged_ = true;
+    controlDirty_.store(true, std::memory_order_release);
+}
+
+void HostPipeline::setFec(const Fec& fec) {
+    std::lock_guard<std::mutex> lock(controlLock_);
+    stagedFec_ = fec;
+    fecStaged_ = true;
+    controlDirty_.store(true, std::memory_order_release);
+}
+
+void HostPipeline::setAggregation(int frames) {
+    std::lock_guard<std::mutex> lock(controlLock_);
+    stagedAggregation_ = frames;
+    aggregationStaged_ = true;
+    controlDirty_.store(true, std::memory_order_release);
+}
+
+// Returns true if a new target set was applied
+bool HostPipeline::applyControl() {
+    if (!controlDirty_.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lock(controlLock_);
+    controlDirty_.store(false, std::memory_order_relaxed);
+
+    // Interface first: group targets need it before they are added
+    if (ifaceStaged_) {
+        sender_.setGroupInterface(stagedIface_);
+        ifaceStaged_ = false;
+    }
+    const bool targets = targetsStaged_;
+    if (targetsStaged_) {
+        const int count = (int)stagedLens_.size();
+        const uint8_t* ips[kMaxTargets];
+        for (int i = 0; i < count; ++i) ips[i] = &stagedIps_[(size_t)i * 16];
+        sender_.setTargets(ips, stagedLens_.data(), stagedPorts_.data(), count);
+        appliedGeneration_ = stagedGeneration_;
+        targetsStaged_ = false;
+    }
+    if (fecStaged_) {
+        sender_.setFec(0, stagedFec_.scheme, stagedFec_.k, stagedFec_.m);
+        fecStaged_ = false;
+    }
+    if (aggregationStaged_) {
+        sender_.setAggregation(aggregationFor(stagedAggregation_));
+        aggregationStaged_ = false;
+    }
+    return targets;
+}
+
+void HostPipeline::sendLoop() {
+    setpriority(PRIO_PROCESS, (id_t)gettid(), cfg_.sendNice);   // best effort
+
+    const int frameShorts = ring_.frameShorts();
+    std::vector<int16_t> pcm((size_t)frameShorts, 0);
+    const auto copy = [&](const int16_t* src) {
+        memcpy(pcm.data(), src, (size_t)frameShorts * sizeof(int16_t));
+    };
+    const int64_t publishEveryNs = (int64_t)(cfg_.publishEveryMs * 1e6);
+    int64_t nextPublishNs = futex::monotonicNs() + publishEveryNs;
+    Stats local;
+
+    while (running_.load(std::memory_order_acquire)) {
+        PcmRing::Frame meta;
+        // Bounded wait so a quiet capture still publishes stats
+        if (!ring_.read(&meta, 100, copy)) {
+            const int64_t now = futex::monotonicNs();
+            if (now >= nextPublishNs) {
+                nextPublishNs = now + publishEveryNs;
+                publish(local);
+            }
+            continue;
+        }
+        FrameTiming ft{meta.seq, 0, 0, meta.readyNs, futex::monotonicNs(), 0, 0};
+
+        // Errors so far are indexed by the old set and would be charged to the new one
+        if (applyControl()) local.errorCount = 0;
+
+        // Receiver reports moved the rate controller: retune the tier-0 encoder
+        RateController::Decision d{};
+        if (sender_.pollRateControl(&d)) {
+            encoder_.setBitrate(0, d.bitrate);
+            encoder_.setLossPercent(0, d.lossPercent);
+            sender_.setFec(0, d.fecScheme, d.fecK, d.fecM);
+            local.decision = d;
+            ++local.decisions;
+        }
+
+        if (sender_.targetCount() == 0) {
+            ++local.idle;
+        } else {
+            // Only the tiers some guest is on are encoded, each as a complete datagram
+            const uint32_t mask = sender_.tierMask(encoder_.activeTiers());
+            const int encoded = encoder_.encode(pcm.data(), meta.seq, meta.pts, 0, mask);
+            ft.encodedNs = futex::monotonicNs();
+            if (encoded < 0) {
+                ++local.encodeErrors;
+            } else if (encoded > 0) {
+                ft.tiers = (uint32_t)encoded;
+                ft.sent = sender_.sendSimulcast(encoder_);
+                ft.sentNs = futex::monotonicNs();
+                ++local.encoded;
+                if (ft.sent < sender_.targetCount()) {
+                    ++local.sendFailures;
+                    const std::vector<int>& errors = sender_.errors();
+                    local.errorCount = std::min((int)errors.size(), kMaxTargets);
+                    std::copy_n(errors.begin(), local.errorCount, local.errors);
+                    local.errorGeneration = appliedGeneration_;
+                }
+
+                local.queueUs += ((ft.dequeuedNs - ft.readyNs) * 1e-3 - local.queueUs) * kSmoothing;
+                local.encodeUs += ((ft.encodedNs - ft.dequeuedNs) * 1e-3 - local.encodeUs) * kSmoothing;
+                local.sendUs += ((ft.sentNs - ft.encodedNs) * 1e-3 - local.sendUs) * kSmoothing;
+                const double totalUs = (ft.sentNs - ft.readyNs) * 1e-3;
+                local.totalUs += (totalUs - local.totalUs) * kSmoothing;
+                local.maxTotalUs = std::max(local.maxTotalUs, totalUs);
+
+                if (observer_) observer_(ft);
+            }
+        }
+
+        const int64_t now = futex::monotonicNs();
+        if (now >= nextPublishNs) {
+            nextPublishNs = now + publishEveryNs;
+            publish(local);
+            local.maxTotalUs = 0;
+            local.errorCount = 0;
+        }
+    }
+    publish(local);
+}
+
+// Send thread: everything but the NACK thread's counters
+void HostPipeline::publish(const Stats& local) {
+    std::lock_guard<std::mutex> lock(statsLock_);
+    Stats& s = snapshot_;
+    s.encoded = local.encoded;
+    s.idle = local.idle;
+    s.encodeErrors = local.encodeErrors;
+    s.sendFailures = local.sendFailures;
+    s.packets = sender_.packetsSent();
+    s.aggregation = sender_.aggregation();
+    s.dredFrames = encoder_.dredFrames();
+    s.queueUs = local.queueUs;
+    s.encodeUs = local.encodeUs;
+    s.sendUs = local.sendUs;
+    s.totalUs = local.totalUs;
+    s.maxTotalUs = local.maxTotalUs;
+    s.decisions = local.decisions;
+    s.decision = local.decision;
+    s.activeTiers = encoder_.activeTiers();
+    s.encoder = encoder_.stats();
+    s.encodeTimes = encoder_.encodeTimes();
+    s.errorCount = local.errorCount;
+    s.errorGeneration = local.errorGeneration;
+    std::copy_n(local.errors, local.errorCount, s.errors);
+}
+
+void HostPipeline::nackLoop() {
+    setpriority(PRIO_PROCESS, (id_t)gettid(), cfg_.nackNice);   // best effort
+
+    const int64_t publishEveryNs = (int64_t)(cfg_.publishEveryMs * 1e6);
+    int64_t nextPublishNs = 0;
+    while (running_.load(std::memory_order_acquire)) {
+        // 100 ms poll so stop() is noticed promptly
+        const int n = sender_.serveNacks(100);
+        if (n == -1) break;   // retransmission not enabled
+        if (n < 0) usleep(50000);
+
+        const int64_t now = futex::monotonicNs();
+        if (now < nextPublishNs) continue;
+        nextPublishNs = now + publishEveryNs;
+        std::lock_guard<std::mutex> lock(statsLock_);
+        if (const NackResponder::Stats* s = sender_.retransmitStats()) snapshot_.nacks = *s;
+        if (const RateController::Stats* s = sender_.rateStats()) snapshot_.rate = *s;
+    }
+}
+
+void HostPipeline::stats(Stats* out) const {
+    {
+        std::lock_guard<std::mutex> lock(statsLock_);
+        *out = snapshot_;
+    }
+    out->frames = frames_.load(std::memory_order_relaxed);
+    out->overwritten = (int64_t)ring_.overwritten();
+}
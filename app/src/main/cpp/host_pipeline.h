@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "host_sender.h"
+#include "media_clock.h"
+#include "pcm_ring.h"
+#include "simulcast_encoder.h"
+
+// Host hot path on native threads: capture chunks -> frames -> ring -> encode -> send.
+//
+// The capture thread hands raw interleaved PCM of any length to push(). A frame
+// assembler cuts it into encoder frames and publishes them to a PcmRing without
+// blocking. A native send thread takes frames off the ring, retunes the encoder from
+// the rate controller, encodes the tiers the guests are on and fans the datagrams out
+// through a HostSender. A NACK thread answers resends and receiver reports on the same
+// socket. Nothing crosses JNI per frame and nothing is allocated per frame.
+//
+// Control (targets, group interface, tier-0 FEC, aggregation) may come from any thread: it is staged
+// under a mutex and picked up by the send thread before its next frame. Counters are
+// published to a Stats snapshot about once a second.
+class HostPipeline {
+public:
+    static constexpr int kMaxTiers = SimulcastEncoder::kMaxTiers;
+    // Unicast guests plus group addresses; bounds the per-target errno snapshot
+    static constexpr int kMaxTargets = 128;
+
+    struct Fec {
+        int scheme = -1;   // wsfec::Scheme, -1 = off
+        int k = 0;
+        int m = 0;
+    };
+
+    struct Config {
+        SimulcastEncoder::Config encoder;
+        int ringFrames = 16;
+        int retransmitFrames = 0;       // resend cache depth; 0 = no NACK service
+        int port = 0;                   // bound for NACKs and receiver reports
+        int minBitrate = 0;             // > 0: receiver reports drive tier-0 bitrate / loss / FEC
+        int maxBitrate = 0;
+        Fec fec[kMaxTiers];             // starting transport FEC per tier
+        int aggregateFrames = 1;        // frames per datagram; frames of 20 ms or less only
+                                        // (DRED packets are padded, so never aggregated)
+        int sendNice = -19;             // THREAD_PRIORITY_URGENT_AUDIO
+        int nackNice = -16;             // THREAD_PRIORITY_AUDIO
+        double publishEveryMs = 1000;
+    };
+
+    struct Stats {
+        int64_t frames = 0;             // assembled by push()
+        int64_t encoded = 0;            // encoded and handed to the sender
+        int64_t overwritten = 0;        // lost in the ring: the send thread fell behind
+        int64_t idle = 0;               // dequeued with no target to send to
+        int64_t encodeErrors = 0;
+        int64_t sendFailures = 0;       // frames some target could not be sent
+        int64_t packets = 0;            // datagrams sent, per target (media, parity, aggregates)
+        int aggregation = 1;            // frames per datagram
+        int dredFrames = 0;             // 10 ms of DRED per packet, 0 = off
+
+        // Per stage, smoothed microseconds: frame complete -> dequeued -> encoded -> sent
+        double queueUs = 0;
+        double encodeUs = 0;
+        double sendUs = 0;
+        double totalUs = 0;
+        double maxTotalUs = 0;          // since the previous snapshot
+
+        int activeTiers = 0;
+        SimulcastEncoder::Stats encoder;
+        ComplexityGovernor::Metrics encodeTimes;
+        NackResponder::Stats nacks;
+        RateController::Stats rate;
+        int64_t decisions = 0;          // rate-control decisions applied
+        RateController::Decision decision{};
+        int errors[kMaxTargets] = {};   // last send errno per target, 0 = ok
+        int errorCount = 0;             // entries valid in errors; 0 if every send went out
+        int64_t errorGeneration = 0;    // setTargets generation the errors are indexed by
+    };
+
+    // Per-frame timestamps for benchmarks (monotonic ns)
+    struct FrameTiming {
+        int32_t seq;
+        uint32_t tiers;                 // mask encoded
+        int sent;                       // targets handed the datagram
+        int64_t readyNs;
+        int64_t dequeuedNs;
+        int64_t encodedNs;
+        int64_t sentNs;
+    };
+
+    explicit HostPipeline(const Config& cfg);
+    ~HostPipeline();
+
+    HostPipeline(const HostPipeline&) = delete;
+    HostPipeline& operator=(const HostPipeline&) = delete;
+
+    // Encoder and socket are up. Resends and rate control are optional, see below.
+    bool ok() const { return encoder_.ok() && sender_.ok(); }
+    bool retransmitEnabled() const { return sender_.retransmitEnabled(); }
+    bool rateControlEnabled() const { return sender_.rateControlEnabled(); }
+    int frameShorts() const { return ring_.frameShorts(); }
+
+    // Called on the send thread after every frame sent. Set before start().
+    void setObserver(std::function<void(const FrameTiming&)> observer) {
+        observer_ = std::move(observer);
+    }
+
+    // Starts the send (and NACK) threads. Once per pipeline.
+    bool start();
+    // Joins the threads; frames still queued are dropped. Idempotent.
+    void stop();
+
+    // ---- Capture thread ----
+
+    // Appends interleaved samples; every completed frame goes into the ring. Never blocks.
+    void push(const int16_t* pcm, int shorts);
+
+    // ---- Any thread ----
+
+    // ips[i] holds ipLens[i] (4 or 16) address bytes. Returns false on a malformed
+    // address or more than kMaxTargets, in which case the send thread ends up with no
+    // targets (as UdpSender). Send errors come back with the generation of the set they
+    // were raised against (Stats::errorGeneration), so a caller that tags each set can
+    // drop the errors of a set it has already replaced.
+    bool setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports, int count,
+                    int64_t generation = 0);
+    void setGroupInterface(const uint8_t* ipv4);
+    // Tier 0; receiver reports take FEC over once they arrive
+    void setFec(const Fec& fec);
+    // Frames per datagram (1 = off); held at 1 for frames over 20 ms
+    void setAggregation(int frames);
+
+    void stats(Stats* out) const;
+
+private:
+    void sendLoop();
+    void nackLoop();
+    bool applyControl();
+    int aggregationFor(int frames) const;
+    void publish(const Stats& local);
+
+    const Config cfg_;
+    SimulcastEncoder encoder_;
+    HostSender sender_;
+    PcmRing ring_;
+    std::function<void(const FrameTiming&)> observer_;
+
+    // Capture thread
+    std::vector<int16_t> assembly_;
+    int filled_ = 0;
+    int32_t seq_ = 0;
+    MediaClock mediaClock_;
+    std::atomic<int64_t> frames_{0};
+
+    // Staged control, send thread applies it
+    std::mutex controlLock_;
+    std::atomic<bool> controlDirty_{false};
+    bool targetsStaged_ = false;
+    std::vector<uint8_t> stagedIps_;      // 16 bytes per target
+    std::vector<int> stagedLens_;
+    std::vector<int> stagedPorts_;
+    int64_t stagedGeneration_ = 0;
+    int64_t appliedGeneration_ = 0;       // send thread
+    bool ifaceStaged_ = false;
+    uint8_t stagedIface_[4] = {};
+    bool fecStaged_ = false;
+    Fec stagedFec_;
+    bool aggregationStaged_ = false;
+    int stagedAggregation_ = 1;
+
+    // Published snapshot
+    mutable std::mutex statsLock_;
+    Stats snapshot_;
+
+    std::atomic<bool> running_{false};
+    bool started_ = false;
+    std::thread sendThread_;
+    std::thread nackThread_;
+};
@@ -0,0 +1,299 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+#include <vector>
+
+#include "dnn_blob.h"
+#include "host_pipeline.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_PIPELINE(ptr) reinterpret_cast<HostPipeline*>(ptr)
+
+// Slots of the stats array; must match OpusNative.HostPipeline.STAT_* / STATS_SIZE
+enum StatIndex : int {
+    kStatFrames = 0,
+    kStatSent,
+    kStatOverwritten,
+    kStatIdle,
+    kStatEncodeErrors,
+    kStatSendFailures,
+    kStatQueueUs,
+    kStatEncodeUs,
+    kStatSendUs,
+    kStatTotalUs,
+    kStatMaxTotalUs,
+    kStatActiveTiers,
+    kStatEncodeWallUs,
+    kStatSheds,
+    kStatRestores,
+    kStatComplexity,
+    kStatEncodeP50Us,
+    kStatEncodeP95Us,
+    kStatEncodeP99Us,
+    kStatEncodeMaxUs,
+    kStatComplexityLowers,
+    kStatComplexityRaises,
+    kStatNacks,
+    kStatNackRequested,
+    kStatResent,
+    kStatResendEvicted,
+    kStatResendRateLimited,
+    kStatReports,
+    kStatBackoffs,
+    kStatProbes,
+    kStatFecChanges,
+    kStatTierMoves,
+    kStatRateDecisions,
+    kStatRateBitrate,
+    kStatRateLossPercent,
+    kStatRateFecScheme,
+    kStatRateFecK,
+    kStatRateFecM,
+    kStatTierCpuUs,                                     // + tier
+    kStatClockRequests = kStatTierCpuUs + HostPipeline::kMaxTiers,
+    kStatPackets,
+    kStatFramesPerPacket,
+    kStatDredMs,
+    kStatErrorGeneration,
+    kStatsSize
+};
+static_assert(kStatsSize == 47, "stats layout changed: update OpusNative.HostPipeline");
+
+extern "C" {
+
+// Encoder parameters as for createSimulcast. fec holds (scheme, k, m) per tier.
+// retransmitFrames > 0 binds port for NACKs; minBitrate > 0 also enables rate control.
+// aggregateFrames > 1 sends that many frames per datagram (see setAggregation).
+// dnnBlob (a DnnBlob, 0 = none) outlives the pipeline; with it every tier carries dredMs
+// of Deep REDundancy when libopus has DRED.
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_createPipeline(
+        JNIEnv* env, jobject /*thiz*/, jint sampleRate, jint channels, jint frameSize,
+        jint application, jint complexity, jint minComplexity, jint maxComplexity,
+        jdouble encodeShare, jintArray bitrates, jint budgetUs, jintArray fec, jint ringFrames,
+        jint retransmitFrames, jint port, jint minBitrate, jint maxBitrate, jint aggregateFrames,
+        jlong dnnBlob, jint dredMs) {
+    const jsize tiers = bitrates ? env->GetArrayLength(bitrates) : 0;
+    if (tiers < 1 || tiers > HostPipeline::kMaxTiers || channels <= 0 || frameSize <= 0 ||
+        budgetUs <= 0 || encodeShare < 0 || encodeShare >= 1 || minComplexity < 0 ||
+        maxComplexity > 10 || minComplexity > maxComplexity || ringFrames <= 0 ||
+        ringFrames > 4096 || !fec || env->GetArrayLength(fec) < tiers * 3) {
+        LOGE("createPipeline: invalid tiers=%d ch=%d frame=%d ring=%d", (int)tiers, (int)channels,
+             (int)frameSize, (int)ringFrames);
+        return 0;
+    }
+
+    HostPipeline::Config cfg;
+    SimulcastEncoder::Config& e = cfg.encoder;
+    e.sampleRate = sampleRate;
+    e.channels = channels;
+    e.frameSize = frameSize;
+    e.application = application;
+    e.complexity = complexity;
+    e.minComplexity = minComplexity;
+    e.maxComplexity = maxComplexity;
+    e.encodeShare = encodeShare;
+    e.tiers = tiers;
+    e.budgetUs = budgetUs;
+    env->GetIntArrayRegion(bitrates, 0, tiers, reinterpret_cast<jint*>(e.bitrates));
+    if (const auto* blob = reinterpret_cast<const DnnBlob*>(dnnBlob)) {
+        e.dnnBlob = blob->data();
+        e.dnnBlobBytes = blob->size();
+        e.dredFrames = dredMs / 10;
+    }
+
+    jint f[HostPipeline::kMaxTiers * 3];
+    env->GetIntArrayRegion(fec, 0, tiers * 3, f);
+    for (int t = 0; t < tiers; ++t) cfg.fec[t] = {f[t * 3], f[t * 3 + 1], f[t * 3 + 2]};
+
+    cfg.ringFrames = ringFrames;
+    cfg.retransmitFrames = retransmitFrames;
+    cfg.port = port;
+    cfg.minBitrate = minBitrate;
+    cfg.maxBitrate = maxBitrate;
+    cfg.aggregateFrames = aggregateFrames;
+
+    auto* p = new (std::nothrow) HostPipeline(cfg);
+    if (p && !p->ok()) {
+        LOGE("createPipeline: encoder or socket setup failed");
+        delete p;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(p);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_destroyPipeline(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_PIPELINE(pointer);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_retransmitEnabled(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    return p && p->retransmitEnabled() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_rateControlEnabled(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    return p && p->rateControlEnabled() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_start(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    return p && p->start() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_stop(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (p) p->stop();
+}
+
+// Capture thread: `bytes` of native-order 16-bit PCM at the start of a direct buffer.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_push(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jobject buffer, jint bytes) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (!p) return -1;
+    auto* pcm = static_cast<const int16_t*>(buffer ? env->GetDirectBufferAddress(buffer) : nullptr);
+    if (!pcm || bytes < 0 || bytes > env->GetDirectBufferCapacity(buffer)) return -2;
+    p->push(pcm, bytes / 2);
+    return 0;
+}
+
+// ips[i] is InetAddress.getAddress() (4 or 16 bytes). Returns false on a malformed entry.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_setTargets(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jobjectArray ips, jintArray ports,
+        jlong generation) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (!p || !ips || !ports) return JNI_FALSE;
+
+    const jsize count = env->GetArrayLength(ips);
+    if (env->GetArrayLength(ports) < count) return JNI_FALSE;
+
+    std::vector<uint8_t> raw((size_t)count * 16);
+    std::vector<const uint8_t*> ipPtrs(count);
+    std::vector<int> ipLens(count);
+    std::vector<int> portVals(count);
+    env->GetIntArrayRegion(ports, 0, count, reinterpret_cast<jint*>(portVals.data()));
+
+    for (jsize i = 0; i < count; ++i) {
+        auto ip = static_cast<jbyteArray>(env->GetObjectArrayElement(ips, i));
+        const jsize len = ip ? env->GetArrayLength(ip) : 0;
+        if (len == 4 || len == 16) {
+            env->GetByteArrayRegion(ip, 0, len, reinterpret_cast<jbyte*>(&raw[(size_t)i * 16]));
+        }
+        if (ip) env->DeleteLocalRef(ip);
+        ipPtrs[i] = &raw[(size_t)i * 16];
+        ipLens[i] = len;
+    }
+
+    const bool ok = p->setTargets(ipPtrs.data(), ipLens.data(), portVals.data(), count, generation);
+    if (!ok) LOGE("setTargets: malformed address in %d targets", (int)count);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_setGroupInterface(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jbyteArray ipv4) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (!p || !ipv4 || env->GetArrayLength(ipv4) != 4) return JNI_FALSE;
+    uint8_t ip[4];
+    env->GetByteArrayRegion(ipv4, 0, 4, reinterpret_cast<jbyte*>(ip));
+    p->setGroupInterface(ip);
+    return JNI_TRUE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_setFec(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint scheme, jint k, jint m) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (p) p->setFec({scheme, k, m});
+}
+
+// Frames per datagram, 1 (off) .. wsaggregate::kMaxFrames; 1 for frames over 20 ms.
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_setAggregation(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint frames) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (p) p->setAggregation(frames);
+}
+
+// Layout documented on OpusNative.HostPipeline.stats. errors (optional) receives the
+// last send errno per target if some send failed in the last snapshot period; returns
+// the number of entries written (0 when every send went out).
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024HostPipeline_stats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out, jintArray errors) {
+    HostPipeline* p = GET_PIPELINE(pointer);
+    if (!p || !out || env->GetArrayLength(out) < kStatsSize) return 0;
+
+    HostPipeline::Stats s;
+    p->stats(&s);
+    const SimulcastEncoder::Stats& e = s.encoder;
+    const ComplexityGovernor::Metrics& g = s.encodeTimes;
+    jlong v[kStatsSize] = {};
+    v[kStatFrames] = s.frames;
+    v[kStatSent] = s.encoded;
+    v[kStatOverwritten] = s.overwritten;
+    v[kStatIdle] = s.idle;
+    v[kStatEncodeErrors] = s.encodeErrors;
+    v[kStatSendFailures] = s.sendFailures;
+    v[kStatQueueUs] = (jlong)s.queueUs;
+    v[kStatEncodeUs] = (jlong)s.encodeUs;
+    v[kStatSendUs] = (jlong)s.sendUs;
+    v[kStatTotalUs] = (jlong)s.totalUs;
+    v[kStatMaxTotalUs] = (jlong)s.maxTotalUs;
+    v[kStatActiveTiers] = s.activeTiers;
+    v[kStatEncodeWallUs] = (jlong)e.wallUs;
+    v[kStatSheds] = e.sheds;
+    v[kStatRestores] = e.restores;
+    v[kStatComplexity] = g.complexity;
+    v[kStatEncodeP50Us] = (jlong)g.p50Us;
+    v[kStatEncodeP95Us] = (jlong)g.p95Us;
+    v[kStatEncodeP99Us] = (jlong)g.p99Us;
+    v[kStatEncodeMaxUs] = (jlong)g.maxUs;
+    v[kStatComplexityLowers] = g.lowers;
+    v[kStatComplexityRaises] = g.raises;
+    v[kStatNacks] = s.nacks.nacks;
+    v[kStatNackRequested] = s.nacks.requested;
+    v[kStatResent] = s.nacks.resent;
+    v[kStatResendEvicted] = s.nacks.evicted;
+    v[kStatResendRateLimited] = s.nacks.rateLimited;
+    v[kStatReports] = s.nacks.reports;
+    v[kStatBackoffs] = s.rate.backoffs;
+    v[kStatProbes] = s.rate.probes;
+    v[kStatFecChanges] = s.rate.fecChanges;
+    v[kStatTierMoves] = s.rate.tierMoves;
+    v[kStatRateDecisions] = s.decisions;
+    v[kStatRateBitrate] = s.decision.bitrate;
+    v[kStatRateLossPercent] = s.decision.lossPercent;
+    v[kStatRateFecScheme] = s.decision.fecScheme;
+    v[kStatRateFecK] = s.decision.fecK;
+    v[kStatRateFecM] = s.decision.fecM;
+    for (int t = 0; t < HostPipeline::kMaxTiers; ++t) v[kStatTierCpuUs + t] = (jlong)e.cpuUs[t];
+    v[kStatClockRequests] = s.nacks.clocks;
+    v[kStatPackets] = s.packets;
+    v[kStatFramesPerPacket] = s.aggregation;
+    v[kStatDredMs] = s.dredFrames * 10;
+    v[kStatErrorGeneration] = s.errorGeneration;
+    env->SetLongArrayRegion(out, 0, kStatsSize, v);
+
+    const jsize n = (jsize)s.errorCount;
+    if (errors && n > 0 && env->GetArrayLength(errors) >= n) {
+        env->SetIntArrayRegion(errors, 0, n, reinterpret_cast<const jint*>(s.errors));
+    }
+    return n;
+}
+
+} // extern "C"
@@ -0,0 +1,217 @@
+#include "host_sender.h"
+
+#include <cstring>
+#include <new>
+
+#include "futex.h"
+#include "simulcast_encoder.h"
+
+static_assert(HostSender::kTiers == SimulcastEncoder::kMaxTiers,
+              "sender and encoder tier counts differ");
+
+bool HostSender::setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports,
+                            int count) {
+    // Held frames belong to the guests they were encoded for
+    flushAggregates();
+    const bool ok = sender_.setTargets(ips, ipLens, ports, count);
+    errors_.assign(sender_.targetCount(), 0);
+    wanted_.assign(sender_.targetCount(), 0);
+    tierRefresh_ = 0;
+    return ok;
+}
+
+int HostSender::sendToAll(const uint8_t* data, int length) {
+    const int sent = sender_.sendToAll(data, length, errors_.data());
+    packets_ += sent;
+    if (cache_) cache_->store(data, length);
+    if (fec_[0].enabled() && fec_[0].addMedia(data, length)) {
+        packets_ += sender_.sendToAll(fec_[0].parity(), fec_[0].parityLength(), nullptr);
+    }
+    return sent;
+}
+
+int HostSender::sendSimulcast(const SimulcastEncoder& encoder) {
+    const uint8_t* data[kTiers] = {};
+    int lengths[kTiers] = {};
+    for (int t = 0; t < encoder.tiers(); ++t) {
+        data[t] = encoder.datagram(t);
+        lengths[t] = encoder.length(t);
+    }
+    if (aggregate_ > 1) return sendAggregated(data, lengths);
+
+    const int sent = sender_.sendTiered(data, lengths, errors_.data());
+    packets_ += sent;
+
+    for (int t = 0; t < kTiers; ++t) {
+        if (lengths[t] <= 0) continue;
+        if (cache_) cache_->store(data[t], lengths[t], t);
+        if (fec_[t].enabled() && fec_[t].addMedia(data[t], lengths[t])) {
+            const uint8_t* parity[kTiers] = {};
+            int parityLengths[kTiers] = {};
+            parity[t] = fec_[t].parity();
+            parityLengths[t] = fec_[t].parityLength();
+            packets_ += sender_.sendTiered(parity, parityLengths, nullptr);
+        }
+    }
+    return sent;
+}
+
+int HostSender::sendAggregated(const uint8_t* const* data, const int* lengths) {
+    const uint8_t* out[kTiers] = {};
+    int outLengths[kTiers] = {};
+    bool sending[kTiers] = {};
+    bool any = false;
+
+    for (int t = 0; t < kTiers; ++t) {
+        FrameAggregator& a = aggregators_[t];
+        if (lengths[t] > 0) {
+            outLengths[t] = a.add(data[t], lengths[t]);
+            // Resends and parity stay per frame
+            if (cache_) cache_->store(data[t], lengths[t], t);
+            ParityQueue& q = parityQueue_[t];
+            if (fec_[t].enabled() && fec_[t].addMedia(data[t], lengths[t]) &&
+                q.count < wsaggregate::kMaxFrames) {
+                memcpy(q.data[q.count], fec_[t].parity(), (size_t)fec_[t].parityLength());
+                q.lengths[q.count++] = fec_[t].parityLength();
+            }
+        } else {
+            outLengths[t] = a.flush();   // tier no longer encoded
+        }
+        out[t] = a.datagram();
+        sending[t] = outLengths[t] > 0;
+        any = any || sending[t];
+    }
+    if (!any) return sender_.targetCount();
+
+    const int sent = sender_.sendTiered(out, outLengths, errors_.data());
+    packets_ += sent;
+    sendParity(sending);
+    return sent;
+}
+
+void HostSender::flushAggregates() {
+    if (aggregate_ <= 1) return;
+    const uint8_t* out[kTiers] = {};
+    int outLengths[kTiers] = {};
+    bool sending[kTiers] = {};
+    bool any = false;
+    for (int t = 0; t < kTiers; ++t) {
+        outLengths[t] = aggregators_[t].flush();
+        out[t] = aggregators_[t].datagram();
+        sending[t] = outLengths[t] > 0 || parityQueue_[t].count > 0;
+        any = any || sending[t];
+    }
+    if (!any) return;
+    packets_ += sender_.sendTiered(out, outLengths, nullptr);
+    sendParity(sending);
+}
+
+// Queued parity of the given tiers, one sendmmsg per queue position
+void HostSender::sendParity(const bool* tiers) {
+    for (int j = 0; j < wsaggregate::kMaxFrames; ++j) {
+        const uint8_t* parity[kTiers] = {};
+        int parityLengths[kTiers] = {};
+        bool any = false;
+        for (int t = 0; t < kTiers; ++t) {
+            if (!tiers[t] || j >= parityQueue_[t].count) continue;
+            parity[t] = parityQueue_[t].data[j];
+            parityLengths[t] = parityQueue_[t].lengths[j];
+            any = true;
+        }
+        if (!any) break;
+        packets_ += sender_.sendTiered(parity, parityLengths, nullptr);
+    }
+    for (int t = 0; t < kTiers; ++t) {
+        if (tiers[t]) parityQueue_[t].count = 0;
+    }
+}
+
+bool HostSender::setAggregation(int frames) {
+    if (frames < 1 || frames > wsaggregate::kMaxFrames) return false;
+    if (frames == aggregate_) return true;
+    for (FrameAggregator& a : aggregators_) {
+        if (frames > 1 && !a.ok()) return false;
+    }
+    flushAggregates();
+    aggregate_ = frames;
+    for (FrameAggregator& a : aggregators_) a.setFrames(frames);
+    return true;
+}
+
+uint32_t HostSender::tierMask(int maxTiers) {
+    const int n = sender_.targetCount();
+    const int top = (maxTiers < 1 ? 1 : (maxTiers > kTiers ? kTiers : maxTiers)) - 1;
+
+    const bool refresh = rate_ && --tierRefresh_ <= 0;
+    const int64_t now = refresh ? futex::monotonicNs() : 0;
+    if (refresh) tierRefresh_ = kTierRefreshFrames;
+
+    bool moved = false;
+    for (int i = 0; i < n; ++i) {
+        int tier = refresh ? rate_->tierFor(sender_.target(i), now) : sender_.targetTier(i);
+        if (tier > top) tier = top;
+        wanted_[i] = tier;
+        moved = moved || tier != sender_.targetTier(i);
+    }
+    // A guest changing tier gets the frames held for its old one first
+    if (moved) flushAggregates();
+
+    uint32_t mask = 0;
+    for (int i = 0; i < n; ++i) {
+        sender_.setTargetTier(i, wanted_[i]);
+        mask |= 1u << wanted_[i];
+    }
+    return mask;
+}
+
+bool HostSender::setFec(int tier, int scheme, int k, int m) {
+    if (tier < 0 || tier >= kTiers) return false;
+    if (scheme < 0) {
+        fec_[tier].disable();
+        return true;
+    }
+    return fec_[tier].configure(scheme, k, m);
+}
+
+bool HostSender::enableRetransmit(int capacity, int port) {
+    if (capacity <= 0 || cache_) return false;
+    if (!sender_.bindPort(port)) return false;
+    cache_.reset(new (std::nothrow) RetransmitCache(capacity, kMaxDatagramBytes, kTiers));
+    if (cache_) responder_.reset(new (std::nothrow) NackResponder(sender_.fd(), *cache_));
+    if (!responder_) {
+        cache_.reset();
+        return false;
+    }
+    return true;
+}
+
+int HostSender::serveNacks(int timeoutMs) {
+    return responder_ ? responder_->serve(timeoutMs) : -1;
+}
+
+const NackResponder::Stats* HostSender::retransmitStats() const {
+    return responder_ ? &responder_->stats() : nullptr;
+}
+
+bool HostSender::enableRateControl(int minBitrate, int maxBitrate, int tiers) {
+    if (!responder_ || rate_ || minBitrate <= 0 || maxBitrate < minBitrate || tiers < 1 ||
+        tiers > kTiers) {
+        return false;
+    }
+    RateController::Config cfg;
+    cfg.minBitrate = minBitrate;
+    cfg.maxBitrate = maxBitrate;
+    cfg.tiers = tiers;
+    rate_.reset(new (std::nothrow) RateController(cfg));
+    if (!rate_) return false;
+    responder_->setReportSink(rate_.get());
+    return true;
+}
+
+bool HostSender::pollRateControl(RateController::Decision* d) {
+    return rate_ && rate_->poll(d);
+}
+
+const RateController::Stats* HostSender::rateStats() const {
+    return rate_ ? &rate_->stats() : nullptr;
+}
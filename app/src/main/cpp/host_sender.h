@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "fec.h"
+#include "frame_aggregator.h"
+#include "rate_controller.h"
+#include "retransmit.h"
+#include "udp_sender.h"
+
+class SimulcastEncoder;
+
+// Host transport: the UdpSender fan-out plus everything that rides on its socket.
+//   - optional NACK service (enableRetransmit): the send thread fills the resend cache,
+//     the NACK thread runs the responder on the same socket;
+//   - optional report-driven rate control (enableRateControl), fed by the responder;
+//   - optional transport FEC per simulcast tier (setFec): parity follows the media it
+//     protects, to the targets of that tier only;
+//   - optional packet aggregation (setAggregation): each tier's frames go out a few to a
+//     datagram. The resend cache and FEC still see every frame on its own, and parity
+//     waits for the aggregate carrying its media. Held frames are sent before guests
+//     change tier or the target set changes, so no guest misses one.
+//
+// Send thread: setTargets, setGroupInterface, setFec, setAggregation, tierMask, send*,
+// pollRateControl.
+// NACK thread: serveNacks, retransmitStats, rateStats. The enable* calls come first,
+// before either thread starts.
+class HostSender {
+public:
+    // A datagram must fit in the MTU anyway (same bound as the encoder scratch).
+    static constexpr int kMaxDatagramBytes = 1500;
+    static constexpr int kTiers = UdpSender::kMaxTiers;
+
+    HostSender() = default;
+
+    bool ok() const { return sender_.ok(); }
+
+    // See UdpSender::setTargets. Guest tiers are re-read from the rate controller on
+    // the next tierMask().
+    bool setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports, int count);
+    bool setGroupInterface(const uint8_t* ipv4) { return sender_.setGroupInterface(ipv4); }
+    int targetCount() const { return sender_.targetCount(); }
+
+    // 0 or the errno of the last send, per target
+    const std::vector<int>& errors() const { return errors_; }
+
+    // Sends one datagram to every target (tier 0 cache / FEC). Returns targets sent to.
+    int sendToAll(const uint8_t* data, int length);
+
+    // The datagrams of the last SimulcastEncoder::encode(), each to the targets on its
+    // tier, with one sendmmsg. Same return value as sendToAll; a frame held for
+    // aggregation counts as sent to every target.
+    int sendSimulcast(const SimulcastEncoder& encoder);
+
+    // Frames per datagram, 1 (off) .. wsaggregate::kMaxFrames, for single-frame Opus
+    // packets; what is held goes out first. False if out of range.
+    bool setAggregation(int frames);
+    int aggregation() const { return aggregate_; }
+
+    // Datagrams handed to the socket so far, per target: media, parity and aggregates
+    int64_t packetsSent() const { return packets_; }
+
+    // Before encoding: places every target on its guest's simulcast tier (from the
+    // rate controller, below maxTiers) and returns the mask of tiers in use.
+    uint32_t tierMask(int maxTiers);
+
+    // scheme < 0 disables FEC on tier. False (FEC off) for an invalid combination.
+    bool setFec(int tier, int scheme, int k, int m);
+
+    // Binds to port and keeps the last `capacity` datagrams per tier for resending.
+    bool enableRetransmit(int capacity, int port);
+    bool retransmitEnabled() const { return responder_ != nullptr; }
+
+    // NACK thread: waits up to timeoutMs and answers queued NACKs. Returns packets
+    // resent, -1 when retransmission is not enabled, or -errno on a socket error.
+    int serveNacks(int timeoutMs);
+    const NackResponder::Stats* retransmitStats() const;
+
+    // Needs enableRetransmit (reports share its socket).
+    bool enableRateControl(int minBitrate, int maxBitrate, int tiers);
+    bool rateControlEnabled() const { return rate_ != nullptr; }
+
+    // Send thread: true and d filled when the decision changed since the last call.
+    bool pollRateControl(RateController::Decision* d);
+    const RateController::Stats* rateStats() const;
+
+private:
+    // Guest tiers are re-read from the rate controller this often (~0.5 s of frames)
+    static constexpr int kTierRefreshFrames = 25;
+    static constexpr int kParityBytes = wsfec::kHeaderSize + wsfec::kMaxBlock;
+
+    // Parity due while its media is held, per tier; at most one per frame held
+    struct ParityQueue {
+        int count = 0;
+        int lengths[wsaggregate::kMaxFrames] = {};
+        uint8_t data[wsaggregate::kMaxFrames][kParityBytes];
+    };
+
+    int sendAggregated(const uint8_t* const* data, const int* lengths);
+    void flushAggregates();
+    void sendParity(const bool* tiers);
+
+    UdpSender sender_;
+    std::vector<int> errors_;    // targetCount()
+
+    std::unique_ptr<RetransmitCache> cache_;
+    std::unique_ptr<NackResponder> responder_;
+    std::unique_ptr<RateController> rate_;
+    int tierRefresh_ = 0;        // frames until target tiers are re-read; 0 = now
+    std::vector<int> wanted_;    // targetCount(), tierMask scratch
+    int64_t packets_ = 0;
+
+    FecEncoder fec_[kTiers];
+
+    int aggregate_ = 1;
+    FrameAggregator aggregators_[kTiers];
+    ParityQueue parityQueue_[kTiers];
+};
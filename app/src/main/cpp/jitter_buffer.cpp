@@ -0,0 +1,160 @@
+#include "jitter_buffer.h"
+
+#include <cstring>
+
+static uint32_t roundUpPow2(int v) {
+    uint32_t n = 1;
+    while (n < static_cast<uint32_t>(v)) n <<= 1;
+    return n;
+}
+
+JitterBuffer::JitterBuffer(int capacity, int slotBytes)
+        : mask_(roundUpPow2(capacity < 2 ? 2 : capacity) - 1),
+          slotBytes_(slotBytes),
+          slots_(mask_ + 1),
+          data_((size_t)(mask_ + 1) * slotBytes) {}
+
+// ---------------- Producer ----------------
+
+bool JitterBuffer::putDatagram(const uint8_t* data, int length, wspacket::Header* out) {
+    wspacket::Header h{};
+    if (!wspacket::parseHeader(data, length, &h)) return false;
+    if (out) *out = h;
+    return put(h.seq, data + wspacket::kHeaderSize, h.payloadLen);
+}
+
+bool JitterBuffer::put(int32_t seq, const uint8_t* payload, int length) {
+    return putWith(seq, length, [&](uint8_t* dst) {
+        if (length > 0) std::memcpy(dst, payload, (size_t)length);
+    });
+}
+
+void JitterBuffer::beginWrite(int32_t seq) {
+    Slot& s = slotFor(seq);
+    uint64_t cur = s.tag.load(std::memory_order_acquire);
+    // CAS so an eviction (or duplicate) is counted exactly once even if the
+    // consumer is releasing the same slot concurrently.
+    while (!s.tag.compare_exchange_weak(cur, makeTag(seq, kWriting),
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {}
+    if (stateOf(cur) == kFull) count_.fetch_sub(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void JitterBuffer::endWrite(int32_t seq, int length) {
+    Slot& s = slotFor(seq);
+    s.length.store(length, std::memory_order_relaxed);
+    s.tag.store(makeTag(seq, kFull), std::memory_order_release);
+    count_.fetch_add(1, std::memory_order_release);
+
+    if (!started_ || seq > head_.load(std::memory_order_relaxed)) {
+        head_.store(seq, std::memory_order_release);
+    }
+    if (!started_) {
+        tail_.store(seq, std::memory_order_release);
+        started_ = true;
+    } else {
+        lowerTail(seq);
+    }
+
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) futex::wakeAll(&epoch_);
+}
+
+void JitterBuffer::lowerTail(int32_t seq) {
+    int32_t t = tail_.load(std::memory_order_relaxed);
+    while (seq < t && !tail_.compare_exchange_weak(t, seq, std::memory_order_acq_rel)) {}
+}
+
+void JitterBuffer::evictAll() {
+    for (uint32_t i = 0; i <= mask_; i++) {
+        uint64_t cur = slots_[i].tag.load(std::memory_order_acquire);
+        if (stateOf(cur) == kFull &&
+            slots_[i].tag.compare_exchange_strong(cur, kEmpty, std::memory_order_acq_rel)) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// ---------------- Consumer ----------------
+
+bool JitterBuffer::release(int32_t seq) {
+    Slot& s = slotFor(seq);
+    uint64_t expected = makeTag(seq, kFull);
+    if (s.tag.compare_exchange_strong(expected, kEmpty, std::memory_order_acq_rel)) {
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+int JitterBuffer::copyPayload(int32_t seq, uint8_t* dst, int cap, bool remove) {
+    Slot& s = slotFor(seq);
+    const uint64_t want = makeTag(seq, kFull);
+    if (s.tag.load(std::memory_order_acquire) != want) return kMissing;
+
+    const int n = s.length.load(std::memory_order_relaxed);
+    if (n < 0 || n > cap) return kMissing;
+    std::memcpy(dst, dataFor(seq), (size_t)n);
+
+    // Seqlock validation: if the producer started overwriting, the copy is torn.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.tag.load(std::memory_order_relaxed) != want) return kMissing;
+
+    if (remove && !release(seq)) return kMissing;
+    return n;
+}
+
+bool JitterBuffer::contains(int32_t seq) const {
+    return slotFor(seq).tag.load(std::memory_order_acquire) == makeTag(seq, kFull);
+}
+
+// Only [head - capacity + 1, head] can be present; tail_ caches where to start.
+int64_t JitterBuffer::scanStart() const {
+    const int32_t head = head_.load(std::memory_order_acquire);
+    const int64_t lowest = (int64_t)head - (int64_t)mask_;
+    const int32_t tail = tail_.load(std::memory_order_acquire);
+    return (tail > lowest && tail <= head) ? tail : lowest;
+}
+
+bool JitterBuffer::firstSeq(int32_t* out) {
+    if (size() == 0) return false;
+
+    int32_t observed = tail_.load(std::memory_order_acquire);
+    const int32_t head = head_.load(std::memory_order_acquire);
+    for (int64_t seq = scanStart(); seq <= head; seq++) {
+        if (contains((int32_t)seq)) {
+            // Fails harmlessly if the producer lowered tail_ for a late packet meanwhile
+            tail_.compare_exchange_strong(observed, (int32_t)seq, std::memory_order_acq_rel);
+            *out = (int32_t)seq;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JitterBuffer::clear() {
+    evictAll();
+}
+
+void JitterBuffer::dropOlderThan(int32_t seq) {
+    if (size() == 0) return;
+
+    int32_t observed = tail_.load(std::memory_order_acquire);
+    if (seq <= observed) return;
+
+    const int32_t head = head_.load(std::memory_order_acquire);
+    const int64_t end = seq <= head ? seq : (int64_t)head + 1;
+    for (int64_t s = scanStart(); s < end && size() > 0; s++) {
+        release((int32_t)s);
+    }
+    tail_.compare_exchange_strong(observed, seq, std::memory_order_acq_rel);
+}
+
+bool JitterBuffer::waitForSeq(int32_t seq, int waitMs) {
+    return waitUntil(waitMs, [&] { return contains(seq); });
+}
+
+bool JitterBuffer::waitForData(int waitMs) {
+    return waitUntil(waitMs, [&] { return size() > 0; });
+}
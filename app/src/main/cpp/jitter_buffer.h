@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "futex.h"
+#include "packet_codec.h"
+
+// Guest-side packet store keyed by seq. Payloads live in fixed-size native slots
+// (slot = seq % capacity), so the rx path never allocates a Java array per packet
+// and the decoder can pull a payload by seq alone.
+//
+// Lock-free single-producer / single-consumer: the rx thread is the only caller
+// of put*, the playout thread owns every other operation. Each slot carries an
+// atomic (seq, state) tag used as a seqlock, so a consumer read that races an
+// overwrite is detected and reported as missing. Waiting uses a futex.
+class JitterBuffer {
+public:
+    static constexpr int kMissing = -1;
+    // This many datagrams in a row more than a ring behind head mean the host
+    // restarted its sequence; fewer are stale stragglers and are dropped.
+    static constexpr int kRestartRun = 8;
+
+    // capacity is rounded up to a power of two.
+    JitterBuffer(int capacity, int slotBytes);
+
+    // ---- Producer (rx thread) ----
+
+    // Validates the PacketCodec header and stores the payload. The header is
+    // returned through `out` (may be null). Returns false for invalid datagrams.
+    bool putDatagram(const uint8_t* data, int length, wspacket::Header* out);
+
+    // Stores a raw payload under seq. Returns false if it does not fit a slot.
+    bool put(int32_t seq, const uint8_t* payload, int length);
+
+    // Like put(), but `fill(dst)` writes the payload (lets JNI copy straight from a Java array).
+    template <typename Fill>
+    bool putWith(int32_t seq, int length, Fill fill);
+
+    // ---- Consumer (playout thread) ----
+
+    // Copies the payload for seq into dst (up to cap bytes). If `remove` is set
+    // the slot is released. Returns the payload length or kMissing.
+    int copyPayload(int32_t seq, uint8_t* dst, int cap, bool remove);
+
+    bool contains(int32_t seq) const;
+    bool firstSeq(int32_t* out);
+    int size() const { return count_.load(std::memory_order_acquire); }
+    // Datagrams dropped for arriving more than a full ring behind head
+    uint64_t staleDropped() const { return stale_.load(std::memory_order_relaxed); }
+    void clear();
+    void dropOlderThan(int32_t seq);
+
+    // Block until seq is present / any data is present, or the timeout expires.
+    bool waitForSeq(int32_t seq, int waitMs);
+    bool waitForData(int waitMs);
+
+private:
+    enum : uint64_t { kEmpty = 0, kWriting = 1, kFull = 2 };
+
+    static uint64_t makeTag(int32_t seq, uint64_t state) {
+        return (uint64_t(uint32_t(seq)) << 32) | state;
+    }
+    static uint64_t stateOf(uint64_t tag) { return tag & 0xFFFFFFFFu; }
+
+    struct Slot {
+        std::atomic<uint64_t> tag{kEmpty};
+        std::atomic<int> length{0};
+    };
+
+    Slot& slotFor(int32_t seq) { return slots_[static_cast<uint32_t>(seq) & mask_]; }
+    const Slot& slotFor(int32_t seq) const { return slots_[static_cast<uint32_t>(seq) & mask_]; }
+    uint8_t* dataFor(int32_t seq) {
+        return data_.data() + (size_t)(static_cast<uint32_t>(seq) & mask_) * slotBytes_;
+    }
+
+    void beginWrite(int32_t seq);
+    void endWrite(int32_t seq, int length);
+    bool release(int32_t seq);   // FULL(seq) -> EMPTY, true if this call emptied it
+    void evictAll();
+    int64_t scanStart() const;
+    void lowerTail(int32_t seq);
+
+    template <typename Pred>
+    bool waitUntil(int waitMs, Pred pred);
+
+    const uint32_t mask_;
+    const int slotBytes_;
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> data_;
+
+    // Producer-owned
+    alignas(64) std::atomic<int32_t> head_{0};   // highest seq stored
+    bool started_ = false;
+    int staleRun_ = 0;
+    std::atomic<uint64_t> stale_{0};
+    std::atomic<uint32_t> epoch_{0};             // bumped on every publish (futex word)
+
+    // Shared
+    alignas(64) std::atomic<int> count_{0};
+    std::atomic<uint32_t> waiters_{0};
+
+    // Consumer-owned (producer may only lower it for late packets)
+    alignas(64) std::atomic<int32_t> tail_{0};   // no stored seq is below this
+};
+
+template <typename Fill>
+bool JitterBuffer::putWith(int32_t seq, int length, Fill fill) {
+    if (length < 0 || length > slotBytes_) return false;
+
+    // More than a full ring behind head: a straggler (or a duplicate from long ago)
+    // is dropped; only a run of them means the host restarted its sequence.
+    const int32_t head = head_.load(std::memory_order_relaxed);
+    if (started_ && (int64_t)seq <= (int64_t)head - (int64_t)(mask_ + 1)) {
+        stale_.fetch_add(1, std::memory_order_relaxed);
+        if (++staleRun_ < kRestartRun) return false;
+        evictAll();
+        started_ = false;
+    }
+    staleRun_ = 0;
+
+    beginWrite(seq);
+    fill(dataFor(seq));
+    endWrite(seq, length);
+    return true;
+}
+
+template <typename Pred>
+bool JitterBuffer::waitUntil(int waitMs, Pred pred) {
+    const int64_t deadline = futex::monotonicNs() + (int64_t)waitMs * 1000000LL;
+    for (;;) {
+        const uint32_t e = epoch_.load(std::memory_order_acquire);
+        if (pred()) return true;
+        const int64_t remaining = deadline - futex::monotonicNs();
+        if (remaining <= 0) return false;
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        futex::wait(&epoch_, e, remaining);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
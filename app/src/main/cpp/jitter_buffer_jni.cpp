@@ -0,0 +1,139 @@
+#include <jni.h>
+#include <android/log.h>
+#include <climits>
+#include <new>
+
+#include "frame_aggregator.h"
+#include "jitter_buffer.h"
+#include "playout_delay.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_JITTER_BUFFER(ptr) reinterpret_cast<JitterBuffer*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_createJitterBuffer(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint capacity, jint slotBytes) {
+    if (capacity <= 0 || slotBytes <= 0) {
+        LOGE("createJitterBuffer: invalid capacity=%d slotBytes=%d", (int)capacity, (int)slotBytes);
+        return 0;
+    }
+    auto* jb = new (std::nothrow) JitterBuffer(capacity, slotBytes);
+    return reinterpret_cast<jlong>(jb);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_destroyJitterBuffer(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_JITTER_BUFFER(pointer);
+}
+
+// Validates the WS header and copies the payload straight from the receive
+// buffer into its native slot. If a PlayoutDelayController is given, the
+// arrival is reported to it in the same crossing. Returns false for
+// foreign/invalid datagrams.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_putDatagram(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jbyteArray data, jint length,
+        jlong arrivalNs, jlong delayPointer) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    if (!jb || data == nullptr) return JNI_FALSE;
+    if (length > env->GetArrayLength(data)) return JNI_FALSE;
+    if (length < wspacket::kHeaderSize) return JNI_FALSE;
+
+    uint8_t header[wspacket::kHeaderSize];
+    env->GetByteArrayRegion(data, 0, wspacket::kHeaderSize, reinterpret_cast<jbyte*>(header));
+
+    wspacket::Header h{};
+    if (!wspacket::parseHeader(header, length, &h)) return JNI_FALSE;
+    auto* delay = reinterpret_cast<PlayoutDelayController*>(delayPointer);
+
+    // An aggregate is stored frame by frame under consecutive seqs
+    if (h.flags & wspacket::kFlagAggregate) {
+        uint8_t datagram[FrameAggregator::kMaxBytes];
+        uint8_t frame[FrameAggregator::kMaxBytes];
+        wsaggregate::Frames f;
+        if (length > FrameAggregator::kMaxBytes) return JNI_FALSE;
+        env->GetByteArrayRegion(data, 0, length, reinterpret_cast<jbyte*>(datagram));
+        if (wsaggregate::parse(datagram, length, &f) < 0) return JNI_FALSE;
+        bool any = false;
+        for (int i = 0; i < f.count; ++i) {
+            wspacket::Header fh{};
+            if (!jb->putDatagram(frame, wsaggregate::frameDatagram(f, i, frame), &fh)) continue;
+            if (delay) delay->onArrival(fh.seq, fh.pts, arrivalNs);
+            any = true;
+        }
+        return any ? JNI_TRUE : JNI_FALSE;
+    }
+
+    const bool ok = jb->putWith(h.seq, h.payloadLen, [&](uint8_t* dst) {
+        env->GetByteArrayRegion(data, wspacket::kHeaderSize, h.payloadLen,
+                                reinterpret_cast<jbyte*>(dst));
+    });
+    if (ok && delay) delay->onArrival(h.seq, h.pts, arrivalNs);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_contains(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint seq) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    return (jb && jb->contains(seq)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Returns the lowest stored seq, or Long.MIN_VALUE when empty.
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_firstSeq(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    int32_t seq = 0;
+    if (!jb || !jb->firstSeq(&seq)) return LLONG_MIN;
+    return seq;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_size(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    return jb ? jb->size() : 0;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_staleDropped(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    return jb ? (jlong)jb->staleDropped() : 0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_clear(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    if (jb) jb->clear();
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_dropOlderThan(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint seq) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    if (jb) jb->dropOlderThan(seq);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_waitForSeq(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint seq, jint waitMs) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    return (jb && jb->waitForSeq(seq, waitMs)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024JitterBuffer_waitForData(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint waitMs) {
+    JitterBuffer* jb = GET_JITTER_BUFFER(pointer);
+    return (jb && jb->waitForData(waitMs)) ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
@@ -0,0 +1,52 @@
+#include "media_clock.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "packet_codec.h"
+
+MediaClock::MediaClock(int frameSamples) : MediaClock(frameSamples, Config()) {}
+
+MediaClock::MediaClock(int frameSamples, const Config& cfg)
+        : frameSamples_(frameSamples),
+          windowFrames_(std::max(1, (int)std::lround(cfg.windowMs * wspacket::kPtsRate / 1000.0 /
+                                                     frameSamples))),
+          toleranceTicks_((int64_t)(cfg.toleranceMs * wspacket::kPtsRate / 1000.0)),
+          jumpTicks_((int64_t)(cfg.jumpMs * wspacket::kPtsRate / 1000.0)) {}
+
+uint32_t MediaClock::next(int64_t completeNs) {
+    // The frame's first sample was captured (at the latest) one frame before it completed
+    const int64_t captured = wspacket::ptsTicks(completeNs) - frameSamples_;
+    if (!started_) {
+        started_ = true;
+        ticks_ = captured;
+        windowMin_ = 0;
+        inWindow_ = 0;
+        return static_cast<uint32_t>(ticks_);
+    }
+
+    ticks_ += frameSamples_;
+    if (slew_ != 0) {
+        const int64_t step = slew_ > 0 ? 1 : -1;
+        ticks_ += step;
+        slew_ -= step;
+        ++slewed_;
+    }
+
+    const int64_t lag = captured - ticks_;
+    windowMin_ = inWindow_ == 0 ? lag : std::min(windowMin_, lag);
+    if (++inWindow_ >= windowFrames_) {
+        inWindow_ = 0;
+        if (windowMin_ > jumpTicks_) {
+            // Every frame of the window arrived late: capture stalled, start afresh
+            ticks_ += windowMin_;
+            slew_ = 0;
+            ++jumps_;
+        } else if (windowMin_ > toleranceTicks_ || windowMin_ < 0) {
+            // Behind: catch up to the least-delayed frame. Ahead of a capture time
+            // (an upper bound): fall back onto it.
+            slew_ = windowMin_;
+        }
+    }
+    return static_cast<uint32_t>(ticks_);
+}
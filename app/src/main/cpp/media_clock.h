@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Host media timeline behind the wspacket pts of every frame.
+//
+// Consecutive frames are exactly frameSamples ticks apart, so guests can place every
+// sample. The origin follows the capture time of the frames, estimated from when the
+// assembler completed them: the smallest lag over each window (the least-delayed
+// frame) is slewed out at one tick per frame, and a lag beyond jumpMs (capture stalled)
+// re-anchors at once. pts therefore stays on the host's CLOCK_MONOTONIC, which is what
+// guests synchronise to. Capture thread only.
+class MediaClock {
+public:
+    struct Config {
+        double windowMs = 1000;     // lag minimum taken over this much audio
+        double toleranceMs = 1.0;   // lag left alone
+        double jumpMs = 100;        // lag re-anchored instead of slewed
+    };
+
+    explicit MediaClock(int frameSamples);
+    MediaClock(int frameSamples, const Config& cfg);
+
+    // pts for the next frame, completed at monotonic completeNs.
+    uint32_t next(int64_t completeNs);
+
+    int64_t slewedTicks() const { return slewed_; }
+    int64_t jumps() const { return jumps_; }
+
+private:
+    const int frameSamples_;
+    const int windowFrames_;
+    const int64_t toleranceTicks_;
+    const int64_t jumpTicks_;
+
+    bool started_ = false;
+    int64_t ticks_ = 0;         // unwrapped pts of the last frame
+    int64_t windowMin_ = 0;
+    int inWindow_ = 0;
+    int64_t slew_ = 0;          // ticks still to add (or remove), one per frame
+    int64_t slewed_ = 0;
+    int64_t jumps_ = 0;
+};
@@ -0,0 +1,106 @@
+#include "nack_tracker.h"
+
+#include <algorithm>
+
+NackTracker::NackTracker() : NackTracker(Config{}) {}
+
+NackTracker::NackTracker(const Config& cfg)
+    : cfg_(cfg),
+      reorderNs_((int64_t)(cfg.reorderMs * 1e6)),
+      retryNs_((int64_t)(cfg.retryMs * 1e6)),
+      maxAgeNs_((int64_t)(cfg.maxAgeMs * 1e6)),
+      tokens_(cfg.burst) {
+    missing_.reserve(kMaxMissing);
+}
+
+void NackTracker::reset() {
+    started_ = false;
+    missing_.clear();
+    tokens_ = cfg_.burst;
+    refillNs_ = 0;
+}
+
+void NackTracker::onReceived(int32_t seq, int64_t nowNs) {
+    if (!started_) {
+        started_ = true;
+        highest_ = seq;
+        return;
+    }
+
+    const int64_t diff = (int64_t)seq - (int64_t)highest_;
+    if (diff > cfg_.maxGap || diff < -(int64_t)cfg_.maxGap * 4) {
+        // Outage or host restart: nothing worth asking for
+        missing_.clear();
+        highest_ = seq;
+        return;
+    }
+
+    if (diff > 0) {
+        for (int64_t s = (int64_t)highest_ + 1; s < (int64_t)highest_ + diff; ++s) {
+            if ((int)missing_.size() == kMaxMissing) {
+                missing_.erase(missing_.begin());
+                ++stats_.abandoned;
+            }
+            missing_.push_back(Missing{(int32_t)s, nowNs, 0, 0});
+            ++stats_.lost;
+        }
+        highest_ = seq;
+        return;
+    }
+
+    // Late packet: a retransmission or reordering
+    auto it = std::lower_bound(missing_.begin(), missing_.end(), seq,
+                               [](const Missing& m, int32_t s) { return m.seq < s; });
+    if (it != missing_.end() && it->seq == seq) {
+        if (it->tries > 0) ++stats_.recovered;
+        else --stats_.lost;   // reordered before we asked: never really lost
+        missing_.erase(it);
+    }
+}
+
+void NackTracker::expire(int64_t nowNs) {
+    missing_.erase(std::remove_if(missing_.begin(), missing_.end(), [&](const Missing& m) {
+        const bool stale = nowNs - m.detectedNs > maxAgeNs_ ||
+                           (m.tries >= cfg_.maxRetries && nowNs - m.lastNackNs > retryNs_);
+        if (stale) ++stats_.abandoned;
+        return stale;
+    }), missing_.end());
+}
+
+bool NackTracker::due(const Missing& m, int64_t nowNs) const {
+    if (m.tries == 0) return nowNs - m.detectedNs >= reorderNs_;
+    return m.tries < cfg_.maxRetries && nowNs - m.lastNackNs >= retryNs_;
+}
+
+int NackTracker::collect(int64_t nowNs, wspacket::NackEntry* out, int maxEntries) {
+    expire(nowNs);
+    if (missing_.empty() || maxEntries <= 0) return 0;
+
+    if (refillNs_ != 0) {
+        tokens_ += (double)(nowNs - refillNs_) * 1e-9 * cfg_.nacksPerSec;
+        if (tokens_ > cfg_.burst) tokens_ = cfg_.burst;
+    }
+    refillNs_ = nowNs;
+    if (tokens_ < 1.0) return 0;
+
+    int count = 0;
+    for (Missing& m : missing_) {
+        if (!due(m, nowNs)) continue;
+        const uint32_t offset = count > 0 ? (uint32_t)m.seq - (uint32_t)out[count - 1].seq : 0;
+        if (count > 0 && offset >= 1 && offset <= 32) {
+            out[count - 1].bitmap |= 1u << (offset - 1);
+        } else {
+            if (count == maxEntries) break;
+            out[count++] = wspacket::NackEntry{m.seq, 0};
+        }
+        m.tries++;
+        m.lastNackNs = nowNs;
+        ++stats_.requested;
+    }
+
+    if (count > 0) {
+        tokens_ -= 1.0;
+        ++stats_.nacksSent;
+    }
+    return count;
+}
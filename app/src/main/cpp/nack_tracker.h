@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "packet_codec.h"
+
+// Guest-side loss detection and NACK scheduling.
+//
+// Every received seq is reported with onReceived(); a jump past the highest seq
+// seen marks the skipped seqs missing. collect() turns missing seqs that are due
+// into compact (seq, bitmap) NACK entries:
+//   - first request after reorderMs, so plain reordering is not NACKed,
+//   - then at most every retryMs, up to maxRetries times,
+//   - abandoned after maxAgeMs (the packet would miss its playout slot anyway).
+// NACK datagrams are token-bucket limited so a long outage can't flood the host.
+// rx thread only.
+class NackTracker {
+public:
+    struct Config {
+        double reorderMs = 5.0;
+        double retryMs = 40.0;      // ~ Wi-Fi RTT + one frame
+        int maxRetries = 3;
+        double maxAgeMs = 300.0;    // below the guest's buffer depth
+        double nacksPerSec = 25.0;
+        double burst = 4.0;
+        int maxGap = 64;            // a larger jump is an outage/restart, not loss
+    };
+
+    struct Stats {
+        int64_t lost = 0;          // seqs detected missing
+        int64_t requested = 0;     // seq requests sent (retries count again)
+        int64_t recovered = 0;     // missing seqs that arrived after a NACK
+        int64_t abandoned = 0;     // given up (too old or out of retries)
+        int64_t nacksSent = 0;     // NACK datagrams
+    };
+
+    NackTracker();
+    explicit NackTracker(const Config& cfg);
+
+    void onReceived(int32_t seq, int64_t nowNs);
+
+    // Fills up to maxEntries NACK entries for the seqs due at nowNs and marks them
+    // requested. Returns 0 when nothing is due or the rate limit holds them back.
+    int collect(int64_t nowNs, wspacket::NackEntry* out, int maxEntries);
+
+    void reset();
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    static constexpr int kMaxMissing = 128;
+
+    struct Missing {
+        int32_t seq;
+        int64_t detectedNs;
+        int64_t lastNackNs;
+        int tries;
+    };
+
+    void expire(int64_t nowNs);
+    bool due(const Missing& m, int64_t nowNs) const;
+
+    const Config cfg_;
+    const int64_t reorderNs_;
+    const int64_t retryNs_;
+    const int64_t maxAgeNs_;
+
+    bool started_ = false;
+    int32_t highest_ = 0;
+    std::vector<Missing> missing_;   // ascending seq
+    double tokens_;
+    int64_t refillNs_ = 0;
+    Stats stats_;
+};
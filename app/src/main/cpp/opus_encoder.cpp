@@ -1,20 +1,70 @@
 #include <jni.h>
 #include <android/log.h>
-#include <vector>
+#include <cstdlib>
+#include <new>
 #include <opus.h>
 #include <opus_defines.h>
 
+#include "dnn_blob.h"
+#include "dred_recovery.h"
+#include "jitter_buffer.h"
+#include "packet_codec.h"
+
 #define LOG_TAG "OpusJNI"
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
-#define GET_ENCODER(ptr) reinterpret_cast<OpusEncoder*>(ptr)
+// Largest Opus frame is 120 ms; at 48 kHz that is 5760 samples per channel.
+static constexpr int kMaxFrameSizePerChannel = 5760;
+// Largest packet we ever produce/accept (a datagram must fit in the MTU anyway).
+static constexpr int kMaxPacketBytes = 1500;
+static constexpr size_t kScratchAlign = 64;
+// Deep PLC (which DRED synthesis runs through) is on from decoder complexity 5
+static constexpr int kDredDecoderComplexity = 5;
+
+// Scratch buffers are sized once at create time, so encode/decode/FEC/PLC
+// never touch the native heap afterwards.
+static void* allocScratch(size_t bytes) {
+    // aligned_alloc requires size to be a multiple of the alignment
+    bytes = (bytes + kScratchAlign - 1) & ~(kScratchAlign - 1);
+    return std::aligned_alloc(kScratchAlign, bytes);
+}
+
+struct EncoderHandle {
+    OpusEncoder* enc;
+    int channels;
+    opus_int16* pcm;        // kMaxFrameSizePerChannel * channels
+    unsigned char* packet;  // kMaxPacketBytes
+};
 
 struct DecoderHandle {
     OpusDecoder* dec;
     int channels;
+    opus_int16* pcm;        // kMaxFrameSizePerChannel * channels
+    unsigned char* packet;  // kMaxPacketBytes
+    int sampleRate;
+    DredRecovery* dred;     // null until enableDred
 };
 
+#define GET_ENCODER_HANDLE(ptr) reinterpret_cast<EncoderHandle*>(ptr)
 #define GET_DECODER_HANDLE(ptr) reinterpret_cast<DecoderHandle*>(ptr)
+#define GET_ENCODER(ptr) ((ptr) ? GET_ENCODER_HANDLE(ptr)->enc : nullptr)
+
+static void freeEncoderHandle(EncoderHandle* h) {
+    if (!h) return;
+    if (h->enc) opus_encoder_destroy(h->enc);
+    std::free(h->pcm);
+    std::free(h->packet);
+    delete h;
+}
+
+static void freeDecoderHandle(DecoderHandle* h) {
+    if (!h) return;
+    if (h->dec) opus_decoder_destroy(h->dec);
+    delete h->dred;
+    std::free(h->pcm);
+    std::free(h->packet);
+    delete h;
+}
 
 extern "C" {
 
@@ -29,7 +79,17 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_createEncoder(
         LOGE("opus_encoder_create failed: %s", opus_strerror(err));
         return 0;
     }
-    return reinterpret_cast<jlong>(enc);
+
+    auto* handle = new EncoderHandle{enc, channels, nullptr, nullptr};
+    handle->pcm = static_cast<opus_int16*>(
+            allocScratch((size_t)kMaxFrameSizePerChannel * channels * sizeof(opus_int16)));
+    handle->packet = static_cast<unsigned char*>(allocScratch(kMaxPacketBytes));
+    if (!handle->pcm || !handle->packet) {
+        LOGE("createEncoder: scratch allocation failed");
+        freeEncoderHandle(handle);
+        return 0;
+    }
+    return reinterpret_cast<jlong>(handle);
 }
 
 JNIEXPORT jbyteArray JNICALL
@@ -47,6 +107,14 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodePcm16(
         return nullptr;
     }
 
+    // Bound frameSize first: frameSize * channels must not overflow or go negative
+    EncoderHandle* h = GET_ENCODER_HANDLE(pointer);
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel || channels != h->channels) {
+        LOGE("encodePcm16: frameSize(%d)/channels(%d) don't fit the handle scratch",
+             (int)frameSize, (int)channels);
+        return nullptr;
+    }
+
     const jsize pcmLen = env->GetArrayLength(pcm);
     if (pcmLen < frameSize * channels) {
         LOGE("encodePcm16: pcmLen(%d) < frameSize(%d) * channels(%d)",
@@ -54,23 +122,12 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodePcm16(
         return nullptr;
     }
 
-    jshort* pcmPtr = env->GetShortArrayElements(pcm, nullptr);
-    if (!pcmPtr) {
-        LOGE("encodePcm16: GetShortArrayElements returned null");
-        return nullptr;
-    }
+    const jsize needed = frameSize * channels;
+    env->GetShortArrayRegion(pcm, 0, needed, reinterpret_cast<jshort*>(h->pcm));
 
-    // If you ever increase bitrate or frame size, you may need larger.
-    const int maxPacket = 1500;
-    unsigned char out[maxPacket];
+    unsigned char* out = h->packet;
 
-    int n = opus_encode(enc,
-                        reinterpret_cast<const opus_int16*>(pcmPtr),
-                        frameSize,
-                        out,
-                        maxPacket);
-
-    env->ReleaseShortArrayElements(pcm, pcmPtr, JNI_ABORT);
+    int n = opus_encode(enc, h->pcm, frameSize, out, kMaxPacketBytes);
 
     if (n < 0) {
         LOGE("opus_encode failed: %s", opus_strerror(n));
@@ -91,43 +148,137 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodePcm16Into(
         jshortArray pcm, jint frameSize, jint channels,
         jbyteArray outBuf) {
 
-    OpusEncoder* enc = GET_ENCODER(pointer);
-    if (!enc || pcm == nullptr || outBuf == nullptr) return -1;
+    EncoderHandle* h = GET_ENCODER_HANDLE(pointer);
+    if (!h || !h->enc || pcm == nullptr || outBuf == nullptr) return -1;
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel || channels != h->channels) return -2;
     const jsize pcmLen = env->GetArrayLength(pcm);
     if (pcmLen < frameSize * channels) return -2;
 
     const jsize outCap = env->GetArrayLength(outBuf);
     if (outCap <= 0) return -3;
 
-    jshort* pcmPtr = env->GetShortArrayElements(pcm, nullptr);
-    if (!pcmPtr) return -4;
+    // Stage through the handle's preallocated scratch (no per-call allocation)
+    env->GetShortArrayRegion(pcm, 0, frameSize * channels, reinterpret_cast<jshort*>(h->pcm));
 
-    // Write directly into a temporary native buffer then copy to Java outBuf
-    // (If you want absolute max perf, use GetByteArrayElements and write there.)
-    std::vector<unsigned char> tmp((size_t)outCap);
+    const opus_int32 cap = outCap < kMaxPacketBytes ? (opus_int32)outCap : kMaxPacketBytes;
+    int n = opus_encode(h->enc, h->pcm, int(frameSize), h->packet, cap);
 
-    int n = opus_encode(enc,
-                        reinterpret_cast<const opus_int16*>(pcmPtr),
-                        int(frameSize),
-                        tmp.data(),
-                        (opus_int32)outCap);
+    if (n < 0) return n;
+
+    env->SetByteArrayRegion(outBuf, 0, n, reinterpret_cast<const jbyte*>(h->packet));
+    return n;
+}
 
-    env->ReleaseShortArrayElements(pcm, pcmPtr, JNI_ABORT);
+// -------- Direct ByteBuffer encode (zero-copy) --------
+// PCM is read in place from pcmBuf (native-order int16, interleaved) and the packet
+// is written in place into outBuf. Returns bytes written or a negative code.
 
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodePcm16Direct(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jobject pcmBuf, jint pcmOffset, jint frameSize, jint channels,
+        jobject outBuf, jint outOffset, jint outCap) {
+
+    EncoderHandle* h = GET_ENCODER_HANDLE(pointer);
+    if (!h || !h->enc || pcmBuf == nullptr || outBuf == nullptr) return -1;
+
+    auto* pcmBase = static_cast<unsigned char*>(env->GetDirectBufferAddress(pcmBuf));
+    auto* outBase = static_cast<unsigned char*>(env->GetDirectBufferAddress(outBuf));
+    if (!pcmBase || !outBase) return -7; // not a direct buffer
+
+    // Opus reads h->channels samples per frame in place: the caller must agree, and
+    // the int16 samples must start on an even byte offset
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel || channels != h->channels) return -2;
+    const jlong pcmBytes = (jlong)frameSize * channels * (jlong)sizeof(opus_int16);
+    if (pcmOffset < 0 || (pcmOffset & 1) != 0 ||
+        pcmOffset + pcmBytes > env->GetDirectBufferCapacity(pcmBuf)) return -2;
+
+    if (outCap <= 0 || outOffset < 0 ||
+        (jlong)outOffset + outCap > env->GetDirectBufferCapacity(outBuf)) return -3;
+
+    return opus_encode(h->enc,
+                       reinterpret_cast<const opus_int16*>(pcmBase + pcmOffset),
+                       int(frameSize),
+                       outBase + outOffset,
+                       (opus_int32)outCap);
+}
+
+
+
+// -------- Fused encode + WS framing --------
+// Writes the PacketCodec v1 header and the Opus payload as one datagram into outPkt.
+// Returns total datagram length (header + payload) or a negative code.
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodeFramedInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jshortArray pcm, jint frameSize, jint channels,
+        jint seq, jint pts, jint flags,
+        jbyteArray outPkt) {
+
+    EncoderHandle* h = GET_ENCODER_HANDLE(pointer);
+    if (!h || !h->enc || pcm == nullptr || outPkt == nullptr) return -1;
+
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel || channels != h->channels) return -2;
+    const jsize pcmLen = env->GetArrayLength(pcm);
+    if (pcmLen < frameSize * channels) return -2;
+
+    const jsize outCap = env->GetArrayLength(outPkt);
+    const jsize cap = outCap < kMaxPacketBytes ? outCap : kMaxPacketBytes;
+    if (cap <= wspacket::kHeaderSize) return -3;
+
+    env->GetShortArrayRegion(pcm, 0, frameSize * channels, reinterpret_cast<jshort*>(h->pcm));
+
+    // Header and payload are assembled contiguously in scratch: one copy out, no arraycopy in Kotlin
+    wspacket::writeHeader(h->packet, seq, (uint32_t)pts, flags);
+    int n = opus_encode(h->enc, h->pcm, int(frameSize),
+                        h->packet + wspacket::kHeaderSize,
+                        (opus_int32)(cap - wspacket::kHeaderSize));
     if (n < 0) return n;
 
-    env->SetByteArrayRegion(outBuf, 0, n, reinterpret_cast<const jbyte*>(tmp.data()));
-    return n;
+    const int total = wspacket::kHeaderSize + n;
+    env->SetByteArrayRegion(outPkt, 0, total, reinterpret_cast<const jbyte*>(h->packet));
+    return total;
 }
 
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_encodeFramedDirect(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jobject pcmBuf, jint pcmOffset, jint frameSize, jint channels,
+        jint seq, jint pts, jint flags,
+        jobject outBuf, jint outOffset, jint outCap) {
+
+    EncoderHandle* h = GET_ENCODER_HANDLE(pointer);
+    if (!h || !h->enc || pcmBuf == nullptr || outBuf == nullptr) return -1;
+
+    auto* pcmBase = static_cast<unsigned char*>(env->GetDirectBufferAddress(pcmBuf));
+    auto* outBase = static_cast<unsigned char*>(env->GetDirectBufferAddress(outBuf));
+    if (!pcmBase || !outBase) return -7;
+
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel || channels != h->channels) return -2;
+    const jlong pcmBytes = (jlong)frameSize * channels * (jlong)sizeof(opus_int16);
+    if (pcmOffset < 0 || (pcmOffset & 1) != 0 ||
+        pcmOffset + pcmBytes > env->GetDirectBufferCapacity(pcmBuf)) return -2;
 
+    if (outCap <= wspacket::kHeaderSize || outOffset < 0 ||
+        (jlong)outOffset + outCap > env->GetDirectBufferCapacity(outBuf)) return -3;
+
+    unsigned char* out = outBase + outOffset;
+    wspacket::writeHeader(out, seq, (uint32_t)pts, flags);
+    int n = opus_encode(h->enc,
+                        reinterpret_cast<const opus_int16*>(pcmBase + pcmOffset),
+                        int(frameSize),
+                        out + wspacket::kHeaderSize,
+                        (opus_int32)(outCap - wspacket::kHeaderSize));
+    if (n < 0) return n;
+    return wspacket::kHeaderSize + n;
+}
 
 JNIEXPORT void JNICALL
 Java_com_kunano_wavesynch_data_stream_OpusNative_00024Encoder_destroyEncoder(
         JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
-    OpusEncoder* enc = GET_ENCODER(pointer);
-    if (enc) opus_encoder_destroy(enc);
+    freeEncoderHandle(GET_ENCODER_HANDLE(pointer));
 }
 
 // Enable FEC
@@ -232,7 +383,15 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_createDecoder(
         return 0;
     }
 
-    auto* handle = new DecoderHandle{dec, channels};
+    auto* handle = new DecoderHandle{dec, channels, nullptr, nullptr, sampleRate, nullptr};
+    handle->pcm = static_cast<opus_int16*>(
+            allocScratch((size_t)kMaxFrameSizePerChannel * channels * sizeof(opus_int16)));
+    handle->packet = static_cast<unsigned char*>(allocScratch(kMaxPacketBytes));
+    if (!handle->pcm || !handle->packet) {
+        LOGE("createDecoder: scratch allocation failed");
+        freeDecoderHandle(handle);
+        return 0;
+    }
     return reinterpret_cast<jlong>(handle);
 }
 
@@ -259,6 +418,12 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16(
         return nullptr;
     }
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) {
+        LOGE("decodePcm16: invalid frameSize=%d", (int)frameSize);
+        return nullptr;
+    }
+    opus_int16* outBuf = h->pcm;
+
     const jsize packetLen = env->GetArrayLength(packet);
     jbyte* packetPtr = env->GetByteArrayElements(packet, nullptr);
     if (!packetPtr) {
@@ -266,13 +431,11 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16(
         return nullptr;
     }
 
-    std::vector<opus_int16> outBuf((size_t)frameSize * (size_t)channels);
-
     int decodedSamples = opus_decode(
             h->dec,
             reinterpret_cast<const unsigned char*>(packetPtr),
             (opus_int32)packetLen,
-            outBuf.data(),
+            outBuf,
             frameSize,
             0
     );
@@ -288,7 +451,7 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16(
     jshortArray pcm = env->NewShortArray(outCount);
     if (!pcm) return nullptr;
     env->SetShortArrayRegion(pcm, 0, outCount,
-                             reinterpret_cast<const jshort*>(outBuf.data()));
+                             reinterpret_cast<const jshort*>(outBuf));
     return pcm;
 }
 
@@ -308,13 +471,17 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePlcPcm16(
         return nullptr;
     }
 
-    std::vector<opus_int16> outBuf((size_t)frameSize * (size_t)channels);
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) {
+        LOGE("decodePlcPcm16: invalid frameSize=%d", (int)frameSize);
+        return nullptr;
+    }
+    opus_int16* outBuf = h->pcm;
 
     int decodedSamples = opus_decode(
             h->dec,
             nullptr,
             0,
-            outBuf.data(),
+            outBuf,
             frameSize,
             0
     );
@@ -328,7 +495,7 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePlcPcm16(
     jshortArray pcm = env->NewShortArray(outCount);
     if (!pcm) return nullptr;
     env->SetShortArrayRegion(pcm, 0, outCount,
-                             reinterpret_cast<const jshort*>(outBuf.data()));
+                             reinterpret_cast<const jshort*>(outBuf));
     return pcm;
 }
 
@@ -353,6 +520,12 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
         return nullptr;
     }
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) {
+        LOGE("decodeFecFromNextPcm16: invalid frameSize=%d", (int)frameSize);
+        return nullptr;
+    }
+    opus_int16* outBuf = h->pcm;
+
     const jsize packetLen = env->GetArrayLength(nextPacket);
     jbyte* packetPtr = env->GetByteArrayElements(nextPacket, nullptr);
     if (!packetPtr) {
@@ -360,13 +533,11 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
         return nullptr;
     }
 
-    std::vector<opus_int16> outBuf((size_t)frameSize * (size_t)channels);
-
     int decodedSamples = opus_decode(
             h->dec,
             reinterpret_cast<const unsigned char*>(packetPtr),
             (opus_int32)packetLen,
-            outBuf.data(),
+            outBuf,
             frameSize,
             1
     );
@@ -382,7 +553,7 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
     jshortArray pcm = env->NewShortArray(outCount);
     if (!pcm) return nullptr;
     env->SetShortArrayRegion(pcm, 0, outCount,
-                             reinterpret_cast<const jshort*>(outBuf.data()));
+                             reinterpret_cast<const jshort*>(outBuf));
     return pcm;
 }
 
@@ -401,6 +572,8 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16Into(
 
     if (outShorts == nullptr) return -3;
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+
     const int needed = frameSize * channels;
     const jsize outLen = env->GetArrayLength(outShorts);
     if (outLen < needed) return -4;
@@ -408,19 +581,16 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16Into(
     if (packet == nullptr) return -5;
 
     const jsize packetLen = env->GetArrayLength(packet);
-    if (packetLen <= 0) return -6;
-
-    // Copy packet bytes (avoid pinning)
-    std::vector<jbyte> packetBuf((size_t)packetLen);
-    env->GetByteArrayRegion(packet, 0, packetLen, packetBuf.data());
+    if (packetLen <= 0 || packetLen > kMaxPacketBytes) return -6;
 
-    std::vector<opus_int16> tmp((size_t)needed);
+    // Copy packet bytes into handle scratch (avoid pinning)
+    env->GetByteArrayRegion(packet, 0, packetLen, reinterpret_cast<jbyte*>(h->packet));
 
     int decodedSamples = opus_decode(
             h->dec,
-            reinterpret_cast<const unsigned char*>(packetBuf.data()),
+            h->packet,
             (opus_int32)packetLen,
-            tmp.data(),
+            h->pcm,
             frameSize,
             0
     );
@@ -428,7 +598,7 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16Into(
     if (decodedSamples < 0) return decodedSamples;
 
     const int outCount = decodedSamples * channels;
-    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(tmp.data()));
+    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(h->pcm));
     return outCount;
 }
 
@@ -444,17 +614,17 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePlcPcm16Into
 
     if (outShorts == nullptr) return -3;
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+
     const int needed = frameSize * channels;
     const jsize outLen = env->GetArrayLength(outShorts);
     if (outLen < needed) return -4;
 
-    std::vector<opus_int16> tmp((size_t)needed);
-
-    int decodedSamples = opus_decode(h->dec, nullptr, 0, tmp.data(), frameSize, 0);
+    int decodedSamples = opus_decode(h->dec, nullptr, 0, h->pcm, frameSize, 0);
     if (decodedSamples < 0) return decodedSamples;
 
     const int outCount = decodedSamples * channels;
-    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(tmp.data()));
+    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(h->pcm));
     return outCount;
 }
 
@@ -470,6 +640,8 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
 
     if (outShorts == nullptr) return -3;
 
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+
     const int needed = frameSize * channels;
     const jsize outLen = env->GetArrayLength(outShorts);
     if (outLen < needed) return -4;
@@ -477,18 +649,16 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
     if (nextPacket == nullptr) return -5;
 
     const jsize packetLen = env->GetArrayLength(nextPacket);
-    if (packetLen <= 0) return -6;
+    if (packetLen <= 0 || packetLen > kMaxPacketBytes) return -6;
 
-    std::vector<jbyte> packetBuf((size_t)packetLen);
-    env->GetByteArrayRegion(nextPacket, 0, packetLen, packetBuf.data());
-
-    std::vector<opus_int16> tmp((size_t)needed);
+    // Copy packet bytes into handle scratch (avoid pinning)
+    env->GetByteArrayRegion(nextPacket, 0, packetLen, reinterpret_cast<jbyte*>(h->packet));
 
     int decodedSamples = opus_decode(
             h->dec,
-            reinterpret_cast<const unsigned char*>(packetBuf.data()),
+            h->packet,
             (opus_int32)packetLen,
-            tmp.data(),
+            h->pcm,
             frameSize,
             1
     );
@@ -496,10 +666,196 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextP
     if (decodedSamples < 0) return decodedSamples;
 
     const int outCount = decodedSamples * channels;
-    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(tmp.data()));
+    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(h->pcm));
+    return outCount;
+}
+
+// -------- Decode straight from the native jitter buffer --------
+// The payload for `seq` is copied from its slot into handle scratch and decoded.
+// fec=0 consumes the slot; fec=1 decodes the LBRR data of `seq` (the NEXT packet)
+// and leaves it in place. Returns shorts written, -8 if seq is not buffered.
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFromBufferInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlong bufferPointer,
+        jint seq, jint frameSize, jshortArray outShorts, jboolean fec) {
+
+    DecoderHandle* h = GET_DECODER_HANDLE(pointer);
+    if (!h || !h->dec) return -1;
+
+    const int channels = h->channels;
+    if (channels <= 0) return -2;
+
+    if (outShorts == nullptr) return -3;
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+
+    const int needed = frameSize * channels;
+    if (env->GetArrayLength(outShorts) < needed) return -4;
+
+    auto* jb = reinterpret_cast<JitterBuffer*>(bufferPointer);
+    if (!jb) return -5;
+
+    const int packetLen = jb->copyPayload(seq, h->packet, kMaxPacketBytes, !fec);
+    if (packetLen <= 0) return -8;
+
+    int decodedSamples = opus_decode(h->dec, h->packet, (opus_int32)packetLen,
+                                     h->pcm, frameSize, fec ? 1 : 0);
+    if (decodedSamples < 0) return decodedSamples;
+
+    const int outCount = decodedSamples * channels;
+    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(h->pcm));
     return outCount;
 }
 
+// -------- Deep REDundancy (DRED) --------
+// Gives the decoder and a DRED decoder the DNN weights (DnnBlob, which must outlive
+// the decoder) and raises decoder complexity to where deep PLC runs. Returns OPUS_OK,
+// or the Opus error that left DRED off (OPUS_UNIMPLEMENTED: libopus built without it).
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_enableDred(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jlong blobPointer) {
+
+    DecoderHandle* h = GET_DECODER_HANDLE(pointer);
+    auto* blob = reinterpret_cast<const DnnBlob*>(blobPointer);
+    if (!h || !h->dec || !blob) return OPUS_BAD_ARG;
+
+    // DRED decoder first: the weights cannot be taken back from an OpusDecoder, so it
+    // only gets them once nothing else can fail
+    auto* dred = new (std::nothrow) DredRecovery(h->sampleRate);
+    if (!dred) return OPUS_ALLOC_FAIL;
+    int rc = dred->loadWeights(blob->data(), blob->size());
+    if (rc != OPUS_OK) {
+        LOGE("DRED unavailable: %s", opus_strerror(rc));
+        delete dred;
+        return rc;
+    }
+    rc = opus_decoder_ctl(h->dec, OPUS_SET_DNN_BLOB(blob->data(), blob->size()));
+    if (rc != OPUS_OK) {
+        // A refused blob leaves the decoder's deep PLC unloaded, as before the call
+        LOGE("OPUS_SET_DNN_BLOB (decoder) failed: %s", opus_strerror(rc));
+        delete dred;
+        return rc;
+    }
+    delete h->dred;
+    h->dred = dred;
+    opus_decoder_ctl(h->dec, OPUS_SET_COMPLEXITY(kDredDecoderComplexity));
+    return OPUS_OK;
+}
+
+// Synthesizes lost frame `seq` from the DRED of the first packet buffered after it
+// (left in place). Returns shorts written, -8 if no buffered packet covers seq.
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeDredFromBufferInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlong bufferPointer,
+        jint seq, jint frameSize, jshortArray outShorts) {
+
+    DecoderHandle* h = GET_DECODER_HANDLE(pointer);
+    if (!h || !h->dec) return -1;
+    if (!h->dred) return -8;
+
+    if (outShorts == nullptr) return -3;
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+    if (env->GetArrayLength(outShorts) < frameSize * h->channels) return -4;
+
+    auto* jb = reinterpret_cast<JitterBuffer*>(bufferPointer);
+    if (!jb) return -5;
+
+    const int decodedSamples = h->dred->recover(h->dec, *jb, seq, frameSize, h->pcm);
+    if (decodedSamples < 0) return decodedSamples;
+    if (decodedSamples == 0) return -8;
+
+    const int outCount = decodedSamples * h->channels;
+    env->SetShortArrayRegion(outShorts, 0, outCount, reinterpret_cast<const jshort*>(h->pcm));
+    return outCount;
+}
+
+// out[0..3] = lost frames asked for, recovered, packets parsed, not covered
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_dredStats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    DecoderHandle* h = GET_DECODER_HANDLE(pointer);
+    if (!h || !out || env->GetArrayLength(out) < 4) return;
+    const DredRecovery::Stats s = h->dred ? h->dred->stats() : DredRecovery::Stats{};
+    const jlong v[4] = {s.attempts, s.recovered, s.parses, s.uncovered};
+    env->SetLongArrayRegion(out, 0, 4, v);
+}
+
+// -------- Direct ByteBuffer decode (zero-copy) --------
+// Packet bytes are read in place from packetBuf and PCM (native-order int16, interleaved)
+// is written in place into outPcmBuf. Returns shorts written or a negative code.
+
+static jint decodeDirect(JNIEnv* env, DecoderHandle* h,
+                         jobject packetBuf, jint packetOffset, jint packetLen,
+                         jint frameSize, jobject outPcmBuf, jint outOffset, int decodeFec) {
+    if (!h || !h->dec) return -1;
+
+    const int channels = h->channels;
+    if (channels <= 0) return -2;
+
+    if (outPcmBuf == nullptr) return -3;
+    auto* outBase = static_cast<unsigned char*>(env->GetDirectBufferAddress(outPcmBuf));
+    if (!outBase) return -7;
+
+    if (frameSize <= 0 || frameSize > kMaxFrameSizePerChannel) return -4;
+    const jlong neededBytes = (jlong)frameSize * channels * (jlong)sizeof(opus_int16);
+    if (outOffset < 0 || (outOffset & 1) != 0 ||
+        outOffset + neededBytes > env->GetDirectBufferCapacity(outPcmBuf)) return -4;
+
+    const unsigned char* data = nullptr;
+    if (packetBuf != nullptr) {
+        auto* packetBase = static_cast<const unsigned char*>(env->GetDirectBufferAddress(packetBuf));
+        if (!packetBase) return -7;
+        if (packetLen <= 0) return -6;
+        if (packetOffset < 0 ||
+            (jlong)packetOffset + packetLen > env->GetDirectBufferCapacity(packetBuf)) return -5;
+        data = packetBase + packetOffset;
+    } else {
+        packetLen = 0; // PLC
+    }
+
+    int decodedSamples = opus_decode(
+            h->dec,
+            data,
+            (opus_int32)packetLen,
+            reinterpret_cast<opus_int16*>(outBase + outOffset),
+            frameSize,
+            decodeFec
+    );
+
+    if (decodedSamples < 0) return decodedSamples;
+    return decodedSamples * channels;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePcm16Direct(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jobject packetBuf, jint packetOffset, jint packetLen,
+        jint frameSize, jobject outPcmBuf, jint outOffset) {
+    if (packetBuf == nullptr) return -5;
+    return decodeDirect(env, GET_DECODER_HANDLE(pointer), packetBuf, packetOffset, packetLen,
+                        frameSize, outPcmBuf, outOffset, 0);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodePlcPcm16Direct(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jint frameSize, jobject outPcmBuf, jint outOffset) {
+    return decodeDirect(env, GET_DECODER_HANDLE(pointer), nullptr, 0, 0,
+                        frameSize, outPcmBuf, outOffset, 0);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_decodeFecFromNextPcm16Direct(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer,
+        jobject nextPacketBuf, jint packetOffset, jint packetLen,
+        jint frameSize, jobject outPcmBuf, jint outOffset) {
+    if (nextPacketBuf == nullptr) return -5;
+    return decodeDirect(env, GET_DECODER_HANDLE(pointer), nextPacketBuf, packetOffset, packetLen,
+                        frameSize, outPcmBuf, outOffset, 1);
+}
+
 // -------- NEW: Reset decoder state (useful after resync jumps) --------
 // Returns 0 on success, or opus error code.
 JNIEXPORT jint JNICALL
@@ -510,6 +866,7 @@ Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_resetDecoderState(
     if (!h || !h->dec) return -1;
 
     int rc = opus_decoder_ctl(h->dec, OPUS_RESET_STATE);
+    if (h->dred) h->dred->reset();
     if (rc != OPUS_OK) {
         LOGE("OPUS_RESET_STATE failed: %s", opus_strerror(rc));
     }
@@ -520,10 +877,7 @@ JNIEXPORT void JNICALL
 Java_com_kunano_wavesynch_data_stream_OpusNative_00024Decoder_destroyDecoder(
         JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
 
-    DecoderHandle* h = GET_DECODER_HANDLE(pointer);
-    if (!h) return;
-    if (h->dec) opus_decoder_destroy(h->dec);
-    delete h;
+    freeDecoderHandle(GET_DECODER_HANDLE(pointer));
 }
 
 } // extern "C"
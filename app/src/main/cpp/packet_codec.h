@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+
+// Native mirror of PacketCodec (Kotlin). Must stay byte-identical to version 1:
+// [0]  'W'
+// [1]  'S'
+// [2]  version
+// [3]  flags
+// [4..7]  seq (int, big endian)
+// [8..11] pts (u32, big endian)
+// [12..]  payload bytes
+//
+// pts is the presentation time of the frame's first sample on the host's
+// CLOCK_MONOTONIC, in kPtsRate ticks (wraps about every 24.8 h). Consecutive frames
+// are exactly one frame of samples apart, so a guest that knows the host clock
+// (clock_sync.h) can place every sample.
+namespace wspacket {
+
+static constexpr uint8_t kMagic0 = 'W';
+static constexpr uint8_t kMagic1 = 'S';
+static constexpr uint8_t kVersion = 1;
+static constexpr int kHeaderSize = 12;
+static constexpr int kPtsRate = 48000;
+
+// Header flag bits
+static constexpr int kFlagRetransmit = 0x01;   // resent in answer to a NACK
+static constexpr int kFlagAggregate = 0x02;    // several frames, see frame_aggregator.h
+
+struct Header {
+    int32_t seq;
+    uint32_t pts;
+    int flags;
+    int payloadLen;
+};
+
+inline void putIntBE(uint8_t* a, int32_t v) {
+    const auto u = static_cast<uint32_t>(v);
+    a[0] = static_cast<uint8_t>(u >> 24);
+    a[1] = static_cast<uint8_t>(u >> 16);
+    a[2] = static_cast<uint8_t>(u >> 8);
+    a[3] = static_cast<uint8_t>(u);
+}
+
+inline int32_t getIntBE(const uint8_t* a) {
+    return static_cast<int32_t>((uint32_t(a[0]) << 24) | (uint32_t(a[1]) << 16) |
+                                (uint32_t(a[2]) << 8) | uint32_t(a[3]));
+}
+
+// Monotonic ns <-> unwrapped pts ticks, exact and overflow-free for any uptime
+inline int64_t ptsTicks(int64_t ns) {
+    return ns / 1000000000LL * kPtsRate + ns % 1000000000LL * kPtsRate / 1000000000LL;
+}
+
+inline int64_t ptsNs(int64_t ticks) {
+    return ticks / kPtsRate * 1000000000LL + ticks % kPtsRate * 1000000000LL / kPtsRate;
+}
+
+inline void writeHeader(uint8_t* out, int32_t seq, uint32_t pts, int flags) {
+    out[0] = kMagic0;
+    out[1] = kMagic1;
+    out[2] = kVersion;
+    out[3] = static_cast<uint8_t>(flags & 0xFF);
+    putIntBE(out + 4, seq);
+    putIntBE(out + 8, static_cast<int32_t>(pts));
+}
+
+// Returns false if the datagram is too short or has the wrong magic/version.
+inline bool parseHeader(const uint8_t* in, int length, Header* h) {
+    if (length < kHeaderSize) return false;
+    if (in[0] != kMagic0 || in[1] != kMagic1 || in[2] != kVersion) return false;
+    h->flags = in[3];
+    h->seq = getIntBE(in + 4);
+    h->pts = static_cast<uint32_t>(getIntBE(in + 8));
+    h->payloadLen = length - kHeaderSize;
+    return true;
+}
+
+// NACK (guest -> host), same version byte:
+// [0]  'W'
+// [1]  'N'
+// [2]  version
+// [3]  entry count (1..kMaxNackEntries)
+// then per entry: [seq int BE][bitmap int BE]; bit i set => seq + 1 + i is missing too
+static constexpr uint8_t kNackMagic1 = 'N';
+static constexpr int kNackHeaderSize = 4;
+static constexpr int kNackEntrySize = 8;
+static constexpr int kMaxNackEntries = 32;
+static constexpr int kMaxNackBytes = kNackHeaderSize + kMaxNackEntries * kNackEntrySize;
+
+struct NackEntry {
+    int32_t seq;
+    uint32_t bitmap;
+};
+
+// Returns bytes written (out must hold kMaxNackBytes), or 0 if count is out of range.
+inline int writeNack(uint8_t* out, const NackEntry* entries, int count) {
+    if (count <= 0 || count > kMaxNackEntries) return 0;
+    out[0] = kMagic0;
+    out[1] = kNackMagic1;
+    out[2] = kVersion;
+    out[3] = static_cast<uint8_t>(count);
+    uint8_t* p = out + kNackHeaderSize;
+    for (int i = 0; i < count; ++i, p += kNackEntrySize) {
+        putIntBE(p, entries[i].seq);
+        putIntBE(p + 4, static_cast<int32_t>(entries[i].bitmap));
+    }
+    return kNackHeaderSize + count * kNackEntrySize;
+}
+
+// Returns the number of entries parsed into out (at most kMaxNackEntries), or -1.
+inline int parseNack(const uint8_t* in, int length, NackEntry* out) {
+    if (length < kNackHeaderSize) return -1;
+    if (in[0] != kMagic0 || in[1] != kNackMagic1 || in[2] != kVersion) return -1;
+    const int count = in[3];
+    if (count <= 0 || count > kMaxNackEntries) return -1;
+    if (length < kNackHeaderSize + count * kNackEntrySize) return -1;
+    const uint8_t* p = in + kNackHeaderSize;
+    for (int i = 0; i < count; ++i, p += kNackEntrySize) {
+        out[i].seq = getIntBE(p);
+        out[i].bitmap = static_cast<uint32_t>(getIntBE(p + 4));
+    }
+    return count;
+}
+
+// Receiver report (guest -> host), about once a second, same version byte:
+// [0]  'W'
+// [1]  'R'
+// [2]  version
+// [3]  fraction lost since the previous report (Q8, counted before NACK/FEC repair)
+// [4..7]   highest seq received (int BE)
+// [8..11]  cumulative packets lost (int BE)
+// [12..13] interarrival jitter (0.1 ms units, u16 BE)
+// [14..15] jitter buffer depth (frames)
+// [16..17] frames decoded     } since the
+// [18..19] frames from FEC    } previous
+// [20..21] frames concealed   } report
+// [22..23] frames from DRED   }
+static constexpr uint8_t kReportMagic1 = 'R';
+static constexpr int kReportSize = 24;
+
+struct Report {
+    int32_t highestSeq;
+    int32_t cumulativeLost;
+    int fractionLost;   // 0..255
+    int jitterTenthMs;
+    int depthFrames;
+    int decoded;
+    int fec;
+    int plc;
+    int dred;
+};
+
+inline void putU16BE(uint8_t* a, int v) {
+    const int c = v < 0 ? 0 : (v > 0xFFFF ? 0xFFFF : v);
+    a[0] = static_cast<uint8_t>(c >> 8);
+    a[1] = static_cast<uint8_t>(c);
+}
+
+inline int getU16BE(const uint8_t* a) { return (a[0] << 8) | a[1]; }
+
+// Writes kReportSize bytes; 16-bit fields saturate.
+inline int writeReport(uint8_t* out, const Report& r) {
+    out[0] = kMagic0;
+    out[1] = kReportMagic1;
+    out[2] = kVersion;
+    out[3] = static_cast<uint8_t>(r.fractionLost < 0 ? 0 : (r.fractionLost > 255 ? 255 : r.fractionLost));
+    putIntBE(out + 4, r.highestSeq);
+    putIntBE(out + 8, r.cumulativeLost);
+    putU16BE(out + 12, r.jitterTenthMs);
+    putU16BE(out + 14, r.depthFrames);
+    putU16BE(out + 16, r.decoded);
+    putU16BE(out + 18, r.fec);
+    putU16BE(out + 20, r.plc);
+    putU16BE(out + 22, r.dred);
+    return kReportSize;
+}
+
+// Returns false if the datagram is not a receiver report.
+inline bool parseReport(const uint8_t* in, int length, Report* r) {
+    if (length < kReportSize) return false;
+    if (in[0] != kMagic0 || in[1] != kReportMagic1 || in[2] != kVersion) return false;
+    r->fractionLost = in[3];
+    r->highestSeq = getIntBE(in + 4);
+    r->cumulativeLost = getIntBE(in + 8);
+    r->jitterTenthMs = getU16BE(in + 12);
+    r->depthFrames = getU16BE(in + 14);
+    r->decoded = getU16BE(in + 16);
+    r->fec = getU16BE(in + 18);
+    r->plc = getU16BE(in + 20);
+    r->dred = getU16BE(in + 22);
+    return true;
+}
+
+// Clock exchange, NTP style, same version byte. Request (guest -> host):
+// [0]  'W'
+// [1]  'T'
+// [2]  version
+// [3]  0
+// [4..11]  t1: guest send time (ns, int64 BE)
+// Reply (host -> the request's source), [3] = kClockReply:
+// [12..19] t2: host receive time
+// [20..27] t3: host send time
+// Both clocks are CLOCK_MONOTONIC of their own device.
+static constexpr uint8_t kClockMagic1 = 'T';
+static constexpr int kClockReply = 1;
+static constexpr int kClockRequestSize = 12;
+static constexpr int kClockReplySize = 28;
+
+struct ClockExchange {
+    int64_t t1;
+    int64_t t2;   // reply only
+    int64_t t3;   // reply only
+};
+
+inline void putLongBE(uint8_t* a, int64_t v) {
+    putIntBE(a, static_cast<int32_t>(static_cast<uint64_t>(v) >> 32));
+    putIntBE(a + 4, static_cast<int32_t>(v));
+}
+
+inline int64_t getLongBE(const uint8_t* a) {
+    return static_cast<int64_t>((uint64_t(uint32_t(getIntBE(a))) << 32) | uint32_t(getIntBE(a + 4)));
+}
+
+inline int writeClockRequest(uint8_t* out, int64_t t1) {
+    out[0] = kMagic0;
+    out[1] = kClockMagic1;
+    out[2] = kVersion;
+    out[3] = 0;
+    putLongBE(out + 4, t1);
+    return kClockRequestSize;
+}
+
+inline int writeClockReply(uint8_t* out, const ClockExchange& c) {
+    out[0] = kMagic0;
+    out[1] = kClockMagic1;
+    out[2] = kVersion;
+    out[3] = kClockReply;
+    putLongBE(out + 4, c.t1);
+    putLongBE(out + 12, c.t2);
+    putLongBE(out + 20, c.t3);
+    return kClockReplySize;
+}
+
+// Returns 0 for a request, kClockReply for a reply (t2/t3 filled), -1 otherwise.
+inline int parseClock(const uint8_t* in, int length, ClockExchange* c) {
+    if (length < kClockRequestSize) return -1;
+    if (in[0] != kMagic0 || in[1] != kClockMagic1 || in[2] != kVersion) return -1;
+    c->t1 = getLongBE(in + 4);
+    if (in[3] != kClockReply) return 0;
+    if (length < kClockReplySize) return -1;
+    c->t2 = getLongBE(in + 12);
+    c->t3 = getLongBE(in + 20);
+    return kClockReply;
+}
+
+} // namespace wspacket
@@ -0,0 +1,45 @@
+#include "pcm_ring.h"
+
+static uint32_t roundUpPow2(int n) {
+    uint32_t v = 1;
+    while ((int)v < n) v <<= 1;
+    return v;
+}
+
+PcmRing::PcmRing(int capacity, int frameShorts)
+    : mask_(roundUpPow2(capacity) - 1),
+      frameShorts_(frameShorts),
+      slots_(mask_ + 1),
+      pcm_((size_t)(mask_ + 1) * frameShorts, 0) {}
+
+int PcmRing::size() const {
+    const uint32_t h = head_.load(std::memory_order_acquire);
+    const uint32_t t = tail_.load(std::memory_order_relaxed);
+    const uint32_t n = h - t;
+    return n > mask_ + 1 ? (int)(mask_ + 1) : (int)n;
+}
+
+void PcmRing::close() {
+    closed_.store(true, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    futex::wakeAll(&epoch_);
+}
+
+bool PcmRing::waitForData(int waitMs) {
+    const int64_t deadline = futex::monotonicNs() + (int64_t)waitMs * 1000000LL;
+    for (;;) {
+        // Register first: a publish after this either changes epoch_ (the futex
+        // wait then returns at once) or sees the waiter and wakes it
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t e = epoch_.load(std::memory_order_seq_cst);
+        const bool closed = closed_.load(std::memory_order_acquire);
+        const bool ready = head_.load(std::memory_order_acquire) != tail_.load(std::memory_order_relaxed);
+        const int64_t remaining = deadline - futex::monotonicNs();
+        if (!closed && !ready && remaining > 0) futex::wait(&epoch_, e, remaining);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+
+        if (closed) return false;
+        if (ready) return true;
+        if (remaining <= 0) return false;
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "futex.h"
+
+// Host capture -> encode handoff: a ring of fixed PCM frame slots.
+//
+// Single producer (capture thread), single consumer (send thread), no locks. The
+// producer never waits: when the consumer falls a whole ring behind, the oldest
+// frames are overwritten. Each slot carries a seqlock tag (write index, odd while
+// writing), so a consumer read that races an overwrite is detected and skipped
+// rather than returning a torn frame. The consumer sleeps on a futex word bumped
+// by every publish and by close(); the producer only makes the wake syscall when
+// someone is waiting.
+//
+// Head, tail and the shared counters sit on separate cache lines so the two
+// threads do not bounce one line on every frame.
+class PcmRing {
+public:
+    struct Frame {
+        int32_t seq = 0;
+        uint32_t pts = 0;      // wspacket pts of the first sample
+        int64_t readyNs = 0;   // monotonic time the frame was complete
+    };
+
+    // capacity is rounded up to a power of two.
+    PcmRing(int capacity, int frameShorts);
+
+    int frameShorts() const { return frameShorts_; }
+    int capacity() const { return (int)(mask_ + 1); }
+
+    // ---- Producer (capture thread) ----
+
+    // Publishes one frame; `fill(dst)` writes frameShorts() samples into the slot.
+    template <typename Fill>
+    void write(const Frame& meta, Fill fill);
+
+    void write(const int16_t* pcm, const Frame& meta) {
+        write(meta, [&](int16_t* dst) { memcpy(dst, pcm, (size_t)frameShorts_ * 2); });
+    }
+
+    // ---- Consumer (send thread) ----
+
+    // Takes the oldest frame still in the ring, waiting up to waitMs for one.
+    // `copy(src)` reads frameShorts() samples out of the slot; it may run more than
+    // once if the producer overwrites the slot mid-copy. Returns false on timeout
+    // or after close().
+    template <typename Copy>
+    bool read(Frame* meta, int waitMs, Copy copy);
+
+    // Drops everything queued.
+    void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_relaxed); }
+
+    // ---- Any thread ----
+
+    int size() const;
+    uint64_t written() const { return head64_.load(std::memory_order_relaxed); }
+    uint64_t overwritten() const { return overwritten_.load(std::memory_order_relaxed); }
+
+    // Wakes the consumer and makes every later read() return false.
+    void close();
+
+private:
+    static uint64_t tagFor(uint32_t index, bool writing) {
+        return ((uint64_t)index << 1) | (writing ? 1u : 0u);
+    }
+
+    struct Slot {
+        std::atomic<uint64_t> tag{~0ull};
+        Frame meta;
+    };
+
+    bool waitForData(int waitMs);
+
+    const uint32_t mask_;
+    const int frameShorts_;
+    std::vector<Slot> slots_;
+    std::vector<int16_t> pcm_;
+
+    // Producer-owned
+    alignas(64) std::atomic<uint32_t> head_{0};
+    std::atomic<uint64_t> head64_{0};           // frames ever written, for stats
+
+    // Shared
+    alignas(64) std::atomic<uint32_t> epoch_{0};   // futex word
+    std::atomic<uint32_t> waiters_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<uint64_t> overwritten_{0};
+
+    // Consumer-owned
+    alignas(64) std::atomic<uint32_t> tail_{0};
+};
+
+template <typename Fill>
+void PcmRing::write(const Frame& meta, Fill fill) {
+    const uint32_t i = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[i & mask_];
+
+    slot.tag.store(tagFor(i, true), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.meta = meta;
+    fill(pcm_.data() + (size_t)(i & mask_) * frameShorts_);
+    slot.tag.store(tagFor(i, false), std::memory_order_release);
+
+    head_.store(i + 1, std::memory_order_release);
+    head64_.store(head64_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) != 0) futex::wakeAll(&epoch_);
+}
+
+template <typename Copy>
+bool PcmRing::read(Frame* meta, int waitMs, Copy copy) {
+    for (;;) {
+        if (!waitForData(waitMs)) return false;
+
+        uint32_t t = tail_.load(std::memory_order_relaxed);
+        const uint32_t h = head_.load(std::memory_order_acquire);
+        const uint32_t ring = mask_ + 1;
+        if (h - t > ring) {
+            // Lapped: everything older than one ring behind head is gone
+            overwritten_.fetch_add(h - t - ring, std::memory_order_relaxed);
+            t = h - ring;
+        }
+
+        Slot& slot = slots_[t & mask_];
+        const uint64_t tag = slot.tag.load(std::memory_order_acquire);
+        if (tag == tagFor(t, false)) {
+            const Frame m = slot.meta;
+            copy(pcm_.data() + (size_t)(t & mask_) * frameShorts_);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.tag.load(std::memory_order_relaxed) == tag) {
+                tail_.store(t + 1, std::memory_order_relaxed);
+                *meta = m;
+                return true;
+            }
+        }
+        // The producer reused the slot under us: that frame is lost, move on
+        overwritten_.fetch_add(1, std::memory_order_relaxed);
+        tail_.store(t + 1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,101 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+
+#include "pcm_ring.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_PCM_RING(ptr) reinterpret_cast<PcmRing*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_createPcmRing(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint capacity, jint frameShorts) {
+    if (capacity <= 0 || capacity > 4096 || frameShorts <= 0) {
+        LOGE("createPcmRing: invalid capacity=%d frameShorts=%d", (int)capacity, (int)frameShorts);
+        return 0;
+    }
+    auto* ring = new (std::nothrow) PcmRing(capacity, frameShorts);
+    return reinterpret_cast<jlong>(ring);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_destroyPcmRing(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_PCM_RING(pointer);
+}
+
+// Copies one frame from pcm straight into its slot. Never blocks; a full ring
+// overwrites its oldest frame.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_write(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray pcm, jint seq, jint pts) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    if (!ring) return -1;
+    const jsize shorts = ring->frameShorts();
+    if (!pcm || env->GetArrayLength(pcm) < shorts) return -2;
+
+    const PcmRing::Frame meta{seq, (uint32_t)pts, futex::monotonicNs()};
+    ring->write(meta, [&](int16_t* dst) {
+        env->GetShortArrayRegion(pcm, 0, shorts, reinterpret_cast<jshort*>(dst));
+    });
+    return 0;
+}
+
+// Waits up to waitMs for the oldest frame and copies it into out, with
+// meta[0] = seq, meta[1] = pts. Returns 1, 0 on timeout / after close, or a negative code.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_read(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray out, jintArray meta, jint waitMs) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    if (!ring) return -1;
+    const jsize shorts = ring->frameShorts();
+    if (!out || env->GetArrayLength(out) < shorts || !meta || env->GetArrayLength(meta) < 2) {
+        return -2;
+    }
+
+    PcmRing::Frame f;
+    const bool got = ring->read(&f, waitMs, [&](const int16_t* src) {
+        env->SetShortArrayRegion(out, 0, shorts, reinterpret_cast<const jshort*>(src));
+    });
+    if (!got) return 0;
+    const jint m[2] = {f.seq, (jint)f.pts};
+    env->SetIntArrayRegion(meta, 0, 2, m);
+    return 1;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_size(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    return ring ? ring->size() : 0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_clear(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    if (ring) ring->clear();
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_close(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    if (ring) ring->close();
+}
+
+// out[0..2] = frames written, frames overwritten before being read, frames queued
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PcmRing_stats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    PcmRing* ring = GET_PCM_RING(pointer);
+    if (!ring || !out || env->GetArrayLength(out) < 3) return;
+    const jlong v[3] = {(jlong)ring->written(), (jlong)ring->overwritten(), ring->size()};
+    env->SetLongArrayRegion(out, 0, 3, v);
+}
+
+} // extern "C"
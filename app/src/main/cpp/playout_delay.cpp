@@ -0,0 +1,139 @@
+#include "playout_delay.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "packet_codec.h"
+
+// Packets (one per frame) in `ms` of audio, at least one
+static int framesIn(double ms, double frameMs) {
+    return std::max(1, (int)std::lround(ms / frameMs));
+}
+
+PlayoutDelayController::PlayoutDelayController(const Config& cfg)
+        : cfg_(cfg),
+          bins_(kBins, 0.0),
+          growth_(std::pow(2.0, 1.0 / framesIn(cfg.histogramHalfLifeMs, cfg.frameMs))),
+          attack_(1.0 - std::exp(-cfg.frameMs / cfg.attackMs)),
+          decay_(1.0 - std::exp(-cfg.frameMs / cfg.decayMs)),
+          creepMsPerPacket_(cfg.baselineCreepMsPerSec * cfg.frameMs / 1000.0),
+          quantileEvery_(framesIn(cfg.quantileEveryMs, cfg.frameMs)),
+          adaptEvery_(framesIn(cfg.adaptEveryMs, cfg.frameMs)),
+          delayMs_((double)cfg.initialFrames * cfg.frameMs),
+          targetFrames_(cfg.initialFrames),
+          quantile_(cfg.quantile) {}
+
+void PlayoutDelayController::reset() {
+    // Applied by the rx thread on its next packet so the histogram keeps a single writer
+    resetRequested_.store(true, std::memory_order_release);
+}
+
+// ---------------- rx thread ----------------
+
+void PlayoutDelayController::onArrival(int32_t /*seq*/, uint32_t pts, int64_t arrivalNs) {
+    if (resetRequested_.exchange(false, std::memory_order_acq_rel)) {
+        haveLast_ = false;
+        haveBaseline_ = false;
+        jitter_ = 0;
+        std::fill(bins_.begin(), bins_.end(), 0.0);
+        weight_ = 1.0;
+        total_ = 0;
+    }
+
+    const double arrivalMs = (double)arrivalNs / 1e6;
+
+    // RFC 3550 interarrival jitter: J += (|D| - J) / 16
+    if (haveLast_) {
+        const double sendDelta =
+                (double)(int32_t)(pts - lastPts_) * 1000.0 / wspacket::kPtsRate;
+        const double d = (arrivalMs - lastArrivalMs_) - sendDelta;
+        jitter_ += (std::fabs(d) - jitter_) / 16.0;
+        jitterMs_.store(jitter_, std::memory_order_relaxed);
+        sendMs_ += sendDelta;
+    } else {
+        sendMs_ = 0;
+    }
+    haveLast_ = true;
+    lastPts_ = pts;
+    lastArrivalMs_ = arrivalMs;
+
+    // Lateness = transit above the fastest recent transit. Host and guest clocks
+    // are unrelated, so only differences of transit are meaningful.
+    const double transit = arrivalMs - sendMs_;
+    if (!haveBaseline_) {
+        baselineTransitMs_ = transit;
+        haveBaseline_ = true;
+    } else {
+        baselineTransitMs_ += creepMsPerPacket_;
+        if (transit < baselineTransitMs_) baselineTransitMs_ = transit;
+    }
+    addLateness(transit - baselineTransitMs_);
+
+    if (++sinceQuantile_ >= quantileEvery_) {
+        sinceQuantile_ = 0;
+        const double q = quantile_.load(std::memory_order_relaxed);
+        quantileDelayMs_.store(computeQuantileMs(q), std::memory_order_relaxed);
+    }
+}
+
+void PlayoutDelayController::addLateness(double latenessMs) {
+    int bin = (int)(latenessMs / kBinMs);
+    bin = std::clamp(bin, 0, kBins - 1);
+
+    // Exponential decay without touching every bin: each new sample weighs a bit
+    // more than the last; renormalise once the weights get large.
+    bins_[bin] += weight_;
+    total_ += weight_;
+    weight_ *= growth_;
+    if (weight_ > 1e12) {
+        for (double& b : bins_) b /= weight_;
+        total_ /= weight_;
+        weight_ = 1.0;
+    }
+}
+
+double PlayoutDelayController::computeQuantileMs(double q) const {
+    if (total_ <= 0) return 0;
+    const double want = q * total_;
+    double acc = 0;
+    for (int i = 0; i < kBins; i++) {
+        acc += bins_[i];
+        if (acc >= want) return (double)(i + 1) * kBinMs;
+    }
+    return (double)kBins * kBinMs;
+}
+
+// ---------------- playout thread ----------------
+
+int PlayoutDelayController::onFrame(Outcome outcome) {
+    framesSinceAdapt_++;
+    if (outcome == kPlc) plcSinceAdapt_++;
+
+    // PLC-rate loop: once a second, move the quantile toward the PLC goal
+    if (framesSinceAdapt_ >= adaptEvery_) {
+        const double rate = (double)plcSinceAdapt_ / framesSinceAdapt_;
+        double plc = plcRate_.load(std::memory_order_relaxed);
+        plc += (rate - plc) * 0.2;
+        plcRate_.store(plc, std::memory_order_relaxed);
+
+        double q = quantile_.load(std::memory_order_relaxed);
+        // Work in "tail mass" (1 - q) so steps are proportional near 1.0
+        double tail = 1.0 - q;
+        if (plc > cfg_.targetPlcRate * 1.5) tail *= 0.7;
+        else if (plc < cfg_.targetPlcRate * 0.5) tail *= 1.1;
+        q = std::clamp(1.0 - tail, cfg_.minQuantile, cfg_.maxQuantile);
+        quantile_.store(q, std::memory_order_relaxed);
+
+        framesSinceAdapt_ = 0;
+        plcSinceAdapt_ = 0;
+    }
+
+    // Fast attack / slow decay toward the quantile target (+ one frame to cover decode cadence)
+    const double wanted = quantileDelayMs_.load(std::memory_order_relaxed) + cfg_.marginMs + cfg_.frameMs;
+    if (wanted > delayMs_) delayMs_ += (wanted - delayMs_) * attack_;
+    else delayMs_ += (wanted - delayMs_) * decay_;
+
+    const int frames = std::clamp((int)std::ceil(delayMs_ / cfg_.frameMs), cfg_.minFrames, cfg_.maxFrames);
+    targetFrames_.store(frames, std::memory_order_relaxed);
+    return frames;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Statistical playout-delay controller for the guest.
+//
+// The rx thread feeds every packet's (seq, sender pts, local arrival time).
+// From that it keeps an RFC 3550 interarrival jitter estimate and an
+// exponentially decaying histogram of arrival lateness (transit time above the
+// fastest recent transit). The playout delay target is a quantile of that
+// histogram, approached with a fast-attack / slow-decay filter. The quantile
+// itself is nudged up or down so the measured PLC rate holds a configured goal.
+//
+// Inputs are plain numbers, so recorded arrival traces can be replayed through
+// the same class offline on Linux to tune the constants.
+class PlayoutDelayController {
+public:
+    struct Config {
+        double frameMs = 20;           // negotiated Opus frame duration (2.5 .. 60)
+        int minFrames = 4;
+        int maxFrames = 25;
+        int initialFrames = 10;
+
+        double quantile = 0.99;        // starting lateness quantile
+        double minQuantile = 0.90;
+        double maxQuantile = 0.9995;
+        double targetPlcRate = 0.005;  // PLC frames / played frames to hold
+
+        // Time constants, so behaviour does not depend on the frame duration
+        double attackMs = 70;          // when the target must grow
+        double decayMs = 10000;        // when the target may shrink
+        double histogramHalfLifeMs = 30000;
+        double baselineCreepMsPerSec = 1.0; // lets the baseline follow clock skew
+        double quantileEveryMs = 100;  // histogram scan period
+        double adaptEveryMs = 1000;    // PLC-rate loop period
+        double marginMs = 5.0;         // decode/scheduling headroom on top of the quantile
+    };
+
+    // kFec and kDred are recovered audio: only kPlc counts towards the PLC rate
+    enum Outcome { kDecoded = 0, kFec = 1, kPlc = 2, kDred = 3 };
+
+    explicit PlayoutDelayController(const Config& cfg);
+
+    // ---- rx thread ----
+    void onArrival(int32_t seq, uint32_t pts, int64_t arrivalNs);
+
+    // ---- playout thread ----
+    // Reports how the frame just played was produced; returns the target in frames.
+    int onFrame(Outcome outcome);
+    int targetFrames() const { return targetFrames_.load(std::memory_order_relaxed); }
+
+    // ---- metrics (any thread) ----
+    double jitterMs() const { return jitterMs_.load(std::memory_order_relaxed); }
+    double quantileDelayMs() const { return quantileDelayMs_.load(std::memory_order_relaxed); }
+    double plcRate() const { return plcRate_.load(std::memory_order_relaxed); }
+    double currentQuantile() const { return quantile_.load(std::memory_order_relaxed); }
+
+    void reset();
+
+private:
+    static constexpr int kBinMs = 1;
+    static constexpr int kBins = 1000;   // lateness above 1 s is clamped into the last bin
+
+    void addLateness(double latenessMs);
+    double computeQuantileMs(double q) const;
+
+    const Config cfg_;
+
+    // rx-thread state
+    bool haveLast_ = false;
+    uint32_t lastPts_ = 0;
+    double sendMs_ = 0;            // pts unwrapped, ms
+    double lastArrivalMs_ = 0;
+    double jitter_ = 0;
+    bool haveBaseline_ = false;
+    double baselineTransitMs_ = 0;
+    std::vector<double> bins_;
+    double weight_ = 1.0;     // weight of the next sample (grows instead of decaying all bins)
+    double total_ = 0;
+    double growth_;
+    int sinceQuantile_ = 0;
+
+    // Per-frame / per-packet forms of the Config time constants
+    const double attack_;
+    const double decay_;
+    const double creepMsPerPacket_;
+    const int quantileEvery_;
+    const int adaptEvery_;
+
+    // playout-thread state
+    double delayMs_;
+    int framesSinceAdapt_ = 0;
+    int plcSinceAdapt_ = 0;
+
+    // published
+    std::atomic<int> targetFrames_;
+    std::atomic<double> jitterMs_{0};
+    std::atomic<double> quantileDelayMs_{0};
+    std::atomic<double> plcRate_{0};
+    std::atomic<double> quantile_;
+    std::atomic<bool> resetRequested_{false};
+};
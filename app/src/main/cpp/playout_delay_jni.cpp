@@ -0,0 +1,85 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+
+#include "playout_delay.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_DELAY_CONTROLLER(ptr) reinterpret_cast<PlayoutDelayController*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_createController(
+        JNIEnv* /*env*/, jobject /*thiz*/, jdouble frameMs, jint minFrames, jint maxFrames,
+        jint initialFrames, jdouble targetPlcRate) {
+    if (!(frameMs > 0) || minFrames <= 0 || maxFrames < minFrames) {
+        LOGE("createController: invalid frameMs=%.1f min=%d max=%d",
+             (double)frameMs, (int)minFrames, (int)maxFrames);
+        return 0;
+    }
+    PlayoutDelayController::Config cfg;
+    cfg.frameMs = frameMs;
+    cfg.minFrames = minFrames;
+    cfg.maxFrames = maxFrames;
+    cfg.initialFrames = initialFrames < minFrames ? minFrames
+                      : (initialFrames > maxFrames ? maxFrames : initialFrames);
+    cfg.targetPlcRate = targetPlcRate;
+    return reinterpret_cast<jlong>(new (std::nothrow) PlayoutDelayController(cfg));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_destroyController(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_DELAY_CONTROLLER(pointer);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_onFrame(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint outcome) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    if (!c) return 0;
+    if (outcome < PlayoutDelayController::kDecoded || outcome > PlayoutDelayController::kDred) {
+        outcome = PlayoutDelayController::kPlc;
+    }
+    return c->onFrame(static_cast<PlayoutDelayController::Outcome>(outcome));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_targetFrames(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    return c ? c->targetFrames() : 0;
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_jitterMs(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    return c ? c->jitterMs() : 0.0;
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_quantileDelayMs(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    return c ? c->quantileDelayMs() : 0.0;
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_plcRate(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    return c ? c->plcRate() : 0.0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024PlayoutDelayController_reset(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    PlayoutDelayController* c = GET_DELAY_CONTROLLER(pointer);
+    if (c) c->reset();
+}
+
+} // extern "C"
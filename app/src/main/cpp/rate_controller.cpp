@@ -0,0 +1,202 @@
+#include "rate_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "fec.h"
+
+namespace {
+
+// FEC ladder: step up once smoothed loss reaches `up`, back down below `down`
+struct FecStep {
+    double up;
+    double down;
+    int scheme;
+    int k;
+    int m;
+};
+
+constexpr FecStep kFecLadder[] = {
+        {0.0, 0.0, -1, 0, 0},
+        {0.01, 0.005, wsfec::kXor, 4, 1},
+        {0.03, 0.015, wsfec::kReedSolomon, 8, 2},
+        {0.06, 0.035, wsfec::kReedSolomon, 8, 4},
+};
+constexpr int kFecSteps = (int)(sizeof(kFecLadder) / sizeof(kFecLadder[0]));
+
+} // namespace
+
+RateController::RateController() : RateController(Config{}) {}
+
+RateController::RateController(const Config& cfg)
+    : cfg_(cfg),
+      holdNs_((int64_t)(cfg.holdMs * 1e6)),
+      probeAfterNs_((int64_t)(cfg.probeAfterMs * 1e6)),
+      staleNs_((int64_t)(cfg.staleMs * 1e6)),
+      budget_(cfg.maxBitrate) {}
+
+void RateController::onReport(int peer, const sockaddr_in6& from, const wspacket::Report& r,
+                              int64_t nowNs) {
+    if (peer < 0 || peer >= kMaxPeers) return;
+    ++stats_.reports;
+
+    Peer& p = peers_[peer];
+    const double loss = r.fractionLost / 256.0;
+    const double jitterMs = r.jitterTenthMs / 10.0;
+    const int played = r.decoded + r.fec + r.dred + r.plc;
+    const double a = cfg_.smoothing;
+
+    const bool sameGuest = p.addr.sin6_port == from.sin6_port &&
+                           std::memcmp(&p.addr.sin6_addr, &from.sin6_addr, sizeof(in6_addr)) == 0;
+    if (!p.used || !sameGuest || nowNs - p.lastNs > staleNs_) {
+        p = Peer{};
+        p.used = true;
+        p.addr = from;
+        p.loss = loss;
+        p.jitterMs = jitterMs;
+        p.plc = played > 0 ? (double)r.plc / played : 0.0;
+    } else {
+        p.loss += a * (loss - p.loss);
+        p.jitterMs += a * (jitterMs - p.jitterMs);
+        if (played > 0) p.plc += a * ((double)r.plc / played - p.plc);
+    }
+    p.lastNs = nowNs;
+
+    placeTier(peer, p, from, nowNs);
+    update(nowNs);
+}
+
+void RateController::placeTier(int peer, Peer& p, const sockaddr_in6& from, int64_t nowNs) {
+    if (cfg_.tiers > 1) {
+        const bool bad = p.loss > cfg_.demoteLoss || p.plc > cfg_.demotePlc ||
+                         p.jitterMs > cfg_.demoteJitterMs;
+        const bool good = p.loss < cfg_.promoteLoss && p.plc < cfg_.promotePlc &&
+                          p.jitterMs < cfg_.promoteJitterMs;
+        if (bad) {
+            p.lastBadNs = nowNs;
+            if (p.tier < cfg_.tiers - 1 && nowNs - p.tierNs >= holdNs_) {
+                ++p.tier;
+                p.tierNs = nowNs;
+                ++stats_.tierMoves;
+            }
+        } else if (good && p.tier > 0 && nowNs - p.lastBadNs >= probeAfterNs_ &&
+                   nowNs - p.tierNs >= probeAfterNs_) {
+            --p.tier;
+            p.tierNs = nowNs;
+            ++stats_.tierMoves;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(routesMu_);
+    Route& route = routes_[peer];
+    route.used = true;
+    route.addr = from;
+    route.tier = p.tier;
+    route.lastNs = nowNs;
+}
+
+int RateController::tierOf(int peer) const {
+    if (peer < 0 || peer >= kMaxPeers || !peers_[peer].used) return 0;
+    return peers_[peer].tier;
+}
+
+int RateController::tierFor(const sockaddr_in6& addr, int64_t nowNs) const {
+    std::lock_guard<std::mutex> lock(routesMu_);
+    for (const Route& r : routes_) {
+        if (r.used && r.addr.sin6_port == addr.sin6_port &&
+            std::memcmp(&r.addr.sin6_addr, &addr.sin6_addr, sizeof(in6_addr)) == 0) {
+            return nowNs - r.lastNs > staleNs_ ? 0 : r.tier;
+        }
+    }
+    return 0;
+}
+
+void RateController::update(int64_t nowNs) {
+    double loss = 0, plc = 0, jitterMs = 0;
+    int active = 0;
+    // With simulcast only tier-0 guests steer tier 0, unless every guest has been moved down
+    bool anyTop = false;
+    for (const Peer& p : peers_) {
+        if (p.used && nowNs - p.lastNs <= staleNs_ && p.tier == 0) anyTop = true;
+    }
+    for (const Peer& p : peers_) {
+        if (!p.used || nowNs - p.lastNs > staleNs_) continue;
+        if (anyTop && p.tier != 0) continue;
+        loss = std::max(loss, p.loss);
+        plc = std::max(plc, p.plc);
+        jitterMs = std::max(jitterMs, p.jitterMs);
+        ++active;
+    }
+    if (active == 0) return;
+
+    // FEC: up as soon as loss calls for it, down only after a quiet period
+    int step = fecStep_;
+    while (step + 1 < kFecSteps && loss >= kFecLadder[step + 1].up) ++step;
+    if (step == fecStep_ && nowNs - lastFecNs_ >= probeAfterNs_) {
+        while (step > 0 && loss < kFecLadder[step].down) --step;
+    }
+    if (step != fecStep_) {
+        fecStep_ = step;
+        lastFecNs_ = nowNs;
+        ++stats_.fecChanges;
+    }
+
+    // Budget: multiplicative decrease on congestion, additive probing when quiet
+    const bool congested = plc > cfg_.plcCongested || jitterMs > cfg_.jitterCongestedMs ||
+                           (fecStep_ == kFecSteps - 1 && loss > cfg_.lossCongested);
+    if (congested) {
+        lastCongestedNs_ = nowNs;
+        if (nowNs - lastBudgetNs_ >= holdNs_ && budget_ > cfg_.minBitrate) {
+            budget_ = std::max<double>(cfg_.minBitrate, budget_ * cfg_.backoff);
+            lastBudgetNs_ = nowNs;
+            ++stats_.backoffs;
+        }
+    } else if (nowNs - lastCongestedNs_ >= probeAfterNs_ && nowNs - lastBudgetNs_ >= holdNs_ &&
+               budget_ < cfg_.maxBitrate) {
+        budget_ = std::min<double>(cfg_.maxBitrate, budget_ + cfg_.stepUp);
+        lastBudgetNs_ = nowNs;
+        ++stats_.probes;
+    }
+
+    const FecStep& t = kFecLadder[fecStep_];
+    const double audio = t.k > 0 ? budget_ * t.k / (t.k + t.m) : budget_;
+
+    Decision d{};
+    d.bitrate = std::max(cfg_.minBitrate, (int)(audio / 1000.0) * 1000);
+    d.lossPercent = std::min(cfg_.maxLossPercent,
+                             std::max(cfg_.minLossPercent, (int)std::ceil(loss * 100.0)));
+    d.fecScheme = t.scheme;
+    d.fecK = t.k;
+    d.fecM = t.m;
+    publish(d);
+}
+
+// [63] valid | [47..32] bitrate / 100 | [31..24] loss % | [23..16] scheme + 1 | [15..8] k | [7..0] m
+uint64_t RateController::pack(const Decision& d) {
+    return (1ull << 63) | ((uint64_t)(uint16_t)(d.bitrate / 100) << 32) |
+           ((uint64_t)(uint8_t)d.lossPercent << 24) | ((uint64_t)(uint8_t)(d.fecScheme + 1) << 16) |
+           ((uint64_t)(uint8_t)d.fecK << 8) | (uint64_t)(uint8_t)d.fecM;
+}
+
+RateController::Decision RateController::unpack(uint64_t v) {
+    Decision d{};
+    d.bitrate = (int)((v >> 32) & 0xFFFF) * 100;
+    d.lossPercent = (int)((v >> 24) & 0xFF);
+    d.fecScheme = (int)((v >> 16) & 0xFF) - 1;
+    d.fecK = (int)((v >> 8) & 0xFF);
+    d.fecM = (int)(v & 0xFF);
+    return d;
+}
+
+void RateController::publish(const Decision& d) {
+    published_.store(pack(d), std::memory_order_release);
+}
+
+bool RateController::poll(Decision* d) {
+    const uint64_t v = published_.load(std::memory_order_acquire);
+    if (v == 0 || v == polled_) return false;
+    polled_ = v;
+    *d = unpack(v);
+    return true;
+}
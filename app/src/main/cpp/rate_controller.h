@@ -0,0 +1,140 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "packet_codec.h"
+
+// Host-side congestion-aware encoder control, driven by guest receiver reports.
+//
+// Every guest's reports are smoothed into loss (before NACK/FEC repair), concealment
+// rate and jitter. All guests share one stream, so the worst guest decides:
+//   - the encoder's expected loss % (in-band LBRR) follows the smoothed loss;
+//   - transport FEC steps off -> XOR(4) -> RS(8,2) -> RS(8,4) as loss grows, and back
+//     down with hysteresis;
+//   - the send budget (audio + parity) backs off multiplicatively on congestion
+//     (concealment or jitter over their limits, or loss that the strongest FEC tier
+//     no longer covers) and probes back up additively after a quiet period.
+// Parity comes out of the budget, so turning FEC on never adds airtime to a hotspot
+// that is already congested.
+//
+// With simulcast (tiers > 1) each guest is also placed on a tier: moved one tier down
+// when its own loss, concealment or jitter is bad, back up after a quiet period. Only
+// guests on tier 0 then steer the shared decision above, which applies to tier 0; the
+// lower tiers keep their fixed bitrates, so one weak link no longer drags everyone down.
+//
+// Reports arrive on the NACK thread; the send thread polls the decision, published
+// as one packed atomic word, and looks guest tiers up by address.
+class RateController {
+public:
+    struct Config {
+        int minBitrate = 32000;
+        int maxBitrate = 128000;
+        int stepUp = 8000;              // budget added per probe, b/s
+        double backoff = 0.8;           // budget multiplier on congestion
+        double holdMs = 2000;           // minimum time between budget or FEC changes
+        double probeAfterMs = 5000;     // congestion-free time before probing up
+        double staleMs = 5000;          // a guest silent this long no longer counts
+        double smoothing = 0.4;         // weight of a new report in the averages
+        double plcCongested = 0.03;     // concealed / played frames
+        double jitterCongestedMs = 30;
+        double lossCongested = 0.12;    // only once FEC is at its strongest tier
+        int maxLossPercent = 30;
+        int minLossPercent = 2;         // keeps some LBRR for isolated drops
+
+        // Simulcast tier selection, per guest
+        int tiers = 1;
+        double demoteLoss = 0.08;
+        double demotePlc = 0.02;
+        double demoteJitterMs = 40;
+        double promoteLoss = 0.02;
+        double promotePlc = 0.005;
+        double promoteJitterMs = 20;
+    };
+
+    struct Decision {
+        int bitrate;        // encoder bitrate, b/s
+        int lossPercent;    // OPUS_SET_PACKET_LOSS_PERC
+        int fecScheme;      // wsfec::Scheme, -1 = off
+        int fecK;
+        int fecM;
+    };
+
+    struct Stats {
+        int64_t reports = 0;
+        int64_t backoffs = 0;
+        int64_t probes = 0;
+        int64_t fecChanges = 0;
+        int64_t tierMoves = 0;
+    };
+
+    static constexpr int kMaxPeers = 32;
+
+    RateController();
+    explicit RateController(const Config& cfg);
+
+    // NACK thread: report from guest `peer` (0 <= peer < kMaxPeers, stable per address)
+    // at `from`.
+    void onReport(int peer, const sockaddr_in6& from, const wspacket::Report& r, int64_t nowNs);
+
+    // NACK thread: simulcast tier of `peer` (0 if unknown).
+    int tierOf(int peer) const;
+
+    // Any thread: simulcast tier of the guest at `addr` (0 if unknown or silent).
+    int tierFor(const sockaddr_in6& addr, int64_t nowNs) const;
+
+    // Send thread: returns true and fills d when the decision changed since the last
+    // call. Nothing is returned before the first report, so manual settings hold until then.
+    bool poll(Decision* d);
+
+    const Stats& stats() const { return stats_; }   // NACK thread
+
+private:
+    struct Peer {
+        bool used = false;
+        sockaddr_in6 addr{};
+        int64_t lastNs = 0;
+        double loss = 0;
+        double plc = 0;
+        double jitterMs = 0;
+        int tier = 0;
+        int64_t tierNs = 0;
+        int64_t lastBadNs = 0;
+    };
+
+    // Address -> tier, shared with the send thread
+    struct Route {
+        bool used = false;
+        sockaddr_in6 addr{};
+        int tier = 0;
+        int64_t lastNs = 0;
+    };
+
+    void placeTier(int peer, Peer& p, const sockaddr_in6& from, int64_t nowNs);
+    void update(int64_t nowNs);
+    void publish(const Decision& d);
+    static uint64_t pack(const Decision& d);
+    static Decision unpack(uint64_t v);
+
+    const Config cfg_;
+    const int64_t holdNs_;
+    const int64_t probeAfterNs_;
+    const int64_t staleNs_;
+
+    // NACK-thread state
+    Peer peers_[kMaxPeers];
+    double budget_;
+    int fecStep_ = 0;
+    int64_t lastBudgetNs_ = 0;
+    int64_t lastFecNs_ = 0;
+    int64_t lastCongestedNs_ = 0;
+    Stats stats_;
+
+    mutable std::mutex routesMu_;
+    Route routes_[kMaxPeers];
+
+    std::atomic<uint64_t> published_{0};   // 0 = nothing yet
+    uint64_t polled_ = 0;                  // send thread
+};
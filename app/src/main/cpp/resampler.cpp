@@ -0,0 +1,158 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Zeroth-order modified Bessel function (series), for the Kaiser window.
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= q / ((double)k * k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static float dot(const float* a, const float* b, int n) {
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4) acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    const float32x4_t acc = vaddq_f32(acc0, acc1);
+    const float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+    // Four independent accumulators; compilers vectorise this (SSE on x86 ABIs)
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+AsyncResampler::AsyncResampler(const Config& cfg)
+        : cfg_(cfg),
+          half_(cfg.taps / 2),
+          bank_((size_t)(cfg.phases + 1) * cfg.taps),
+          coeffs_(cfg.taps),
+          history_(cfg.channels) {
+    for (auto& h : history_) h.assign((size_t)cfg.maxInputFrames + 2 * cfg.taps, 0.0f);
+    buildFilterBank();
+    reset();
+}
+
+void AsyncResampler::buildFilterBank() {
+    const int taps = cfg_.taps;
+    const double norm = besselI0(cfg_.kaiserBeta);
+    for (int p = 0; p <= cfg_.phases; ++p) {
+        // Row p interpolates at fractional offset frac = p / phases past tap (half_ - 1)
+        const double frac = (double)p / cfg_.phases;
+        float* row = &bank_[(size_t)p * taps];
+        double sum = 0;
+        for (int k = 0; k < taps; ++k) {
+            const double t = (double)(k - (half_ - 1)) - frac;   // distance from the output instant
+            const double x = cfg_.cutoff * t;
+            const double sinc = std::fabs(x) < 1e-9 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            const double r = t / (double)half_;
+            const double w = std::fabs(r) >= 1.0 ? 0.0
+                           : besselI0(cfg_.kaiserBeta * std::sqrt(1.0 - r * r)) / norm;
+            row[k] = (float)(sinc * w);
+            sum += row[k];
+        }
+        for (int k = 0; k < taps; ++k) row[k] = (float)(row[k] / sum);   // unity DC gain
+    }
+}
+
+void AsyncResampler::interpolateTaps(float frac) {
+    const float fp = frac * (float)cfg_.phases;
+    const int p = std::min((int)fp, cfg_.phases - 1);
+    const float t = fp - (float)p;
+    const float* a = &bank_[(size_t)p * cfg_.taps];
+    const float* b = a + cfg_.taps;
+    for (int k = 0; k < cfg_.taps; ++k) coeffs_[k] = a[k] + t * (b[k] - a[k]);
+}
+
+void AsyncResampler::reset() {
+    // Leading silence so the first input sample sits at tap (half_ - 1)
+    for (auto& h : history_) std::fill(h.begin(), h.end(), 0.0f);
+    fill_ = half_ - 1;
+    pos_ = (double)(half_ - 1);
+    step_ = 1.0;
+    error_ = 0;
+    integral_ = 0;
+    ppm_ = 0;
+}
+
+int AsyncResampler::maxOutputFrames(int frames) const {
+    // Plus whatever the previous call left within one step of its end
+    return (int)std::ceil((frames + 1) / (1.0 - cfg_.maxPpm * 1e-6)) + 1;
+}
+
+int AsyncResampler::process(const int16_t* in, int frames, int16_t* out, int outCapFrames) {
+    if (!in || !out || frames < 0 || frames > cfg_.maxInputFrames) return -2;
+    const int ch = cfg_.channels;
+    if (fill_ + frames > (int)history_[0].size()) return -3;   // previous output was cut short
+
+    for (int c = 0; c < ch; ++c) {
+        float* h = history_[c].data() + fill_;
+        for (int i = 0; i < frames; ++i) h[i] = (float)in[i * ch + c];
+    }
+    fill_ += frames;
+
+    int produced = 0;
+    while (produced < outCapFrames) {
+        const int base = (int)pos_;
+        // Taps span [base - (half_ - 1), base + half_]
+        if (base + half_ >= fill_) break;
+
+        interpolateTaps((float)(pos_ - base));
+        const int first = base - (half_ - 1);
+        for (int c = 0; c < ch; ++c) {
+            const float y = dot(coeffs_.data(), history_[c].data() + first, cfg_.taps);
+            const float clamped = std::max(-32768.0f, std::min(32767.0f, y));
+            out[produced * ch + c] = (int16_t)std::lrint(clamped);
+        }
+        ++produced;
+        pos_ += step_;
+    }
+
+    // Keep only the taps the next output still needs
+    const int keepFrom = std::min(fill_, std::max(0, (int)pos_ - (half_ - 1)));
+    if (keepFrom > 0) {
+        for (int c = 0; c < ch; ++c) {
+            float* h = history_[c].data();
+            std::memmove(h, h + keepFrom, (size_t)(fill_ - keepFrom) * sizeof(float));
+        }
+        fill_ -= keepFrom;
+        pos_ -= keepFrom;
+    }
+    return produced;
+}
+
+double AsyncResampler::trackDepth(double depthFrames, double targetFrames) {
+    // Depth is quantised to whole packets and noisy; the loop acts on a smoothed error
+    error_ += ((depthFrames - targetFrames) - error_) * cfg_.errorSmoothing;
+
+    // The integrator only learns the clock offset; target jumps are left to the P term
+    if (std::fabs(error_) < cfg_.integrateBand) {
+        integral_ = std::max(-cfg_.maxPpm, std::min(cfg_.maxPpm, integral_ + cfg_.ki * error_));
+    }
+    ppm_ = std::max(-cfg_.maxPpm, std::min(cfg_.maxPpm, cfg_.kp * error_ + integral_));
+    step_ = 1.0 + ppm_ * 1e-6;
+    return ppm_;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Asynchronous sample-rate converter for host/guest clock drift.
+//
+// Polyphase windowed-sinc (Kaiser) interpolator with linear interpolation between
+// adjacent phases, so the conversion ratio is continuous. The ratio is steered by a
+// PI loop on jitter-buffer depth: a guest whose clock runs slower than the host's
+// sees the buffer grow and consumes input slightly faster, and vice versa.
+//
+// The correction is clamped to a few thousand ppm (well under the ~5 cent pitch JND);
+// larger depth changes are the time stretcher's job. Interleaved int16 in and out,
+// ~taps/2 samples of look-ahead.
+class AsyncResampler {
+public:
+    struct Config {
+        int channels = 2;
+        int maxInputFrames = 1440;  // samples per channel per process() call
+        int taps = 32;              // multiple of 4
+        int phases = 128;
+        double cutoff = 0.92;       // of input Nyquist
+        double kaiserBeta = 8.0;
+
+        // PI loop on depth error (frames), run once per played frame
+        double kp = 200.0;          // ppm per frame of (smoothed) error
+        double ki = 0.5;            // ppm per frame of error, per update
+        double errorSmoothing = 0.01;
+        double integrateBand = 2.0; // frames; larger errors (target moves) don't wind up the I term
+        double maxPpm = 2000.0;
+    };
+
+    explicit AsyncResampler(const Config& cfg);
+
+    int channels() const { return cfg_.channels; }
+    int maxInputFrames() const { return cfg_.maxInputFrames; }
+
+    // Largest output (samples per channel) process() can produce for `frames` input.
+    int maxOutputFrames(int frames) const;
+
+    // Resamples `frames` samples per channel at the current ratio.
+    // Returns samples per channel written, or -2 bad args / -3 history overflow
+    // (outCapFrames was below maxOutputFrames on earlier calls).
+    int process(const int16_t* in, int frames, int16_t* out, int outCapFrames);
+
+    // Feeds one depth observation to the PI loop; returns the correction in ppm
+    // (> 0: input consumed faster than nominal).
+    double trackDepth(double depthFrames, double targetFrames);
+
+    double ppm() const { return ppm_; }
+
+    // Drops history and loop state (after a stream gap / track flush).
+    void reset();
+
+private:
+    void buildFilterBank();
+    void interpolateTaps(float frac);
+
+    const Config cfg_;
+    const int half_;            // taps / 2
+
+    std::vector<float> bank_;   // (phases + 1) * taps
+    std::vector<float> coeffs_; // taps, current interpolated phase
+    std::vector<std::vector<float>> history_;  // per channel, deinterleaved
+    int fill_ = 0;              // valid samples in each history_ channel
+    double pos_ = 0;            // input position of the next output sample
+
+    double step_ = 1.0;         // input samples per output sample
+    double error_ = 0;
+    double integral_ = 0;
+    double ppm_ = 0;
+};
@@ -0,0 +1,94 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+#include <vector>
+
+#include "resampler.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+struct ResamplerHandle {
+    explicit ResamplerHandle(const AsyncResampler::Config& cfg)
+            : resampler(cfg),
+              in((size_t)cfg.maxInputFrames * cfg.channels),
+              out((size_t)resampler.maxOutputFrames(cfg.maxInputFrames) * cfg.channels) {}
+
+    AsyncResampler resampler;
+    std::vector<int16_t> in;    // maxInputFrames * channels
+    std::vector<int16_t> out;   // maxOutputFrames(maxInputFrames) * channels
+};
+
+#define GET_RESAMPLER_HANDLE(ptr) reinterpret_cast<ResamplerHandle*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_createResampler(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint channels, jint maxInputFrames, jdouble maxPpm) {
+    if (channels <= 0 || maxInputFrames <= 0 || maxPpm < 0) {
+        LOGE("createResampler: invalid ch=%d frames=%d", (int)channels, (int)maxInputFrames);
+        return 0;
+    }
+    AsyncResampler::Config cfg;
+    cfg.channels = channels;
+    cfg.maxInputFrames = maxInputFrames;
+    cfg.maxPpm = maxPpm;
+    return reinterpret_cast<jlong>(new (std::nothrow) ResamplerHandle(cfg));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_destroyResampler(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_RESAMPLER_HANDLE(pointer);
+}
+
+// Returns shorts written to `out`, or a negative error code.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_processInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray pcm, jint frames,
+        jshortArray out) {
+    ResamplerHandle* h = GET_RESAMPLER_HANDLE(pointer);
+    if (!h) return -1;
+    if (!pcm || !out) return -2;
+
+    AsyncResampler& rs = h->resampler;
+    const int channels = rs.channels();
+    if (frames < 0 || frames > rs.maxInputFrames()) return -2;
+    const jsize inShorts = frames * channels;
+    if (env->GetArrayLength(pcm) < inShorts) return -2;
+
+    // Every call must be able to drain what it produces, or history would pile up
+    const int needFrames = rs.maxOutputFrames(frames);
+    if (env->GetArrayLength(out) / channels < needFrames) return -3;
+
+    env->GetShortArrayRegion(pcm, 0, inShorts, reinterpret_cast<jshort*>(h->in.data()));
+    const int n = rs.process(h->in.data(), frames, h->out.data(), needFrames);
+    if (n < 0) return n;
+
+    env->SetShortArrayRegion(out, 0, n * channels, reinterpret_cast<const jshort*>(h->out.data()));
+    return n * channels;
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_trackDepth(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jdouble depthFrames, jdouble targetFrames) {
+    ResamplerHandle* h = GET_RESAMPLER_HANDLE(pointer);
+    return h ? h->resampler.trackDepth(depthFrames, targetFrames) : 0.0;
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_ppm(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    ResamplerHandle* h = GET_RESAMPLER_HANDLE(pointer);
+    return h ? h->resampler.ppm() : 0.0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024Resampler_reset(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    ResamplerHandle* h = GET_RESAMPLER_HANDLE(pointer);
+    if (h) h->resampler.reset();
+}
+
+} // extern "C"
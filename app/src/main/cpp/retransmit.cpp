@@ -0,0 +1,205 @@
+#include "retransmit.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+
+#include "futex.h"
+#include "rate_controller.h"
+
+static uint32_t roundUpPow2(int v) {
+    uint32_t n = 1;
+    while (n < (uint32_t)v) n <<= 1;
+    return n;
+}
+
+RetransmitCache::RetransmitCache(int capacity, int slotBytes, int tiers)
+    : mask_(roundUpPow2(capacity < 1 ? 1 : capacity) - 1),
+      slotBytes_(slotBytes),
+      tiers_(tiers < 1 ? 1 : tiers),
+      slots_((size_t)(mask_ + 1) * tiers_),
+      data_((size_t)(mask_ + 1) * tiers_ * slotBytes) {}
+
+void RetransmitCache::store(const uint8_t* datagram, int length, int tier) {
+    wspacket::Header h{};
+    if (!wspacket::parseHeader(datagram, length, &h) || length > slotBytes_) return;
+    if (tier < 0 || tier >= tiers_) return;
+
+    const size_t idx = slotIndex(h.seq, tier);
+    Slot& s = slots_[idx];
+    s.tag.store(makeTag(h.seq, kWriting), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(data_.data() + (size_t)idx * slotBytes_, datagram, (size_t)length);
+    s.length.store(length, std::memory_order_relaxed);
+    s.tag.store(makeTag(h.seq, kFull), std::memory_order_release);
+}
+
+int RetransmitCache::lookup(int32_t seq, uint8_t* dst, int cap, int tier) const {
+    if (tier < 0 || tier >= tiers_) return -1;
+    const size_t idx = slotIndex(seq, tier);
+    const Slot& s = slots_[idx];
+    const uint64_t want = makeTag(seq, kFull);
+    if (s.tag.load(std::memory_order_acquire) != want) return -1;
+
+    const int len = s.length.load(std::memory_order_relaxed);
+    if (len > cap) return -1;
+    std::memcpy(dst, data_.data() + (size_t)idx * slotBytes_, (size_t)len);
+
+    // Seqlock validation: the slot must not have been rewritten during the copy
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.tag.load(std::memory_order_relaxed) == want ? len : -1;
+}
+
+NackResponder::NackResponder(int fd, const RetransmitCache& cache)
+    : NackResponder(fd, cache, Config{}) {}
+
+NackResponder::NackResponder(int fd, const RetransmitCache& cache, const Config& cfg)
+    : fd_(fd), cache_(cache), cfg_(cfg) {
+    peers_.reserve(kMaxPeers);
+    std::memset(msgs_, 0, sizeof(msgs_));
+    for (int i = 0; i < kBatch; ++i) {
+        iov_[i].iov_base = in_[i];
+        iov_[i].iov_len = sizeof(in_[i]);
+    }
+}
+
+NackResponder::Peer& NackResponder::peerFor(const sockaddr_in6& addr, int64_t nowNs) {
+    for (Peer& p : peers_) {
+        if (p.addr.sin6_port == addr.sin6_port &&
+            std::memcmp(&p.addr.sin6_addr, &addr.sin6_addr, sizeof(in6_addr)) == 0) {
+            p.lastSeenNs = nowNs;
+            return p;
+        }
+    }
+
+    Peer fresh{addr, cfg_.burst, nowNs, nowNs};
+    if ((int)peers_.size() < kMaxPeers) {
+        peers_.push_back(fresh);
+        return peers_.back();
+    }
+    // Table full: reuse the guest that has been quiet the longest
+    Peer* oldest = &peers_[0];
+    for (Peer& p : peers_) {
+        if (p.lastSeenNs < oldest->lastSeenNs) oldest = &p;
+    }
+    *oldest = fresh;
+    return *oldest;
+}
+
+int NackResponder::peerIndex(const sockaddr_in6& addr, int64_t nowNs) {
+    static_assert(kMaxPeers <= RateController::kMaxPeers, "peer ids must fit the rate controller");
+    return (int)(&peerFor(addr, nowNs) - peers_.data());
+}
+
+bool NackResponder::resend(const sockaddr_in6& to, int32_t seq, int tier) {
+    // The guest's own tier first; after a tier change or shed, whatever tier carried it
+    int len = -1;
+    for (int t = tier < cache_.tiers() ? tier : cache_.tiers() - 1; t >= 0 && len < 0; --t) {
+        len = cache_.lookup(seq, out_, (int)sizeof(out_), t);
+    }
+    if (len < wspacket::kHeaderSize) {
+        ++stats_.evicted;
+        return false;
+    }
+    // Marked so the guest keeps it out of its jitter statistics
+    out_[3] = static_cast<uint8_t>(out_[3] | wspacket::kFlagRetransmit);
+    for (;;) {
+        const ssize_t r = ::sendto(fd_, out_, (size_t)len, 0,
+                                   reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+        if (r >= 0) break;
+        if (errno == EINTR) continue;
+        return false;
+    }
+    ++stats_.resent;
+    return true;
+}
+
+void NackResponder::answerClock(const sockaddr_in6& to, int64_t t1, int64_t receivedNs) {
+    uint8_t out[wspacket::kClockReplySize];
+    wspacket::ClockExchange c{t1, receivedNs, 0};
+    // Stamped as late as possible: whatever precedes the send counts as host processing
+    c.t3 = futex::monotonicNs();
+    const int len = wspacket::writeClockReply(out, c);
+    // Best effort: the guest's next request replaces a lost reply
+    if (::sendto(fd_, out, (size_t)len, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&to),
+                 sizeof(to)) == len) {
+        ++stats_.clocks;
+    }
+}
+
+void NackResponder::answer(const sockaddr_in6& to, const wspacket::NackEntry* entries,
+                           int count, int64_t nowNs) {
+    Peer& peer = peerFor(to, nowNs);
+    const int tier = rate_ ? rate_->tierOf((int)(&peer - peers_.data())) : 0;
+    peer.tokens += (double)(nowNs - peer.refillNs) * 1e-9 * cfg_.resendsPerSec;
+    if (peer.tokens > cfg_.burst) peer.tokens = cfg_.burst;
+    peer.refillNs = nowNs;
+
+    for (int i = 0; i < count; ++i) {
+        const wspacket::NackEntry& e = entries[i];
+        for (int bit = -1; bit < 32; ++bit) {
+            if (bit >= 0 && !(e.bitmap & (1u << bit))) continue;
+            const int32_t seq = (int32_t)((uint32_t)e.seq + (uint32_t)(bit + 1));
+            ++stats_.requested;
+            if (peer.tokens < 1.0) {
+                ++stats_.rateLimited;
+                continue;
+            }
+            if (resend(to, seq, tier)) peer.tokens -= 1.0;
+        }
+    }
+}
+
+int NackResponder::serve(int timeoutMs) {
+    pollfd pfd{fd_, POLLIN, 0};
+    const int pr = ::poll(&pfd, 1, timeoutMs);
+    if (pr == 0) return 0;
+    if (pr < 0) return errno == EINTR ? 0 : -errno;
+    if (pfd.revents & (POLLERR | POLLNVAL)) return -EBADF;
+
+    const int64_t before = stats_.resent;
+    wspacket::NackEntry entries[wspacket::kMaxNackEntries];
+    wspacket::Report report{};
+    wspacket::ClockExchange clock{};
+    for (;;) {
+        for (int i = 0; i < kBatch; ++i) {
+            msghdr& h = msgs_[i].msg_hdr;
+            h.msg_iov = &iov_[i];
+            h.msg_iovlen = 1;
+            h.msg_name = &from_[i];
+            h.msg_namelen = sizeof(from_[i]);
+            h.msg_control = nullptr;
+            h.msg_controllen = 0;
+            h.msg_flags = 0;
+        }
+
+        const int n = ::recvmmsg(fd_, msgs_, kBatch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return stats_.resent > before ? (int)(stats_.resent - before) : -errno;
+        }
+
+        const int64_t now = futex::monotonicNs();
+        for (int i = 0; i < n; ++i) {
+            if (from_[i].sin6_family != AF_INET6) continue;
+            const int len = (int)msgs_[i].msg_len;
+            if (wspacket::parseReport(in_[i], len, &report)) {
+                ++stats_.reports;
+                if (rate_) rate_->onReport(peerIndex(from_[i], now), from_[i], report, now);
+                continue;
+            }
+            if (wspacket::parseClock(in_[i], len, &clock) == 0) {
+                answerClock(from_[i], clock.t1, now);
+                continue;
+            }
+            const int count = wspacket::parseNack(in_[i], len, entries);
+            if (count <= 0) continue;
+            ++stats_.nacks;
+            answer(from_[i], entries, count, now);
+        }
+
+        if (n < kBatch) break;  // socket drained
+    }
+    return (int)(stats_.resent - before);
+}
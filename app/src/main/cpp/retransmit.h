@@ -0,0 +1,126 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "packet_codec.h"
+
+class RateController;
+
+// Host-side store of the last N datagrams sent, keyed by seq (slot = seq % capacity),
+// so a NACKed packet can be resent byte-for-byte without re-encoding. With simulcast
+// every tier has its own ring, as the same seq is a different datagram per tier.
+//
+// The send thread is the only writer; the NACK thread reads. Each slot carries an
+// atomic (seq, state) tag used as a seqlock, like JitterBuffer: a read that races
+// an overwrite is detected and reported as missing.
+class RetransmitCache {
+public:
+    // capacity (per tier) is rounded up to a power of two.
+    RetransmitCache(int capacity, int slotBytes, int tiers = 1);
+
+    // Send thread: keeps a copy of a datagram carrying a PacketCodec header.
+    void store(const uint8_t* datagram, int length, int tier = 0);
+
+    // Copies the datagram for seq into dst. Returns its length, or -1 if it was
+    // never sent, has been overwritten, or does not fit cap.
+    int lookup(int32_t seq, uint8_t* dst, int cap, int tier = 0) const;
+
+    int capacity() const { return (int)mask_ + 1; }
+    int tiers() const { return tiers_; }
+
+private:
+    enum : uint64_t { kEmpty = 0, kWriting = 1, kFull = 2 };
+
+    static uint64_t makeTag(int32_t seq, uint64_t state) {
+        return (uint64_t(uint32_t(seq)) << 32) | state;
+    }
+
+    struct Slot {
+        std::atomic<uint64_t> tag{kEmpty};
+        std::atomic<int> length{0};
+    };
+
+    size_t slotIndex(int32_t seq, int tier) const {
+        return (size_t)tier * (mask_ + 1) + (static_cast<uint32_t>(seq) & mask_);
+    }
+
+    const uint32_t mask_;
+    const int slotBytes_;
+    const int tiers_;
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> data_;
+};
+
+// Answers guest NACKs from a RetransmitCache with unicast resends.
+//
+// Reads NACK datagrams on the (bound) sender socket and sends each requested packet
+// back to the NACK's source address with kFlagRetransmit set, from the simulcast tier
+// the rate controller has that guest on. Every guest has its own
+// token bucket, so one guest on a bad link cannot take more than its share of airtime.
+// Receiver reports arriving on the same socket are handed to the RateController, if set,
+// and clock requests are answered at once with this host's receive / send times.
+// NACK thread only.
+class NackResponder {
+public:
+    struct Config {
+        double resendsPerSec = 50.0;   // per guest, i.e. up to one extra stream
+        double burst = 16.0;
+    };
+
+    struct Stats {
+        int64_t nacks = 0;         // NACK datagrams accepted
+        int64_t requested = 0;     // seqs asked for
+        int64_t resent = 0;
+        int64_t evicted = 0;       // no longer (or never) in the cache
+        int64_t rateLimited = 0;
+        int64_t reports = 0;       // receiver reports accepted
+        int64_t clocks = 0;        // clock requests answered
+    };
+
+    NackResponder(int fd, const RetransmitCache& cache);
+    NackResponder(int fd, const RetransmitCache& cache, const Config& cfg);
+
+    // Waits up to timeoutMs for NACKs and answers everything queued.
+    // Returns packets resent (0 on timeout), or -errno on a socket error.
+    int serve(int timeoutMs);
+
+    // Receiver reports go to `rate` (not owned; nullptr drops them). Before serve() runs.
+    void setReportSink(RateController* rate) { rate_ = rate; }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    static constexpr int kBatch = 8;
+    static constexpr int kMaxPeers = 32;
+
+    struct Peer {
+        sockaddr_in6 addr;
+        double tokens;
+        int64_t refillNs;
+        int64_t lastSeenNs;
+    };
+
+    Peer& peerFor(const sockaddr_in6& addr, int64_t nowNs);
+    int peerIndex(const sockaddr_in6& addr, int64_t nowNs);
+    void answer(const sockaddr_in6& to, const wspacket::NackEntry* entries, int count,
+                int64_t nowNs);
+    bool resend(const sockaddr_in6& to, int32_t seq, int tier);
+    void answerClock(const sockaddr_in6& to, int64_t t1, int64_t receivedNs);
+
+    const int fd_;
+    const RetransmitCache& cache_;
+    const Config cfg_;
+    RateController* rate_ = nullptr;
+    Stats stats_;
+    std::vector<Peer> peers_;
+
+    uint8_t in_[kBatch][wspacket::kMaxNackBytes];
+    sockaddr_in6 from_[kBatch];
+    iovec iov_[kBatch];
+    mmsghdr msgs_[kBatch];
+    uint8_t out_[2048];
+};
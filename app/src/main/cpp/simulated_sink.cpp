@@ -0,0 +1,63 @@
+#include "simulated_sink.h"
+
+#include <algorithm>
+
+// Pulls kept for heardNs() and position(); trimmed in halves
+static constexpr size_t kMaxPulls = 1024;
+
+SimulatedSink::SimulatedSink(const Config& cfg) : cfg_(cfg), rng_(cfg.seed) {
+    pulls_.reserve(kMaxPulls);
+}
+
+int64_t SimulatedSink::periodNs() const {
+    return (int64_t)(cfg_.burstFrames * 1e9 / (cfg_.sampleRate * (1.0 + cfg_.ppm * 1e-6)));
+}
+
+void SimulatedSink::advance(int64_t nowNs) {
+    if (!started_) {
+        started_ = true;
+        nextPullNs_ = nowNs;
+    }
+    nowNs_ = nowNs;
+    while (nextPullNs_ <= nowNs) {
+        const int available = (int)std::min<int64_t>(cfg_.burstFrames, written_ - pulled_);
+        if (available < cfg_.burstFrames) ++underruns_;
+        if (pulls_.size() >= kMaxPulls) pulls_.erase(pulls_.begin(), pulls_.begin() + kMaxPulls / 2);
+        pulls_.push_back({pulled_, available, nextPullNs_ + (int64_t)(cfg_.deviceLatencyMs * 1e6),
+                          1e9 / (cfg_.sampleRate * (1.0 + cfg_.ppm * 1e-6))});
+        pulled_ += available;
+        nextPullNs_ += periodNs();
+    }
+}
+
+void SimulatedSink::reroute(const Config& cfg, int64_t nowNs) {
+    advance(nowNs);
+    cfg_ = cfg;
+    nextPullNs_ = nowNs + periodNs();
+}
+
+int SimulatedSink::write(const int16_t* /*pcm*/, int frames) {
+    const int n = std::max(0, std::min(frames, freeFrames()));
+    written_ += n;
+    return n;
+}
+
+bool SimulatedSink::heardNs(int64_t frame, int64_t* ns) const {
+    for (auto it = pulls_.rbegin(); it != pulls_.rend(); ++it) {
+        if (frame < it->frame || frame >= it->frame + it->frames) continue;
+        *ns = it->heardNs + (int64_t)((frame - it->frame) * it->sampleNs);
+        return true;
+    }
+    return false;
+}
+
+bool SimulatedSink::position(Position* out) {
+    for (auto it = pulls_.rbegin(); it != pulls_.rend(); ++it) {
+        if (it->frames == 0 || it->heardNs > nowNs_) continue;
+        std::uniform_real_distribution<double> jitter(-cfg_.positionJitterMs, cfg_.positionJitterMs);
+        out->framePosition = it->frame;
+        out->presentedNs = it->heardNs + (int64_t)(jitter(rng_) * 1e6);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "audio_sink.h"
+
+// Off-device AudioSink for SinkLatency and the playout scheduler: a track buffer
+// drained by a simulated device on a simulated clock. The device pulls burstFrames at
+// a time at its own rate (nominal + ppm), and what it pulls is heard deviceLatencyMs
+// later. An empty buffer underruns (silence, the written frames play late). Positions
+// come back the way AudioTrack.getTimestamp reports them: the newest frame already
+// heard, optionally with jitter on the time. Not used on Android.
+class SimulatedSink : public AudioSink {
+public:
+    struct Config {
+        int sampleRate = 48000;
+        int bufferFrames = 3840;        // track buffer (80 ms)
+        int burstFrames = 240;          // device pull (5 ms: a speaker mixer period)
+        double deviceLatencyMs = 20;    // pulled -> heard
+        double ppm = 0;                 // device clock rate error
+        double positionJitterMs = 0;    // uniform +- on reported presentation times
+        unsigned seed = 1;
+    };
+
+    explicit SimulatedSink(const Config& cfg);
+
+    // Runs the device up to simulated time nowNs. The first call starts it.
+    void advance(int64_t nowNs);
+
+    // Reconfigures the device from nowNs on (a route change); the buffer is kept.
+    void reroute(const Config& cfg, int64_t nowNs);
+
+    int freeFrames() const { return cfg_.bufferFrames - (int)(written_ - pulled_); }
+    int64_t underruns() const { return underruns_; }
+
+    // Time frame `frame` is (or will be) heard; false if it has not been pulled yet.
+    bool heardNs(int64_t frame, int64_t* ns) const;
+
+    int sampleRate() const override { return cfg_.sampleRate; }
+    int write(const int16_t* pcm, int frames) override;
+    int64_t framesWritten() const override { return written_; }
+    bool position(Position* out) override;
+
+private:
+    struct Pull {
+        int64_t frame;      // first frame pulled
+        int frames;         // frames of audio pulled (the rest of the burst was silence)
+        int64_t heardNs;    // when the first is heard
+        double sampleNs;    // device sample period at the time
+    };
+
+    int64_t periodNs() const;
+
+    Config cfg_;
+    std::mt19937 rng_;
+    bool started_ = false;
+    int64_t nextPullNs_ = 0;
+    int64_t nowNs_ = 0;
+    int64_t written_ = 0;
+    int64_t pulled_ = 0;
+    int64_t underruns_ = 0;
+    std::vector<Pull> pulls_;       // recent pulls, oldest first
+};
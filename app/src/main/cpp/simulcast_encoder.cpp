@@ -0,0 +1,218 @@
+#include "simulcast_encoder.h"
+
+#include <opus.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "futex.h"
+#include "packet_codec.h"
+
+static int64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double frameMs(const SimulcastEncoder::Config& cfg) {
+    return cfg.sampleRate > 0 ? 1000.0 * cfg.frameSize / cfg.sampleRate : 20.0;
+}
+
+// A fixed complexity is a governor pinned to it, which still measures encode times
+ComplexityGovernor::Config SimulcastEncoder::governorConfig(const Config& cfg) {
+    ComplexityGovernor::Config g;
+    g.frameMs = frameMs(cfg);
+    g.startComplexity = cfg.complexity;
+    if (cfg.encodeShare > 0) {
+        g.targetShare = cfg.encodeShare;
+        g.minComplexity = cfg.minComplexity;
+        g.maxComplexity = cfg.maxComplexity;
+    } else {
+        g.minComplexity = g.maxComplexity = cfg.complexity;
+    }
+    return g;
+}
+
+SimulcastEncoder::SimulcastEncoder(const Config& cfg)
+    : cfg_(cfg),
+      restoreAfterFrames_(std::max(1, (int)(cfg.restoreAfterMs / frameMs(cfg)))),
+      smoothing_(std::min(1.0, frameMs(cfg) / std::max(1.0, cfg.smoothingMs))),
+      governor_(governorConfig(cfg)),
+      complexity_(governor_.complexity()) {
+    if (cfg_.tiers < 1 || cfg_.tiers > kMaxTiers) return;
+
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        int err = 0;
+        OpusEncoder* enc = opus_encoder_create(cfg_.sampleRate, cfg_.channels,
+                                               cfg_.application, &err);
+        if (err != OPUS_OK || !enc) return;
+        tiers_[t].enc = enc;
+        opus_encoder_ctl(enc, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
+        opus_encoder_ctl(enc, OPUS_SET_INBAND_FEC(1));
+        opus_encoder_ctl(enc, OPUS_SET_COMPLEXITY(complexity_));
+        opus_encoder_ctl(enc, OPUS_SET_BITRATE(cfg_.bitrates[t]));
+        opus_encoder_ctl(enc, OPUS_SET_PACKET_LOSS_PERC(cfg_.lossPercent[t]));
+    }
+    enableDred();
+
+    for (int t = 1; t < cfg_.tiers; ++t) {
+        workers_.emplace_back(&SimulcastEncoder::workerLoop, this, t);
+    }
+    active_ = cfg_.tiers;
+    ok_ = true;
+}
+
+SimulcastEncoder::~SimulcastEncoder() {
+    stop_.store(true, std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_release);
+    futex::wakeAll(&generation_);
+    for (std::thread& w : workers_) w.join();
+    for (Tier& t : tiers_) {
+        if (t.enc) opus_encoder_destroy(t.enc);
+    }
+}
+
+// All tiers or none: a guest moved between tiers keeps the same recovery
+void SimulcastEncoder::enableDred() {
+    if (cfg_.dredFrames <= 0 || !cfg_.dnnBlob || cfg_.dnnBlobBytes <= 0) return;
+    const int frames = std::min(cfg_.dredFrames, kMaxDredFrames);
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        OpusEncoder* enc = tiers_[t].enc;
+        // Without DRED in libopus the blob is ignored and the duration is OPUS_UNIMPLEMENTED
+        if (opus_encoder_ctl(enc, OPUS_SET_DNN_BLOB(cfg_.dnnBlob, cfg_.dnnBlobBytes)) != OPUS_OK ||
+            opus_encoder_ctl(enc, OPUS_SET_DRED_DURATION(frames)) != OPUS_OK) {
+            // An encoder keeps a blob it accepted, but with no duration it never runs the
+            // DRED encoder on it: duration 0 everywhere is the whole of "off"
+            for (int u = 0; u <= t; ++u) opus_encoder_ctl(tiers_[u].enc, OPUS_SET_DRED_DURATION(0));
+            return;
+        }
+    }
+    dredFrames_ = frames;
+}
+
+void SimulcastEncoder::encodeTier(int t) {
+    Tier& tier = tiers_[t];
+    const int64_t cpu0 = threadCpuNs();
+    wspacket::writeHeader(tier.packet, seq_, pts_, flags_);
+    const int64_t wall0 = futex::monotonicNs();
+    const int n = opus_encode(tier.enc, pcm_, cfg_.frameSize, tier.packet + wspacket::kHeaderSize,
+                              kMaxPacketBytes - wspacket::kHeaderSize);
+    encodeNs_[t] = futex::monotonicNs() - wall0;
+    cpuNs_[t] = threadCpuNs() - cpu0;
+    tier.error = n < 0 ? n : 0;
+    tier.length = n < 0 ? 0 : wspacket::kHeaderSize + n;
+}
+
+void SimulcastEncoder::workerLoop(int t) {
+    setpriority(PRIO_PROCESS, (id_t)gettid(), cfg_.workerNice);   // best effort
+
+    uint32_t seen = 0;   // not a fresh load: a frame may be handed out before this thread runs
+    for (;;) {
+        uint32_t g = generation_.load(std::memory_order_acquire);
+        while (g == seen) {
+            futex::wait(&generation_, g, 100000000LL);
+            g = generation_.load(std::memory_order_acquire);
+        }
+        seen = g;
+        if (stop_.load(std::memory_order_acquire)) return;
+
+        if (mask_ & (1u << t)) encodeTier(t);
+        else tiers_[t].length = 0;
+
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) futex::wakeAll(&pending_);
+    }
+}
+
+int SimulcastEncoder::encode(const int16_t* pcm, int32_t seq, uint32_t pts, int flags,
+                             uint32_t mask) {
+    if (!ok_ || !pcm) return OPUS_BAD_ARG;
+    const int64_t start = futex::monotonicNs();
+
+    mask &= (1u << active_) - 1u;
+    pcm_ = pcm;
+    seq_ = seq;
+    pts_ = pts;
+    flags_ = flags;
+    mask_ = mask;
+
+    // Hand the frame to the workers, encode tier 0 here, then join
+    const uint32_t workers = (uint32_t)workers_.size();
+    if (workers > 0 && (mask >> 1) != 0) {
+        pending_.store(workers, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        futex::wakeAll(&generation_);
+    } else {
+        for (int t = 1; t < cfg_.tiers; ++t) tiers_[t].length = 0;
+    }
+
+    if (mask & 1u) encodeTier(0);
+    else tiers_[0].length = 0;
+
+    for (uint32_t p = pending_.load(std::memory_order_acquire); p != 0;
+         p = pending_.load(std::memory_order_acquire)) {
+        futex::wait(&pending_, p, 100000000LL);
+    }
+
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        if ((mask & (1u << t)) && tiers_[t].error < 0) return tiers_[t].error;
+    }
+    track(futex::monotonicNs() - start, mask);
+    govern(mask);
+    return (int)mask;
+}
+
+void SimulcastEncoder::govern(uint32_t encoded) {
+    if (encoded == 0) return;
+    int64_t slowest = 0;
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        if ((encoded & (1u << t)) && encodeNs_[t] > slowest) slowest = encodeNs_[t];
+    }
+    const int c = governor_.onFrame(slowest * 1e-3);
+    if (c == complexity_) return;
+
+    // Workers are idle until the next encode(), so their encoders can be retuned here
+    complexity_ = c;
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        opus_encoder_ctl(tiers_[t].enc, OPUS_SET_COMPLEXITY(c));
+    }
+}
+
+void SimulcastEncoder::track(int64_t wallNs, uint32_t encoded) {
+    const double a = smoothing_;
+    stats_.wallUs += a * (wallNs * 1e-3 - stats_.wallUs);
+    for (int t = 0; t < cfg_.tiers; ++t) {
+        if (encoded & (1u << t)) stats_.cpuUs[t] += a * (cpuNs_[t] * 1e-3 - stats_.cpuUs[t]);
+    }
+    ++stats_.frames;
+
+    if (stats_.wallUs > cfg_.budgetUs && active_ > 1 && governor_.atFloor()) {
+        // Over budget at the lowest complexity: shed the highest tier, its guests fall
+        // back to the next one down
+        --active_;
+        ++stats_.sheds;
+        underBudgetFrames_ = 0;
+        stats_.wallUs = 0;   // measure the smaller set afresh
+        return;
+    }
+    if (active_ < cfg_.tiers && stats_.wallUs < cfg_.budgetUs * cfg_.restoreBelow) {
+        if (++underBudgetFrames_ >= restoreAfterFrames_) {
+            ++active_;
+            ++stats_.restores;
+            underBudgetFrames_ = 0;
+        }
+    } else {
+        underBudgetFrames_ = 0;
+    }
+}
+
+bool SimulcastEncoder::setBitrate(int tier, int bitrate) {
+    if (!ok_ || tier < 0 || tier >= cfg_.tiers) return false;
+    return opus_encoder_ctl(tiers_[tier].enc, OPUS_SET_BITRATE(bitrate)) == OPUS_OK;
+}
+
+bool SimulcastEncoder::setLossPercent(int tier, int lossPercent) {
+    if (!ok_ || tier < 0 || tier >= cfg_.tiers) return false;
+    if (lossPercent < 0) lossPercent = 0;
+    if (lossPercent > 100) lossPercent = 100;
+    return opus_encoder_ctl(tiers_[tier].enc, OPUS_SET_PACKET_LOSS_PERC(lossPercent)) == OPUS_OK;
+}
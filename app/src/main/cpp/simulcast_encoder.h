@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "complexity_governor.h"
+
+struct OpusEncoder;
+
+// Host-side simulcast: the same PCM frame encoded at several bitrates in parallel.
+//
+// Tier 0 (the full-quality stream) is encoded on the calling send thread, every other
+// tier on a worker thread of its own, so N tiers cost about one tier of wall time when
+// N cores are free. Workers sleep on a futex generation word between frames. Every
+// tier's output is a complete PacketCodec datagram with the same seq / pts, so a
+// guest can be moved between tiers at any frame boundary.
+//
+// Every opus_encode is timed on the monotonic clock; a ComplexityGovernor turns the
+// slowest tier's time per frame into one complexity for all tiers, kept under a share of
+// the frame period. encode() also keeps a smoothed per-frame wall time and per-tier
+// thread CPU time. When the wall time goes over the frame budget even at the lowest
+// complexity, the highest tier is shed; it is brought back after a long stretch well
+// under budget. Callers clamp guest tiers to activeTiers().
+// Send thread only; the workers are internal.
+class SimulcastEncoder {
+public:
+    static constexpr int kMaxTiers = 4;
+    static constexpr int kMaxPacketBytes = 1500;
+    static constexpr int kMaxDredFrames = 104;   // DRED_MAX_FRAMES, 10 ms each
+
+    struct Config {
+        int sampleRate = 48000;
+        int channels = 2;
+        int frameSize = 960;            // samples per channel
+        int application = 2049;         // OPUS_APPLICATION_AUDIO; RESTRICTED_LOWDELAY = CELT only
+        int complexity = 5;             // starting point when governed
+        int minComplexity = 2;
+        int maxComplexity = 10;
+        double encodeShare = 0.25;      // governor target, p95 encode / frame; 0 = fixed
+        int tiers = 1;
+        int bitrates[kMaxTiers] = {128000, 64000, 32000, 24000};
+        int lossPercent[kMaxTiers] = {10, 15, 25, 25};
+        double budgetUs = 8000;         // per-frame wall time, all tiers
+        double restoreBelow = 0.5;      // share of the budget under which a shed tier returns
+        double restoreAfterMs = 10000;  // of audio spent under restoreBelow
+        double smoothingMs = 400;       // memory of the wall / CPU averages
+        int workerNice = -19;           // THREAD_PRIORITY_URGENT_AUDIO, like the send thread
+        // Deep REDundancy per packet, in 10 ms units (0 = off, max 104). Needs the DNN
+        // weights (DnnBlob, outliving the encoder) in a libopus built with DRED; its
+        // bitrate is taken out of each tier's own, in proportion to lossPercent.
+        int dredFrames = 0;
+        const uint8_t* dnnBlob = nullptr;
+        int dnnBlobBytes = 0;
+    };
+
+    struct Stats {
+        double wallUs = 0;              // smoothed encode() wall time
+        double cpuUs[kMaxTiers] = {};   // smoothed opus_encode thread CPU time per tier
+        int64_t frames = 0;
+        int64_t sheds = 0;
+        int64_t restores = 0;
+    };
+
+    explicit SimulcastEncoder(const Config& cfg);
+    ~SimulcastEncoder();
+
+    SimulcastEncoder(const SimulcastEncoder&) = delete;
+    SimulcastEncoder& operator=(const SimulcastEncoder&) = delete;
+
+    bool ok() const { return ok_; }
+
+    // Encodes pcm (frameSize * channels, interleaved) for the tiers in `mask` (bit t =
+    // tier t, clamped to activeTiers()). Returns the mask actually encoded, or an Opus
+    // error code (< 0) from the first tier that failed.
+    int encode(const int16_t* pcm, int32_t seq, uint32_t pts, int flags, uint32_t mask);
+
+    // Datagram of the last encode() for `tier`; length 0 if that tier was skipped.
+    const uint8_t* datagram(int tier) const { return tiers_[tier].packet; }
+    int length(int tier) const { return tiers_[tier].length; }
+
+    // Between encode() calls only.
+    bool setBitrate(int tier, int bitrate);
+    bool setLossPercent(int tier, int lossPercent);
+
+    // 10 ms frames of DRED every tier carries; 0 when off or libopus lacks DRED
+    int dredFrames() const { return dredFrames_; }
+
+    int tiers() const { return cfg_.tiers; }
+    int activeTiers() const { return active_; }
+    const Stats& stats() const { return stats_; }
+
+    // Current complexity and the opus_encode time distribution (slowest tier per frame)
+    const ComplexityGovernor::Metrics& encodeTimes() const { return governor_.metrics(); }
+
+private:
+    struct Tier {
+        OpusEncoder* enc = nullptr;
+        uint8_t packet[kMaxPacketBytes];
+        int length = 0;
+        int error = 0;
+    };
+
+    void enableDred();
+    void encodeTier(int t);
+    void workerLoop(int t);
+    void govern(uint32_t encoded);
+    void track(int64_t wallNs, uint32_t encoded);
+    static ComplexityGovernor::Config governorConfig(const Config& cfg);
+
+    const Config cfg_;
+    const int restoreAfterFrames_;
+    const double smoothing_;   // per-frame EWMA weight
+    bool ok_ = false;
+    int active_ = 1;
+    int dredFrames_ = 0;
+    int underBudgetFrames_ = 0;
+    Stats stats_;
+
+    Tier tiers_[kMaxTiers];
+    int64_t cpuNs_[kMaxTiers] = {};      // written by each tier's thread, read after the join
+    int64_t encodeNs_[kMaxTiers] = {};   // same, monotonic wall time of opus_encode
+
+    ComplexityGovernor governor_;
+    int complexity_;
+
+    // Frame handed to the workers (valid while pending_ != 0)
+    const int16_t* pcm_ = nullptr;
+    int32_t seq_ = 0;
+    uint32_t pts_ = 0;
+    int flags_ = 0;
+    uint32_t mask_ = 0;
+
+    std::atomic<uint32_t> generation_{0};
+    std::atomic<uint32_t> pending_{0};
+    std::atomic<bool> stop_{false};
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,129 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+#include <vector>
+
+#include "simulcast_encoder.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+struct SimulcastHandle {
+    explicit SimulcastHandle(const SimulcastEncoder::Config& cfg)
+            : encoder(cfg), pcm((size_t)cfg.frameSize * cfg.channels) {}
+
+    SimulcastEncoder encoder;
+    std::vector<int16_t> pcm;   // frameSize * channels
+};
+
+#define GET_SIMULCAST_HANDLE(ptr) reinterpret_cast<SimulcastHandle*>(ptr)
+
+extern "C" {
+
+// bitrates[t] is tier t's bitrate, highest first; its length is the tier count.
+// encodeShare > 0 lets complexity float in [minComplexity, maxComplexity] to hold p95
+// encode time under that share of the frame; 0 pins it at complexity.
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_createSimulcast(
+        JNIEnv* env, jobject /*thiz*/, jint sampleRate, jint channels, jint frameSize,
+        jint application, jint complexity, jint minComplexity, jint maxComplexity,
+        jdouble encodeShare, jintArray bitrates, jint budgetUs) {
+    const jsize tiers = bitrates ? env->GetArrayLength(bitrates) : 0;
+    if (tiers < 1 || tiers > SimulcastEncoder::kMaxTiers || channels <= 0 || frameSize <= 0 ||
+        budgetUs <= 0 || encodeShare < 0 || encodeShare >= 1 || minComplexity < 0 ||
+        maxComplexity > 10 || minComplexity > maxComplexity) {
+        LOGE("createSimulcast: invalid tiers=%d ch=%d frame=%d", (int)tiers, (int)channels,
+             (int)frameSize);
+        return 0;
+    }
+
+    SimulcastEncoder::Config cfg;
+    cfg.sampleRate = sampleRate;
+    cfg.channels = channels;
+    cfg.frameSize = frameSize;
+    cfg.application = application;
+    cfg.complexity = complexity;
+    cfg.minComplexity = minComplexity;
+    cfg.maxComplexity = maxComplexity;
+    cfg.encodeShare = encodeShare;
+    cfg.tiers = tiers;
+    cfg.budgetUs = budgetUs;
+    env->GetIntArrayRegion(bitrates, 0, tiers, reinterpret_cast<jint*>(cfg.bitrates));
+
+    auto* h = new (std::nothrow) SimulcastHandle(cfg);
+    if (h && !h->encoder.ok()) {
+        LOGE("createSimulcast: opus_encoder_create failed");
+        delete h;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(h);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_destroySimulcast(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_SIMULCAST_HANDLE(pointer);
+}
+
+// Encodes one frame for the tiers in mask. Returns the mask encoded, or a negative code.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_encode(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray pcm, jint seq, jint pts,
+        jint flags, jint mask) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    if (!h) return -1;
+    const jsize shorts = (jsize)h->pcm.size();
+    if (!pcm || env->GetArrayLength(pcm) < shorts) return -2;
+
+    env->GetShortArrayRegion(pcm, 0, shorts, reinterpret_cast<jshort*>(h->pcm.data()));
+    return h->encoder.encode(h->pcm.data(), seq, (uint32_t)pts, flags, (uint32_t)mask);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_setBitrate(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint tier, jint bitrate) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    return h && h->encoder.setBitrate(tier, bitrate) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_setExpectedPacketLossPercent(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint tier, jint lossPercent) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    return h && h->encoder.setLossPercent(tier, lossPercent) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_activeTiers(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    return h ? h->encoder.activeTiers() : 0;
+}
+
+// out[0..3] = wall us, frames, sheds, restores; out[4 + t] = tier t CPU us
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_stats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    constexpr int kCount = 4 + SimulcastEncoder::kMaxTiers;
+    if (!h || !out || env->GetArrayLength(out) < kCount) return;
+    const SimulcastEncoder::Stats& s = h->encoder.stats();
+    jlong v[kCount] = {(jlong)s.wallUs, s.frames, s.sheds, s.restores};
+    for (int t = 0; t < SimulcastEncoder::kMaxTiers; ++t) v[4 + t] = (jlong)s.cpuUs[t];
+    env->SetLongArrayRegion(out, 0, kCount, v);
+}
+
+// out = complexity, p50/p95/p99/max encode us, samples, lowers, raises
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SimulcastEncoder_encodeTimes(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    SimulcastHandle* h = GET_SIMULCAST_HANDLE(pointer);
+    constexpr int kCount = 8;
+    if (!h || !out || env->GetArrayLength(out) < kCount) return;
+    const ComplexityGovernor::Metrics& m = h->encoder.encodeTimes();
+    const jlong v[kCount] = {m.complexity, (jlong)m.p50Us, (jlong)m.p95Us, (jlong)m.p99Us,
+                             (jlong)m.maxUs, m.samples, m.lowers, m.raises};
+    env->SetLongArrayRegion(out, 0, kCount, v);
+}
+
+} // extern "C"
@@ -0,0 +1,90 @@
+#include "sink_latency.h"
+
+#include <algorithm>
+
+SinkLatency::SinkLatency(int sampleRate) : SinkLatency(sampleRate, Config()) {}
+
+SinkLatency::SinkLatency(int sampleRate, const Config& cfg)
+        : sampleRate_(sampleRate > 0 ? sampleRate : 48000),
+          cfg_(cfg),
+          windowNs_((int64_t)(cfg.windowMs * 1e6)),
+          staleNs_((int64_t)(cfg.staleMs * 1e6)),
+          jumpNs_((int64_t)(cfg.jumpMs * 1e6)) {
+    window_.reserve(64);
+    scratch_.reserve(64);
+}
+
+void SinkLatency::update(const AudioSink::Position& p, int64_t framesWritten, int64_t nowNs) {
+    haveAnchor_ = true;
+    anchor_ = p;
+    anchorAtNs_ = nowNs;
+    ++current_.samples;
+
+    const int64_t latency =
+            p.presentedNs + (framesWritten - p.framePosition) * 1000000000LL / sampleRate_ - nowNs;
+
+    while (!window_.empty() && nowNs - window_.front().atNs > windowNs_) {
+        window_.erase(window_.begin());
+    }
+
+    if ((int)window_.size() >= cfg_.minSamples) {
+        int64_t lo = window_.front().latencyNs, hi = lo;
+        for (const Sample& s : window_) {
+            lo = std::min(lo, s.latencyNs);
+            hi = std::max(hi, s.latencyNs);
+        }
+        if (latency < lo - jumpNs_ || latency > hi + jumpNs_) {
+            if (++outside_ < cfg_.jumpAfter) return;
+            // The sink is not what it was: start over from the samples that say so
+            window_.clear();
+            ++current_.jumps;
+        }
+    }
+    outside_ = 0;
+
+    window_.push_back({nowNs, latency});
+    summarize();
+}
+
+bool SinkLatency::poll(AudioSink& sink, int64_t nowNs) {
+    AudioSink::Position p{};
+    if (!sink.position(&p)) return false;
+    update(p, sink.framesWritten(), nowNs);
+    return true;
+}
+
+void SinkLatency::summarize() {
+    scratch_.clear();
+    for (const Sample& s : window_) scratch_.push_back(s.latencyNs);
+    const auto mid = scratch_.begin() + scratch_.size() / 2;
+    std::nth_element(scratch_.begin(), mid, scratch_.end());
+    current_.latencyNs = *mid;
+    const auto range = std::minmax_element(scratch_.begin(), scratch_.end());
+    current_.spreadNs = *range.second - *range.first;
+    current_.valid = (int)window_.size() >= cfg_.minSamples;
+}
+
+int64_t SinkLatency::playsAtNs(int64_t framesWritten, int64_t nowNs) const {
+    if (haveAnchor_ && nowNs - anchorAtNs_ <= staleNs_) {
+        return anchor_.presentedNs + (framesWritten - anchor_.framePosition) * 1000000000LL / sampleRate_;
+    }
+    return nowNs + (current_.valid ? current_.latencyNs : 0);
+}
+
+bool SinkLatency::estimate(Estimate* out) const {
+    *out = current_;
+    return current_.valid;
+}
+
+void SinkLatency::reset() {
+    haveAnchor_ = false;
+}
+
+void SinkLatency::clear() {
+    haveAnchor_ = false;
+    window_.clear();
+    outside_ = 0;
+    current_.valid = false;
+    current_.latencyNs = 0;
+    current_.spreadNs = 0;
+}
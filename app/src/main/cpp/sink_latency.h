@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "audio_sink.h"
+
+// Measured output latency of the guest's sink: how long after it is written a frame
+// is heard, from the sink's own presentation positions.
+//
+// Every position gives latency = presentedNs + (written - framePosition) / rate - now
+// for the next frame written. Over a window that latency swings by however much the
+// sink pulls at once (a few ms on a speaker, 100 ms+ on Bluetooth A2DP); the spread is
+// the extra cushion the jitter buffer needs on that route. Samples well outside the
+// window (a route change, a new Bluetooth codec) restart it.
+//
+// playsAtNs() extrapolates the newest position to the frame about to be written, which
+// is exact while the sink runs at its nominal rate. Without a recent position it falls
+// back to now + the measured latency. One thread.
+class SinkLatency {
+public:
+    struct Config {
+        double windowMs = 3000;      // latency samples kept
+        double staleMs = 1000;       // newest position no longer extrapolated
+        double jumpMs = 30;          // beyond the window's range: maybe a new route ...
+        int jumpAfter = 2;           // ... this many samples in a row restart
+        int minSamples = 2;          // before the estimate is valid
+    };
+
+    struct Estimate {
+        bool valid = false;
+        int64_t latencyNs = 0;       // median over the window
+        int64_t spreadNs = 0;        // max - min over the window
+        int64_t samples = 0;         // positions taken
+        int64_t jumps = 0;           // window restarts
+    };
+
+    explicit SinkLatency(int sampleRate);
+    SinkLatency(int sampleRate, const Config& cfg);
+
+    // A position read from the sink at nowNs, when framesWritten had been written.
+    void update(const AudioSink::Position& p, int64_t framesWritten, int64_t nowNs);
+    // Reads the sink itself; false if it had no position.
+    bool poll(AudioSink& sink, int64_t nowNs);
+
+    // When the next frame written (framesWritten so far) will be heard.
+    int64_t playsAtNs(int64_t framesWritten, int64_t nowNs) const;
+
+    bool estimate(Estimate* out) const;
+
+    // After a flush: positions restart at zero, the measured latency still holds.
+    void reset();
+    // A new route: forget the measurements too.
+    void clear();
+
+private:
+    struct Sample {
+        int64_t atNs;
+        int64_t latencyNs;
+    };
+
+    void summarize();
+
+    const int sampleRate_;
+    const Config cfg_;
+    const int64_t windowNs_;
+    const int64_t staleNs_;
+    const int64_t jumpNs_;
+
+    bool haveAnchor_ = false;
+    AudioSink::Position anchor_{};
+    int64_t anchorAtNs_ = 0;
+
+    std::vector<Sample> window_;     // oldest first
+    std::vector<int64_t> scratch_;
+    int outside_ = 0;
+    Estimate current_;
+};
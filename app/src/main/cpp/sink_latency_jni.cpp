@@ -0,0 +1,73 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+
+#include "sink_latency.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_SINK_LATENCY(ptr) reinterpret_cast<SinkLatency*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_createSinkLatency(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint sampleRate) {
+    if (sampleRate <= 0) {
+        LOGE("createSinkLatency: invalid sampleRate=%d", (int)sampleRate);
+        return 0;
+    }
+    return reinterpret_cast<jlong>(new (std::nothrow) SinkLatency(sampleRate));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_destroySinkLatency(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_SINK_LATENCY(pointer);
+}
+
+// An AudioTimestamp (framePosition, nanoTime) read at nowNs with framesWritten written.
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_update(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jlong framePosition, jlong presentedNs,
+        jlong framesWritten, jlong nowNs) {
+    SinkLatency* s = GET_SINK_LATENCY(pointer);
+    if (s) s->update({framePosition, presentedNs}, framesWritten, nowNs);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_playsAtNs(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jlong framesWritten, jlong nowNs) {
+    SinkLatency* s = GET_SINK_LATENCY(pointer);
+    return s ? s->playsAtNs(framesWritten, nowNs) : nowNs;
+}
+
+// out[0..4] = valid, latencyNs, spreadNs, samples, jumps
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_estimate(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    SinkLatency* s = GET_SINK_LATENCY(pointer);
+    if (!s || !out || env->GetArrayLength(out) < 5) return JNI_FALSE;
+    SinkLatency::Estimate e;
+    const bool valid = s->estimate(&e);
+    const jlong v[5] = {valid ? 1 : 0, e.latencyNs, e.spreadNs, e.samples, e.jumps};
+    env->SetLongArrayRegion(out, 0, 5, v);
+    return valid ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_reset(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    SinkLatency* s = GET_SINK_LATENCY(pointer);
+    if (s) s->reset();
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024SinkLatency_clear(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    SinkLatency* s = GET_SINK_LATENCY(pointer);
+    if (s) s->clear();
+}
+
+} // extern "C"
@@ -0,0 +1,159 @@
+#include "time_stretch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+TimeStretcher::TimeStretcher(const Config& cfg)
+        : cfg_(cfg),
+          minLag_(std::max(kDecimation, (int)std::lround(cfg.minLagMs * cfg.sampleRate / 1000.0))),
+          maxLag_(std::min(cfg.maxFrameSize / 2,
+                           (int)std::lround(cfg.maxLagMs * cfg.sampleRate / 1000.0))),
+          mono_(cfg.maxFrameSize, 0.0f),
+          decimated_(cfg.maxFrameSize / kDecimation + 1, 0.0f) {}
+
+void TimeStretcher::reset() {
+    credit_ = 0;
+    stretched_ = 0;
+}
+
+// Normalised cross-correlation of x[0, len) with x[lag, lag + len); negative -> 0.
+static float similarity(const float* x, int lag, int len) {
+    float xy = 0, e0 = 0, e1 = 0;
+    for (int i = 0; i < len; ++i) {
+        const float a = x[i];
+        const float b = x[i + lag];
+        xy += a * b;
+        e0 += a * a;
+        e1 += b * b;
+    }
+    if (xy <= 0) return 0;
+    return xy / std::sqrt(e0 * e1 + 1e-9f);
+}
+
+int TimeStretcher::findPeriod(const int16_t* in, int maxLag) {
+    const int ch = cfg_.channels;
+    const int span = 2 * maxLag;
+
+    float energy = 0;
+    for (int i = 0; i < span; ++i) {
+        float s = 0;
+        for (int c = 0; c < ch; ++c) s += in[i * ch + c];
+        s /= (float)ch;
+        mono_[i] = s;
+        energy += s * s;
+    }
+
+    // Near-silence: any splice is inaudible, take the longest allowed
+    if (std::sqrt(energy / (float)span) < kSilenceRms) return maxLag;
+
+    // Coarse search on a box-decimated copy, then refine at full rate
+    const int spanD = span / kDecimation;
+    for (int i = 0; i < spanD; ++i) {
+        float s = 0;
+        for (int k = 0; k < kDecimation; ++k) s += mono_[i * kDecimation + k];
+        decimated_[i] = s;
+    }
+
+    const int loD = (minLag_ + kDecimation - 1) / kDecimation;
+    const int hiD = maxLag / kDecimation;
+    int bestD = 0;
+    float bestCorr = -1;
+    for (int t = loD; t <= hiD; ++t) {
+        const float c = similarity(decimated_.data(), t, t);
+        if (c > bestCorr) {
+            bestCorr = c;
+            bestD = t;
+        }
+    }
+    if (bestD == 0) return 0;
+
+    const int lo = std::max(minLag_, bestD * kDecimation - kDecimation);
+    const int hi = std::min(maxLag, bestD * kDecimation + kDecimation);
+    int best = 0;
+    bestCorr = -1;
+    for (int t = lo; t <= hi; ++t) {
+        const float c = similarity(mono_.data(), t, t);
+        if (c > bestCorr) {
+            bestCorr = c;
+            best = t;
+        }
+    }
+    return bestCorr >= (float)cfg_.minCorrelation ? best : 0;
+}
+
+int TimeStretcher::expand(const int16_t* in, int frameSize, int16_t* out, int outCapFrames) {
+    if (!in || !out || frameSize <= 0 || frameSize > cfg_.maxFrameSize) return -2;
+    if (outCapFrames < frameSize) return -3;
+
+    const int ch = cfg_.channels;
+    const int lag = spliceLag(in, frameSize, std::min(frameSize / 2, outCapFrames - frameSize));
+    if (lag == 0) {
+        std::memcpy(out, in, (size_t)frameSize * ch * sizeof(int16_t));
+        return frameSize;
+    }
+
+    // out = P1 | xfade(P2 -> P1) | P2 ... end, where P1 = in[0, T), P2 = in[T, 2T)
+    const size_t periodShorts = (size_t)lag * ch;
+    std::memcpy(out, in, periodShorts * sizeof(int16_t));
+
+    const int16_t* p1 = in;
+    const int16_t* p2 = in + periodShorts;
+    int16_t* mix = out + periodShorts;
+    const float step = 1.0f / (float)lag;
+    for (int i = 0; i < lag; ++i) {
+        const float w = ((float)i + 0.5f) * step;
+        for (int c = 0; c < ch; ++c) {
+            const int k = i * ch + c;
+            mix[k] = (int16_t)std::lround((float)p2[k] * (1.0f - w) + (float)p1[k] * w);
+        }
+    }
+
+    std::memcpy(mix + periodShorts, p2, (size_t)(frameSize - lag) * ch * sizeof(int16_t));
+
+    stretched_ += lag;
+    return frameSize + lag;
+}
+
+int TimeStretcher::compress(const int16_t* in, int frameSize, int16_t* out) {
+    if (!in || !out || frameSize <= 0 || frameSize > cfg_.maxFrameSize) return -2;
+
+    const int ch = cfg_.channels;
+    const int lag = spliceLag(in, frameSize, frameSize / 2);
+    if (lag == 0) {
+        std::memcpy(out, in, (size_t)frameSize * ch * sizeof(int16_t));
+        return frameSize;
+    }
+
+    // out = xfade(P1 -> P2) | rest after P2, where P1 = in[0, T), P2 = in[T, 2T)
+    const size_t periodShorts = (size_t)lag * ch;
+    const int16_t* p1 = in;
+    const int16_t* p2 = in + periodShorts;
+    const float step = 1.0f / (float)lag;
+    for (int i = 0; i < lag; ++i) {
+        const float w = ((float)i + 0.5f) * step;
+        for (int c = 0; c < ch; ++c) {
+            const int k = i * ch + c;
+            out[k] = (int16_t)std::lround((float)p1[k] * (1.0f - w) + (float)p2[k] * w);
+        }
+    }
+
+    std::memcpy(out + periodShorts, in + 2 * periodShorts,
+                (size_t)(frameSize - 2 * lag) * ch * sizeof(int16_t));
+
+    stretched_ -= lag;
+    return frameSize - lag;
+}
+
+int TimeStretcher::spliceLag(const int16_t* in, int frameSize, int maxLag) {
+    credit_ = std::min(credit_ + frameSize * cfg_.maxRate, (double)maxLag_);
+
+    // Search the full lag range once a minimal splice is affordable; a longer splice
+    // leaves the credit negative, which keeps the long-run rate at maxRate.
+    maxLag = std::min(maxLag, maxLag_);
+    if (credit_ < minLag_ || maxLag < minLag_) return 0;
+
+    const int lag = findPeriod(in, maxLag);
+    credit_ -= lag;
+    return lag;
+}
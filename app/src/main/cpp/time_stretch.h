@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Pitch-synchronous time stretch of single decoded frames (one-segment WSOLA).
+//
+// expand() finds the lag T at which the frame best repeats itself (two adjacent
+// similar segments P1 P2) and plays P1 once more, cross-fading between the copies,
+// so the frame comes out T samples longer with no gap or click. compress() does the
+// reverse: it cross-fades P1 into P2 and drops one period. The frame's first and
+// last samples are untouched, so consecutive frames stay continuous.
+//
+// A sample budget (maxRate of the input length) paces how often frames are
+// stretched, so growth and drain stay below audibility. Works on interleaved int16 and
+// needs no look-ahead, so it adds no latency.
+class TimeStretcher {
+public:
+    struct Config {
+        int sampleRate = 48000;
+        int channels = 2;
+        int maxFrameSize = 960;     // samples per channel
+        double maxRate = 0.08;      // at most this fraction of samples added / removed
+        double minCorrelation = 0.6;
+        double minLagMs = 2.5;
+        double maxLagMs = 10.0;     // also bounded by maxFrameSize / 2
+    };
+
+    explicit TimeStretcher(const Config& cfg);
+
+    int channels() const { return cfg_.channels; }
+    int maxFrameSize() const { return cfg_.maxFrameSize; }
+
+    // Largest output (samples per channel) for an input of frameSize.
+    int maxOutputFrames(int frameSize) const { return frameSize + maxLag_; }
+
+    // Copies `frameSize` samples per channel from `in` to `out`, lengthened by one
+    // period when the budget allows and a good splice point exists.
+    // Returns samples per channel written, or -2 bad args / -3 out too small.
+    int expand(const int16_t* in, int frameSize, int16_t* out, int outCapFrames);
+
+    // Copies `frameSize` samples per channel from `in` to `out`, shortened by one
+    // period when the budget allows and a good splice point exists.
+    // Returns samples per channel written (>= frameSize / 2), or -2 bad args.
+    int compress(const int16_t* in, int frameSize, int16_t* out);
+
+    // Net samples per channel added (expand) minus removed (compress) since creation / reset().
+    int64_t stretchedFrames() const { return stretched_; }
+
+    void reset();
+
+private:
+    static constexpr int kDecimation = 4;
+    static constexpr float kSilenceRms = 32.0f;   // ~-60 dBFS: splice anywhere
+
+    // Best lag for two adjacent similar segments starting at 0; 0 if none qualifies.
+    int findPeriod(const int16_t* in, int maxLag);
+
+    // Charges the budget for one frame and returns the splice lag, or 0 to pass through.
+    int spliceLag(const int16_t* in, int frameSize, int maxLag);
+
+    const Config cfg_;
+    const int minLag_;
+    const int maxLag_;
+
+    double credit_ = 0;
+    int64_t stretched_ = 0;
+
+    std::vector<float> mono_;        // maxFrameSize
+    std::vector<float> decimated_;   // maxFrameSize / kDecimation
+};
@@ -0,0 +1,104 @@
+#include <jni.h>
+#include <android/log.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "time_stretch.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+struct TimeStretchHandle {
+    explicit TimeStretchHandle(const TimeStretcher::Config& cfg)
+            : stretcher(cfg),
+              in((size_t)cfg.maxFrameSize * cfg.channels),
+              out((size_t)stretcher.maxOutputFrames(cfg.maxFrameSize) * cfg.channels) {}
+
+    TimeStretcher stretcher;
+    std::vector<int16_t> in;    // maxFrameSize * channels
+    std::vector<int16_t> out;   // maxOutputFrames(maxFrameSize) * channels
+};
+
+#define GET_STRETCH_HANDLE(ptr) reinterpret_cast<TimeStretchHandle*>(ptr)
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_createStretcher(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint sampleRate, jint channels, jint maxFrameSize,
+        jdouble maxRate) {
+    if (sampleRate <= 0 || channels <= 0 || maxFrameSize <= 0 || maxRate < 0) {
+        LOGE("createStretcher: invalid rate=%d ch=%d frame=%d",
+             (int)sampleRate, (int)channels, (int)maxFrameSize);
+        return 0;
+    }
+    TimeStretcher::Config cfg;
+    cfg.sampleRate = sampleRate;
+    cfg.channels = channels;
+    cfg.maxFrameSize = maxFrameSize;
+    cfg.maxRate = maxRate;
+    return reinterpret_cast<jlong>(new (std::nothrow) TimeStretchHandle(cfg));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_destroyStretcher(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_STRETCH_HANDLE(pointer);
+}
+
+// Returns shorts written to `out`, or a negative error code.
+static jint stretchInto(JNIEnv* env, jlong pointer, jshortArray pcm, jint frameSize,
+                        jshortArray out, bool expand) {
+    TimeStretchHandle* h = GET_STRETCH_HANDLE(pointer);
+    if (!h) return -1;
+    if (!pcm || !out) return -2;
+
+    const int channels = h->stretcher.channels();
+    if (frameSize <= 0 || frameSize > h->stretcher.maxFrameSize()) return -2;
+    const jsize inShorts = frameSize * channels;
+    if (env->GetArrayLength(pcm) < inShorts) return -2;
+
+    const jsize outCapFrames = env->GetArrayLength(out) / channels;
+    if (outCapFrames < frameSize) return -3;
+
+    env->GetShortArrayRegion(pcm, 0, inShorts, reinterpret_cast<jshort*>(h->in.data()));
+    const int n = expand
+            ? h->stretcher.expand(h->in.data(), frameSize, h->out.data(),
+                                  std::min<int>(outCapFrames, h->stretcher.maxOutputFrames(frameSize)))
+            : h->stretcher.compress(h->in.data(), frameSize, h->out.data());
+    if (n < 0) return n;
+
+    env->SetShortArrayRegion(out, 0, n * channels, reinterpret_cast<const jshort*>(h->out.data()));
+    return n * channels;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_expandInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray pcm, jint frameSize,
+        jshortArray out) {
+    return stretchInto(env, pointer, pcm, frameSize, out, true);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_compressInto(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jshortArray pcm, jint frameSize,
+        jshortArray out) {
+    return stretchInto(env, pointer, pcm, frameSize, out, false);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_stretchedFrames(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    TimeStretchHandle* h = GET_STRETCH_HANDLE(pointer);
+    return h ? (jlong)h->stretcher.stretchedFrames() : 0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024TimeStretcher_reset(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    TimeStretchHandle* h = GET_STRETCH_HANDLE(pointer);
+    if (h) h->stretcher.reset();
+}
+
+} // extern "C"
@@ -0,0 +1,273 @@
+#include "udp_receiver.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+
+#include "clock_sync.h"
+#include "jitter_buffer.h"
+#include "playout_delay.h"
+
+static int64_t clockNs(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// A gap is NACKed as long as its packets could still be played: maxAgeMs worth of frames
+static NackTracker::Config nackConfig(double frameMs) {
+    NackTracker::Config cfg;
+    if (frameMs > 0) cfg.maxGap = std::max(cfg.maxGap, (int)std::ceil(cfg.maxAgeMs / frameMs));
+    return cfg;
+}
+
+UdpReceiver::UdpReceiver(int fd, double frameMs) : fd_(fd), nack_(nackConfig(frameMs)) {
+    int on = 1;
+    kernelTimestamps_ = ::setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+
+    std::memset(msgs_, 0, sizeof(msgs_));
+    for (int i = 0; i < kBatch; ++i) {
+        iov_[i].iov_base = data_[i];
+        iov_[i].iov_len = kDatagramBytes;
+    }
+}
+
+UdpReceiver::~UdpReceiver() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+int64_t UdpReceiver::arrivalNs(const msghdr& h, int64_t realToMonoNs, int64_t fallbackNs) const {
+    if (!kernelTimestamps_) return fallbackNs;
+    for (cmsghdr* c = CMSG_FIRSTHDR(const_cast<msghdr*>(&h)); c != nullptr;
+         c = CMSG_NXTHDR(const_cast<msghdr*>(&h), c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec ts{};
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec + realToMonoNs;
+        }
+    }
+    return fallbackNs;
+}
+
+bool UdpReceiver::setNackTarget(const uint8_t* ip, int ipLen, int port) {
+    if (!ip || (ipLen != 4 && ipLen != 16)) return false;
+
+    // Match the socket's family: Java sockets are usually dual-stack AF_INET6
+    sockaddr_storage local{};
+    socklen_t localLen = sizeof(local);
+    if (::getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &localLen) != 0) return false;
+
+    std::memset(&nackDest_, 0, sizeof(nackDest_));
+    if (local.ss_family == AF_INET6) {
+        auto* a = reinterpret_cast<sockaddr_in6*>(&nackDest_);
+        a->sin6_family = AF_INET6;
+        a->sin6_port = htons((uint16_t)port);
+        if (ipLen == 4) {
+            a->sin6_addr.s6_addr[10] = 0xff;
+            a->sin6_addr.s6_addr[11] = 0xff;
+            std::memcpy(&a->sin6_addr.s6_addr[12], ip, 4);
+        } else {
+            std::memcpy(&a->sin6_addr, ip, 16);
+        }
+        nackDestLen_ = sizeof(sockaddr_in6);
+    } else if (ipLen == 4) {
+        auto* a = reinterpret_cast<sockaddr_in*>(&nackDest_);
+        a->sin_family = AF_INET;
+        a->sin_port = htons((uint16_t)port);
+        std::memcpy(&a->sin_addr, ip, 4);
+        nackDestLen_ = sizeof(sockaddr_in);
+    } else {
+        return false;
+    }
+    nack_.reset();
+    nackEnabled_ = true;
+    return true;
+}
+
+void UdpReceiver::flushNacks(int64_t nowNs) {
+    if (!nackEnabled_) return;
+    wspacket::NackEntry entries[wspacket::kMaxNackEntries];
+    const int n = nack_.collect(nowNs, entries, wspacket::kMaxNackEntries);
+    if (n <= 0) return;
+
+    uint8_t out[wspacket::kMaxNackBytes];
+    const int len = wspacket::writeNack(out, entries, n);
+    // Best effort: a lost NACK is retried by the tracker
+    ::sendto(fd_, out, (size_t)len, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&nackDest_),
+             nackDestLen_);
+}
+
+void UdpReceiver::pollClock(HostClock* clock, int64_t nowNs) {
+    if (!clock || !nackEnabled_ || !clock->requestDue(nowNs)) return;
+    uint8_t out[wspacket::kClockRequestSize];
+    const int64_t t1 = clockNs(CLOCK_MONOTONIC);
+    const int len = wspacket::writeClockRequest(out, t1);
+    // Best effort: a lost request or reply only delays the next exchange
+    ::sendto(fd_, out, (size_t)len, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&nackDest_),
+             nackDestLen_);
+    clock->onRequestSent(t1);
+}
+
+void UdpReceiver::countArrival(int32_t seq) {
+    const int64_t diff = (int64_t)seq - (int64_t)highestSeq_;
+    if (!counting_ || diff > 3000 || diff < -3000) {
+        // First packet, or the host restarted its sequence: start counting afresh
+        counting_ = true;
+        baseSeq_ = seq;
+        highestSeq_ = seq;
+        received_ = 0;
+        reportedExpected_ = 0;
+        reportedReceived_ = 0;
+    } else if (diff > 0) {
+        highestSeq_ = seq;
+    }
+    ++received_;
+}
+
+bool UdpReceiver::sendReport(int jitterTenthMs, int depthFrames, int decoded, int fec, int plc,
+                             int dred) {
+    if (!nackEnabled_) return false;
+
+    wspacket::Report r{};
+    r.highestSeq = highestSeq_;
+    if (counting_) {
+        // RFC 3550 style: expected from the seq span, lost = expected - received
+        const int64_t expected = (int64_t)highestSeq_ - (int64_t)baseSeq_ + 1;
+        const int64_t lost = expected - received_;
+        const int64_t expectedInterval = expected - reportedExpected_;
+        const int64_t lostInterval = expectedInterval - (received_ - reportedReceived_);
+        reportedExpected_ = expected;
+        reportedReceived_ = received_;
+        r.cumulativeLost = (int32_t)std::max<int64_t>(0, std::min<int64_t>(lost, INT32_MAX));
+        r.fractionLost = expectedInterval > 0 && lostInterval > 0
+                         ? (int)std::min<int64_t>(255, (lostInterval << 8) / expectedInterval)
+                         : 0;
+    }
+    r.jitterTenthMs = jitterTenthMs;
+    r.depthFrames = depthFrames;
+    r.decoded = decoded;
+    r.fec = fec;
+    r.plc = plc;
+    r.dred = dred;
+
+    uint8_t out[wspacket::kReportSize];
+    const int len = wspacket::writeReport(out, r);
+    return ::sendto(fd_, out, (size_t)len, MSG_DONTWAIT,
+                    reinterpret_cast<const sockaddr*>(&nackDest_), nackDestLen_) == len;
+}
+
+void UdpReceiver::recoverFec(JitterBuffer& jb, int64_t nowNs) {
+    if (!fec_.active()) return;
+    fec_.recover([&](const uint8_t* datagram, int length) {
+        wspacket::Header header{};
+        if (jb.putDatagram(datagram, length, &header) && nackEnabled_) {
+            nack_.onReceived(header.seq, nowNs);   // no NACK for what parity rebuilt
+        }
+    });
+}
+
+bool UdpReceiver::storeMedia(JitterBuffer& jb, PlayoutDelayController* delay, HostClock* clock,
+                             const uint8_t* data, int len, int64_t at, int64_t monoNow) {
+    wspacket::Header header{};
+    if (!jb.putDatagram(data, len, &header)) return false;
+    fec_.onMedia(header.seq, data, len);
+
+    if (nackEnabled_) nack_.onReceived(header.seq, monoNow);
+    if (!(header.flags & wspacket::kFlagRetransmit)) countArrival(header.seq);
+    // A resend's arrival time says nothing about path jitter
+    if (delay && !(header.flags & wspacket::kFlagRetransmit)) {
+        delay->onArrival(header.seq, header.pts, at);
+    }
+    if (clock) clock->onMedia(header.seq, header.pts);
+    if (at > lastArrivalNs_) lastArrivalNs_ = at;
+    return true;
+}
+
+// Every frame of an aggregate goes through as the datagram the host cached and
+// protected; their arrival is the aggregate's, so the older frames show the wait
+int UdpReceiver::storeAggregate(JitterBuffer& jb, PlayoutDelayController* delay,
+                                HostClock* clock, const uint8_t* data, int len, int64_t at,
+                                int64_t monoNow) {
+    if (wsaggregate::parse(data, len, &frames_) < 0) return 0;
+    int stored = 0;
+    for (int k = 0; k < frames_.count; ++k) {
+        const int n = wsaggregate::frameDatagram(frames_, k, frame_);
+        if (storeMedia(jb, delay, clock, frame_, n, at, monoNow)) ++stored;
+    }
+    ++aggregates_;
+    return stored;
+}
+
+int UdpReceiver::receiveInto(JitterBuffer& jb, PlayoutDelayController* delay, HostClock* clock,
+                             int timeoutMs) {
+    pollfd pfd{fd_, POLLIN, 0};
+    const int pr = ::poll(&pfd, 1, timeoutMs);
+    if (pr == 0) {
+        const int64_t now = clockNs(CLOCK_MONOTONIC);
+        flushNacks(now);  // retries are due even when nothing arrives
+        pollClock(clock, now);
+        return 0;
+    }
+    if (pr < 0) return errno == EINTR ? 0 : -errno;
+    if (pfd.revents & (POLLERR | POLLNVAL)) return -EBADF;
+
+    int stored = 0;
+    for (;;) {
+        // msg_controllen / msg_namelen are in-out, so reset before every call
+        for (int i = 0; i < kBatch; ++i) {
+            msghdr& h = msgs_[i].msg_hdr;
+            h.msg_iov = &iov_[i];
+            h.msg_iovlen = 1;
+            h.msg_control = control_[i];
+            h.msg_controllen = sizeof(control_[i]);
+            h.msg_name = nullptr;
+            h.msg_namelen = 0;
+            h.msg_flags = 0;
+        }
+
+        const int n = ::recvmmsg(fd_, msgs_, kBatch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return stored > 0 ? stored : -errno;
+        }
+
+        // Kernel stamps are CLOCK_REALTIME; shift them onto the monotonic base
+        const int64_t monoNow = clockNs(CLOCK_MONOTONIC);
+        const int64_t realToMono = monoNow - clockNs(CLOCK_REALTIME);
+
+        for (int i = 0; i < n; ++i) {
+            const msghdr& h = msgs_[i].msg_hdr;
+            if (h.msg_flags & MSG_TRUNC) continue;
+
+            const int len = (int)msgs_[i].msg_len;
+            wspacket::ClockExchange exchange{};
+            if (clock && wspacket::parseClock(data_[i], len, &exchange) == wspacket::kClockReply) {
+                clock->onReply(exchange, arrivalNs(h, realToMono, monoNow));
+                continue;
+            }
+            if (wsfec::isParity(data_[i], len)) {
+                fec_.onParity(data_[i], len);
+                continue;
+            }
+
+            const int64_t at = arrivalNs(h, realToMono, monoNow);
+            if (len > wspacket::kHeaderSize && (data_[i][3] & wspacket::kFlagAggregate)) {
+                stored += storeAggregate(jb, delay, clock, data_[i], len, at, monoNow);
+            } else if (storeMedia(jb, delay, clock, data_[i], len, at, monoNow)) {
+                ++stored;
+            }
+        }
+
+        if (n < kBatch) break;  // socket drained
+    }
+    const int64_t now = clockNs(CLOCK_MONOTONIC);
+    recoverFec(jb, now);
+    flushNacks(now);
+    pollClock(clock, now);
+    return stored;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <cstdint>
+#include <ctime>
+
+#include "fec.h"
+#include "frame_aggregator.h"
+#include "nack_tracker.h"
+
+class HostClock;
+class JitterBuffer;
+class PlayoutDelayController;
+
+// Guest-side batched UDP receive: one poll() wakeup per burst, drained with
+// recvmmsg(), each datagram stamped by the kernel (SO_TIMESTAMPNS) on arrival.
+//
+// Datagrams go straight into the JitterBuffer and their kernel arrival times into
+// the PlayoutDelayController, so jitter estimates exclude thread-scheduling delay.
+// Timestamps are mapped to CLOCK_MONOTONIC (the System.nanoTime() base).
+// With a NACK target set, gaps are reported to the host from the same socket, so
+// its unicast resends come back to the port this receiver listens on; receiver
+// reports go to the same target. FEC parity
+// datagrams are consumed here and rebuilt media goes into the JitterBuffer. Given a
+// HostClock, clock requests go to the same target too and the replies (kernel-stamped
+// like media) and every media pts feed it. Aggregate datagrams (frame_aggregator.h) are
+// split into their frames, each handled like a datagram of its own.
+// rx thread only.
+class UdpReceiver {
+public:
+    static constexpr int kBatch = 16;
+    static constexpr int kDatagramBytes = 2048;
+
+    // Takes ownership of `fd` (a bound UDP socket). frameMs is the negotiated Opus frame
+    // duration; frame-counted NACK limits are derived from it.
+    UdpReceiver(int fd, double frameMs);
+    ~UdpReceiver();
+
+    UdpReceiver(const UdpReceiver&) = delete;
+    UdpReceiver& operator=(const UdpReceiver&) = delete;
+
+    // Waits up to timeoutMs for data, then drains everything queued. delay and clock
+    // are optional. Returns frames stored (0 on timeout), or -errno on a socket error.
+    int receiveInto(JitterBuffer& jb, PlayoutDelayController* delay, HostClock* clock,
+                    int timeoutMs);
+
+    // Enables NACKs to the host at ip (4 or 16 bytes) : port. Returns false if malformed.
+    bool setNackTarget(const uint8_t* ip, int ipLen, int port);
+
+    // Sends a receiver report to the NACK target. Highest seq and loss come from this
+    // receiver's own counts; the rest describes playout since the previous report.
+    // Returns false without a target or if the send fails.
+    bool sendReport(int jitterTenthMs, int depthFrames, int decoded, int fec, int plc, int dred);
+
+    const NackTracker::Stats& nackStats() const { return nack_.stats(); }
+    const FecDecoder::Stats& fecStats() const { return fec_.stats(); }
+
+    // Monotonic arrival time of the newest stored datagram (0 before the first).
+    int64_t lastArrivalNs() const { return lastArrivalNs_; }
+
+    bool kernelTimestamps() const { return kernelTimestamps_; }
+
+    // Aggregate datagrams split so far
+    int64_t aggregates() const { return aggregates_; }
+
+private:
+    int64_t arrivalNs(const msghdr& h, int64_t realToMonoNs, int64_t fallbackNs) const;
+    void flushNacks(int64_t nowNs);
+    void pollClock(HostClock* clock, int64_t nowNs);
+    void recoverFec(JitterBuffer& jb, int64_t nowNs);
+    void countArrival(int32_t seq);
+    bool storeMedia(JitterBuffer& jb, PlayoutDelayController* delay, HostClock* clock,
+                    const uint8_t* data, int len, int64_t at, int64_t monoNow);
+    int storeAggregate(JitterBuffer& jb, PlayoutDelayController* delay, HostClock* clock,
+                       const uint8_t* data, int len, int64_t at, int64_t monoNow);
+
+    int fd_;
+    bool kernelTimestamps_ = false;
+    int64_t lastArrivalNs_ = 0;
+
+    NackTracker nack_;
+    bool nackEnabled_ = false;
+    sockaddr_storage nackDest_{};
+    socklen_t nackDestLen_ = 0;
+
+    FecDecoder fec_;
+
+    // First-transmission arrivals, for the loss fields of receiver reports
+    bool counting_ = false;
+    int32_t baseSeq_ = 0;
+    int32_t highestSeq_ = 0;
+    int64_t received_ = 0;
+    int64_t reportedExpected_ = 0;
+    int64_t reportedReceived_ = 0;
+
+    int64_t aggregates_ = 0;
+    wsaggregate::Frames frames_;
+    uint8_t frame_[kDatagramBytes];   // one frame of an aggregate, rebuilt
+
+    alignas(64) uint8_t data_[kBatch][kDatagramBytes];
+    alignas(8) uint8_t control_[kBatch][CMSG_SPACE(sizeof(timespec))];
+    iovec iov_[kBatch];
+    mmsghdr msgs_[kBatch];
+};
@@ -0,0 +1,108 @@
+#include <jni.h>
+#include <android/log.h>
+#include <unistd.h>
+#include <new>
+
+#include "clock_sync.h"
+#include "jitter_buffer.h"
+#include "playout_delay.h"
+#include "udp_receiver.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define GET_RECEIVER(ptr) reinterpret_cast<UdpReceiver*>(ptr)
+
+extern "C" {
+
+// Takes ownership of fd (ParcelFileDescriptor.detachFd()).
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_createReceiver(
+        JNIEnv* /*env*/, jobject /*thiz*/, jint fd, jdouble frameMs) {
+    if (fd < 0) {
+        LOGE("createReceiver: invalid fd=%d", (int)fd);
+        return 0;
+    }
+    if (!(frameMs > 0)) {
+        LOGE("createReceiver: invalid frameMs=%.1f", (double)frameMs);
+        ::close(fd);
+        return 0;
+    }
+    auto* r = new (std::nothrow) UdpReceiver(fd, frameMs);
+    if (r && !r->kernelTimestamps()) {
+        LOGE("createReceiver: SO_TIMESTAMPNS unavailable, using receive-time stamps");
+    }
+    return reinterpret_cast<jlong>(r);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_destroyReceiver(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_RECEIVER(pointer);
+}
+
+// Returns datagrams stored into the jitter buffer (0 on timeout), or -errno.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_receiveInto(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jlong bufferPointer,
+        jlong delayPointer, jlong clockPointer, jint timeoutMs) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    auto* jb = reinterpret_cast<JitterBuffer*>(bufferPointer);
+    if (!r || !jb) return -1;
+    return r->receiveInto(*jb, reinterpret_cast<PlayoutDelayController*>(delayPointer),
+                          reinterpret_cast<HostClock*>(clockPointer), timeoutMs);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_lastArrivalNs(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    return r ? (jlong)r->lastArrivalNs() : 0;
+}
+
+// ip is InetAddress.getAddress() of the host (4 or 16 bytes).
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_setNackTarget(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jbyteArray ip, jint port) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    if (!r || !ip) return JNI_FALSE;
+    const jsize len = env->GetArrayLength(ip);
+    if (len != 4 && len != 16) return JNI_FALSE;
+    uint8_t raw[16];
+    env->GetByteArrayRegion(ip, 0, len, reinterpret_cast<jbyte*>(raw));
+    return r->setNackTarget(raw, (int)len, port) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Receiver report to the NACK target; rx thread. Returns false without a target.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_sendReport(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint jitterTenthMs, jint depthFrames,
+        jint decoded, jint fec, jint plc, jint dred) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    if (!r) return JNI_FALSE;
+    return r->sendReport(jitterTenthMs, depthFrames, decoded, fec, plc, dred) ? JNI_TRUE : JNI_FALSE;
+}
+
+// out[0..4] = lost, requested, recovered, abandoned, nacksSent
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_nackStats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    if (!r || !out || env->GetArrayLength(out) < 5) return;
+    const NackTracker::Stats& s = r->nackStats();
+    const jlong v[5] = {s.lost, s.requested, s.recovered, s.abandoned, s.nacksSent};
+    env->SetLongArrayRegion(out, 0, 5, v);
+}
+
+// out[0..2] = parity datagrams, media recovered, groups unrecoverable
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpReceiver_fecStats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    UdpReceiver* r = GET_RECEIVER(pointer);
+    if (!r || !out || env->GetArrayLength(out) < 3) return;
+    const FecDecoder::Stats& s = r->fecStats();
+    const jlong v[3] = {s.parity, s.recovered, s.unrecoverable};
+    env->SetLongArrayRegion(out, 0, 3, v);
+}
+
+} // extern "C"
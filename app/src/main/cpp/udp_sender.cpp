@@ -0,0 +1,149 @@
+#include "udp_sender.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+UdpSender::UdpSender() {
+    fd_ = ::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return;
+
+    // Dual-stack so IPv4 guests are reached through v4-mapped addresses
+    int off = 0;
+    ::setsockopt(fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    // Room for one frame to every guest even if the driver is briefly behind
+    int sndbuf = 256 * 1024;
+    ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+}
+
+UdpSender::~UdpSender() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool UdpSender::bindPort(int port) {
+    if (fd_ < 0) return false;
+    sockaddr_in6 a{};
+    a.sin6_family = AF_INET6;
+    a.sin6_port = htons((uint16_t)port);
+    a.sin6_addr = in6addr_any;
+    return ::bind(fd_, reinterpret_cast<const sockaddr*>(&a), sizeof(a)) == 0;
+}
+
+bool UdpSender::setGroupInterface(const uint8_t* ipv4) {
+    if (fd_ < 0 || !ipv4) return false;
+
+    // IPv4-level options apply to the v4-mapped traffic of this dual-stack socket.
+    // A local-only hotspot often has no default route, so the interface must be explicit.
+    in_addr iface{};
+    std::memcpy(&iface, ipv4, 4);
+    const unsigned char ttl = 1;   // never leave the link
+    const int on = 1;
+    bool ok = ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) == 0;
+    ok = ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == 0 && ok;
+    ok = ::setsockopt(fd_, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) == 0 && ok;
+    return ok;
+}
+
+bool UdpSender::setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports, int count) {
+    addrs_.clear();
+    tiers_.clear();
+    msgs_.clear();
+    if (count <= 0) return true;
+
+    addrs_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        sockaddr_in6& a = addrs_[i];
+        std::memset(&a, 0, sizeof(a));
+        a.sin6_family = AF_INET6;
+        a.sin6_port = htons((uint16_t)ports[i]);
+        if (ipLens[i] == 4) {
+            // ::ffff:a.b.c.d
+            a.sin6_addr.s6_addr[10] = 0xff;
+            a.sin6_addr.s6_addr[11] = 0xff;
+            std::memcpy(&a.sin6_addr.s6_addr[12], ips[i], 4);
+        } else if (ipLens[i] == 16) {
+            std::memcpy(&a.sin6_addr, ips[i], 16);
+        } else {
+            addrs_.clear();
+            return false;
+        }
+    }
+
+    // Messages on a tier share that tier's iovec; only the destination differs
+    tiers_.assign(count, 0);
+    msgs_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        std::memset(&msgs_[i], 0, sizeof(mmsghdr));
+        msghdr& h = msgs_[i].msg_hdr;
+        h.msg_name = &addrs_[i];
+        h.msg_namelen = sizeof(sockaddr_in6);
+        h.msg_iov = &iov_[0];
+        h.msg_iovlen = 1;
+    }
+    batch_.reserve(count);
+    batchIndex_.reserve(count);
+    return true;
+}
+
+void UdpSender::setTargetTier(int i, int tier) {
+    if (i < 0 || i >= (int)tiers_.size() || tier < 0 || tier >= kMaxTiers) return;
+    tiers_[i] = tier;
+    msgs_[i].msg_hdr.msg_iov = &iov_[tier];
+}
+
+int UdpSender::sendBatch(mmsghdr* msgs, const int* index, int n, int* errors) {
+    // sendmmsg stops at the first failing message: record it, skip it, continue
+    int sent = 0;
+    int next = 0;
+    while (next < n) {
+        const int r = ::sendmmsg(fd_, &msgs[next], (unsigned)(n - next), 0);
+        if (r > 0) {
+            sent += r;
+            next += r;
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (errors) errors[index ? index[next] : next] = r < 0 ? errno : EIO;
+        ++next;
+    }
+    return sent;
+}
+
+int UdpSender::sendToAll(const uint8_t* data, int length, int* errors) {
+    const int n = (int)msgs_.size();
+    if (errors) std::memset(errors, 0, (size_t)n * sizeof(int));
+    if (fd_ < 0 || n == 0) return 0;
+
+    for (iovec& v : iov_) {
+        v.iov_base = const_cast<uint8_t*>(data);
+        v.iov_len = (size_t)length;
+    }
+    return sendBatch(msgs_.data(), nullptr, n, errors);
+}
+
+int UdpSender::sendTiered(const uint8_t* const* data, const int* lengths, int* errors) {
+    const int n = (int)msgs_.size();
+    if (errors) std::memset(errors, 0, (size_t)n * sizeof(int));
+    if (fd_ < 0 || n == 0) return 0;
+
+    for (int t = 0; t < kMaxTiers; ++t) {
+        iov_[t].iov_base = const_cast<uint8_t*>(data[t]);
+        iov_[t].iov_len = lengths[t] > 0 ? (size_t)lengths[t] : 0;
+    }
+
+    bool all = true;
+    for (int i = 0; i < n && all; ++i) all = lengths[tiers_[i]] > 0;
+    if (all) return sendBatch(msgs_.data(), nullptr, n, errors);
+
+    // Some tiers have nothing this time: compact the rest into one batch
+    batch_.clear();
+    batchIndex_.clear();
+    for (int i = 0; i < n; ++i) {
+        if (lengths[tiers_[i]] <= 0) continue;
+        batch_.push_back(msgs_[i]);
+        batchIndex_.push_back(i);
+    }
+    return sendBatch(batch_.data(), batchIndex_.data(), (int)batch_.size(), errors);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <cstdint>
+#include <vector>
+
+// Host-side UDP fan-out: one datagram to every guest with a single sendmmsg().
+// With simulcast every target is on a tier and gets that tier's datagram, still in
+// one sendmmsg() per frame.
+//
+// Owns a dual-stack (v4-mapped) UDP socket and the current guest address array.
+// Targets are replaced as a whole with setTargets(); both calls are made from the
+// send thread only, so no locking is needed here. A NackResponder may answer on
+// the same fd from its own thread (datagram sends are atomic in the kernel).
+class UdpSender {
+public:
+    static constexpr int kMaxTiers = 4;
+
+    UdpSender();
+    ~UdpSender();
+
+    UdpSender(const UdpSender&) = delete;
+    UdpSender& operator=(const UdpSender&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+
+    // Binds the socket to `port` on all interfaces so guests can reach it (NACKs).
+    bool bindPort(int port);
+
+    // `ips` holds `count` raw addresses (4 or 16 bytes each, see ipLens).
+    // Returns false if an address is malformed (targets are then left empty).
+    // Every target starts on tier 0.
+    bool setTargets(const uint8_t* const* ips, const int* ipLens, const int* ports, int count);
+
+    int targetCount() const { return (int)addrs_.size(); }
+    const sockaddr_in6& target(int i) const { return addrs_[i]; }
+
+    void setTargetTier(int i, int tier);
+    int targetTier(int i) const { return tiers_[i]; }
+
+    // Enables group delivery (IPv4 multicast / subnet broadcast targets): multicast
+    // leaves through the interface owning `ipv4` (4 bytes), TTL 1, broadcast allowed.
+    bool setGroupInterface(const uint8_t* ipv4);
+
+    // Sends `data` to every target. A failing target does not stop the batch;
+    // errors[i] (if given, targetCount() entries) is 0 or the errno for target i.
+    // Returns the number of targets the datagram was handed to.
+    int sendToAll(const uint8_t* data, int length, int* errors);
+
+    // Sends data[t] (lengths[t] bytes) to every target on tier t; targets on a tier
+    // with length 0 are skipped. Same error reporting and return value as sendToAll.
+    int sendTiered(const uint8_t* const* data, const int* lengths, int* errors);
+
+private:
+    int sendBatch(mmsghdr* msgs, const int* index, int n, int* errors);
+
+    int fd_ = -1;
+    std::vector<sockaddr_in6> addrs_;
+    std::vector<int> tiers_;
+    std::vector<mmsghdr> msgs_;
+    iovec iov_[kMaxTiers] = {};
+
+    // sendTiered scratch when some targets are skipped
+    std::vector<mmsghdr> batch_;
+    std::vector<int> batchIndex_;
+};
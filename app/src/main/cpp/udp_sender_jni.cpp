@@ -0,0 +1,218 @@
+#include <jni.h>
+#include <android/log.h>
+#include <new>
+#include <vector>
+
+#include "host_sender.h"
+#include "simulcast_encoder.h"
+
+#define LOG_TAG "OpusJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+static constexpr int kMaxDatagramBytes = HostSender::kMaxDatagramBytes;
+
+struct UdpSenderHandle {
+    HostSender sender;
+    uint8_t packet[kMaxDatagramBytes];
+};
+
+#define GET_SENDER_HANDLE(ptr) reinterpret_cast<UdpSenderHandle*>(ptr)
+
+static void copyErrors(JNIEnv* env, const HostSender& sender, jintArray errors) {
+    const jsize n = (jsize)sender.errors().size();
+    if (errors && n > 0 && env->GetArrayLength(errors) >= n) {
+        env->SetIntArrayRegion(errors, 0, n, reinterpret_cast<const jint*>(sender.errors().data()));
+    }
+}
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_createSender(
+        JNIEnv* /*env*/, jobject /*thiz*/) {
+    auto* h = new (std::nothrow) UdpSenderHandle();
+    if (!h) return 0;
+    if (!h->sender.ok()) {
+        LOGE("createSender: socket() failed");
+        delete h;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(h);
+}
+
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_destroySender(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer) {
+    delete GET_SENDER_HANDLE(pointer);
+}
+
+// ips[i] is InetAddress.getAddress() (4 or 16 bytes). Returns false on a malformed entry.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_setTargets(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jobjectArray ips, jintArray ports) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h || !ips || !ports) return JNI_FALSE;
+
+    const jsize count = env->GetArrayLength(ips);
+    if (env->GetArrayLength(ports) < count) return JNI_FALSE;
+
+    std::vector<uint8_t> raw((size_t)count * 16);
+    std::vector<const uint8_t*> ipPtrs(count);
+    std::vector<int> ipLens(count);
+    std::vector<int> portVals(count);
+    env->GetIntArrayRegion(ports, 0, count, reinterpret_cast<jint*>(portVals.data()));
+
+    for (jsize i = 0; i < count; ++i) {
+        auto ip = static_cast<jbyteArray>(env->GetObjectArrayElement(ips, i));
+        const jsize len = ip ? env->GetArrayLength(ip) : 0;
+        if (len == 4 || len == 16) {
+            env->GetByteArrayRegion(ip, 0, len, reinterpret_cast<jbyte*>(&raw[(size_t)i * 16]));
+        }
+        if (ip) env->DeleteLocalRef(ip);
+        ipPtrs[i] = &raw[(size_t)i * 16];
+        ipLens[i] = len;
+    }
+
+    const bool ok = h->sender.setTargets(ipPtrs.data(), ipLens.data(), portVals.data(), count);
+    if (!ok) LOGE("setTargets: malformed address in %d targets", (int)count);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_setGroupInterface(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jbyteArray ipv4) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h || !ipv4 || env->GetArrayLength(ipv4) != 4) return JNI_FALSE;
+    uint8_t ip[4];
+    env->GetByteArrayRegion(ipv4, 0, 4, reinterpret_cast<jbyte*>(ip));
+    const bool ok = h->sender.setGroupInterface(ip);
+    if (!ok) LOGE("setGroupInterface: setsockopt failed");
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Sends data[0, length) to every target with sendmmsg. errors (optional, >= target
+// count) receives 0 or errno per target. Returns targets sent to, or a negative code.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_sendToAll(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jbyteArray data, jint length,
+        jintArray errors) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h) return -1;
+    if (!data || length <= 0 || length > kMaxDatagramBytes || length > env->GetArrayLength(data)) {
+        return -2;
+    }
+
+    env->GetByteArrayRegion(data, 0, length, reinterpret_cast<jbyte*>(h->packet));
+    const int sent = h->sender.sendToAll(h->packet, length);
+    copyErrors(env, h->sender, errors);
+    return sent;
+}
+
+// Simulcast send: the datagrams of the last SimulcastEncoder::encode(), each to the
+// targets on its tier, with one sendmmsg. Same errors / return value as sendToAll.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_sendSimulcast(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlong encoderPointer, jintArray errors) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    auto* enc = reinterpret_cast<SimulcastEncoder*>(encoderPointer);
+    if (!h || !enc) return -1;
+
+    const int sent = h->sender.sendSimulcast(*enc);
+    copyErrors(env, h->sender, errors);
+    return sent;
+}
+
+// Send thread, before encoding: places every target on its guest's simulcast tier
+// (from the rate controller, below maxTiers) and returns the mask of tiers in use.
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_tierMask(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint maxTiers) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    return h ? (jint)h->sender.tierMask(maxTiers) : 0;
+}
+
+// scheme < 0 disables FEC on `tier`; otherwise wsfec::Scheme with k media / m parity
+// per group. Send thread only. Returns false (FEC off) for an invalid combination.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_setFec(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint tier, jint scheme, jint k, jint m) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h) return JNI_FALSE;
+    const bool ok = h->sender.setFec(tier, scheme, k, m);
+    if (!ok) LOGE("setFec: invalid tier=%d scheme=%d k=%d m=%d", (int)tier, (int)scheme, (int)k, (int)m);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Binds the sender to port and keeps the last `capacity` datagrams for resending.
+// Call once, before the send and NACK threads start.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_enableRetransmit(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint capacity, jint port) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h || capacity <= 0 || h->sender.retransmitEnabled()) return JNI_FALSE;
+    if (!h->sender.enableRetransmit(capacity, port)) {
+        LOGE("enableRetransmit: bind(%d) failed", (int)port);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+// NACK thread: waits up to timeoutMs and answers queued NACKs.
+// Returns packets resent, or a negative code (-1 not enabled, -errno socket error).
+JNIEXPORT jint JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_serveNacks(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint timeoutMs) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    return h ? h->sender.serveNacks(timeoutMs) : -1;
+}
+
+// out[0..5] = nacks, requested, resent, evicted, rateLimited, reports
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_retransmitStats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    const NackResponder::Stats* st = h ? h->sender.retransmitStats() : nullptr;
+    if (!st || !out || env->GetArrayLength(out) < 6) return;
+    const NackResponder::Stats& s = *st;
+    const jlong v[6] = {s.nacks, s.requested, s.resent, s.evicted, s.rateLimited, s.reports};
+    env->SetLongArrayRegion(out, 0, 6, v);
+}
+
+// Lets guest receiver reports drive the tier-0 bitrate (minBitrate..maxBitrate),
+// expected loss and FEC, and place guests on `tiers` simulcast tiers. Needs
+// enableRetransmit (reports share its socket); call once, before the NACK thread starts.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_enableRateControl(
+        JNIEnv* /*env*/, jobject /*thiz*/, jlong pointer, jint minBitrate, jint maxBitrate,
+        jint tiers) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    return h && h->sender.enableRateControl(minBitrate, maxBitrate, tiers) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Send thread: out[0..4] = bitrate, lossPercent, fecScheme, k, m.
+// Returns true only when the decision changed since the previous call.
+JNIEXPORT jboolean JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_pollRateControl(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jintArray out) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    if (!h || !out || env->GetArrayLength(out) < 5) return JNI_FALSE;
+    RateController::Decision d{};
+    if (!h->sender.pollRateControl(&d)) return JNI_FALSE;
+    const jint v[5] = {d.bitrate, d.lossPercent, d.fecScheme, d.fecK, d.fecM};
+    env->SetIntArrayRegion(out, 0, 5, v);
+    return JNI_TRUE;
+}
+
+// NACK thread: out[0..4] = reports, backoffs, probes, FEC changes, tier moves
+JNIEXPORT void JNICALL
+Java_com_kunano_wavesynch_data_stream_OpusNative_00024UdpSender_rateControlStats(
+        JNIEnv* env, jobject /*thiz*/, jlong pointer, jlongArray out) {
+    UdpSenderHandle* h = GET_SENDER_HANDLE(pointer);
+    const RateController::Stats* st = h ? h->sender.rateStats() : nullptr;
+    if (!st || !out || env->GetArrayLength(out) < 5) return;
+    const RateController::Stats& s = *st;
+    const jlong v[5] = {s.reports, s.backoffs, s.probes, s.fecChanges, s.tierMoves};
+    env->SetLongArrayRegion(out, 0, 5, v);
+}
+
+} // extern "C"
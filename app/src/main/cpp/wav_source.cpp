@@ -0,0 +1,86 @@
+#include "wav_source.h"
+
+#include <cstring>
+#include <ctime>
+
+#include "futex.h"
+
+// WAVE fields are little-endian, like every target this builds for
+static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+WavSource::~WavSource() {
+    if (file_) fclose(file_);
+}
+
+bool WavSource::open(const char* path) {
+    if (file_) fclose(file_);
+    file_ = fopen(path, "rb");
+    if (!file_) return false;
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, file_) != 12 || memcmp(riff, "RIFF", 4) != 0 ||
+        memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool haveFormat = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file_) == 8) {
+        const uint32_t size = le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, file_) != 16) return false;
+            const uint16_t format = le16(fmt);
+            channels_ = le16(fmt + 2);
+            sampleRate_ = (int)le32(fmt + 4);
+            const uint16_t bits = le16(fmt + 14);
+            // 1 = PCM, 0xFFFE = WAVE_FORMAT_EXTENSIBLE (assumed PCM)
+            if ((format != 1 && format != 0xFFFE) || bits != 16 || channels_ <= 0) return false;
+            haveFormat = true;
+            if (fseek(file_, (long)(size - 16 + (size & 1)), SEEK_CUR) != 0) return false;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) return false;
+            dataStart_ = ftell(file_);
+            dataBytes_ = size & ~1u;
+            position_ = 0;
+            return dataBytes_ > 0;
+        } else if (fseek(file_, (long)(size + (size & 1)), SEEK_CUR) != 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+int WavSource::read(int16_t* dst, int maxShorts, bool loop) {
+    if (!file_ || maxShorts <= 0) return 0;
+    int done = 0;
+    while (done < maxShorts) {
+        if (position_ >= dataBytes_) {
+            if (!loop) break;
+            if (fseek(file_, dataStart_, SEEK_SET) != 0) break;
+            position_ = 0;
+        }
+        const int64_t left = (dataBytes_ - position_) / 2;
+        const int want = (int)(left < maxShorts - done ? left : maxShorts - done);
+        const size_t got = fread(dst + done, 2, (size_t)want, file_);
+        if (got == 0) break;
+        done += (int)got;
+        position_ += (int64_t)got * 2;
+    }
+    return done;
+}
+
+void WavSource::pace(int64_t shorts) {
+    const int64_t now = futex::monotonicNs();
+    if (paceStartNs_ < 0) paceStartNs_ = now;
+    const int64_t dueNs = paceStartNs_ + shorts * 1000000000LL / ((int64_t)sampleRate_ * channels_);
+    if (dueNs <= now) return;
+    const timespec ts{(time_t)((dueNs - now) / 1000000000LL), (long)((dueNs - now) % 1000000000LL)};
+    nanosleep(&ts, nullptr);
+}
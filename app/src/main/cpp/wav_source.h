@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Off-device PCM source for HostPipeline: reads 16-bit PCM from a RIFF/WAVE file in
+// capture-sized chunks, optionally paced to real time, so the native host path can be
+// driven and measured on a Linux machine without AudioRecord. Not used on Android.
+class WavSource {
+public:
+    WavSource() = default;
+    ~WavSource();
+
+    WavSource(const WavSource&) = delete;
+    WavSource& operator=(const WavSource&) = delete;
+
+    // Parses the header; false unless the file is PCM, 16-bit.
+    bool open(const char* path);
+
+    int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
+    int64_t totalShorts() const { return dataBytes_ / 2; }
+
+    // Reads up to maxShorts interleaved samples. With loop set, wraps to the start of
+    // the data at the end; otherwise returns 0 there.
+    int read(int16_t* dst, int maxShorts, bool loop);
+
+    // Sleeps until `shorts` samples since the first paced call are due in real time.
+    void pace(int64_t shorts);
+
+private:
+    FILE* file_ = nullptr;
+    int sampleRate_ = 0;
+    int channels_ = 0;
+    long dataStart_ = 0;
+    int64_t dataBytes_ = 0;
+    int64_t position_ = 0;   // bytes into the data chunk
+    int64_t paceStartNs_ = -1;
+};
@@ -5,6 +5,7 @@ import android.content.Context
 import android.content.Intent
 import androidx.annotation.RequiresPermission
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
+import com.kunano.wavesynch.data.stream.StreamProfile
 import com.kunano.wavesynch.data.stream.host.HostAudioCapturer
 import com.kunano.wavesynch.data.stream.host.HostStreamer
 import com.kunano.wavesynch.data.wifi.WifiController
@@ -69,8 +70,15 @@ class HostRepositoryImpl @Inject constructor(
     @RequiresPermission(Manifest.permission.RECORD_AUDIO)
     override fun addGuestToHostStreamer(guestId: String) {
         val guestSocket = serverManager.socketList[guestId]
-        val inetSocketAddress: InetSocketAddress =
+        val mode = serverManager.deliveryModeFor(guestId)
+        val groupAddress = serverManager.groupAddress(mode)
+        val inetSocketAddress: InetSocketAddress = if (groupAddress != null) {
+            // Group guests share one destination, so the host sends once for all of them
+            hostStreamer.setGroupInterface(serverManager.hostAddress)
+            InetSocketAddress(groupAddress, AudioStreamConstants.UDP_PORT)
+        } else {
             InetSocketAddress(guestSocket?.inetAddress, AudioStreamConstants.UDP_PORT)
+        }
         hostStreamer.addGuest(guestId, inetSocketAddress)
     }
 
@@ -81,18 +89,21 @@ class HostRepositoryImpl @Inject constructor(
 
     @RequiresPermission(Manifest.permission.RECORD_AUDIO)
     override fun startStreamingAsHost(hostAudioCapturer: HostAudioCapturer) {
-        hostStreamer.startStreaming(hostAudioCapturer)
+        hostStreamer.startStreaming(hostAudioCapturer, serverManager.streamProfile)
     }
 
     override fun playGuest(guestId: String) {
 
         serverManager.setGuestPlayingState(guestId, true)
         hostStreamer.resumeGuest(guestId)
+        serverManager.sendAnswerToGuest(guestId = guestId, answer = HandShakeResult.ResumedByHost())
     }
 
     override fun pauseGuest(guestId: String) {
         hostStreamer.pauseGuest(guestId)
         serverManager.setGuestPlayingState(guestId, false)
+        // Dropping it from the target set is not enough when it shares a group address
+        serverManager.sendAnswerToGuest(guestId = guestId, answer = HandShakeResult.PausedByHost())
     }
 
     fun stopStreamingService() {
@@ -120,4 +131,12 @@ class HostRepositoryImpl @Inject constructor(
     override fun openPortOverLocalWifi(hostIp: String) {
         serverManager.startServerSocket(hostIp)
     }
+
+    override fun setDeliveryMode(mode: Int) {
+        serverManager.preferredDeliveryMode = mode
+    }
+
+    override fun setStreamProfile(profile: StreamProfile) {
+        serverManager.streamProfile = profile
+    }
 }
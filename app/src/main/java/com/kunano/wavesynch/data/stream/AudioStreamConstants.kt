@@ -15,19 +15,57 @@ object AudioStreamConstants {
 
     const val MONO_BITRATE = 64_000
     const val STEREO_BITRATE = 128_000
+    // Floor for receiver-report rate control on a congested hotspot
+    const val MIN_STEREO_BITRATE = 32_000
+    // Starting Opus complexity; the encoder governor moves it within MIN..MAX_ENCODE_COMPLEXITY
     const val HOST_SPOT_COMPLEXITY = 5
+    const val MIN_ENCODE_COMPLEXITY = 2
+    const val MAX_ENCODE_COMPLEXITY = 10
+    // p95 opus_encode time (slowest tier) to hold, as a share of the frame; 0 = fixed complexity
+    const val ENCODE_TARGET_SHARE = 0.25
 
-    // Opus frame duration
-    const val PACKET_MS = 20
+    // Frame duration and everything sized from it live in StreamProfile (negotiated per session)
 
-    // PCM sizing (INTERLEAVED)
-    const val SAMPLES_PER_CHANNEL = (SAMPLE_RATE * PACKET_MS / 1000) // 960
-    const val SAMPLES_PER_PACKET = SAMPLES_PER_CHANNEL * CHANNELS     // 1920 shorts
-    const val PCM_FRAME_BYTES = SAMPLES_PER_PACKET * BYTES_PER_SAMPLE // 3840 bytes
+    // Host keeps this much sent audio to answer guest NACKs on UDP_PORT
+    const val RETRANSMIT_MS = 1_280.0
 
-    const val FRAME_NS = PACKET_MS.toLong() * 1_000_000L
+    // Transport FEC schemes (fec.h): parity datagrams over groups of k media packets
+    const val FEC_OFF = -1
+    const val FEC_XOR = 0            // m = 1, any single loss per group
+    const val FEC_REED_SOLOMON = 1   // m <= 4, any m losses per group
+
+    // Simulcast tiers, highest first: guests on weak links are moved down by their reports.
+    // Tier 0 FEC follows rate control; the lower tiers carry fixed, stronger parity.
+    val SIMULCAST_BITRATES = intArrayOf(STEREO_BITRATE, MONO_BITRATE, MIN_STEREO_BITRATE)
+    val SIMULCAST_FEC = arrayOf(
+        intArrayOf(FEC_OFF, 0, 0),
+        intArrayOf(FEC_REED_SOLOMON, 8, 2),
+        intArrayOf(FEC_REED_SOLOMON, 8, 4),
+    )
+
+    // Per-frame encode budget for all tiers, as a share of the frame; over it, a tier is shed
+    const val SIMULCAST_BUDGET_SHARE = 0.4
+
+    // Packet aggregation: frames per datagram once this many guests play (or always in
+    // low-overhead mode). Each datagram costs a fixed slice of Wi-Fi airtime whatever its
+    // size, so on a shared hotspot fewer, larger packets leave room for more guests.
+    const val AGGREGATE_FRAMES = 3
+    const val AGGREGATE_MIN_GUESTS = 4
+
+    // Deep REDundancy each packet carries, when the DNN weights are present (DnnWeights).
+    // A gap can only be rebuilt from a packet that arrives before its playout deadline,
+    // so more than the usual playout delay buys nothing.
+    const val DRED_MS = 200
 
 
     const val UDP_PORT = 8989
     const val TCP_PORT = 8988
+
+    // Delivery modes; a guest advertises support as a bitmask of (1 shl mode)
+    const val DELIVERY_UNICAST = 0
+    const val DELIVERY_MULTICAST = 1
+    const val DELIVERY_BROADCAST = 2
+
+    // Administratively scoped (239/8) group, sent with TTL 1 so it never leaves the link
+    const val MULTICAST_GROUP = "239.255.42.99"
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+package com.kunano.wavesynch.data.stream
+
+import android.content.Context
+import android.util.Log
+import java.io.File
+import java.io.IOException
+
+/**
+ * The process-wide Opus DNN weights for DRED and deep PLC, or null when there are none.
+ *
+ * The blob lives at files/[BLOB_PATH]; an APK that bundles it as an asset of the same
+ * name has it copied there on first use. [BLOB_VERSION] is bumped with the Opus model
+ * the native library is built against, so a blob left behind by an older install is
+ * never handed to the new codecs and is deleted instead.
+ *
+ * It is mapped once per process and never unmapped: every encoder and decoder shares
+ * the same read-only pages, which are paged in from the file as the models run.
+ *
+ * The first [blob] call may copy the asset and maps the file, so it is disk I/O:
+ * streamers [preload] it when they are created and fetch it before taking their own
+ * locks or starting audio threads.
+ */
+object DnnWeights {
+    const val BLOB_VERSION = 1
+    const val BLOB_PATH = "opus/weights_blob-v$BLOB_VERSION.bin"
+
+    private var blob: OpusNative.DnnBlob? = null
+    @Volatile private var tried = false
+
+    /** Starts loading on a background thread, so a later [blob] call finds it ready. */
+    fun preload(context: Context) {
+        if (tried) return
+        val app = context.applicationContext
+        Thread({ blob(app) }, "DnnWeights").apply { isDaemon = true; start() }
+    }
+
+    @Synchronized
+    fun blob(context: Context): OpusNative.DnnBlob? {
+        if (tried) return blob
+        tried = true
+        val file = File(context.filesDir, BLOB_PATH)
+        deleteStale(file)
+        if (!file.exists() && !copyAsset(context, file)) {
+            Log.i("OpusJNI", "No DNN weights ($BLOB_PATH): DRED off")
+            return null
+        }
+        blob = runCatching { OpusNative.DnnBlob(file.path) }
+            .onFailure { Log.e("OpusJNI", "DNN weights unusable: ${it.message}") }
+            .getOrNull()
+        return blob
+    }
+
+    private fun deleteStale(current: File) {
+        current.parentFile?.listFiles { f -> f.name.startsWith("weights_blob") && f != current }
+            ?.forEach { it.delete() }
+    }
+
+    private fun copyAsset(context: Context, file: File): Boolean = try {
+        file.parentFile?.mkdirs()
+        val tmp = File(file.path + ".tmp")
+        context.assets.open(BLOB_PATH).use { input -> tmp.outputStream().use { input.copyTo(it) } }
+        tmp.renameTo(file)
+    } catch (_: IOException) {
+        false
+    }
+}
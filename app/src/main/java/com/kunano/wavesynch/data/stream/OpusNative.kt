@@ -1,6 +1,12 @@
 package com.kunano.wavesynch.data.stream
 
+import android.os.ParcelFileDescriptor
 import android.util.Log
+import java.net.DatagramSocket
+import java.net.Inet4Address
+import java.net.InetAddress
+import java.net.InetSocketAddress
+import java.nio.ByteBuffer
 
 object OpusNative {
     init {
@@ -8,6 +14,36 @@ object OpusNative {
         Log.e("OpusJNI", "✅ wavesynch loaded")
     }
 
+    // Opus application (opus_defines.h)
+    const val APPLICATION_AUDIO = 2049
+    const val APPLICATION_RESTRICTED_LOWDELAY = 2051
+
+    // =========================
+    // DNN weights
+    // =========================
+    // Opus' weights_blob.bin (DRED encoder / decoder, deep PLC), mapped read-only and
+    // validated once, then handed to codecs by pointer so they all share its pages.
+    // Codecs keep pointers into it: destroy only after every HostPipeline / Decoder it
+    // was given to.
+    class DnnBlob(path: String) {
+        internal var pointer: Long = loadBlob(path).also {
+            require(it != 0L) { "Failed to load DNN weights from $path" }
+        }
+
+        fun size(): Int = size(pointer)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyBlob(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun loadBlob(path: String): Long
+        private external fun destroyBlob(pointer: Long)
+        private external fun size(pointer: Long): Int
+    }
+
     // =========================
     // Encoder
     // =========================
@@ -22,6 +58,52 @@ object OpusNative {
         fun encodeInto(pcm: ShortArray, frameSize: Int, outBuf: ByteArray): Int =
             encodePcm16Into(pointer, pcm, frameSize, channels, outBuf)
 
+        // -------- Direct ByteBuffer API (zero-copy) --------
+        // `pcm` holds native-order interleaved int16 (`channels` per frame) starting at an
+        // even pcm.position().
+        // The packet is written at out.position(), at most out.remaining() bytes.
+        // Buffer positions are not modified. Returns packet length.
+
+        fun encodeDirect(pcm: ByteBuffer, frameSize: Int, out: ByteBuffer): Int {
+            require(pcm.isDirect && out.isDirect) { "encodeDirect needs direct ByteBuffers" }
+            val n = encodePcm16Direct(
+                pointer, pcm, pcm.position(), frameSize, channels,
+                out, out.position(), out.remaining()
+            )
+            if (n < 0) error("Opus encodeDirect failed (rc=$n)")
+            return n
+        }
+
+        // -------- Fused encode + PacketCodec framing --------
+        // Writes the 12-byte WS header (PacketCodec v1) and the Opus payload into
+        // outPkt in a single JNI crossing. Returns total datagram length.
+
+        fun encodeFramedInto(
+            pcm: ShortArray,
+            frameSize: Int,
+            seq: Int,
+            pts: Int,
+            flags: Int,
+            outPkt: ByteArray
+        ): Int = encodeFramedInto(pointer, pcm, frameSize, channels, seq, pts, flags, outPkt)
+
+        fun encodeFramedDirect(
+            pcm: ByteBuffer,
+            frameSize: Int,
+            seq: Int,
+            pts: Int,
+            flags: Int,
+            out: ByteBuffer
+        ): Int {
+            require(pcm.isDirect && out.isDirect) { "encodeFramedDirect needs direct ByteBuffers" }
+            val n = encodeFramedDirect(
+                pointer, pcm, pcm.position(), frameSize, channels,
+                seq, pts, flags, out, out.position(), out.remaining()
+            )
+            if (n < 0) error("Opus encodeFramedDirect failed (rc=$n)")
+            return n
+        }
+
 
         fun setInbandFecEnabled(enabled: Boolean) {
             setInbandFecEnabled(pointer, enabled)
@@ -64,6 +146,39 @@ object OpusNative {
             channels: Int,
             outBuf: ByteArray
         ): Int
+        private external fun encodePcm16Direct(
+            pointer: Long,
+            pcm: ByteBuffer,
+            pcmOffset: Int,
+            frameSize: Int,
+            channels: Int,
+            out: ByteBuffer,
+            outOffset: Int,
+            outCap: Int
+        ): Int
+        private external fun encodeFramedInto(
+            pointer: Long,
+            pcm: ShortArray,
+            frameSize: Int,
+            channels: Int,
+            seq: Int,
+            pts: Int,
+            flags: Int,
+            outPkt: ByteArray
+        ): Int
+        private external fun encodeFramedDirect(
+            pointer: Long,
+            pcm: ByteBuffer,
+            pcmOffset: Int,
+            frameSize: Int,
+            channels: Int,
+            seq: Int,
+            pts: Int,
+            flags: Int,
+            out: ByteBuffer,
+            outOffset: Int,
+            outCap: Int
+        ): Int
 
         private external fun destroyEncoder(pointer: Long)
 
@@ -128,6 +243,68 @@ object OpusNative {
             return n
         }
 
+        // -------- Direct ByteBuffer API (zero-copy) --------
+        // Packet bytes are read from packet.position() .. packet.limit().
+        // PCM (native-order interleaved int16) is written at out.position(), which must be even.
+        // Buffer positions are not modified. Returns number of shorts written.
+
+        fun decodeDirect(packet: ByteBuffer, frameSize: Int, out: ByteBuffer): Int {
+            checkDirect(packet, out, frameSize)
+            val n = decodePcm16Direct(pointer, packet, packet.position(), packet.remaining(), frameSize, out, out.position())
+            if (n < 0) error("Opus decodeDirect failed (rc=$n)")
+            return n
+        }
+
+        fun decodeFecDirect(nextPacket: ByteBuffer, frameSize: Int, out: ByteBuffer): Int {
+            checkDirect(nextPacket, out, frameSize)
+            val n = decodeFecFromNextPcm16Direct(pointer, nextPacket, nextPacket.position(), nextPacket.remaining(), frameSize, out, out.position())
+            if (n < 0) error("Opus decodeFecDirect failed (rc=$n)")
+            return n
+        }
+
+        fun decodePlcDirect(frameSize: Int, out: ByteBuffer): Int {
+            checkDirect(out, out, frameSize)
+            val n = decodePlcPcm16Direct(pointer, frameSize, out, out.position())
+            if (n < 0) error("Opus decodePlcDirect failed (rc=$n)")
+            return n
+        }
+
+        private fun checkDirect(packet: ByteBuffer, out: ByteBuffer, frameSize: Int) {
+            require(packet.isDirect && out.isDirect) { "direct ByteBuffers required" }
+            check(out.remaining() >= frameSize * channels * 2) {
+                "out too small: need >= ${frameSize * channels * 2} bytes, got ${out.remaining()}"
+            }
+        }
+
+        // -------- Decode by seq from the native JitterBuffer --------
+        // Returns shorts written, or DECODE_MISSING if seq is not buffered.
+        // A normal decode consumes the slot; FEC (nextSeq = missing + 1) leaves it.
+
+        fun decodeFromBufferInto(buffer: JitterBuffer, seq: Int, frameSize: Int, out: ShortArray): Int =
+            decodeFromBufferInto(pointer, buffer.pointer, seq, frameSize, out, false)
+
+        fun decodeFecFromBufferInto(buffer: JitterBuffer, nextSeq: Int, frameSize: Int, out: ShortArray): Int =
+            decodeFromBufferInto(pointer, buffer.pointer, nextSeq, frameSize, out, true)
+
+        // -------- Deep REDundancy (DRED) --------
+
+        /**
+         * Loads [blob] into the decoder and a DRED decoder and turns on deep PLC. Returns 0,
+         * or the Opus error that left DRED off (-5 OPUS_UNIMPLEMENTED: no DRED in libopus).
+         * [blob] must outlive this decoder.
+         */
+        fun enableDred(blob: DnnBlob): Int = enableDred(pointer, blob.pointer)
+
+        /**
+         * Synthesizes lost frame [seq] from the redundancy of the first packet buffered after
+         * it (left in place). Returns shorts written, or DECODE_MISSING if nothing covers it.
+         */
+        fun decodeDredFromBufferInto(buffer: JitterBuffer, seq: Int, frameSize: Int, out: ShortArray): Int =
+            decodeDredFromBufferInto(pointer, buffer.pointer, seq, frameSize, out)
+
+        /** out[0..3] = lost frames asked for, recovered, packets parsed, not covered. */
+        fun dredStats(out: LongArray) = dredStats(pointer, out)
+
         // Optional: very useful after resync jumps
         fun reset() {
             val rc = resetDecoderState(pointer)
@@ -156,7 +333,833 @@ object OpusNative {
         private external fun decodePlcPcm16Into(pointer: Long, frameSize: Int, out: ShortArray): Int
         private external fun decodeFecFromNextPcm16Into(pointer: Long, nextPacket: ByteArray, frameSize: Int, out: ShortArray): Int
 
+        // Direct ByteBuffer natives (zero-copy)
+        private external fun decodePcm16Direct(pointer: Long, packet: ByteBuffer, packetOffset: Int, packetLen: Int, frameSize: Int, out: ByteBuffer, outOffset: Int): Int
+        private external fun decodePlcPcm16Direct(pointer: Long, frameSize: Int, out: ByteBuffer, outOffset: Int): Int
+        private external fun decodeFecFromNextPcm16Direct(pointer: Long, nextPacket: ByteBuffer, packetOffset: Int, packetLen: Int, frameSize: Int, out: ByteBuffer, outOffset: Int): Int
+
+        private external fun decodeFromBufferInto(pointer: Long, bufferPointer: Long, seq: Int, frameSize: Int, out: ShortArray, fec: Boolean): Int
+
+        private external fun enableDred(pointer: Long, blobPointer: Long): Int
+        private external fun decodeDredFromBufferInto(pointer: Long, bufferPointer: Long, seq: Int, frameSize: Int, out: ShortArray): Int
+        private external fun dredStats(pointer: Long, out: LongArray)
+
         // Reset decoder state (recommended)
         private external fun resetDecoderState(pointer: Long): Int
+
+        companion object {
+            const val DECODE_MISSING = -8
+        }
+    }
+
+    // =========================
+    // Jitter buffer (guest)
+    // =========================
+    // Payloads are stored in fixed native slots keyed by seq; the rx thread hands in
+    // raw datagrams and the decoder pulls payloads by seq, so nothing is allocated per packet.
+    // Lock-free SPSC: putDatagram / UdpReceiver.receiveInto run only on the rx thread, everything else
+    // only from the playout thread (clear() also once both have stopped).
+    class JitterBuffer(capacity: Int, slotBytes: Int) {
+        internal var pointer: Long = createJitterBuffer(capacity, slotBytes).also {
+            require(it != 0L) { "Failed to create jitter buffer" }
+        }
+            private set
+
+        /**
+         * Validates the PacketCodec header and stores the payload. False if invalid.
+         * When [delay] is given, the arrival is reported to it in the same JNI call.
+         */
+        fun putDatagram(
+            data: ByteArray,
+            length: Int,
+            arrivalNs: Long = System.nanoTime(),
+            delay: PlayoutDelayController? = null
+        ): Boolean = putDatagram(pointer, data, length, arrivalNs, delay?.pointer ?: 0L)
+
+        fun contains(seq: Int): Boolean = contains(pointer, seq)
+
+        fun firstSeq(): Int? {
+            val s = firstSeq(pointer)
+            return if (s == NO_SEQ) null else s.toInt()
+        }
+
+        /** Non-boxing variant for the playout loop: lowest seq, or [NO_SEQ] when empty. */
+        fun firstSeqOrNone(): Long = firstSeq(pointer)
+
+        fun size(): Int = size(pointer)
+
+        /** Datagrams dropped for arriving more than a full ring behind the newest. */
+        fun staleDropped(): Long = staleDropped(pointer)
+
+        fun clear() = clear(pointer)
+
+        fun dropOlderThan(seqInclusive: Int) = dropOlderThan(pointer, seqInclusive)
+
+        fun waitForSeq(seq: Int, waitMs: Long) {
+            waitForSeq(pointer, seq, waitMs.toInt())
+        }
+
+        fun waitForData(waitMs: Long) {
+            waitForData(pointer, waitMs.toInt())
+        }
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyJitterBuffer(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createJitterBuffer(capacity: Int, slotBytes: Int): Long
+        private external fun destroyJitterBuffer(pointer: Long)
+        private external fun putDatagram(pointer: Long, data: ByteArray, length: Int, arrivalNs: Long, delayPointer: Long): Boolean
+        private external fun contains(pointer: Long, seq: Int): Boolean
+        private external fun firstSeq(pointer: Long): Long
+        private external fun size(pointer: Long): Int
+        private external fun staleDropped(pointer: Long): Long
+        private external fun clear(pointer: Long)
+        private external fun dropOlderThan(pointer: Long, seq: Int)
+        private external fun waitForSeq(pointer: Long, seq: Int, waitMs: Int): Boolean
+        private external fun waitForData(pointer: Long, waitMs: Int): Boolean
+
+        companion object {
+            const val NO_SEQ = Long.MIN_VALUE
+        }
+    }
+
+    // =========================
+    // Playout delay controller (guest)
+    // =========================
+    // Keeps RFC 3550 jitter and a decaying histogram of arrival lateness (fed by
+    // UdpReceiver / JitterBuffer.putDatagram on the rx thread) and turns a quantile of it into a
+    // target buffer depth, adapting the quantile to hold [targetPlcRate].
+    class PlayoutDelayController(
+        frameMs: Double,
+        minFrames: Int,
+        maxFrames: Int,
+        initialFrames: Int,
+        targetPlcRate: Double = 0.005,
+    ) {
+        internal var pointer: Long =
+            createController(frameMs, minFrames, maxFrames, initialFrames, targetPlcRate).also {
+                require(it != 0L) { "Failed to create playout delay controller" }
+            }
+            private set
+
+        /** Reports how the frame just played was produced; returns the target depth in frames. */
+        fun onFrame(outcome: Int): Int = onFrame(pointer, outcome)
+
+        fun targetFrames(): Int = targetFrames(pointer)
+        fun jitterMs(): Double = jitterMs(pointer)
+        fun quantileDelayMs(): Double = quantileDelayMs(pointer)
+        fun plcRate(): Double = plcRate(pointer)
+
+        /** Forget arrival history (e.g. after a stream gap). */
+        fun reset() = reset(pointer)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyController(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createController(
+            frameMs: Double,
+            minFrames: Int,
+            maxFrames: Int,
+            initialFrames: Int,
+            targetPlcRate: Double
+        ): Long
+        private external fun destroyController(pointer: Long)
+        private external fun onFrame(pointer: Long, outcome: Int): Int
+        private external fun targetFrames(pointer: Long): Int
+        private external fun jitterMs(pointer: Long): Double
+        private external fun quantileDelayMs(pointer: Long): Double
+        private external fun plcRate(pointer: Long): Double
+        private external fun reset(pointer: Long)
+
+        companion object {
+            const val OUTCOME_DECODED = 0
+            const val OUTCOME_FEC = 1
+            const val OUTCOME_PLC = 2
+            const val OUTCOME_DRED = 3
+        }
+    }
+
+    // =========================
+    // Host clock (guest)
+    // =========================
+    // NTP-style estimate of the host's monotonic clock (offset + skew), kept by the
+    // UdpReceiver's clock exchanges on the rx thread, plus the host media timeline from
+    // packet pts. Lets every guest present frame N at the same host time. Any thread.
+    class HostClock {
+        internal var pointer: Long = createHostClock().also {
+            require(it != 0L) { "Failed to create host clock" }
+        }
+            private set
+
+        /**
+         * System.nanoTime() at which frame [seq]'s first sample should be heard, i.e. its
+         * host capture time + [delayNs]; [NO_TIME] until the clock and stream are known.
+         */
+        fun presentationNs(seq: Int, frameTicks: Int, delayNs: Long): Long =
+            presentationNs(pointer, seq, frameTicks, delayNs)
+
+        /**
+         * out[0..6] = valid (0/1), offset ns (host - guest), skew (ppb), smallest round
+         * trip ns, exchanges, points trusted, restarts. Returns valid.
+         */
+        fun estimate(out: LongArray): Boolean = estimate(pointer, out)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyHostClock(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createHostClock(): Long
+        private external fun destroyHostClock(pointer: Long)
+        private external fun presentationNs(pointer: Long, seq: Int, frameTicks: Int, delayNs: Long): Long
+        private external fun estimate(pointer: Long, out: LongArray): Boolean
+
+        companion object {
+            const val NO_TIME = Long.MIN_VALUE
+        }
+    }
+
+    // =========================
+    // Sink latency (guest)
+    // =========================
+    // Output latency measured from AudioTrack.getTimestamp positions: when a frame
+    // written now is heard, and how far that swings as the sink pulls. Playout thread.
+    class SinkLatency(sampleRate: Int) {
+        private var pointer: Long = createSinkLatency(sampleRate).also {
+            require(it != 0L) { "Failed to create sink latency model" }
+        }
+
+        /** A timestamp read at [nowNs] ([System.nanoTime]) with [framesWritten] written so far. */
+        fun update(framePosition: Long, presentedNs: Long, framesWritten: Long, nowNs: Long) =
+            update(pointer, framePosition, presentedNs, framesWritten, nowNs)
+
+        /** [System.nanoTime] at which the next frame written (after [framesWritten]) is heard. */
+        fun playsAtNs(framesWritten: Long, nowNs: Long): Long = playsAtNs(pointer, framesWritten, nowNs)
+
+        /**
+         * out[0..4] = valid (0/1), latency ns (write to heard, median), spread ns (how far
+         * the sink's pulls swing it), positions taken, restarts (route changes seen). Returns valid.
+         */
+        fun estimate(out: LongArray): Boolean = estimate(pointer, out)
+
+        /** After a flush: positions restart, the measured latency still holds. */
+        fun reset() = reset(pointer)
+
+        /** A new route: measure from scratch. */
+        fun clear() = clear(pointer)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroySinkLatency(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createSinkLatency(sampleRate: Int): Long
+        private external fun destroySinkLatency(pointer: Long)
+        private external fun update(pointer: Long, framePosition: Long, presentedNs: Long, framesWritten: Long, nowNs: Long)
+        private external fun playsAtNs(pointer: Long, framesWritten: Long, nowNs: Long): Long
+        private external fun estimate(pointer: Long, out: LongArray): Boolean
+        private external fun reset(pointer: Long)
+        private external fun clear(pointer: Long)
+    }
+
+    // =========================
+    // Time stretcher (guest)
+    // =========================
+    // Lengthens or shortens decoded frames by one pitch period with a cross-fade
+    // (single-segment WSOLA), paced so at most [maxRate] of the audio is added/removed.
+    // Used to grow and drain the jitter cushion without silence or skipped frames.
+    // Playout thread only.
+    class TimeStretcher(
+        sampleRate: Int,
+        private val channels: Int,
+        maxFrameSize: Int,
+        maxRate: Double = 0.08,
+    ) {
+        private var pointer: Long = createStretcher(sampleRate, channels, maxFrameSize, maxRate).also {
+            require(it != 0L) { "Failed to create time stretcher" }
+        }
+
+        /**
+         * Writes [frameSize] samples per channel of [pcm] into [out], possibly lengthened.
+         * [out] should hold at least 1.5 * frameSize * channels shorts. Returns shorts written.
+         */
+        fun expandInto(pcm: ShortArray, frameSize: Int, out: ShortArray): Int {
+            val n = expandInto(pointer, pcm, frameSize, out)
+            if (n < 0) error("TimeStretcher expandInto failed (rc=$n)")
+            return n
+        }
+
+        /**
+         * Writes [frameSize] samples per channel of [pcm] into [out], possibly shortened
+         * (never below half). Returns shorts written.
+         */
+        fun compressInto(pcm: ShortArray, frameSize: Int, out: ShortArray): Int {
+            val n = compressInto(pointer, pcm, frameSize, out)
+            if (n < 0) error("TimeStretcher compressInto failed (rc=$n)")
+            return n
+        }
+
+        /** Net samples per channel added (minus removed) since creation / [reset]. */
+        fun stretchedFrames(): Long = stretchedFrames(pointer)
+
+        fun reset() = reset(pointer)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyStretcher(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createStretcher(sampleRate: Int, channels: Int, maxFrameSize: Int, maxRate: Double): Long
+        private external fun destroyStretcher(pointer: Long)
+        private external fun expandInto(pointer: Long, pcm: ShortArray, frameSize: Int, out: ShortArray): Int
+        private external fun compressInto(pointer: Long, pcm: ShortArray, frameSize: Int, out: ShortArray): Int
+        private external fun stretchedFrames(pointer: Long): Long
+        private external fun reset(pointer: Long)
+    }
+
+    // =========================
+    // Asynchronous resampler (guest)
+    // =========================
+    // Polyphase windowed-sinc converter with a continuously variable ratio, steered by
+    // a PI loop on jitter-buffer depth to absorb host/guest clock drift. Correction is
+    // clamped to +-[maxPpm]. Playout thread only.
+    class Resampler(
+        private val channels: Int,
+        maxInputFrames: Int,
+        maxPpm: Double = 2000.0,
+    ) {
+        private var pointer: Long = createResampler(channels, maxInputFrames, maxPpm).also {
+            require(it != 0L) { "Failed to create resampler" }
+        }
+
+        /**
+         * Resamples [frames] samples per channel of [pcm] into [out] at the current ratio.
+         * [out] must hold (frames + 2) * 1.01 * channels shorts. Returns shorts written.
+         */
+        fun processInto(pcm: ShortArray, frames: Int, out: ShortArray): Int {
+            val n = processInto(pointer, pcm, frames, out)
+            if (n < 0) error("Resampler processInto failed (rc=$n)")
+            return n
+        }
+
+        /** One depth observation per played frame; returns the correction in ppm. */
+        fun trackDepth(depthFrames: Double, targetFrames: Double): Double =
+            trackDepth(pointer, depthFrames, targetFrames)
+
+        fun ppm(): Double = ppm(pointer)
+
+        /** Drops filter history and loop state (after a track flush / resync). */
+        fun reset() = reset(pointer)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyResampler(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createResampler(channels: Int, maxInputFrames: Int, maxPpm: Double): Long
+        private external fun destroyResampler(pointer: Long)
+        private external fun processInto(pointer: Long, pcm: ShortArray, frames: Int, out: ShortArray): Int
+        private external fun trackDepth(pointer: Long, depthFrames: Double, targetFrames: Double): Double
+        private external fun ppm(pointer: Long): Double
+        private external fun reset(pointer: Long)
+    }
+
+    // =========================
+    // PCM frame ring (host)
+    // =========================
+    // Capture -> encode handoff: fixed native PCM slots, lock-free SPSC. [write] runs only on
+    // the capture thread and never blocks (a full ring overwrites its oldest frame); [read]
+    // runs only on the send thread and sleeps on a futex until a frame arrives.
+    class PcmRing(capacity: Int, val frameShorts: Int) {
+        private var pointer: Long = createPcmRing(capacity, frameShorts).also {
+            require(it != 0L) { "Failed to create PCM ring" }
+        }
+
+        fun write(pcm: ShortArray, seq: Int, pts: Int) {
+            val rc = write(pointer, pcm, seq, pts)
+            if (rc < 0) error("PcmRing write failed (rc=$rc)")
+        }
+
+        /** Copies the oldest frame into [out], meta = (seq, pts). False on timeout or after [close]. */
+        fun read(out: ShortArray, meta: IntArray, waitMs: Int): Boolean {
+            val rc = read(pointer, out, meta, waitMs)
+            if (rc < 0) error("PcmRing read failed (rc=$rc)")
+            return rc == 1
+        }
+
+        fun size(): Int = size(pointer)
+
+        /** Consumer side: drops everything queued. */
+        fun clear() = clear(pointer)
+
+        /** Wakes a blocked [read]; every later read returns false. */
+        fun close() = close(pointer)
+
+        /** out[0..2] = frames written, overwritten before being read, queued. */
+        fun stats(out: LongArray) = stats(pointer, out)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyPcmRing(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createPcmRing(capacity: Int, frameShorts: Int): Long
+        private external fun destroyPcmRing(pointer: Long)
+        private external fun write(pointer: Long, pcm: ShortArray, seq: Int, pts: Int): Int
+        private external fun read(pointer: Long, out: ShortArray, meta: IntArray, waitMs: Int): Int
+        private external fun size(pointer: Long): Int
+        private external fun clear(pointer: Long)
+        private external fun close(pointer: Long)
+        private external fun stats(pointer: Long, out: LongArray)
+    }
+
+    // =========================
+    // Simulcast encoder (host)
+    // =========================
+    // One Opus encoder per tier ([bitrates], highest first) fed the same PCM frame; tier 0
+    // is encoded on the calling thread, every other tier on its own native worker. Output
+    // datagrams stay native and go out through UdpSender.sendSimulcast. Every opus_encode
+    // is timed; with [encodeShare] > 0 complexity starts at [complexity] and is lowered or
+    // raised within [minComplexity]..[maxComplexity] to keep p95 encode time under that
+    // share of the frame. When a frame still takes longer than [budgetUs] at the lowest
+    // complexity the highest tier is shed (see activeTiers). Send thread only.
+    class SimulcastEncoder(
+        sampleRate: Int,
+        channels: Int,
+        frameSize: Int,
+        application: Int,
+        complexity: Int,
+        bitrates: IntArray,
+        budgetUs: Int,
+        encodeShare: Double = 0.0,
+        minComplexity: Int = complexity,
+        maxComplexity: Int = complexity,
+    ) {
+        internal var pointer: Long =
+            createSimulcast(
+                sampleRate, channels, frameSize, application, complexity, minComplexity,
+                maxComplexity, encodeShare, bitrates, budgetUs
+            ).also {
+                require(it != 0L) { "Failed to create simulcast encoder" }
+            }
+
+        /**
+         * Encodes [pcm] as datagrams with [seq]/[pts] for the tiers in [mask] (bit t = tier t).
+         * Returns the mask actually encoded.
+         */
+        fun encode(pcm: ShortArray, seq: Int, pts: Int, mask: Int, flags: Int = 0): Int {
+            val n = encode(pointer, pcm, seq, pts, flags, mask)
+            if (n < 0) error("SimulcastEncoder encode failed (rc=$n)")
+            return n
+        }
+
+        fun setBitrate(tier: Int, bitrate: Int): Boolean = setBitrate(pointer, tier, bitrate)
+
+        fun setExpectedPacketLossPercent(tier: Int, lossPercent: Int): Boolean =
+            setExpectedPacketLossPercent(pointer, tier, lossPercent)
+
+        /** Tiers still encoded within the CPU budget; guests above are folded down. */
+        fun activeTiers(): Int = activeTiers(pointer)
+
+        /** out[0..3] = wall us per frame, frames, sheds, restores; out[4 + t] = tier t CPU us. */
+        fun stats(out: LongArray) = stats(pointer, out)
+
+        /**
+         * out[0..7] = complexity, p50/p95/p99/max opus_encode us (slowest tier, recent
+         * window), frames measured, complexity lowers, raises.
+         */
+        fun encodeTimes(out: LongArray) = encodeTimes(pointer, out)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroySimulcast(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createSimulcast(
+            sampleRate: Int, channels: Int, frameSize: Int, application: Int, complexity: Int,
+            minComplexity: Int, maxComplexity: Int, encodeShare: Double, bitrates: IntArray,
+            budgetUs: Int
+        ): Long
+        private external fun destroySimulcast(pointer: Long)
+        private external fun encode(pointer: Long, pcm: ShortArray, seq: Int, pts: Int, flags: Int, mask: Int): Int
+        private external fun setBitrate(pointer: Long, tier: Int, bitrate: Int): Boolean
+        private external fun setExpectedPacketLossPercent(pointer: Long, tier: Int, lossPercent: Int): Boolean
+        private external fun activeTiers(pointer: Long): Int
+        private external fun stats(pointer: Long, out: LongArray)
+        private external fun encodeTimes(pointer: Long, out: LongArray)
+    }
+
+    // =========================
+    // Host pipeline (host)
+    // =========================
+    // The whole host hot path on native threads: frame assembly, PCM ring, simulcast
+    // encoder, UDP fan-out with resends / FEC / rate control, and the NACK service.
+    // Kotlin only pushes raw capture chunks ([push], capture thread) and edits the target
+    // set; per-frame work never crosses JNI. Encoder parameters are as for SimulcastEncoder;
+    // [fec] holds the starting (scheme, k, m) per tier, [aggregateFrames] the starting
+    // frames per datagram (see [setAggregation]). With [dnnBlob] (outliving the pipeline)
+    // every tier carries [dredMs] of Deep REDundancy, if libopus was built with DRED.
+    class HostPipeline(
+        sampleRate: Int,
+        channels: Int,
+        frameSize: Int,
+        application: Int,
+        complexity: Int,
+        minComplexity: Int,
+        maxComplexity: Int,
+        encodeShare: Double,
+        bitrates: IntArray,
+        budgetUs: Int,
+        fec: IntArray,
+        ringFrames: Int,
+        retransmitFrames: Int,
+        port: Int,
+        minBitrate: Int,
+        maxBitrate: Int,
+        aggregateFrames: Int = 1,
+        dnnBlob: DnnBlob? = null,
+        dredMs: Int = 0,
+    ) {
+        private var pointer: Long =
+            createPipeline(
+                sampleRate, channels, frameSize, application, complexity, minComplexity,
+                maxComplexity, encodeShare, bitrates, budgetUs, fec, ringFrames,
+                retransmitFrames, port, minBitrate, maxBitrate, aggregateFrames,
+                dnnBlob?.pointer ?: 0L, dredMs
+            ).also {
+                require(it != 0L) { "Failed to create host pipeline" }
+            }
+
+        /** Resend cache bound to its port (false if the port was busy). */
+        fun retransmitEnabled(): Boolean = retransmitEnabled(pointer)
+        fun rateControlEnabled(): Boolean = rateControlEnabled(pointer)
+
+        fun start(): Boolean = start(pointer)
+
+        /** Joins the native threads; queued frames are dropped. */
+        fun stop() = stop(pointer)
+
+        /**
+         * Capture thread: hands [bytes] of native-order 16-bit interleaved PCM at the start of
+         * the direct [buffer] to the frame assembler. Never blocks.
+         */
+        fun push(buffer: ByteBuffer, bytes: Int) {
+            val rc = push(pointer, buffer, bytes)
+            if (rc < 0) error("HostPipeline push failed (rc=$rc)")
+        }
+
+        /**
+         * Replaces the whole target set (at most [MAX_TARGETS]). The send thread picks it up
+         * at its next frame: index i of [stats]' errors maps to targets[i] only while
+         * out[STAT_ERROR_GENERATION] equals the [generation] given here.
+         */
+        fun setTargets(targets: List<InetSocketAddress>, generation: Long): Boolean {
+            val ips = Array(targets.size) { targets[it].address.address }
+            val ports = IntArray(targets.size) { targets[it].port }
+            return setTargets(pointer, ips, ports, generation)
+        }
+
+        /** Lets multicast/broadcast targets leave through [iface] with TTL 1. */
+        fun setGroupInterface(iface: Inet4Address): Boolean =
+            setGroupInterface(pointer, iface.address)
+
+        /** Tier-0 transport FEC; receiver reports take it over once they arrive. */
+        fun setFec(scheme: Int, k: Int = 0, m: Int = 0) = setFec(pointer, scheme, k, m)
+
+        /**
+         * Sends [frames] consecutive frames per datagram (1 = one each, up to
+         * [MAX_AGGREGATE_FRAMES]) as one multi-frame Opus packet: fewer packets on the air
+         * for (frames - 1) frames of latency. Frames over 20 ms are never aggregated.
+         */
+        fun setAggregation(frames: Int) = setAggregation(pointer, frames)
+
+        /**
+         * Snapshot, about once a second, into out[0..[STATS_SIZE]), indexed by the STAT_
+         * constants below. When a send failed in the period, [errors] gets the errno per
+         * target; returns the entries written (0 if none).
+         */
+        fun stats(out: LongArray, errors: IntArray?): Int = stats(pointer, out, errors)
+
+        fun destroy() {
+            if (pointer != 0L) {
+                destroyPipeline(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createPipeline(
+            sampleRate: Int, channels: Int, frameSize: Int, application: Int, complexity: Int,
+            minComplexity: Int, maxComplexity: Int, encodeShare: Double, bitrates: IntArray,
+            budgetUs: Int, fec: IntArray, ringFrames: Int, retransmitFrames: Int, port: Int,
+            minBitrate: Int, maxBitrate: Int, aggregateFrames: Int, dnnBlob: Long, dredMs: Int
+        ): Long
+        private external fun destroyPipeline(pointer: Long)
+        private external fun retransmitEnabled(pointer: Long): Boolean
+        private external fun rateControlEnabled(pointer: Long): Boolean
+        private external fun start(pointer: Long): Boolean
+        private external fun stop(pointer: Long)
+        private external fun push(pointer: Long, buffer: ByteBuffer, bytes: Int): Int
+        private external fun setTargets(
+            pointer: Long, ips: Array<ByteArray>, ports: IntArray, generation: Long
+        ): Boolean
+        private external fun setGroupInterface(pointer: Long, ipv4: ByteArray): Boolean
+        private external fun setFec(pointer: Long, scheme: Int, k: Int, m: Int)
+        private external fun setAggregation(pointer: Long, frames: Int)
+        private external fun stats(pointer: Long, out: LongArray, errors: IntArray?): Int
+
+        companion object {
+            // Slots of [stats]; must match StatIndex in host_pipeline_jni.cpp
+            const val STAT_FRAMES = 0                // assembled from capture
+            const val STAT_SENT = 1                  // encoded and sent
+            const val STAT_OVERWRITTEN = 2           // lost in the ring
+            const val STAT_IDLE = 3                  // dequeued with no target
+            const val STAT_ENCODE_ERRORS = 4
+            const val STAT_SEND_FAILURES = 5         // frames some target could not be sent
+            const val STAT_QUEUE_US = 6              // smoothed stage times
+            const val STAT_ENCODE_US = 7
+            const val STAT_SEND_US = 8
+            const val STAT_TOTAL_US = 9
+            const val STAT_MAX_TOTAL_US = 10         // since the previous snapshot
+            const val STAT_ACTIVE_TIERS = 11
+            const val STAT_ENCODE_WALL_US = 12
+            const val STAT_SHEDS = 13
+            const val STAT_RESTORES = 14
+            const val STAT_COMPLEXITY = 15
+            const val STAT_ENCODE_P50_US = 16        // opus_encode time percentiles
+            const val STAT_ENCODE_P95_US = 17
+            const val STAT_ENCODE_P99_US = 18
+            const val STAT_ENCODE_MAX_US = 19
+            const val STAT_COMPLEXITY_LOWERS = 20
+            const val STAT_COMPLEXITY_RAISES = 21
+            const val STAT_NACKS = 22
+            const val STAT_NACK_REQUESTED = 23
+            const val STAT_RESENT = 24
+            const val STAT_RESEND_EVICTED = 25
+            const val STAT_RESEND_RATE_LIMITED = 26
+            const val STAT_REPORTS = 27              // receiver reports
+            const val STAT_BACKOFFS = 28
+            const val STAT_PROBES = 29
+            const val STAT_FEC_CHANGES = 30
+            const val STAT_TIER_MOVES = 31
+            const val STAT_RATE_DECISIONS = 32       // latest decision follows
+            const val STAT_RATE_BITRATE = 33
+            const val STAT_RATE_LOSS_PERCENT = 34
+            const val STAT_RATE_FEC_SCHEME = 35
+            const val STAT_RATE_FEC_K = 36
+            const val STAT_RATE_FEC_M = 37
+            const val STAT_TIER_CPU_US = 38          // + tier, MAX_TIERS slots
+            const val STAT_CLOCK_REQUESTS = 42       // guest clock requests answered
+            const val STAT_PACKETS = 43              // datagrams sent, per target
+            const val STAT_FRAMES_PER_PACKET = 44
+            const val STAT_DRED_MS = 45              // per packet, 0 = off or unavailable
+            const val STAT_ERROR_GENERATION = 46     // setTargets generation of the errors
+            const val STATS_SIZE = 47
+
+            const val MAX_TIERS = 4                  // SimulcastEncoder::kMaxTiers
+            const val MAX_TARGETS = 128              // HostPipeline::kMaxTargets
+            const val MAX_AGGREGATE_FRAMES = 3       // wsaggregate::kMaxFrames
+        }
+    }
+
+    // =========================
+    // UDP fan-out sender (host)
+    // =========================
+    // Owns a dual-stack UDP socket and the guest address array, and hands one datagram
+    // to every guest with a single sendmmsg(). A failing guest does not stop the batch.
+    // With simulcast each guest gets its tier's datagram, still in one sendmmsg().
+    // Send thread only.
+    class UdpSender {
+        private var pointer: Long = createSender().also {
+            require(it != 0L) { "Failed to create UDP sender" }
+        }
+
+        /** Replaces the whole target set; index i of [sendToAll]'s errors maps to targets[i]. */
+        fun setTargets(targets: List<InetSocketAddress>): Boolean {
+            val ips = Array(targets.size) { targets[it].address.address }
+            val ports = IntArray(targets.size) { targets[it].port }
+            return setTargets(pointer, ips, ports)
+        }
+
+        /**
+         * Lets multicast/broadcast targets leave through [iface] (an IPv4 interface
+         * address) with TTL 1. Call before adding such targets.
+         */
+        fun setGroupInterface(iface: Inet4Address): Boolean =
+            setGroupInterface(pointer, iface.address)
+
+        /**
+         * Sends data[0, length) to every target. [errors] (size >= target count) receives
+         * 0 or the errno per target. Returns the number of targets sent to.
+         */
+        fun sendToAll(data: ByteArray, length: Int, errors: IntArray?): Int {
+            val n = sendToAll(pointer, data, length, errors)
+            if (n < 0) error("UdpSender sendToAll failed (rc=$n)")
+            return n
+        }
+
+        /**
+         * Binds the sender to [port] and keeps the last [capacity] datagrams so guest
+         * NACKs can be answered. Call once, before the send thread starts.
+         */
+        fun enableRetransmit(capacity: Int, port: Int): Boolean =
+            enableRetransmit(pointer, capacity, port)
+
+        /**
+         * NACK thread: waits up to [timeoutMs] and resends what queued NACKs ask for.
+         * Returns packets resent, or a negative code (-1 not enabled, -errno).
+         */
+        fun serveNacks(timeoutMs: Int): Int = serveNacks(pointer, timeoutMs)
+
+        /**
+         * Transport FEC: after every [k] media datagrams, [m] parity datagrams follow,
+         * paced one per media datagram. [scheme] < 0 turns it off. With simulcast, each
+         * [tier] has its own FEC. Send thread only.
+         */
+        fun setFec(scheme: Int, k: Int, m: Int, tier: Int = 0): Boolean = setFec(pointer, tier, scheme, k, m)
+
+        /**
+         * Before each simulcast encode: places every target on its guest's tier (below
+         * [maxTiers]) and returns the mask of tiers that have targets.
+         */
+        fun tierMask(maxTiers: Int): Int = tierMask(pointer, maxTiers)
+
+        /** Sends [encoder]'s last frame, each tier's datagram to that tier's targets. */
+        fun sendSimulcast(encoder: SimulcastEncoder, errors: IntArray?): Int {
+            val n = sendSimulcast(pointer, encoder.pointer, errors)
+            if (n < 0) error("UdpSender sendSimulcast failed (rc=$n)")
+            return n
+        }
+
+        /** out[0..5] = NACKs, requested, resent, evicted, rate limited, receiver reports. */
+        fun retransmitStats(out: LongArray) = retransmitStats(pointer, out)
+
+        /**
+         * Lets guest receiver reports (read by [serveNacks]) steer the tier-0 bitrate within
+         * [minBitrate]..[maxBitrate], its expected loss and FEC, and place guests on one of
+         * [tiers] simulcast tiers. Needs [enableRetransmit].
+         */
+        fun enableRateControl(minBitrate: Int, maxBitrate: Int, tiers: Int = 1): Boolean =
+            enableRateControl(pointer, minBitrate, maxBitrate, tiers)
+
+        /**
+         * Send thread: when the rate controller changed its decision, fills
+         * out[0..4] = bitrate, expected loss %, FEC scheme, k, m and returns true.
+         */
+        fun pollRateControl(out: IntArray): Boolean = pollRateControl(pointer, out)
+
+        /** NACK thread: out[0..4] = reports, backoffs, probes, FEC changes, tier moves. */
+        fun rateControlStats(out: LongArray) = rateControlStats(pointer, out)
+
+        fun close() {
+            if (pointer != 0L) {
+                destroySender(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createSender(): Long
+        private external fun destroySender(pointer: Long)
+        private external fun setTargets(pointer: Long, ips: Array<ByteArray>, ports: IntArray): Boolean
+        private external fun setGroupInterface(pointer: Long, ipv4: ByteArray): Boolean
+        private external fun enableRetransmit(pointer: Long, capacity: Int, port: Int): Boolean
+        private external fun serveNacks(pointer: Long, timeoutMs: Int): Int
+        private external fun setFec(pointer: Long, tier: Int, scheme: Int, k: Int, m: Int): Boolean
+        private external fun tierMask(pointer: Long, maxTiers: Int): Int
+        private external fun sendSimulcast(pointer: Long, encoderPointer: Long, errors: IntArray?): Int
+        private external fun retransmitStats(pointer: Long, out: LongArray)
+        private external fun enableRateControl(pointer: Long, minBitrate: Int, maxBitrate: Int, tiers: Int): Boolean
+        private external fun pollRateControl(pointer: Long, out: IntArray): Boolean
+        private external fun rateControlStats(pointer: Long, out: LongArray)
+        private external fun sendToAll(pointer: Long, data: ByteArray, length: Int, errors: IntArray?): Int
+    }
+
+    // =========================
+    // Batched UDP receiver (guest)
+    // =========================
+    // Drains bursts with recvmmsg (one wakeup per burst) and stamps each datagram with
+    // its kernel arrival time (SO_TIMESTAMPNS, monotonic base). Datagrams go straight
+    // into the JitterBuffer and arrivals into the PlayoutDelayController. rx thread only.
+    // Works on a dup of [socket]'s descriptor; close() releases it. [frameMs] is the
+    // negotiated frame duration, which frame-counted NACK limits are derived from.
+    class UdpReceiver(socket: DatagramSocket, frameMs: Double) {
+        private var pointer: Long =
+            createReceiver(ParcelFileDescriptor.fromDatagramSocket(socket).detachFd(), frameMs).also {
+                require(it != 0L) { "Failed to create UDP receiver" }
+            }
+
+        /**
+         * Waits up to [timeoutMs] for data, then stores everything queued into [buffer].
+         * With a NACK target, [clock] is kept in sync with the host from the same socket.
+         * Returns datagrams stored (0 on timeout), or a negative errno on socket error.
+         */
+        fun receiveInto(
+            buffer: JitterBuffer,
+            delay: PlayoutDelayController?,
+            clock: HostClock?,
+            timeoutMs: Int,
+        ): Int = receiveInto(pointer, buffer.pointer, delay?.pointer ?: 0L, clock?.pointer ?: 0L, timeoutMs)
+
+        /** System.nanoTime()-based kernel arrival time of the newest stored datagram. */
+        fun lastArrivalNs(): Long = lastArrivalNs(pointer)
+
+        /**
+         * Reports sequence gaps to the host at [host]:[port] as NACKs, sent from this
+         * socket so resends come back to it. Driven by [receiveInto]; rx thread only.
+         */
+        fun setNackTarget(host: InetAddress, port: Int): Boolean =
+            setNackTarget(pointer, host.address, port)
+
+        /**
+         * Sends a receiver report to the NACK target: loss and highest seq as seen by this
+         * receiver, plus the playout figures passed in (counts since the previous report).
+         */
+        fun sendReport(jitterMs: Double, depthFrames: Int, decoded: Int, fec: Int, plc: Int, dred: Int): Boolean =
+            sendReport(pointer, (jitterMs * 10).toInt(), depthFrames, decoded, fec, plc, dred)
+
+        /** out[0..4] = lost, requested, recovered, abandoned, NACK datagrams sent. */
+        fun nackStats(out: LongArray) = nackStats(pointer, out)
+
+        /** out[0..2] = parity datagrams, media rebuilt from parity, groups given up. */
+        fun fecStats(out: LongArray) = fecStats(pointer, out)
+
+        fun close() {
+            if (pointer != 0L) {
+                destroyReceiver(pointer)
+                pointer = 0L
+            }
+        }
+
+        private external fun createReceiver(fd: Int, frameMs: Double): Long
+        private external fun destroyReceiver(pointer: Long)
+        private external fun receiveInto(
+            pointer: Long, bufferPointer: Long, delayPointer: Long, clockPointer: Long, timeoutMs: Int
+        ): Int
+        private external fun lastArrivalNs(pointer: Long): Long
+        private external fun setNackTarget(pointer: Long, ip: ByteArray, port: Int): Boolean
+        private external fun sendReport(
+            pointer: Long, jitterTenthMs: Int, depthFrames: Int, decoded: Int, fec: Int, plc: Int, dred: Int
+        ): Boolean
+        private external fun nackStats(pointer: Long, out: LongArray)
+        private external fun fecStats(pointer: Long, out: LongArray)
     }
 }
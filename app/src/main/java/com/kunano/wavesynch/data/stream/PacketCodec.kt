@@ -2,7 +2,7 @@ package com.kunano.wavesynch.data.stream
 
 data class AudioPacket(
     val seq: Int,
-    val tsMs: Int,
+    val pts: Int,
     val payload: ByteArray
 )
 
@@ -13,14 +13,22 @@ data class AudioPacket(
  * [2]  version
  * [3]  flags
  * [4..7]  seq (int)
- * [8..11] tsMs (int)
+ * [8..11] pts (u32): host CLOCK_MONOTONIC of the frame's first sample, in [PTS_RATE] ticks
  * [12..]  payload bytes
+ *
+ * The native encoder writes the same header in packet_codec.h; keep both in sync.
  */
 object PacketCodec {
     private const val MAGIC_0: Byte = 'W'.code.toByte()
     private const val MAGIC_1: Byte = 'S'.code.toByte()
     private const val VERSION: Byte = 1
     const val HEADER_SIZE = 12
+    const val PTS_RATE = 48_000
+
+    // flags bits (packet_codec.h)
+    const val FLAG_RETRANSMIT = 0x01
+    // Several consecutive frames in one multi-frame Opus packet (frame_aggregator.h)
+    const val FLAG_AGGREGATE = 0x02
 
     // ----------------------------
     // Zero-allocation ENCODE
@@ -34,7 +42,7 @@ object PacketCodec {
     fun writeInto(
         out: ByteArray,
         seq: Int,
-        tsMs: Int,
+        pts: Int,
         payload: ByteArray,
         payloadLen: Int,
         flags: Int = 0
@@ -49,7 +57,7 @@ object PacketCodec {
         out[3] = (flags and 0xFF).toByte()
 
         putIntBE(out, 4, seq)
-        putIntBE(out, 8, tsMs)
+        putIntBE(out, 8, pts)
 
         // copy payload
         System.arraycopy(payload, 0, out, HEADER_SIZE, payloadLen)
@@ -62,7 +70,7 @@ object PacketCodec {
 
     data class DecodedHeader(
         val seq: Int,
-        val tsMs: Int,
+        val pts: Int,
         val flags: Int,
         val payloadOffset: Int,
         val payloadLen: Int
@@ -82,7 +90,7 @@ object PacketCodec {
         val payloadLen = length - HEADER_SIZE
         return DecodedHeader(
             seq = seq,
-            tsMs = ts,
+            pts = ts,
             flags = flags,
             payloadOffset = HEADER_SIZE,
             payloadLen = payloadLen
@@ -96,9 +104,9 @@ object PacketCodec {
     /**
      * Old encode API (allocates).
      */
-    fun encode(seq: Int, tsMs: Int, pcm: ByteArray, length: Int): ByteArray {
+    fun encode(seq: Int, pts: Int, pcm: ByteArray, length: Int): ByteArray {
         val out = ByteArray(HEADER_SIZE + length)
-        val n = writeInto(out, seq, tsMs, pcm, length)
+        val n = writeInto(out, seq, pts, pcm, length)
         return if (n > 0) out else ByteArray(0)
     }
 
@@ -109,7 +117,7 @@ object PacketCodec {
         val h = decodeHeader(packetBytes, length) ?: return null
         val payload = ByteArray(h.payloadLen)
         System.arraycopy(packetBytes, h.payloadOffset, payload, 0, h.payloadLen)
-        return AudioPacket(h.seq, h.tsMs, payload)
+        return AudioPacket(h.seq, h.pts, payload)
     }
 
     // ----------------------------
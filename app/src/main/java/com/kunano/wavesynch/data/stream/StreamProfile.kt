@@ -0,0 +1,63 @@
+package com.kunano.wavesynch.data.stream
+
+import kotlin.math.ceil
+
+/**
+ * Per-session stream parameters: Opus frame duration and application.
+ *
+ * The host picks the profile, guests learn it from the Success handshake, and every
+ * frame-sized buffer and frame-counted threshold on both ends is derived from it.
+ * [lowDelay] selects OPUS_APPLICATION_RESTRICTED_LOWDELAY (CELT only, ~2.5 ms less
+ * look-ahead, no SILK LBRR); pair it with 5-10 ms frames.
+ */
+data class StreamProfile(
+    val frameUs: Int = 20_000,
+    val lowDelay: Boolean = false,
+) {
+    init {
+        require(frameUs in FRAME_DURATIONS_US) { "Unsupported Opus frame duration: $frameUs us" }
+    }
+
+    // PCM sizing (INTERLEAVED)
+    val samplesPerChannel: Int = (AudioStreamConstants.SAMPLE_RATE.toLong() * frameUs / 1_000_000L).toInt()
+    val samplesPerPacket: Int = samplesPerChannel * AudioStreamConstants.CHANNELS
+    val pcmFrameBytes: Int = samplesPerPacket * AudioStreamConstants.BYTES_PER_SAMPLE
+
+    val frameMs: Double = frameUs / 1000.0
+    val frameNs: Long = frameUs * 1000L
+
+    val application: Int =
+        if (lowDelay) OpusNative.APPLICATION_RESTRICTED_LOWDELAY else OpusNative.APPLICATION_AUDIO
+
+    /**
+     * Host capture -> guest speaker delay of synchronous playout. Every guest of a session
+     * presents frame N at its host pts + this, so it must cover the worst guest's network
+     * jitter and output latency.
+     */
+    val syncDelayMs: Double = if (lowDelay) 150.0 else 400.0
+
+    /** Frame length in packet pts ticks. */
+    val ptsTicks: Int = (PacketCodec.PTS_RATE.toLong() * frameUs / 1_000_000L).toInt()
+
+    /** Whole frames covering at least [ms] of audio (at least one). */
+    fun framesFor(ms: Double): Int = maxOf(1, ceil(ms * 1000.0 / frameUs - 1e-9).toInt())
+
+    /** Frames in one second of audio (rounded down). */
+    val framesPerSecond: Int = 1_000_000 / frameUs
+
+    companion object {
+        // Opus frame durations; a guest advertises support as a bitmask over this list
+        val FRAME_DURATIONS_US = intArrayOf(2_500, 5_000, 10_000, 20_000, 40_000, 60_000)
+        val ALL_FRAME_DURATIONS = (1 shl FRAME_DURATIONS_US.size) - 1
+
+        val DEFAULT = StreamProfile()
+        val LOW_DELAY = StreamProfile(frameUs = 10_000, lowDelay = true)
+
+        fun durationBit(frameUs: Int): Int = 1 shl FRAME_DURATIONS_US.indexOf(frameUs)
+
+        /** Profile sent in a host's Success handshake, or null if it is missing or unsupported. */
+        fun fromHandshake(frameUs: Int?, lowDelay: Boolean?): StreamProfile? =
+            if (frameUs == null || frameUs !in FRAME_DURATIONS_US) null
+            else StreamProfile(frameUs, lowDelay == true)
+    }
+}
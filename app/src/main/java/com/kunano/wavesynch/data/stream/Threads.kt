@@ -0,0 +1,15 @@
+package com.kunano.wavesynch.data.stream
+
+/**
+ * Waits for [thread] to exit, however long it takes. Shutdown paths call this before
+ * freeing native objects the thread may still be using, so an interrupt of the caller
+ * only delays it (and is restored afterwards). No-op for null or the calling thread.
+ */
+internal fun joinFully(thread: Thread?) {
+    if (thread == null || thread === Thread.currentThread()) return
+    var interrupted = false
+    while (thread.isAlive) {
+        try { thread.join() } catch (_: InterruptedException) { interrupted = true }
+    }
+    if (interrupted) Thread.currentThread().interrupt()
+}
@@ -5,122 +5,323 @@ import android.media.AudioAttributes
 import android.media.AudioDeviceInfo
 import android.media.AudioFormat
 import android.media.AudioManager
+import android.media.AudioRouting
+import android.media.AudioTimestamp
 import android.media.AudioTrack
-import android.media.PlaybackParams
 import android.os.Build
+import android.os.Debug
+import android.os.Handler
+import android.os.Looper
 import android.util.Log
 import com.google.firebase.crashlytics.FirebaseCrashlytics
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
-import com.kunano.wavesynch.data.stream.PacketCodec
+import com.kunano.wavesynch.data.stream.DnnWeights
+import com.kunano.wavesynch.data.stream.OpusNative
+import com.kunano.wavesynch.data.stream.StreamProfile
+import com.kunano.wavesynch.data.stream.joinFully
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.asStateFlow
-import java.net.DatagramPacket
 import java.net.DatagramSocket
-import java.net.SocketTimeoutException
+import java.net.InetAddress
 import java.util.concurrent.atomic.AtomicBoolean
-import kotlin.math.abs
+import kotlin.math.roundToLong
 
 class AudioReceiver(
     private val context: Context
 ) {
 
-    init { System.loadLibrary("wavesynch") }
+    init {
+        System.loadLibrary("wavesynch")
+        DnnWeights.preload(context)
+    }
 
     val firebaseCrashlytics = FirebaseCrashlytics.getInstance()
 
     private val _isPlayingState = MutableStateFlow(false)
     val isPlayingState = _isPlayingState.asStateFlow()
 
+    // Time from start() to the first decoded frame handed to the AudioTrack (null until then)
+    private val _joinToFirstSoundMs = MutableStateFlow<Long?>(null)
+    val joinToFirstSoundMs = _joinToFirstSoundMs.asStateFlow()
+
     private val running = AtomicBoolean(false)
 
     @Volatile private var isPaused = false
+    // Paused by the host. Separate from isPaused so the listener's own resume can't undo it.
+    @Volatile private var hostMuted = false
     private var rxThread: Thread? = null
     private var playoutThread: Thread? = null
 
     @Volatile private var udpSocket: DatagramSocket? = null
 
-    private val buffer = JitterBuffer(maxFrames = 2048)
+    // Session frame duration (negotiated in the handshake). Every frame-sized buffer and
+    // frame-counted threshold below is derived from it in configure(); tuning is in ms.
+    private var profile = StreamProfile.DEFAULT
+
+    // Native slot store keyed by seq (~10 s of audio); payloads never touch the Java heap
+    private lateinit var buffer: OpusNative.JitterBuffer
     private lateinit var decoder: OpusGuestDecoder
 
-    private val padBuf = ShortArray(AudioStreamConstants.SAMPLES_PER_PACKET)
+    // Room for a frame stretched by up to half its length, plus resampler slack
+    private var maxStretchedShorts = 0
+    private lateinit var padBuf: ShortArray
 
     // Wake/sleep signal: playout REALLY blocks here, RX wakes it
     private val rxSignal = Object()
 
     // -------- BASE TUNING (speaker/wired) --------
-    private var targetFrames = 20
-    private val minFrames = 12
-    private val maxFrames = 25
-
-    private val reorderWaitMs = 12L
-    private val lateToleranceFrames = 48
+    private var initialTargetFrames = 0
+    private var targetFrames = 0
+    private var minFrames = 0
+    private var maxFrames = 0
+
+    // Jitter-quantile playout delay (speaker/wired). Fed per packet from the rx thread.
+    private lateinit var delayController: OpusNative.PlayoutDelayController
+
+    // -------- FAST START --------
+    // Playout starts once this many frames are buffered; the cushion then grows to
+    // targetFrames by time-stretching decoded audio (no silence inserted).
+    private var fastStartFrames = 0
+    private lateinit var stretcher: OpusNative.TimeStretcher
+    // Fast start grows the cushion and draining shrinks it, at up to 8% time-stretch
+    private lateinit var stretchBuf: ShortArray
+    @Volatile private var joinStartNs = 0L
+
+    // Frames under 10 ms are too short to splice a pitch period out of: no fast start, and
+    // draining drops whole frames, paced at the same 8%
+    private var canStretch = true
+    private val stretchRate = 0.08
+
+    // -------- CLOCK DRIFT --------
+    // Everything played goes through the resampler; its ratio follows buffer depth
+    private lateinit var resampler: OpusNative.Resampler
+    private lateinit var resampleBuf: ShortArray
+
+    private var reorderWaitMs = 0L
+    private var lateToleranceFrames = 0
 
     // NOTE: big fixed thresholds are fragile; we use a dynamic jump check too.
-    private val bufferBehindDropThreshold = 450
+    private var bufferBehindDropThreshold = 0
 
     @Volatile private var lastRxNs: Long = 0L
+
+    // Playout figures for the next receiver report, published by the playout thread once
+    // a second and sent by the rx thread: depth, decoded, fec, plc, jitter (0.1 ms)
+    @Volatile private var pendingReport: IntArray? = null
     private val connectionTimeoutNs = 2_500_000_000L // 2.5s
 
+    // Speaker/wired: time-compress once the buffer is this far over target, until back on it
+    private var drainMarginFrames = 0
+
+    // -------- SYNCHRONOUS PLAYOUT --------
+    // The rx thread keeps hostClock in step with the host (NTP-style exchanges on the
+    // stream socket); every guest then presents frame N at its host pts + syncDelayNs, so
+    // phones in one room play the same sample at the same time. Needs a NACK target;
+    // Bluetooth routes join once their output latency has been measured.
+    private lateinit var hostClock: OpusNative.HostClock
+    @Volatile private var syncEnabled = false
+    private var syncDelayNs = 0L
+    private var syncToleranceNs = 0L
+    private lateinit var silenceBuf: ShortArray
+    private val syncMinToleranceNs = 15_000_000L
+    private val syncMaxPadNs = 1_000_000_000L
+    // How long a joining guest waits for the clock before starting unsynced
+    private val syncWaitNs = 1_000_000_000L
+
+    // -------- OUTPUT LATENCY --------
+    // AudioTrack timestamps (a written frame position and when it is heard) feed the
+    // sink latency model a few times a second. Until the first one after a start or
+    // flush, the playback head stands in, without the device's own latency.
+    private lateinit var sinkLatency: OpusNative.SinkLatency
+    private val trackTs = AudioTimestamp()
+    private var haveTrackTs = false
+    private var trackTsCheckedNs = 0L
+    private val trackTsEveryNs = 200_000_000L
+    private var writtenFrames = 0L
+    private val sinkStats = LongArray(5)
+    // Measured: jitter-buffer frames the sink's pulls need on top of the network's target
+    private var sinkCushionFrames = -1
+    private val sinkMarginMs = 40.0
+
+    // Output route, from the track's routing callback (no per-frame AudioManager queries)
+    @Volatile private var routedBt = false
+    @Volatile private var routeChanged = false
+    private val routingListener = AudioRouting.OnRoutingChangedListener { router ->
+        val device = router.routedDevice ?: return@OnRoutingChangedListener
+        routedBt = isBluetooth(device)
+        routeChanged = true
+    }
+
     // -------- BLUETOOTH MODE (gentle hysteresis drain) --------
     @Volatile private var btMode: Boolean = false
 
-    private val btTargetFrames = 28
-    private val btHighWater = 35
-    private val btLowWater = 25
-    private val btMaxDropPerSecond = 1
-
-    private val btDropStepFrames = 1
-    private val btDropCooldownNs = 500_000_000L // 500ms
+    // Until the sink is measured, BT starts from a guess
+    private var btInitialFrames = 0
+    private var btTargetFrames = 0
+    private var btHighWater = 0
+    private var btLowWater = 0
+
+    private fun configure(p: StreamProfile) {
+        profile = p
+        val frames = p::framesFor
+
+        buffer = OpusNative.JitterBuffer(capacity = frames(10_240.0), slotBytes = 1500)
+        decoder = OpusGuestDecoder(p)
+
+        maxStretchedShorts = p.samplesPerPacket * 3 / 2
+        val maxOutShorts = maxStretchedShorts + 512
+        padBuf = ShortArray(maxOutShorts)
+
+        // The low-delay profile starts and floors lower; the quantile controller then adapts
+        initialTargetFrames = frames(if (p.lowDelay) 60.0 else 200.0)
+        minFrames = frames(if (p.lowDelay) 20.0 else 80.0)
+        maxFrames = frames(500.0)
+        targetFrames = initialTargetFrames
+        delayController = OpusNative.PlayoutDelayController(
+            frameMs = p.frameMs,
+            minFrames = minFrames,
+            maxFrames = maxFrames,
+            initialFrames = initialTargetFrames,
+            targetPlcRate = 0.005
+        )
+
+        canStretch = p.frameUs >= 10_000
+        fastStartFrames = if (canStretch) frames(if (p.lowDelay) 20.0 else 60.0) else initialTargetFrames
+        stretcher = OpusNative.TimeStretcher(
+            sampleRate = AudioStreamConstants.SAMPLE_RATE,
+            channels = AudioStreamConstants.CHANNELS,
+            maxFrameSize = p.samplesPerChannel,
+            maxRate = stretchRate
+        )
+        stretchBuf = ShortArray(maxStretchedShorts)
+
+        resampler = OpusNative.Resampler(
+            channels = AudioStreamConstants.CHANNELS,
+            maxInputFrames = maxStretchedShorts / AudioStreamConstants.CHANNELS,
+            maxPpm = 2000.0
+        )
+        resampleBuf = ShortArray(maxOutShorts)
+
+        // Waiting for a reordered packet must stay well inside one frame
+        reorderWaitMs = (p.frameMs * 0.6).roundToLong().coerceIn(1L, 12L)
+        lateToleranceFrames = frames(960.0)
+        bufferBehindDropThreshold = frames(9_000.0)
+        drainMarginFrames = frames(60.0)
+
+        hostClock = OpusNative.HostClock()
+        syncDelayNs = (p.syncDelayMs * 1_000_000).toLong()
+        // A dropped frame moves playout by one frame; the tolerance keeps that from overshooting
+        syncToleranceNs = maxOf(syncMinToleranceNs, p.frameNs * 3 / 4)
+        silenceBuf = ShortArray(p.samplesPerPacket)
+
+        sinkLatency = OpusNative.SinkLatency(AudioStreamConstants.SAMPLE_RATE)
+        sinkCushionFrames = -1
+
+        btInitialFrames = frames(560.0)
+        setBtTarget(btInitialFrames)
+    }
 
-    private var btDropsThisSecond = 0
-    private var btSecondMarkNs = 0L
-    private var btLastDropNs = 0L
+    // BT drain hysteresis around the target: 140 ms over to start, 60 ms under to stop
+    private fun setBtTarget(frames: Int) {
+        btTargetFrames = frames
+        btHighWater = frames + profile.framesFor(140.0)
+        btLowWater = maxOf(minFrames, frames - profile.framesFor(60.0))
+    }
 
-    fun start(socket: DatagramSocket) {
+    /**
+     * [host] enables NACK-based recovery and receiver reports: gaps and once-a-second
+     * playout figures go to host:UDP_PORT. [profile] is the host's stream, from the handshake.
+     */
+    fun start(socket: DatagramSocket, host: InetAddress? = null, profile: StreamProfile = StreamProfile.DEFAULT) {
 
         if (running.getAndSet(true)) return
 
         udpSocket = socket
-        decoder = OpusGuestDecoder(AudioStreamConstants.SAMPLE_RATE, AudioStreamConstants.CHANNELS)
+        configure(profile)
+        syncEnabled = host != null
         _isPlayingState.tryEmit(true)
 
+        joinStartNs = System.nanoTime()
+        _joinToFirstSoundMs.value = null
+        pendingReport = null
+
+        // Until the track is routed (its callback follows play()), any BT output counts
         btMode = isBluetoothOutputActive()
+        routedBt = btMode
+        routeChanged = false
         Log.w("AudioReceiver", "Output route: btMode=$btMode")
 
-        socket.soTimeout = 50
         val track = buildAudioTrack()
+        track.addOnRoutingChangedListener(routingListener, Handler(Looper.getMainLooper()))
 
         // ---------------- RX THREAD ----------------
         rxThread = Thread {
             android.os.Process.setThreadPriority(android.os.Process.THREAD_PRIORITY_URGENT_AUDIO)
-            val recvBuf = ByteArray(4096)
-            val dp = DatagramPacket(recvBuf, recvBuf.size)
 
-            while (running.get() && !socket.isClosed) {
-                try {
-                    socket.receive(dp)
-                    if (!running.get() || socket.isClosed) break
+            // recvmmsg drains each burst in one wakeup; kernel arrival stamps feed the
+            // playout delay controller, payloads go straight into their native slots
+            val receiver = try {
+                OpusNative.UdpReceiver(socket, profile.frameMs)
+            } catch (e: Exception) {
+                firebaseCrashlytics.recordException(e)
+                Log.e("AudioReceiver", "Native receiver unavailable", e)
+                return@Thread
+            }
+            if (host != null && !receiver.setNackTarget(host, AudioStreamConstants.UDP_PORT)) {
+                Log.w("AudioReceiver", "NACK target rejected: $host")
+            }
+            val nackStats = LongArray(5)
+            val fecStats = LongArray(3)
+            val clockStats = LongArray(7)
+            var lastStatsNs = System.nanoTime()
 
-                    val h = PacketCodec.decodeHeader(dp.data, dp.length) ?: continue
+            try {
+                while (running.get() && !socket.isClosed) {
+                    // 50 ms poll so stop() is noticed promptly
+                    val n = receiver.receiveInto(buffer, delayController, hostClock, 50)
+                    if (n < 0) {
+                        if (!running.get() || socket.isClosed) break
+                        firebaseCrashlytics.setCustomKey("rzThread", "Audio receiver thread")
+                        firebaseCrashlytics.log("Audio receiver thread error errno=${-n}")
+                        Log.e("AudioReceiver", "RX error errno=${-n}")
+                        Thread.sleep(50)
+                        continue
+                    }
+
+                    // Reports go out from the socket's owner, so the receiver is never used after close()
+                    pendingReport?.let { r ->
+                        pendingReport = null
+                        receiver.sendReport(r[4] / 10.0, r[0], r[1], r[2], r[3], r[5])
+                    }
 
-                    val payload = ByteArray(h.payloadLen)
-                    System.arraycopy(dp.data, h.payloadOffset, payload, 0, h.payloadLen)
+                    if (n == 0) continue
 
-                    lastRxNs = System.nanoTime()
-                    buffer.put(payload, seq = h.seq)
+                    lastRxNs = receiver.lastArrivalNs()
+
+                    if (lastRxNs - lastStatsNs > 10_000_000_000L) {
+                        lastStatsNs = lastRxNs
+                        receiver.nackStats(nackStats)
+                        receiver.fecStats(fecStats)
+                        hostClock.estimate(clockStats)
+                        Log.d(
+                            "AudioReceiver",
+                            "lost=${nackStats[0]} requested=${nackStats[1]} recovered=${nackStats[2]} " +
+                                "abandoned=${nackStats[3]} nacks=${nackStats[4]} " +
+                                "fecParity=${fecStats[0]} fecRebuilt=${fecStats[1]} fecGaveUp=${fecStats[2]} " +
+                                "stale=${buffer.staleDropped()} " +
+                                "clock=${clockStats[0] == 1L} skewPpm=${"%.1f".format(clockStats[2] / 1000.0)} " +
+                                "minRttMs=${"%.2f".format(clockStats[3] / 1e6)} exchanges=${clockStats[4]} " +
+                                "trusted=${clockStats[5]} restarts=${clockStats[6]}"
+                        )
+                    }
 
                     // Wake playout (even if buffer isn't empty)
                     synchronized(rxSignal) { rxSignal.notifyAll() }
-
-                } catch (_: SocketTimeoutException) {
-                    // normal
-                } catch (e: Exception) {
-                    firebaseCrashlytics.setCustomKey("rzThread", "Audio receiver thread")
-                    firebaseCrashlytics.log("Audio receiver thread error")
-                    firebaseCrashlytics.recordException(e)
-                    if (!running.get() || socket.isClosed) break
-                    Log.e("AudioReceiver", "RX error", e)
                 }
+            } catch (_: InterruptedException) {
+                // stop()
+            } finally {
+                receiver.close()
             }
         }.apply { start() }
 
@@ -128,33 +329,49 @@ class AudioReceiver(
         playoutThread = Thread {
             android.os.Process.setThreadPriority(android.os.Process.THREAD_PRIORITY_URGENT_AUDIO)
 
+            // The decoder's owner, before its first frame; start()'s caller never waits on disk
+            DnnWeights.blob(context)?.let { decoder.enableDred(it) }
+
             // Stats + controllers
             var lateWindow = 0
             var okWindow = 0
             var fecWindow = 0
+            var dredWindow = 0
 
             var lastStatsNs = System.nanoTime()
-            var lastDriftNs = System.nanoTime()
-            var driftScore = 0
-            val driftThreshold = 40
+            // Playout thread CPU (decode + stretch + resample) per second of audio
+            var lastCpuNs = Debug.threadCpuTimeNanos()
+            var playedWindow = 0
 
             // Soft resync: if we're PLC-ing while buffer has plenty -> we're desynced
             var missStreak = 0
-            val maxMissStreak = 12 // ~120ms at 10ms frames (tune 8..20)
+            val maxMissStreak = profile.framesFor(240.0)
+
+            // Frame drops owed while draining short frames (see canStretch)
+            var dropCredit = 0.0
 
             // Current expected sequence
             var expectedSeq: Int? = null
 
-            // BT hysteresis state
+            // Drain hysteresis state (time compression)
             var btDraining = false
+            var draining = false
+
+            // Fast start: stretching toward targetFrames until the buffer first reaches it
+            var growing = false
+
+            // Synchronous playout state (see syncErrorNs)
+            var sync = false
+            var syncErrNs = 0L
+            var syncDrops = 0
+            var syncPads = 0
 
             fun resetControllers() {
                 lateWindow = 0
                 okWindow = 0
                 fecWindow = 0
+                dredWindow = 0
                 lastStatsNs = System.nanoTime()
-                lastDriftNs = System.nanoTime()
-                driftScore = 0
                 missStreak = 0
             }
 
@@ -162,6 +379,8 @@ class AudioReceiver(
                 // We consider stream "paused". Stop adding latency inside AudioTrack.
                 try { track.pause() } catch (_: Exception) {}
                 try { track.flush() } catch (_: Exception) {}
+                resampler.reset()
+                resetTrackClock()
 
                 val mark = lastRxNs
                 synchronized(rxSignal) {
@@ -179,24 +398,40 @@ class AudioReceiver(
                     expectedSeq = first             // jump to live stream
                 }
 
-                // restart audio
+                // restart audio, rebuilding the cushion from what has arrived so far
+                // (synchronous playout instead pads the gap to the next frame's due time)
                 try { track.play() } catch (_: Exception) {}
+                growing = canStretch && !sync
+
+                // arrival statistics from before the gap no longer describe the link
+                delayController.reset()
 
                 // reset drift/stat logic so it doesn't overreact to the gap
                 resetControllers()
             }
 
             try {
+                resetTrackClock()
                 track.play()
 
                 if (btMode) targetFrames = btTargetFrames
 
-                // ---- Initial sync: wait for enough fill, then start at buffer head
+                // ---- Initial sync: fast start on a few frames, then start at buffer head.
+                // Once the host clock is known the head frame is presented at its due time
+                // instead; without it by the deadline, buffer-depth playout it is.
+                val syncDeadlineNs = System.nanoTime() + syncWaitNs
                 while (running.get()) {
                     val first = buffer.firstSeq()
                     val size = buffer.size()
-                    if (first != null && size >= targetFrames) {
+                    if (first != null && syncEnabled && !btMode && System.nanoTime() < syncDeadlineNs) {
+                        if (syncErrorNs(first, track) != null) {
+                            sync = true
+                            expectedSeq = first
+                            break
+                        }
+                    } else if (first != null && size >= fastStartFrames) {
                         expectedSeq = first
+                        growing = canStretch
                         break
                     }
 
@@ -211,18 +446,28 @@ class AudioReceiver(
 
                 while (running.get()) {
 
-                    // ---- Route can change mid-stream
-                    val btNow = isBluetoothOutputActive()
-                    if (btNow != btMode) {
-                        btMode = btNow
-                        btDropsThisSecond = 0
-                        btSecondMarkNs = 0L
-                        btLastDropNs = 0L
-                        btDraining = false
-                        Log.w("AudioPlayer", "Route change detected. btMode=$btMode")
-                        if (btMode) targetFrames = btTargetFrames
-                        resetControllers()
+                    // ---- Route can change mid-stream: the new sink is measured from scratch
+                    if (routeChanged) {
+                        routeChanged = false
+                        sinkLatency.clear()
+                        haveTrackTs = false
+                        sinkCushionFrames = -1
+                        val btNow = routedBt
+                        if (btNow != btMode) {
+                            btMode = btNow
+                            btDraining = false
+                            draining = false
+                            // BT rejoins synchronous playout once measured (see the stats block)
+                            sync = sync && !btMode
+                            Log.w("AudioPlayer", "Route change detected. btMode=$btMode sync=$sync")
+                            if (btMode) {
+                                setBtTarget(btInitialFrames)
+                                targetFrames = btTargetFrames
+                            }
+                            resetControllers()
+                        }
                     }
+                    pollSink(track)
 
                     // ---- If no packets have arrived for too long -> SLEEP until RX resumes
                     val nowNs = System.nanoTime()
@@ -241,12 +486,13 @@ class AudioReceiver(
                     buffer.dropOlderThan(exp - lateToleranceFrames)
 
                     // Dynamic jump forward on restart / big forward gap
-                    val first = buffer.firstSeq()
-                    if (first != null) {
+                    val firstRaw = buffer.firstSeqOrNone()
+                    if (firstRaw != OpusNative.JitterBuffer.NO_SEQ) {
+                        val first = firstRaw.toInt()
                         val gapForward = first - exp
                         val gapBackward = exp - first
 
-                        val dynamicJump = (targetFrames * 3).coerceIn(40, 90)
+                        val dynamicJump = (targetFrames * 3).coerceIn(profile.framesFor(800.0), profile.framesFor(1_800.0))
                         if (gapForward > dynamicJump) {
                             Log.w("AudioPlayer", "Jump forward: first=$first expected=$exp gapF=$gapForward")
                             buffer.dropOlderThan(first)
@@ -260,68 +506,54 @@ class AudioReceiver(
                         }
                     }
 
-                    // 1) Try exact packet
-                    var payload = buffer.pop(exp)
+                    // 1) Try exact packet (decoded straight from its native slot)
+                    var decoded = decoder.decodeFrom(buffer, exp)
 
                     // 2) If missing, wait briefly for reorder
-                    if (payload == null) {
+                    if (decoded == null) {
                         buffer.waitForSeq(exp, reorderWaitMs)
-                        payload = buffer.pop(exp)
+                        decoded = decoder.decodeFrom(buffer, exp)
                     }
 
-                    val nextPayload = if (payload == null) buffer.peek(exp + 1) else null
-
-                    val pcm: ShortArray = when {
-                        payload != null -> {
-                            missStreak = 0
-                            okWindow++
-                            decoder.decode(payload)
-                        }
-                        nextPayload != null -> {
+                    var outcome = OpusNative.PlayoutDelayController.OUTCOME_DECODED
+                    val pcm: ShortArray = if (decoded != null) {
+                        missStreak = 0
+                        okWindow++
+                        decoded
+                    } else {
+                        // 3) FEC from packet exp+1 (left in the buffer), 4) DRED from the first
+                        // packet buffered after the gap, else PLC
+                        val recovered = decoder.decodeFecFrom(buffer, exp + 1)
+                        val rebuilt = if (recovered == null) decoder.decodeDredFrom(buffer, exp) else null
+                        if (recovered != null) {
                             missStreak = 0
                             fecWindow++
-                            decoder.decodeWithFEC(nextPayload)
-                        }
-                        else -> {
+                            outcome = OpusNative.PlayoutDelayController.OUTCOME_FEC
+                            recovered
+                        } else if (rebuilt != null) {
+                            missStreak = 0
+                            dredWindow++
+                            outcome = OpusNative.PlayoutDelayController.OUTCOME_DRED
+                            rebuilt
+                        } else {
                             missStreak++
                             lateWindow++
+                            outcome = OpusNative.PlayoutDelayController.OUTCOME_PLC
                             decoder.decodeWithPLC()
                         }
                     }
 
-                    writeFixed(track, pcm)
-
-                    // advance
-                    expectedSeq = exp + 1
-
-                    // ---- Soft resync: if we keep missing but buffer has data, we are desynced
-                    if (missStreak >= maxMissStreak) {
-                        val head = buffer.firstSeq()
-                        val bufNow = buffer.size()
-                        if (head != null && bufNow >= targetFrames) {
-                            Log.w("AudioPlayer", "Soft resync: missStreak=$missStreak buf=$bufNow expected=${expectedSeq} -> head=$head")
-                            buffer.dropOlderThan(head)
-                            expectedSeq = head
-                            missStreak = 0
-                            // Optional: decoder.reset() if you implement OPUS_RESET_STATE
-                        }
+                    // -------- Latency control: grow / drain by time-stretching --------
+                    val bufNow = buffer.size()
+                    if (growing && bufNow >= targetFrames) {
+                        growing = false
+                        Log.d("AudioPlayer", "Fast start: cushion reached $targetFrames frames, stretched=${stretcher.stretchedFrames()}")
                     }
 
-                    val now = System.nanoTime()
-
-                    // -------- Drift correction / latency control --------
-                    if (!btMode) {
-                        // Speaker/wired: speed nudges are OK
-                        if (now - lastDriftNs > 250_000_000L) {
-                            applyDriftCorrection(track, buffer.size(), targetFrames)
-                            lastDriftNs = now
-                        }
-                    } else {
-                        // Bluetooth: hysteresis drain (gentle, capped)
+                    if (btMode) {
+                        // Bluetooth: hysteresis drain
                         targetFrames = btTargetFrames
 
-                        val bufNow = buffer.size()
-
                         if (!btDraining && bufNow > btHighWater){
                             firebaseCrashlytics.setCustomKey("latency", "buffer size $bufNow")
                             firebaseCrashlytics.log("Buffer size $bufNow")
@@ -330,62 +562,150 @@ class AudioReceiver(
                             btDraining = true
                         }
                         if (btDraining && bufNow < btLowWater) btDraining = false
+                    } else {
+                        if (!draining && bufNow > targetFrames + drainMarginFrames) draining = true
+                        if (draining && bufNow <= targetFrames) draining = false
+                    }
+                    // Synchronous playout holds its own latency: the due time, not buffer depth
+                    val compress = !growing && !sync && (if (btMode) btDraining else draining)
+
+                    // A stretched frame plays longer than one frame, so packets accumulate;
+                    // a compressed one plays shorter, so the backlog drains without skipping audio
+                    val src: ShortArray
+                    var srcShorts: Int
+                    if (growing) {
+                        src = stretchBuf
+                        srcShorts = stretcher.expandInto(pcm, profile.samplesPerChannel, stretchBuf)
+                    } else if (compress && canStretch) {
+                        src = stretchBuf
+                        srcShorts = stretcher.compressInto(pcm, profile.samplesPerChannel, stretchBuf)
+                    } else {
+                        src = pcm
+                        srcShorts = profile.samplesPerPacket
+                        if (compress) {
+                            dropCredit += stretchRate
+                            if (dropCredit >= 1.0) {
+                                dropCredit -= 1.0
+                                srcShorts = 0 // decoded (decoder state stays continuous), not played
+                            }
+                        }
+                    }
 
-                        if (btSecondMarkNs == 0L) btSecondMarkNs = now
-                        if (now - btSecondMarkNs >= 1_000_000_000L) {
-                            btDropsThisSecond = 0
-                            btSecondMarkNs = now
+                    // -------- Synchronous playout: on time to within the tolerance --------
+                    // Late frames are decoded (decoder state stays continuous) but not played,
+                    // early ones get exact silence ahead of them; in between the resampler
+                    // steers the error to zero as it would buffer depth
+                    if (sync && srcShorts > 0) {
+                        val err = syncErrorNs(exp, track)
+                        if (err != null) {
+                            syncErrNs = err
+                            if (err > syncToleranceNs) {
+                                srcShorts = 0
+                                syncDrops++
+                            } else if (err < -syncToleranceNs) {
+                                writeSilence(track, -err)
+                                syncPads++
+                            } else {
+                                resampler.trackDepth(err.toDouble() / profile.frameNs, 0.0)
+                            }
                         }
+                    }
 
-                        val canDrain =
-                            (now - btLastDropNs) >= btDropCooldownNs &&
-                                    btDropsThisSecond < btMaxDropPerSecond
+                    if (srcShorts > 0) {
+                        val outShorts = resampler.processInto(src, srcShorts / AudioStreamConstants.CHANNELS, resampleBuf)
+                        writeFixed(track, resampleBuf, outShorts)
+                        playedWindow++
+                    }
 
-                        if (btDraining && canDrain) {
-                            val newExp = (expectedSeq ?: 0) + btDropStepFrames
-                            expectedSeq = newExp
-                            buffer.dropOlderThan(newExp - lateToleranceFrames)
+                    if (_joinToFirstSoundMs.value == null && outcome != OpusNative.PlayoutDelayController.OUTCOME_PLC) {
+                        val joinMs = (System.nanoTime() - joinStartNs) / 1_000_000L
+                        _joinToFirstSoundMs.value = joinMs
+                        firebaseCrashlytics.setCustomKey("joinToFirstSoundMs", joinMs)
+                        Log.i("AudioPlayer", "Join to first sound: ${joinMs}ms (buf=${buffer.size()})")
+                    }
 
-                            btLastDropNs = now
-                            btDropsThisSecond++
+                    // Quantile controller owns the network share of the target; on BT the
+                    // measured sink cushion goes on top. Underruns while the cushion is still
+                    // growing are expected and not reported.
+                    val adaptiveTarget = if (growing) delayController.targetFrames()
+                                         else delayController.onFrame(outcome)
+                    if (btMode && sinkCushionFrames >= 0) setBtTarget(adaptiveTarget + sinkCushionFrames)
+                    targetFrames = if (btMode) btTargetFrames else adaptiveTarget
 
-                            Log.w("AudioPlayer", "BT drain: dropped $btDropStepFrames frame(s). buf=$bufNow")
+                    // advance
+                    expectedSeq = exp + 1
+
+                    // ---- Soft resync: if we keep missing but buffer has data, we are desynced
+                    if (missStreak >= maxMissStreak) {
+                        val head = buffer.firstSeq()
+                        val depthNow = buffer.size()
+                        if (head != null && depthNow >= targetFrames) {
+                            Log.w("AudioPlayer", "Soft resync: missStreak=$missStreak buf=$depthNow expected=${expectedSeq} -> head=$head")
+                            buffer.dropOlderThan(head)
+                            expectedSeq = head
+                            missStreak = 0
+                            // Optional: decoder.reset() if you implement OPUS_RESET_STATE
                         }
                     }
 
-                    // -------- Buffer target update (every 1s) --------
+                    val now = System.nanoTime()
+
+                    // -------- Drift correction --------
+                    // Resampler PI loop on depth, every route (not while time-stretching)
+                    if (!growing && !compress && !sync) resampler.trackDepth(buffer.size().toDouble(), targetFrames.toDouble())
+
+                    // -------- Stats (every 1s) --------
                     if (now - lastStatsNs > 1_000_000_000L) {
-                        val total = okWindow + fecWindow + lateWindow
+                        val total = okWindow + fecWindow + dredWindow + lateWindow
                         val lateRate = if (total == 0) 0.0 else lateWindow.toDouble() / total.toDouble()
                         val bufSize = buffer.size()
 
-                        if (!btMode) {
-                            if (lateRate > 0.02) targetFrames = (targetFrames + 1).coerceAtMost(maxFrames)
-
-                            if (lateRate < 0.003 && bufSize > targetFrames + 3) {
-                                targetFrames = (targetFrames - 1).coerceAtLeast(minFrames)
-                            }
-
-                            val e = bufSize - targetFrames
-                            driftScore += e
-                            if (abs(driftScore) > driftThreshold) {
-                                targetFrames = (targetFrames + if (driftScore < 0) 1 else -1)
-                                    .coerceIn(minFrames, maxFrames)
-                                driftScore = 0
-                            }
-                        } else {
-                            targetFrames = btTargetFrames
-                            driftScore = 0
+                        // Clock or sink measured late (or a new route): switch to synchronous playout
+                        val nextSeq = expectedSeq
+                        if (!sync && syncEnabled && nextSeq != null && (!btMode || sinkCushionFrames >= 0) &&
+                            syncErrorNs(nextSeq, track) != null) {
+                            sync = true
+                            growing = false
+                            draining = false
+                            btDraining = false
+                            Log.i("AudioPlayer", "Synchronous playout from seq $nextSeq (bt=$btMode)")
                         }
 
+                        // Guest share of glass-to-glass: buffered frames + the AudioTrack's own buffer
+                        val cpuNs = Debug.threadCpuTimeNanos()
+                        val audioMs = playedWindow * profile.frameMs
+                        val cpuPerSecMs = if (audioMs > 0) (cpuNs - lastCpuNs) / 1e6 * 1000.0 / audioMs else 0.0
+                        lastCpuNs = cpuNs
+                        playedWindow = 0
+                        // Measured write-to-heard latency once known, else the track buffer's size
+                        val sinkValid = sinkLatency.estimate(sinkStats)
+                        val trackMs = if (sinkValid) sinkStats[1] / 1e6
+                                      else track.bufferSizeInFrames * 1000.0 / AudioStreamConstants.SAMPLE_RATE
                         Log.d(
                             "AudioPlayer",
-                            "buf=$bufSize target=$targetFrames lateRate=${"%.3f".format(lateRate)} ok=$okWindow fec=$fecWindow plc=$lateWindow bt=$btMode draining=$btDraining drops1s=$btDropsThisSecond"
+                            "frame=${profile.frameMs}ms lowDelay=${profile.lowDelay} " +
+                                    "buf=$bufSize target=$targetFrames lateRate=${"%.3f".format(lateRate)} ok=$okWindow fec=$fecWindow dred=$dredWindow plc=$lateWindow " +
+                                    "jitterMs=${"%.1f".format(delayController.jitterMs())} qDelayMs=${"%.0f".format(delayController.quantileDelayMs())} " +
+                                    "bt=$btMode draining=${if (btMode) btDraining else draining} growing=$growing stretched=${stretcher.stretchedFrames()} " +
+                                    "ppm=${"%.0f".format(resampler.ppm())} " +
+                                    "guestDelayMs=${"%.0f".format(bufSize * profile.frameMs + trackMs)} " +
+                                    "cpuPerSec=${"%.1f".format(cpuPerSecMs)}ms " +
+                                    "sync=$sync syncErrMs=${"%.2f".format(syncErrNs / 1e6)} syncDrops=$syncDrops syncPads=$syncPads " +
+                                    "sinkMs=${if (sinkValid) "%.1f".format(sinkStats[1] / 1e6) else "?"} " +
+                                    "sinkSpreadMs=${"%.1f".format(sinkStats[2] / 1e6)} sinkRoutes=${sinkStats[4]}"
+                        )
+
+                        pendingReport = intArrayOf(
+                            bufSize, okWindow, fecWindow, lateWindow,
+                            (delayController.jitterMs() * 10).toInt(), dredWindow
                         )
 
                         okWindow = 0
                         fecWindow = 0
+                        dredWindow = 0
                         lateWindow = 0
+                        syncDrops = 0
+                        syncPads = 0
                         lastStatsNs = now
                     }
                 }
@@ -420,16 +740,23 @@ class AudioReceiver(
         // Wake playout if it's blocked on rxSignal
         synchronized(rxSignal) { rxSignal.notifyAll() }
 
-        try { rxThread?.join(500) } catch (_: Exception) {}
-        try { playoutThread?.join(500) } catch (_: Exception) {}
+        // Both loops notice within one poll or blocking write (<= 250 ms), and the native
+        // objects freed below are theirs until they exit: wait for them, however long
+        joinFully(rxThread)
+        joinFully(playoutThread)
 
         rxThread = null
         playoutThread = null
         udpSocket = null
 
-        buffer.clear()
-
+        // configure() builds a fresh set for the next session's profile
+        try { if (::buffer.isInitialized) buffer.destroy() } catch (_: Exception) {}
+        try { if (::delayController.isInitialized) delayController.destroy() } catch (_: Exception) {}
+        try { if (::stretcher.isInitialized) stretcher.destroy() } catch (_: Exception) {}
+        try { if (::resampler.isInitialized) resampler.destroy() } catch (_: Exception) {}
         try { if (::decoder.isInitialized) decoder.close() } catch (_: Exception) {}
+        try { if (::hostClock.isInitialized) hostClock.destroy() } catch (_: Exception) {}
+        try { if (::sinkLatency.isInitialized) sinkLatency.destroy() } catch (_: Exception) {}
     }
 
     fun pause() {
@@ -442,6 +769,11 @@ class AudioReceiver(
         _isPlayingState.tryEmit(true)
     }
 
+    /** Plays silence while the host has this guest paused; reception and sync carry on. */
+    fun setHostMuted(muted: Boolean) {
+        hostMuted = muted
+    }
+
     private fun buildAudioTrack(): AudioTrack {
         val sampleRate = AudioStreamConstants.SAMPLE_RATE
         val channelMask = AudioStreamConstants.CHANNEL_MASK_OUT
@@ -450,10 +782,10 @@ class AudioReceiver(
         val minOut = AudioTrack.getMinBufferSize(sampleRate, channelMask, encoding)
         require(minOut > 0) { "Invalid AudioTrack min buffer: $minOut" }
 
-        val frameBytes = AudioStreamConstants.PCM_FRAME_BYTES
+        val frameBytes = profile.pcmFrameBytes
 
-        // 2–4 frames keeps latency low. 10 frames is usually too much.
-        val desiredFrames = 4
+        // ~80 ms (20 ms in low delay) keeps latency low; the device minimum still wins
+        val desiredFrames = profile.framesFor(if (profile.lowDelay) 20.0 else 80.0)
         val desiredBytes = frameBytes * desiredFrames
 
         var bufSize = maxOf(minOut, desiredBytes)
@@ -488,7 +820,7 @@ class AudioReceiver(
     private fun writeFixed(
         track: AudioTrack,
         data: ShortArray,
-        frameShorts: Int = AudioStreamConstants.SAMPLES_PER_PACKET,
+        frameShorts: Int = profile.samplesPerPacket,
     ) {
         val out = if (data.size >= frameShorts) data else {
             java.util.Arrays.fill(padBuf, 0.toShort())
@@ -496,7 +828,11 @@ class AudioReceiver(
             padBuf
         }
 
-        if (isPaused) {
+        writtenFrames += frameShorts / AudioStreamConstants.CHANNELS
+
+        if (isPaused || hostMuted) {
+            // padBuf may still hold the tail of a short frame
+            java.util.Arrays.fill(padBuf, 0, frameShorts, 0.toShort())
             track.write(padBuf, 0, frameShorts, AudioTrack.WRITE_BLOCKING)
             return
         }
@@ -504,92 +840,77 @@ class AudioReceiver(
         track.write(out, 0, frameShorts, AudioTrack.WRITE_BLOCKING)
     }
 
-    private fun applyDriftCorrection(track: AudioTrack, bufSize: Int, target: Int) {
+    /** Writes [ns] of silence (at most [syncMaxPadNs]) ahead of the next frame. */
+    private fun writeSilence(track: AudioTrack, ns: Long) {
+        var shorts = (minOf(ns, syncMaxPadNs) * AudioStreamConstants.SAMPLE_RATE / 1_000_000_000L).toInt() *
+            AudioStreamConstants.CHANNELS
+        while (shorts > 0) {
+            val n = minOf(shorts, silenceBuf.size)
+            val written = track.write(silenceBuf, 0, n, AudioTrack.WRITE_BLOCKING)
+            if (written <= 0) return
+            writtenFrames += written / AudioStreamConstants.CHANNELS
+            shorts -= written
+        }
+    }
 
-        val error = (bufSize - target).coerceIn(-6, 6)
-        val speed = (1.0f + error * 0.0025f).coerceIn(0.985f, 1.015f)
+    /**
+     * How late the next sample written to the track would be heard relative to frame
+     * [seq]'s due time (host pts + sync delay): > 0 late, < 0 early. Null while the host
+     * clock or the stream timeline is unknown. Playout thread only.
+     */
+    private fun syncErrorNs(seq: Int, track: AudioTrack): Long? {
+        val due = hostClock.presentationNs(seq, profile.ptsTicks, syncDelayNs)
+        if (due == OpusNative.HostClock.NO_TIME) return null
+        return playsAtNs(track) - due
+    }
 
-        try {
-            val pp = track.playbackParams
-            if (abs(pp.speed - speed) > 0.001f) {
-                track.playbackParams = pp.setSpeed(speed).setPitch(1.0f)
-            }
-        } catch (_: Exception) {
-            // ignore
-        }
+    // Feeds the sink latency model a timestamp every trackTsEveryNs. Playout thread.
+    private fun pollSink(track: AudioTrack) {
+        val now = System.nanoTime()
+        if (now - trackTsCheckedNs < trackTsEveryNs) return
+        trackTsCheckedNs = now
+        val ok = try { track.getTimestamp(trackTs) } catch (_: Exception) { false }
+        if (!ok) return
+        haveTrackTs = true
+        sinkLatency.update(trackTs.framePosition, trackTs.nanoTime, writtenFrames, now)
+        sinkCushionFrames = if (sinkLatency.estimate(sinkStats)) {
+            profile.framesFor(sinkStats[2] / 1e6 + sinkMarginMs)
+        } else -1
+    }
+
+    // When the next written sample reaches the speaker
+    private fun playsAtNs(track: AudioTrack): Long {
+        val now = System.nanoTime()
+        if (haveTrackTs) return sinkLatency.playsAtNs(writtenFrames, now)
+        val head = (track.playbackHeadPosition.toLong() and 0xFFFFFFFFL)
+        return now + (writtenFrames - head).coerceAtLeast(0L) * 1_000_000_000L / AudioStreamConstants.SAMPLE_RATE
+    }
+
+    // After play() from scratch or a flush: positions restart at zero
+    private fun resetTrackClock() {
+        writtenFrames = 0L
+        haveTrackTs = false
+        trackTsCheckedNs = 0L
+        sinkLatency.reset()
     }
 
     private fun isBluetoothOutputActive(): Boolean {
         val am = context.getSystemService(Context.AUDIO_SERVICE) as AudioManager
         val outs = am.getDevices(AudioManager.GET_DEVICES_OUTPUTS)
-        return outs.any {
-            it.type == AudioDeviceInfo.TYPE_BLUETOOTH_A2DP ||
-                    it.type == AudioDeviceInfo.TYPE_BLUETOOTH_SCO ||
-                    it.type == AudioDeviceInfo.TYPE_BLE_HEADSET ||
-                    it.type == AudioDeviceInfo.TYPE_BLE_SPEAKER
-        }
+        return outs.any { isBluetooth(it) }
     }
 
+    private fun isBluetooth(device: AudioDeviceInfo): Boolean =
+        device.type == AudioDeviceInfo.TYPE_BLUETOOTH_A2DP ||
+                device.type == AudioDeviceInfo.TYPE_BLUETOOTH_SCO ||
+                device.type == AudioDeviceInfo.TYPE_BLE_HEADSET ||
+                device.type == AudioDeviceInfo.TYPE_BLE_SPEAKER
+
     private fun safeStopTrack(track: AudioTrack) {
+        try { track.removeOnRoutingChangedListener(routingListener) } catch (_: Exception) {}
         try { track.pause() } catch (_: Exception) {}
         try { track.flush() } catch (_: Exception) {}
         try { track.stop() } catch (_: Exception) {}
         try { track.release() } catch (_: Exception) {}
     }
 }
-
-class JitterBuffer(private val maxFrames: Int = 2048) {
-    private val map = java.util.TreeMap<Int, ByteArray>()
-    private val lock = Object()
-
-    fun put(payload: ByteArray, seq: Int) {
-        synchronized(lock) {
-            if (map.size >= maxFrames) map.pollFirstEntry()
-            map[seq] = payload
-            lock.notifyAll()
-        }
-    }
-
-    fun pop(seq: Int): ByteArray? = synchronized(lock) { map.remove(seq) }
-
-    fun peek(seq: Int): ByteArray? = synchronized(lock) { map[seq] }
-
-    fun firstSeq(): Int? = synchronized(lock) { map.firstKeyOrNull() }
-
-    fun size(): Int = synchronized(lock) { map.size }
-
-    fun clear() = synchronized(lock) { map.clear() }
-
-    fun dropOlderThan(seqInclusive: Int) {
-        synchronized(lock) {
-            while (true) {
-                val first = map.firstKeyOrNull() ?: break
-                if (first < seqInclusive) map.pollFirstEntry() else break
-            }
-        }
-    }
-
-    fun waitForSeq(seq: Int, waitMs: Long) {
-        val end = System.currentTimeMillis() + waitMs
-        synchronized(lock) {
-            while (!map.containsKey(seq)) {
-                val remaining = end - System.currentTimeMillis()
-                if (remaining <= 0) break
-                try { lock.wait(remaining) }
-                catch (e: InterruptedException) { Thread.currentThread().interrupt(); break }
-            }
-        }
-    }
-
-    fun waitForData(waitMs: Long) {
-        synchronized(lock) {
-            if (map.isEmpty()) {
-                try { lock.wait(waitMs) }
-                catch (e: InterruptedException) { Thread.currentThread().interrupt() }
-            }
-        }
-    }
-
-    private fun <K, V> java.util.TreeMap<K, V>.firstKeyOrNull(): K? =
-        if (this.isEmpty()) null else this.firstKey()
-}
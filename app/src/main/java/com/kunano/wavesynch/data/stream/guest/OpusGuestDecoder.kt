@@ -3,22 +3,26 @@ package com.kunano.wavesynch.data.stream.guest
 import android.util.Log
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
 import com.kunano.wavesynch.data.stream.OpusNative
+import com.kunano.wavesynch.data.stream.StreamProfile
 
+/** Decodes the session's frames ([profile] frame duration) into one reused buffer. */
 class OpusGuestDecoder(
+    profile: StreamProfile = StreamProfile.DEFAULT,
     sampleRate: Int = AudioStreamConstants.SAMPLE_RATE,
     channels: Int = AudioStreamConstants.CHANNELS,
 ) {
     private val decoder = OpusNative.Decoder(sampleRate, channels)
+    private val frameSize = profile.samplesPerChannel
 
     // Reused output buffer: ONE allocation total.
-    private val outPcm = ShortArray(AudioStreamConstants.SAMPLES_PER_PACKET)
+    private val outPcm = ShortArray(profile.samplesPerPacket)
 
     /**
      * Decode normal frame into reused buffer.
      * Returns the same outPcm reference every time.
      */
     fun decode(p: ByteArray): ShortArray {
-        decoder.decodeInto(p, AudioStreamConstants.SAMPLES_PER_CHANNEL, outPcm)
+        decoder.decodeInto(p, frameSize, outPcm)
         return outPcm
     }
 
@@ -27,16 +31,53 @@ class OpusGuestDecoder(
      * Returns the same outPcm reference every time.
      */
     fun decodeWithFEC(nextPacket: ByteArray): ShortArray {
-        decoder.decodeFecInto(nextPacket, AudioStreamConstants.SAMPLES_PER_CHANNEL, outPcm)
+        decoder.decodeFecInto(nextPacket, frameSize, outPcm)
         return outPcm
     }
 
+    /**
+     * Decode frame [seq] straight from the native jitter buffer (consumes it).
+     * Returns outPcm, or null if seq is not buffered / undecodable.
+     */
+    fun decodeFrom(buffer: OpusNative.JitterBuffer, seq: Int): ShortArray? {
+        val n = decoder.decodeFromBufferInto(buffer, seq, frameSize, outPcm)
+        return if (n >= 0) outPcm else null
+    }
+
+    /**
+     * Recover frame [nextSeq] - 1 from the FEC data of buffered packet [nextSeq] (left in place).
+     * Returns outPcm, or null if nextSeq is not buffered / undecodable.
+     */
+    fun decodeFecFrom(buffer: OpusNative.JitterBuffer, nextSeq: Int): ShortArray? {
+        val n = decoder.decodeFecFromBufferInto(buffer, nextSeq, frameSize, outPcm)
+        return if (n >= 0) outPcm else null
+    }
+
+    /**
+     * Turns on Deep REDundancy recovery with the DNN weights in [blob] (must outlive this
+     * decoder). Returns false if this libopus has no DRED.
+     */
+    fun enableDred(blob: OpusNative.DnnBlob): Boolean {
+        val rc = decoder.enableDred(blob)
+        if (rc != 0) Log.i("OpusJNI", "DRED recovery off (rc=$rc)")
+        return rc == 0
+    }
+
+    /**
+     * Rebuild lost frame [seq] from the DRED of the first packet buffered after it (left in place).
+     * Returns outPcm, or null if DRED is off or no buffered packet reaches back to seq.
+     */
+    fun decodeDredFrom(buffer: OpusNative.JitterBuffer, seq: Int): ShortArray? {
+        val n = decoder.decodeDredFromBufferInto(buffer, seq, frameSize, outPcm)
+        return if (n >= 0) outPcm else null
+    }
+
     /**
      * PLC (concealment) into reused buffer.
      * Returns the same outPcm reference every time.
      */
     fun decodeWithPLC(): ShortArray {
-        decoder.decodePlcInto(AudioStreamConstants.SAMPLES_PER_CHANNEL, outPcm)
+        decoder.decodePlcInto(frameSize, outPcm)
         return outPcm
     }
 
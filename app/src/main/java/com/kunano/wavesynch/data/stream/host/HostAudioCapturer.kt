@@ -10,6 +10,10 @@ import android.os.Process
 import androidx.annotation.RequiresPermission
 import com.google.firebase.crashlytics.FirebaseCrashlytics
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
+import com.kunano.wavesynch.data.stream.OpusNative
+import com.kunano.wavesynch.data.stream.joinFully
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 
 class HostAudioCapturer(
     private val mediaProjection: MediaProjection,
@@ -20,13 +24,9 @@ class HostAudioCapturer(
     private var captureThread: Thread? = null
     @Volatile private var isCapturing = false
 
-    private val frameShorts: Int =
-        AudioStreamConstants.SAMPLES_PER_CHANNEL * AudioStreamConstants.CHANNELS
-
     @RequiresPermission(Manifest.permission.RECORD_AUDIO)
     fun start(
-        pool: PcmFramePool,
-        queue: PcmFrameQueue,
+        pipeline: OpusNative.HostPipeline,
     ) {
         if (isCapturing) return
 
@@ -57,42 +57,25 @@ class HostAudioCapturer(
 
         audioRecord = recorder
 
-        val readBuf = ShortArray(maxOf(frameShorts * 2, 2048))
-        val assembler = ShortFrameAssembler(frameShorts)
+        // Direct so the native side reads it in place; frames are cut natively at the
+        // session's size (StreamProfile), so reads need not line up with them
+        val readBuf = ByteBuffer.allocateDirect(READ_BYTES).order(ByteOrder.nativeOrder())
 
         isCapturing = true
 
         captureThread = Thread {
             Process.setThreadPriority(Process.THREAD_PRIORITY_URGENT_AUDIO)
-
-            var seq = 0
             try {
                 recorder.startRecording()
 
                 while (isCapturing && !Thread.currentThread().isInterrupted) {
-                    val readCount = recorder.read(readBuf, 0, readBuf.size)
+                    val readBytes = recorder.read(readBuf, READ_BYTES)
                     if (!isCapturing) break
-                    if (readCount <= 0) continue
-
-                    assembler.push(readBuf, readCount) { frameView ->
-                        if (!isCapturing) return@push
-
-                        val f = pool.acquire() ?: return@push // pool exhausted -> drop
-
-                        // Copy into pooled frame storage
-                        // IMPORTANT: use f.shorts.size (source of truth)
-                        System.arraycopy(frameView, 0, f.shorts, 0, f.shorts.size)
+                    if (readBytes <= 0) continue
 
-                        f.seq = seq
-                        f.tsMs = (System.nanoTime() / 1_000_000L).toInt()
-                        seq++
-
-                        // Enqueue; if full, drop oldest and return it to pool
-                        val dropped = queue.offerDropOldest(f)
-                        if (dropped != null) {
-                            pool.release(dropped)
-                        }
-                    }
+                    // Assembled straight into native ring slots; if the send thread is a
+                    // whole ring behind, the oldest frame is overwritten
+                    pipeline.push(readBuf, readBytes)
                 }
             } catch (t: Throwable) {
                 crashlytics.setCustomKey("captureThread", "HostAudioCapturer")
@@ -110,39 +93,22 @@ class HostAudioCapturer(
         // Unblock AudioRecord.read()
         try { audioRecord?.stop() } catch (_: Throwable) {}
 
+        // The thread may be inside pipeline.push(): the pipeline is freed only after this
         captureThread?.interrupt()
-        try { captureThread?.join(500) } catch (_: Throwable) {}
+        joinFully(captureThread)
         captureThread = null
 
         try { audioRecord?.release() } catch (_: Throwable) {}
         audioRecord = null
 
-        // No queue.wakeAll() in ABQ design; sender unblocks via interrupt()
+        // The native send thread is stopped by HostStreamer.stopStreaming
 
         try { mediaProjection.stop() } catch (_: Throwable) {}
     }
-}
 
-/**
- * Assembles arbitrary short chunks into fixed frames.
- * It passes an internal buffer to onFrame; caller must copy.
- */
-class ShortFrameAssembler(private val frameShorts: Int) {
-    private val buf = ShortArray(frameShorts)
-    private var filled = 0
-
-    fun push(input: ShortArray, length: Int, onFrame: (ShortArray) -> Unit) {
-        var offset = 0
-        while (offset < length) {
-            val toCopy = minOf(frameShorts - filled, length - offset)
-            System.arraycopy(input, offset, buf, filled, toCopy)
-            filled += toCopy
-            offset += toCopy
-
-            if (filled == frameShorts) {
-                onFrame(buf)
-                filled = 0
-            }
-        }
+    private companion object {
+        // 4096 stereo 16-bit samples: several frames at any profile
+        const val READ_BYTES = 16 * 1024
     }
 }
+
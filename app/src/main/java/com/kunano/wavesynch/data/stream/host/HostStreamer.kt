@@ -1,135 +1,270 @@
 package com.kunano.wavesynch.data.stream.host
 
 import android.Manifest
+import android.content.Context
 import android.os.Process
 import android.util.Log
 import androidx.annotation.RequiresPermission
 import com.google.firebase.crashlytics.FirebaseCrashlytics
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
-import com.kunano.wavesynch.data.stream.PacketCodec
+import com.kunano.wavesynch.data.stream.DnnWeights
+import com.kunano.wavesynch.data.stream.OpusNative
+import com.kunano.wavesynch.data.stream.StreamProfile
 import com.kunano.wavesynch.data.stream.guest.GuestStreamingData
+import com.kunano.wavesynch.data.stream.joinFully
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
-import java.net.DatagramPacket
-import java.net.DatagramSocket
+import java.net.Inet4Address
+import java.net.InetAddress
 import java.net.InetSocketAddress
 import java.util.concurrent.atomic.AtomicBoolean
 
-class HostStreamer {
+class HostStreamer(
+    private val context: Context,
+) {
+
+    init { DnnWeights.preload(context) }
 
     private val lock = Any()
     private val guests = HashMap<String, GuestStreamingData>()
 
-    private var udpSocket: DatagramSocket? = null
-    private var encoder: OpusHostEncoder? = null
+    // Native capture -> encode -> send pipeline; one per streaming session
+    private var pipeline: OpusNative.HostPipeline? = null
 
-    private var sendThread: Thread? = null
-    private val running = AtomicBoolean(false)
+    // Guest ids per native target index (guests sharing a group address share a target),
+    // tagged with the generation passed to setTargets: the pipeline reports its send errors
+    // against the set it has applied, which lags the one staged here by up to a frame
+    private var targetIds: List<String> = emptyList()
+    private var targetGeneration = 0L
+
+    // Interface for multicast/broadcast targets; applied to the pipeline with the targets
+    private var groupInterface: InetAddress? = null
+    private var appliedInterface: InetAddress? = null
 
-    private val mtuBytes = 1500
-    private val outPkt = ByteArray(mtuBytes)
-    val pool: PcmFramePool = PcmFramePool(
-    frameShorts = AudioStreamConstants.SAMPLES_PER_PACKET,
-    poolSize = 32
-    )
-    val queue: PcmFrameQueue = PcmFrameQueue(capacity = 16)
+    // Tier-0 transport FEC (scheme, k, m). Once guest receiver reports arrive, the
+    // native rate controller takes FEC over.
+    private var fecConfig = intArrayOf(AudioStreamConstants.FEC_OFF, 0, 0)
+
+    // Frames per datagram: aggregated in low-overhead mode, or once enough guests share the
+    // air; low-delay sessions only when asked for
+    private var lowOverhead = false
+    private var lowDelay = false
+    private var appliedAggregation = 1
+
+    private var statsThread: Thread? = null
+    private val running = AtomicBoolean(false)
 
     private val _isHostStreamingFlow = MutableStateFlow(false)
     val isHostStreamingFlow: StateFlow<Boolean> = _isHostStreamingFlow
 
     fun addGuest(id: String, inetSocketAddress: InetSocketAddress) = synchronized(lock) {
         guests[id] = GuestStreamingData(id, inetSocketAddress, isPlaying = true)
+        applyTargets()
+    }
+
+    fun pauseGuest(id: String) = synchronized(lock) { guests[id]?.isPlaying = false; applyTargets() }
+    fun resumeGuest(id: String) = synchronized(lock) { guests[id]?.isPlaying = true; applyTargets() }
+    fun removeGuest(id: String) = synchronized(lock) { guests.remove(id).also { applyTargets() } }
+    fun removeAllGuests() = synchronized(lock) { guests.clear(); applyTargets() }
+
+    fun setTransportFec(scheme: Int, k: Int = 0, m: Int = 0) = synchronized(lock) {
+        fecConfig = intArrayOf(scheme, k, m)
+        pipeline?.setFec(scheme, k, m)
+    }
+
+    fun setLowOverhead(enabled: Boolean) = synchronized(lock) {
+        lowOverhead = enabled
+        applyAggregation()
     }
 
-    fun pauseGuest(id: String) = synchronized(lock) { guests[id]?.isPlaying = false }
-    fun resumeGuest(id: String) = synchronized(lock) { guests[id]?.isPlaying = true }
-    fun removeGuest(id: String) = synchronized(lock) { guests.remove(id) }
-    fun removeAllGuests() = synchronized(lock) { guests.clear() }
+    fun setGroupInterface(address: InetAddress?) = synchronized(lock) {
+        if (address != groupInterface) {
+            groupInterface = address
+            applyTargets()
+        }
+    }
 
+    // Under lock. The pipeline stages the set and its send thread picks it up at the next frame.
+    private fun applyTargets() {
+        val p = pipeline ?: return
+        val v4 = groupInterface as? Inet4Address
+        if (v4 != null && v4 != appliedInterface) {
+            if (!p.setGroupInterface(v4)) Log.e("HostStreamer", "Group delivery unavailable on $v4")
+            appliedInterface = v4
+        }
+        // A paused group guest keeps receiving while others in its group play; the host's
+        // PausedByHost answer mutes it
+        val byTarget = guests.values.filter { it.isPlaying }.groupBy { it.inetSocketAddress }
+        targetGeneration++
+        if (!p.setTargets(byTarget.keys.toList(), targetGeneration)) {
+            Log.e("HostStreamer", "Invalid guest address in target set")
+        }
+        targetIds = byTarget.values.map { group -> group.joinToString(",") { it.id } }
+        applyAggregation()
+    }
 
+    // Under lock
+    private fun applyAggregation() {
+        val p = pipeline ?: return
+        val playing = guests.values.count { it.isPlaying }
+        val crowded = !lowDelay && playing >= AudioStreamConstants.AGGREGATE_MIN_GUESTS
+        val frames = if (lowOverhead || crowded) AudioStreamConstants.AGGREGATE_FRAMES else 1
+        if (frames != appliedAggregation) {
+            p.setAggregation(frames)
+            appliedAggregation = frames
+        }
+    }
 
     @RequiresPermission(Manifest.permission.RECORD_AUDIO)
     fun startStreaming(
         capturer: HostAudioCapturer,
+        profile: StreamProfile = StreamProfile.DEFAULT,
     ) {
         if (running.getAndSet(true)) return
+
+        // Streaming only counts as started once the pipeline is up and capture runs
+        val p = try {
+            // Disk I/O on first use: never under the lock addGuest() and friends take
+            buildPipeline(profile, DnnWeights.blob(context))
+        } catch (t: Throwable) {
+            running.set(false)
+            throw t
+        }
+
+        // Producer: the capture thread pushes raw chunks; assembly, encoding and sending are native
+        try {
+            capturer.start(p)
+        } catch (t: Throwable) {
+            releasePipeline()
+            running.set(false)
+            throw t
+        }
         _isHostStreamingFlow.tryEmit(true)
 
+        statsThread = Thread { statsLoop(p, profile) }.apply { start() }
+    }
+
+    private fun buildPipeline(profile: StreamProfile, dnnBlob: OpusNative.DnnBlob?): OpusNative.HostPipeline =
         synchronized(lock) {
-            if (udpSocket == null || udpSocket?.isClosed == true) {
-                udpSocket = DatagramSocket().apply { reuseAddress = true }
+            val tiers = AudioStreamConstants.SIMULCAST_BITRATES.size
+            // Tier 0 starts from the manual setting; the lower tiers keep their fixed parity
+            val fec = IntArray(tiers * 3) { i ->
+                if (i < 3) fecConfig[i] else AudioStreamConstants.SIMULCAST_FEC[i / 3][i % 3]
+            }
+            OpusNative.HostPipeline(
+                sampleRate = AudioStreamConstants.SAMPLE_RATE,
+                channels = AudioStreamConstants.CHANNELS,
+                frameSize = profile.samplesPerChannel,
+                application = profile.application,
+                complexity = AudioStreamConstants.HOST_SPOT_COMPLEXITY,
+                minComplexity = AudioStreamConstants.MIN_ENCODE_COMPLEXITY,
+                maxComplexity = AudioStreamConstants.MAX_ENCODE_COMPLEXITY,
+                encodeShare = AudioStreamConstants.ENCODE_TARGET_SHARE,
+                bitrates = AudioStreamConstants.SIMULCAST_BITRATES,
+                budgetUs = (profile.frameUs * AudioStreamConstants.SIMULCAST_BUDGET_SHARE).toInt(),
+                fec = fec,
+                // Capture-side buffering is set in time, so short frames get proportionally more slots
+                ringFrames = profile.framesFor(QUEUE_MS),
+                retransmitFrames = profile.framesFor(AudioStreamConstants.RETRANSMIT_MS),
+                port = AudioStreamConstants.UDP_PORT,
+                minBitrate = AudioStreamConstants.MIN_STEREO_BITRATE,
+                maxBitrate = AudioStreamConstants.STEREO_BITRATE,
+                dnnBlob = dnnBlob,
+                dredMs = AudioStreamConstants.DRED_MS,
+            ).also {
+                lowDelay = profile.lowDelay
+                appliedAggregation = 1
+                if (!it.retransmitEnabled()) {
+                    Log.w("HostStreamer", "Retransmission unavailable (port ${AudioStreamConstants.UDP_PORT} busy?)")
+                } else if (!it.rateControlEnabled()) {
+                    Log.w("HostStreamer", "Rate control unavailable")
+                }
+                pipeline = it
+                appliedInterface = null
+                applyTargets()
+                it.start()
             }
-            if (encoder == null) encoder = OpusHostEncoder()
         }
 
-        // Producer: capture thread writes into queue (your capturer must use pool+queue now)
-        capturer.start(pool, queue)
-
-        // Consumer: send thread reads from queue
-        sendThread = Thread {
-            Process.setThreadPriority(Process.THREAD_PRIORITY_URGENT_AUDIO)
-            val crashlytics = FirebaseCrashlytics.getInstance()
-
-            try {
-                while (running.get() && !Thread.currentThread().isInterrupted) {
-                    // Blocking take; returns null if interrupted
-                    val frame = queue.takeBlocking() ?: break
-
-                    val sock: DatagramSocket?
-                    val enc: OpusHostEncoder?
-                    val targets: Array<InetSocketAddress>
-
-                    synchronized(lock) {
-                        sock = udpSocket
-                        enc = encoder
-                        targets = guests.values
-                            .asSequence()
-                            .filter { it.isPlaying }
-                            .map { it.inetSocketAddress }
-                            .toList()
-                            .toTypedArray()
-                    }
-
-                    if (sock == null || sock.isClosed || enc == null) {
-                        pool.release(frame)
-                        continue
-                    }
-
-                    if (targets.isEmpty()) {
-                        pool.release(frame)
-                        continue
-                    }
-
-                    val opus = enc.encodeInto(frame.shorts)
-
-                    val packetLen = PacketCodec.writeInto(
-                        out = outPkt,
-                        seq = frame.seq,
-                        tsMs = frame.tsMs,
-                        payload = opus.buf,
-                        payloadLen = opus.len
-                    )
+    // Joins the native send and NACK threads, then frees encoder, socket and ring. Only
+    // once no Kotlin thread can still be inside push() or stats().
+    private fun releasePipeline() = synchronized(lock) {
+        try { pipeline?.stop() } catch (_: Throwable) {}
+        try { pipeline?.destroy() } catch (_: Throwable) {}
+        pipeline = null
+        targetIds = emptyList()
+    }
 
-                    // Return frame to pool ASAP
-                    pool.release(frame)
+    // Off the hot path: surfaces send errors, rate decisions and stage timings
+    private fun statsLoop(p: OpusNative.HostPipeline, profile: StreamProfile): Unit = with(OpusNative.HostPipeline) {
+        Process.setThreadPriority(Process.THREAD_PRIORITY_BACKGROUND)
+        val crashlytics = FirebaseCrashlytics.getInstance()
+        val stats = LongArray(STATS_SIZE)
+        var sendErrors = IntArray(0)
+        var decisions = 0L
+        var lastLogNs = System.nanoTime()
+        var lastPackets = 0L
 
-                    if (packetLen <= 0) continue
+        try {
+            while (running.get()) {
+                Thread.sleep(STATS_EVERY_MS)
+                val (ids, generation) = synchronized(lock) { targetIds to targetGeneration }
+                if (sendErrors.size < ids.size) sendErrors = IntArray(ids.size)
+                // Errors against a set staged over since are indexed differently: drop them
+                val failed = p.stats(stats, sendErrors)
+                    .takeIf { stats[STAT_ERROR_GENERATION] == generation } ?: 0
+                for (i in 0 until minOf(failed, ids.size)) {
+                    if (sendErrors[i] == 0) continue
+                    val msg = "UDP send error guest=${ids[i]} errno=${sendErrors[i]}"
+                    crashlytics.log(msg)
+                    Log.e("HostStreamer", msg)
+                }
+
+                // Receiver reports moved the rate controller
+                if (stats[STAT_RATE_DECISIONS] != decisions) {
+                    decisions = stats[STAT_RATE_DECISIONS]
+                    Log.d(
+                        "HostStreamer",
+                        "Rate control: bitrate=${stats[STAT_RATE_BITRATE]} loss=${stats[STAT_RATE_LOSS_PERCENT]}% " +
+                            "fec=${stats[STAT_RATE_FEC_SCHEME]}(${stats[STAT_RATE_FEC_K]},${stats[STAT_RATE_FEC_M]})"
+                    )
+                }
 
-                    for (addr in targets) {
-                        try {
-                            sock.send(DatagramPacket(outPkt, packetLen, addr))
-                        } catch (ex: Exception) {
-                            crashlytics.recordException(ex)
-                            Log.e("HostStreamer", "UDP send error", ex)
-                        }
-                    }
+                val now = System.nanoTime()
+                if (now - lastLogNs > 10_000_000_000L) {
+                    val packetsPerSec = (stats[STAT_PACKETS] - lastPackets) * 1_000_000_000L / (now - lastLogNs)
+                    lastPackets = stats[STAT_PACKETS]
+                    lastLogNs = now
+                    val cpuUs = (0 until MAX_TIERS).sumOf { stats[STAT_TIER_CPU_US + it] }
+                    Log.d(
+                        "HostStreamer",
+                        "Pipeline frame=${profile.frameMs}ms lowDelay=${profile.lowDelay} " +
+                            "frames=${stats[STAT_FRAMES]} sent=${stats[STAT_SENT]} ringOverwritten=${stats[STAT_OVERWRITTEN]} " +
+                            "stageUs queue/encode/send=${stats[STAT_QUEUE_US]}/${stats[STAT_ENCODE_US]}/${stats[STAT_SEND_US]} " +
+                            "captureToSend=${stats[STAT_TOTAL_US]}us max=${stats[STAT_MAX_TOTAL_US]}us " +
+                            "tiers=${stats[STAT_ACTIVE_TIERS]}/${AudioStreamConstants.SIMULCAST_BITRATES.size} " +
+                            "wall=${stats[STAT_ENCODE_WALL_US]}us cpuPerSec=${cpuUs * profile.framesPerSecond / 1000}ms " +
+                            "sheds=${stats[STAT_SHEDS]} restores=${stats[STAT_RESTORES]} complexity=${stats[STAT_COMPLEXITY]} " +
+                            "encodeUs p50/p95/p99/max=${stats[STAT_ENCODE_P50_US]}/${stats[STAT_ENCODE_P95_US]}/" +
+                            "${stats[STAT_ENCODE_P99_US]}/${stats[STAT_ENCODE_MAX_US]} " +
+                            "lowers=${stats[STAT_COMPLEXITY_LOWERS]} raises=${stats[STAT_COMPLEXITY_RAISES]}"
+                    )
+                    Log.d(
+                        "HostStreamer",
+                        "NACKs=${stats[STAT_NACKS]} requested=${stats[STAT_NACK_REQUESTED]} resent=${stats[STAT_RESENT]} " +
+                            "evicted=${stats[STAT_RESEND_EVICTED]} rateLimited=${stats[STAT_RESEND_RATE_LIMITED]} reports=${stats[STAT_REPORTS]} " +
+                            "backoffs=${stats[STAT_BACKOFFS]} probes=${stats[STAT_PROBES]} fecChanges=${stats[STAT_FEC_CHANGES]} " +
+                            "tierMoves=${stats[STAT_TIER_MOVES]} clockSyncs=${stats[STAT_CLOCK_REQUESTS]} " +
+                            "packetsPerSec=$packetsPerSec framesPerPacket=${stats[STAT_FRAMES_PER_PACKET]} dredMs=${stats[STAT_DRED_MS]}"
+                    )
                 }
-            } catch (t: Throwable) {
-                crashlytics.setCustomKey("sendThread", "HostStreamer")
-                crashlytics.log("Host send thread error")
-                crashlytics.recordException(t)
             }
-        }.apply { start() }
+        } catch (_: InterruptedException) {
+        } catch (t: Throwable) {
+            crashlytics.setCustomKey("statsThread", "HostStreamer")
+            crashlytics.log("Host stats thread error")
+            crashlytics.recordException(t)
+        }
     }
 
     fun stopStreaming(
@@ -140,24 +275,19 @@ class HostStreamer {
         // Stop producer first
         try { capturer.stop() } catch (_: Throwable) {}
 
-        // Stop consumer: interrupt unblocks take()
-        sendThread?.interrupt()
-        try { sendThread?.join(500) } catch (_: Throwable) {}
-        sendThread = null
+        // Sleeping between polls, so it exits promptly; it may be inside stats() until then
+        statsThread?.interrupt()
+        joinFully(statsThread)
+        statsThread = null
 
-        // Drain leftover frames and return them to pool
-        try {
-            queue.drainAll().forEach { pool.release(it) }
-        } catch (_: Throwable) {}
-
-        synchronized(lock) {
-            try { encoder?.close() } catch (_: Throwable) {}
-            encoder = null
-
-            try { udpSocket?.close() } catch (_: Throwable) {}
-            udpSocket = null
-        }
+        releasePipeline()
 
         _isHostStreamingFlow.tryEmit(false)
     }
+
+    private companion object {
+        // Capture -> send ring depth, in audio time
+        const val QUEUE_MS = 320.0
+        const val STATS_EVERY_MS = 1_000L
+    }
 }
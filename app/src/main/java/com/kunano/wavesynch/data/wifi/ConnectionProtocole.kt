@@ -2,6 +2,12 @@ package com.kunano.wavesynch.data.wifi
 
 class ConnectionProtocol {
     object Protocol  {
-        const val PROTOCOL_VERSION = 1
+        /**
+         * Peers must match exactly: the host refuses any other version. Bump it on every
+         * change to the handshake JSON (unknown keys fail to parse) or to the datagram
+         * formats, and don't keep fallbacks for earlier versions, which never get past the
+         * handshake.
+         */
+        const val PROTOCOL_VERSION = 4
     }
 }
\ No newline at end of file
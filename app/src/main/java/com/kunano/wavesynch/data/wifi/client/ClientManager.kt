@@ -1,11 +1,13 @@
 package com.kunano.wavesynch.data.wifi.client
 
 import android.content.Context
+import android.net.wifi.WifiManager
 import android.os.Build
 import android.util.Log
 import com.kunano.wavesynch.AppIdProvider
 import com.kunano.wavesynch.CrashReporter
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
+import com.kunano.wavesynch.data.stream.StreamProfile
 import com.kunano.wavesynch.data.wifi.ConnectionProtocol
 import com.kunano.wavesynch.data.wifi.server.HandShake
 import com.kunano.wavesynch.data.wifi.server.HandShakeResult
@@ -25,9 +27,11 @@ import java.io.IOException
 import java.io.InputStreamReader
 import java.io.OutputStreamWriter
 import java.net.DatagramSocket
+import java.net.InetAddress
 import java.net.InetSocketAddress
+import java.net.MulticastSocket
+import java.net.NetworkInterface
 import java.net.Socket
-import java.net.SocketException
 import java.net.SocketTimeoutException
 
 class ClientManager(
@@ -54,6 +58,19 @@ class ClientManager(
     var isConnectedToHostServer: Boolean = false
     private var sessionData: SessionData? = null
 
+    // Negotiated in the Success handshake; group modes need the Wi-Fi multicast filter lifted
+    private var deliveryMode = AudioStreamConstants.DELIVERY_UNICAST
+    private var deliveryAddress: String? = null
+    private var multicastLock: WifiManager.MulticastLock? = null
+
+    // Set while the host has paused this guest (PausedByHost / ResumedByHost)
+    private val _hostMuted = MutableStateFlow(false)
+    val hostMuted = _hostMuted.asStateFlow()
+
+    // Frame duration / application of the host's stream, from the Success handshake
+    var streamProfile = StreamProfile.DEFAULT
+        private set
+
     val sessionInfo: SessionData?
         get() = sessionData
 
@@ -70,7 +87,9 @@ class ClientManager(
                     appIdentifier = AppIdProvider.APP_ID,
                     userId = AppIdProvider.getUserId(context),
                     deviceName = Build.MODEL,
-                    protocolVersion = ConnectionProtocol.Protocol.PROTOCOL_VERSION
+                    protocolVersion = ConnectionProtocol.Protocol.PROTOCOL_VERSION,
+                    deliveryModes = SUPPORTED_DELIVERY_MODES,
+                    frameDurations = StreamProfile.ALL_FRAME_DURATIONS
                 )
                 sendHandShake(connectionRequestHandShake)
 
@@ -165,21 +184,44 @@ class ClientManager(
             }
             Log.d(TAG, "Opening UDP socket")
 
-            val newSocket = DatagramSocket(null).apply {
+            val group = deliveryAddress
+                ?.takeIf { deliveryMode == AudioStreamConstants.DELIVERY_MULTICAST }
+                ?.let { InetAddress.getByName(it) }
+            val newSocket = (if (group != null) MulticastSocket(null) else DatagramSocket(null)).apply {
                 reuseAddress = true
                 soTimeout = 0
                 bind(InetSocketAddress(AudioStreamConstants.UDP_PORT))
             }
+            if (newSocket is MulticastSocket && group != null) {
+                // Join on the interface that reaches the host, not the default route
+                val iface = socket?.localAddress?.let { NetworkInterface.getByInetAddress(it) }
+                newSocket.joinGroup(InetSocketAddress(group, 0), iface)
+            }
+            if (deliveryMode != AudioStreamConstants.DELIVERY_UNICAST) acquireMulticastLock()
             _udpSocket.value = newSocket
 
             sendUdpSocketStatus(true)
-        } catch (e: SocketException) {
+        } catch (e: IOException) {
             CrashReporter.set("operation_tag", "open_udp_socket")
             CrashReporter.record(e)
             _udpSocket.value = null // Ensure state is consistent on failure
         }
     }
 
+    private fun acquireMulticastLock() {
+        if (multicastLock?.isHeld == true) return
+        val wifi = context.applicationContext.getSystemService(Context.WIFI_SERVICE) as WifiManager
+        multicastLock = wifi.createMulticastLock(TAG).apply {
+            setReferenceCounted(false)
+            acquire()
+        }
+    }
+
+    private fun releaseMulticastLock() {
+        multicastLock?.let { if (it.isHeld) it.release() }
+        multicastLock = null
+    }
+
     fun sendUdpSocketStatus(isOpen: Boolean) {
         val response =
             if (isOpen) HandShakeResult.UdpSocketOpen().intValue else HandShakeResult.UdpSocketClosed().intValue
@@ -204,9 +246,18 @@ class ClientManager(
                 }
 
                 HandShakeResult.Success().intValue -> {
+                    val profile = StreamProfile.fromHandshake(handShake.frameUs, handShake.lowDelay)
+                    if (profile == null) {
+                        isConnectedToHostServer = false
+                        _handShakeResponseFlow.tryEmit(HandShakeResult.Error("Host sent no usable stream profile"))
+                        return
+                    }
                     _serverConnectionsStateFlow.tryEmit(ServerConnectionState.ConnectedToServer)
                     isConnectedToHostServer = true
                     sessionData = SessionData(handShake.roomName, handShake.deviceName)
+                    deliveryMode = handShake.deliveryMode ?: AudioStreamConstants.DELIVERY_UNICAST
+                    deliveryAddress = handShake.deliveryAddress
+                    streamProfile = profile
                     _handShakeResponseFlow.tryEmit(HandShakeResult.Success(handShake))
                 }
 
@@ -223,6 +274,16 @@ class ClientManager(
                     isConnectedToHostServer = false
                     _handShakeResponseFlow.tryEmit(HandShakeResult.RoomFull(handShake))
                 }
+
+                HandShakeResult.PausedByHost().intValue -> {
+                    _hostMuted.value = true
+                    _handShakeResponseFlow.tryEmit(HandShakeResult.PausedByHost(handShake))
+                }
+
+                HandShakeResult.ResumedByHost().intValue -> {
+                    _hostMuted.value = false
+                    _handShakeResponseFlow.tryEmit(HandShakeResult.ResumedByHost(handShake))
+                }
             }
         }
     }
@@ -239,8 +300,19 @@ class ClientManager(
             socket = null
             sessionData = null
             _udpSocket.value = null
+            deliveryMode = AudioStreamConstants.DELIVERY_UNICAST
+            deliveryAddress = null
+            streamProfile = StreamProfile.DEFAULT
+            _hostMuted.value = false
+            releaseMulticastLock()
             _serverConnectionsStateFlow.tryEmit(ServerConnectionState.Disconnected)
         }
     }
 
+    private companion object {
+        const val SUPPORTED_DELIVERY_MODES =
+            (1 shl AudioStreamConstants.DELIVERY_UNICAST) or
+                (1 shl AudioStreamConstants.DELIVERY_MULTICAST) or
+                (1 shl AudioStreamConstants.DELIVERY_BROADCAST)
+    }
 }
\ No newline at end of file
@@ -12,7 +12,17 @@ data class HandShake(
     val deviceName: String,
     val roomName: String? = null,
     val protocolVersion: Int,
-    var response: Int? = null
+    var response: Int? = null,
+    // Guest -> host: bitmask of supported delivery modes (1 shl DELIVERY_*)
+    val deliveryModes: Int? = null,
+    // Host -> guest (Success only): negotiated mode and its group/broadcast address
+    val deliveryMode: Int? = null,
+    val deliveryAddress: String? = null,
+    // Guest -> host: bitmask of supported frame durations (StreamProfile.FRAME_DURATIONS_US)
+    val frameDurations: Int? = null,
+    // Host -> guest (Success only): session frame duration and low-delay application
+    val frameUs: Int? = null,
+    val lowDelay: Boolean? = null
 )
 
 open class HandShakeResult(val intValue: Int) {
@@ -30,6 +40,10 @@ open class HandShakeResult(val intValue: Int) {
     data class GuestLeftRoom(val handShake: HandShake? = null) : HandShakeResult(12)
     data class RoomFull(val handShake: HandShake? = null) : HandShakeResult(13)
     object None : HandShakeResult(14)
+    // Host -> guest: the host paused or resumed this guest. A guest in a group delivery
+    // mode still receives the group's datagrams, so it mutes itself.
+    data class PausedByHost(val handShake: HandShake? = null) : HandShakeResult(15)
+    data class ResumedByHost(val handShake: HandShake? = null) : HandShakeResult(16)
 }
 
 fun parseHandshake(json: String): HandShake? {
@@ -9,6 +9,7 @@ import androidx.collection.arrayMapOf
 import com.kunano.wavesynch.AppIdProvider
 import com.kunano.wavesynch.CrashReporter
 import com.kunano.wavesynch.data.stream.AudioStreamConstants
+import com.kunano.wavesynch.data.stream.StreamProfile
 import com.kunano.wavesynch.data.wifi.ConnectionProtocol
 import com.kunano.wavesynch.domain.model.Guest
 import com.kunano.wavesynch.domain.model.Room
@@ -29,11 +30,14 @@ import java.io.BufferedWriter
 import java.io.IOException
 import java.io.InputStreamReader
 import java.io.OutputStreamWriter
+import java.net.Inet4Address
 import java.net.InetAddress
+import java.net.NetworkInterface
 import java.net.ServerSocket
 import java.net.Socket
 import java.net.SocketTimeoutException
 import java.net.UnknownHostException
+import java.util.concurrent.ConcurrentHashMap
 
 @SuppressLint("MissingPermission")
 class ServerManager(
@@ -52,6 +56,18 @@ class ServerManager(
     var isServerRunning = false
     private var currentRoom: Room? = null
 
+    // Address the server is bound to (the hotspot / LAN interface)
+    var hostAddress: InetAddress? = null
+        private set
+
+    // Host-side delivery preference; guests that don't support it get unicast
+    var preferredDeliveryMode = AudioStreamConstants.DELIVERY_UNICAST
+    private val guestDeliveryModes = ConcurrentHashMap<String, Int>()
+
+    // Session frame duration / application; every guest decodes the one stream, so a
+    // guest that can't take it is refused rather than downgraded
+    var streamProfile = StreamProfile.DEFAULT
+
     private val _handShakeResult = MutableSharedFlow<HandShakeResult>(extraBufferCapacity = 20)
     val handShakeResultFlow: Flow<HandShakeResult> = _handShakeResult.asSharedFlow()
 
@@ -68,6 +84,7 @@ class ServerManager(
         try {
             _serverStateFlow.tryEmit(ServerState.Starting)
             val inetAddress = InetAddress.getByName(ipAddress)
+            hostAddress = inetAddress
 
             if (isServerRunning && serverSocket?.inetAddress?.hostAddress == ipAddress) {
                 _serverStateFlow.tryEmit(ServerState.Running)
@@ -127,6 +144,7 @@ class ServerManager(
                     guestId = guestHandshake?.userId
                     guestId?.let {
                         socketList[guestId] = clientSocket
+                        guestHandshake.deliveryModes?.let { guestDeliveryModes[guestId] = it }
                         val result = verifyHandshake(guestHandshake)
                         _handShakeResult.emit(result)
                     }
@@ -174,18 +192,55 @@ class ServerManager(
         return guestHandShake
     }
 
+    /** Mode negotiated with [guestId]: the host preference if the guest supports it. */
+    fun deliveryModeFor(guestId: String): Int {
+        val mode = preferredDeliveryMode
+        if (mode == AudioStreamConstants.DELIVERY_UNICAST) return mode
+        val supported = guestDeliveryModes[guestId] ?: 0
+        if (supported and (1 shl mode) == 0 || groupAddress(mode) == null) {
+            return AudioStreamConstants.DELIVERY_UNICAST
+        }
+        return mode
+    }
+
+    /** Shared destination for a group mode, or null if the interface can't provide one. */
+    fun groupAddress(mode: Int): InetAddress? = when (mode) {
+        AudioStreamConstants.DELIVERY_MULTICAST ->
+            InetAddress.getByName(AudioStreamConstants.MULTICAST_GROUP)
+
+        AudioStreamConstants.DELIVERY_BROADCAST -> hostAddress?.let { host ->
+            try {
+                NetworkInterface.getByInetAddress(host)?.interfaceAddresses
+                    ?.firstOrNull { it.address == host && it.address is Inet4Address }
+                    ?.broadcast
+            } catch (e: IOException) {
+                CrashReporter.set("operation_tag", "resolve_broadcast_address")
+                CrashReporter.record(e)
+                null
+            }
+        }
+
+        else -> null
+    }
+
     fun sendAnswerToGuest(guestId: String, roomName: String? = null, answer: HandShakeResult) {
         CoroutineScope(Dispatchers.IO).launch {
             try {
                 val socket = socketList[guestId]
                 val output = BufferedWriter(OutputStreamWriter(socket?.getOutputStream()))
+                val deliveryMode =
+                    if (answer is HandShakeResult.Success) deliveryModeFor(guestId) else null
                 val hostHandshake = HandShake(
                     appIdentifier = AppIdProvider.APP_ID,
                     userId = AppIdProvider.getUserId(context),
                     deviceName = Build.MODEL,
                     roomName = roomName,
                     protocolVersion = ConnectionProtocol.Protocol.PROTOCOL_VERSION,
-                    response = answer.intValue
+                    response = answer.intValue,
+                    deliveryMode = deliveryMode,
+                    deliveryAddress = deliveryMode?.let { groupAddress(it)?.hostAddress },
+                    frameUs = streamProfile.frameUs.takeIf { answer is HandShakeResult.Success },
+                    lowDelay = streamProfile.lowDelay.takeIf { answer is HandShakeResult.Success }
                 )
                 output.write(serializeHandshake(handshake = hostHandshake))
                 Log.d("", "Sent handshake: $hostHandshake")
@@ -219,6 +274,7 @@ class ServerManager(
         if (handshake.appIdentifier != AppIdProvider.APP_ID) {
             return HandShakeResult.InvalidAppId(handshake)
         }
+        // Exact match only: see PROTOCOL_VERSION
         if (handshake.protocolVersion != ConnectionProtocol.Protocol.PROTOCOL_VERSION) {
             return HandShakeResult.InvalidProtocol(handshake)
         }
@@ -229,6 +285,10 @@ class ServerManager(
         if (handshake.response == HandShakeResult.GuestLeftRoom().intValue) {
             return HandShakeResult.GuestLeftRoom(handshake)
         }
+        val frameDurations = handshake.frameDurations ?: 0
+        if (frameDurations and StreamProfile.durationBit(streamProfile.frameUs) == 0) {
+            return HandShakeResult.InvalidProtocol(handshake)
+        }
         if (_connectedGuests.value?.size == RoomFeatures().maxGuests) {
             return HandShakeResult.RoomFull(handshake)
         }
@@ -268,6 +328,7 @@ class ServerManager(
 
     fun closeGuestSocket(guestId: String) {
         val guestSocket = socketList[guestId]
+        guestDeliveryModes.remove(guestId)
         if (guestSocket != null) {
             try {
                 _connectedGuests.update {
@@ -303,5 +364,6 @@ class ServerManager(
             }
         }
         socketList.clear()
+        guestDeliveryModes.clear()
     }
 }
\ No newline at end of file
@@ -41,7 +41,8 @@ abstract class HostRepositoryModule {
         @Provides
         @Singleton
         fun provideHostStreamer(
-        ): HostStreamer = HostStreamer()
+            @ApplicationContext context: Context,
+        ): HostStreamer = HostStreamer(context)
 
         @Provides
         @Singleton
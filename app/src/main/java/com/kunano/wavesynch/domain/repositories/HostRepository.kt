@@ -1,5 +1,6 @@
 package com.kunano.wavesynch.domain.repositories
 
+import com.kunano.wavesynch.data.stream.StreamProfile
 import com.kunano.wavesynch.data.stream.host.HostAudioCapturer
 import com.kunano.wavesynch.data.wifi.server.HandShakeResult
 import com.kunano.wavesynch.data.wifi.server.ServerState
@@ -29,4 +30,7 @@ interface HostRepository {
     fun emptyRoom()
     fun setCurrentRoom(room: Room)
     fun openPortOverLocalWifi(hostIp: String)
+    fun setDeliveryMode(mode: Int)
+    // Takes effect for guests joining and streams started afterwards
+    fun setStreamProfile(profile: StreamProfile)
 }
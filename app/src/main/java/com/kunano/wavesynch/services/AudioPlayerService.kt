@@ -81,6 +81,13 @@ class AudioPlayerService : Service() {
 
         // Start collecting the UDP socket state
         collectUdpSocket()
+        collectHostMuted()
+    }
+
+    private fun collectHostMuted() {
+        serviceScope.launch {
+            clientManager.hostMuted.collect { muted -> audioReceiver?.setHostMuted(muted) }
+        }
     }
 
     private fun collectIsPlayingState() {
@@ -106,8 +113,9 @@ class AudioPlayerService : Service() {
                     if (socket != null && !socket.isClosed) {
                         Log.d("AudioPlayerService", "New UDP socket received, starting audio receiver.")
                         audioReceiver = audioReceiverProvider.get()
+                        audioReceiver?.setHostMuted(clientManager.hostMuted.value)
                         collectIsPlayingState() // Start collecting state from the new receiver
-                        audioReceiver?.start(socket)
+                        audioReceiver?.start(socket, clientManager.socket?.inetAddress, clientManager.streamProfile)
                     } else {
                         Log.d("AudioPlayerService", "UDP socket is null or closed, stopping audio receiver.")
                         // Receiver is already stopped by the start of the new collection
@@ -0,0 +1,266 @@
+// Packet aggregation under a network simulator, on loopback.
+//
+// A paced HostPipeline (20 ms frames, one tier, resends on) sends to a relay per guest
+// that drops datagrams on a Gilbert-Elliott channel and delays the rest by 2-8 ms,
+// in order. Each guest receives with UdpReceiver (NACKs and reports straight back to
+// the host) into a JitterBuffer, and takes every frame out 200 ms after it was
+// captured: the frame is on time if it is there and decodes.
+//
+// Airtime is modelled for 802.11n at 2.4 GHz per unicast datagram: DIFS, mean
+// backoff, preamble, MAC + LLC + IPv4 + UDP headers and payload at the PHY rate, SIFS
+// and the ACK. Reported as the share of the channel one guest's stream takes.
+//
+// aggregation_sim_bench [seconds] [guests]
+#include <opus.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "host_pipeline.h"
+#include "jitter_buffer.h"
+#include "udp_receiver.h"
+
+namespace {
+constexpr int kFrame = 960;
+constexpr int64_t kDeadlineNs = 200000000;
+constexpr int kSeqs = 1 << 16;
+
+int loopbackSocket(int* port) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof a);
+    socklen_t len = sizeof a;
+    getsockname(fd, reinterpret_cast<sockaddr*>(&a), &len);
+    const int big = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &big, sizeof big);
+    *port = ntohs(a.sin_port);
+    return fd;
+}
+
+// One unicast exchange at `mbps`, in microseconds
+double airtimeUs(int udpPayload, double mbps) {
+    const double difs = 28, backoff = 7.5 * 9, preamble = 36, sifs = 10, ack = 20 + 14 * 8 / 24.0;
+    return difs + backoff + preamble + (udpPayload + 28 + 38) * 8 / mbps + sifs + ack;
+}
+
+struct Channel {
+    double enterBad;   // per datagram
+    double leaveBad;
+    const char* name;
+};
+
+struct Relay {
+    int in = -1;
+    int out = -1;
+    sockaddr_in to{};
+    bool bad = false;
+    int64_t lastOutNs = 0;
+    int64_t dropped = 0;
+    std::vector<int> sizes;
+};
+
+struct Held {
+    int64_t atNs;
+    int guest;
+    std::vector<uint8_t> data;
+    bool operator>(const Held& o) const { return atNs > o.atNs; }
+};
+
+struct Guest {
+    std::unique_ptr<UdpReceiver> rx;
+    JitterBuffer jb{256, 1500};
+    OpusDecoder* dec = nullptr;
+    int32_t next = 0;
+    int64_t onTime = 0;
+    int64_t late = 0;
+    int64_t badDecode = 0;
+};
+
+void run(int aggregate, const Channel& channel, int seconds, int guestCount) {
+    int hostPort = 0;
+    close(loopbackSocket(&hostPort));
+    HostPipeline::Config cfg;
+    cfg.encoder.workerNice = 0;
+    cfg.retransmitFrames = 64;
+    cfg.port = hostPort;
+    cfg.aggregateFrames = aggregate;
+    cfg.sendNice = 0;
+    cfg.nackNice = 0;
+    HostPipeline host(cfg);
+    if (!host.ok()) {
+        std::printf("host setup failed\n");
+        return;
+    }
+
+    std::unique_ptr<std::atomic<int64_t>[]> ready(new std::atomic<int64_t>[kSeqs]);
+    for (int i = 0; i < kSeqs; ++i) ready[i].store(0);
+    host.setObserver([&](const HostPipeline::FrameTiming& t) {
+        ready[t.seq & (kSeqs - 1)].store(t.readyNs, std::memory_order_release);
+    });
+
+    static const uint8_t loopback[4] = {127, 0, 0, 1};
+    std::vector<Relay> relays(guestCount);
+    std::vector<Guest> guests(guestCount);
+    std::vector<const uint8_t*> ips(guestCount, loopback);
+    std::vector<int> lens(guestCount, 4), ports(guestCount);
+    for (int g = 0; g < guestCount; ++g) {
+        int port = 0;
+        relays[g].in = loopbackSocket(&ports[g]);
+        relays[g].out = loopbackSocket(&port);
+        const int fd = loopbackSocket(&port);
+        relays[g].to.sin_family = AF_INET;
+        relays[g].to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        relays[g].to.sin_port = htons((uint16_t)port);
+        guests[g].rx.reset(new UdpReceiver(fd, 20.0));
+        guests[g].rx->setNackTarget(loopback, 4, hostPort);
+        int err = 0;
+        guests[g].dec = opus_decoder_create(48000, 2, &err);
+    }
+    host.setTargets(ips.data(), lens.data(), ports.data(), guestCount);
+
+    std::atomic<bool> running{true};
+    std::thread network([&] {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::priority_queue<Held, std::vector<Held>, std::greater<Held>> queue;
+        std::vector<pollfd> fds(guestCount);
+        for (int g = 0; g < guestCount; ++g) fds[g] = {relays[g].in, POLLIN, 0};
+        uint8_t buf[2048];
+        while (running.load()) {
+            poll(fds.data(), guestCount, 1);
+            const int64_t now = bench::nowNs();
+            for (int g = 0; g < guestCount; ++g) {
+                Relay& r = relays[g];
+                for (int n; (n = (int)recv(r.in, buf, sizeof buf, MSG_DONTWAIT)) > 0;) {
+                    r.sizes.push_back(n);
+                    r.bad = r.bad ? uniform(rng) >= channel.leaveBad : uniform(rng) < channel.enterBad;
+                    if (r.bad) {
+                        ++r.dropped;
+                        continue;
+                    }
+                    r.lastOutNs = std::max(r.lastOutNs, now + (int64_t)((2 + 6 * uniform(rng)) * 1e6));
+                    queue.push({r.lastOutNs, g, std::vector<uint8_t>(buf, buf + n)});
+                }
+            }
+            for (; !queue.empty() && queue.top().atNs <= bench::nowNs(); queue.pop()) {
+                const Held& h = queue.top();
+                const Relay& r = relays[h.guest];
+                sendto(r.out, h.data.data(), h.data.size(), 0, reinterpret_cast<const sockaddr*>(&r.to), sizeof r.to);
+            }
+        }
+    });
+
+    std::vector<double> arrivalMs;
+    std::thread playout([&] {
+        std::vector<int16_t> pcm(kFrame * 2);
+        uint8_t payload[1500];
+        std::vector<std::vector<char>> seen(guestCount, std::vector<char>(kSeqs, 0));
+        while (running.load()) {
+            for (int g = 0; g < guestCount; ++g) {
+                Guest& guest = guests[g];
+                guest.rx->receiveInto(guest.jb, nullptr, nullptr, 0);
+                const int64_t now = bench::nowNs();
+                int32_t first;
+                if (g == 0 && guest.jb.firstSeq(&first)) {
+                    for (int32_t s = first; s < first + 32; ++s) {
+                        if (!guest.jb.contains(s) || seen[g][s & (kSeqs - 1)]) continue;
+                        seen[g][s & (kSeqs - 1)] = 1;
+                        const int64_t readyNs = ready[s & (kSeqs - 1)].load(std::memory_order_acquire);
+                        if (readyNs > 0) arrivalMs.push_back((double)(now - readyNs) / 1e6);
+                    }
+                }
+                for (;;) {
+                    const int64_t readyNs = ready[guest.next & (kSeqs - 1)].load(std::memory_order_acquire);
+                    if (readyNs == 0 || now < readyNs + kDeadlineNs) break;
+                    const int32_t s = guest.next++;
+                    const int n = guest.jb.copyPayload(s, payload, sizeof payload, true);
+                    if (n == JitterBuffer::kMissing) {
+                        ++guest.late;
+                        continue;
+                    }
+                    ++guest.onTime;
+                    if (opus_decode(guest.dec, payload, n, pcm.data(), kFrame, 0) != kFrame) ++guest.badDecode;
+                    guest.jb.dropOlderThan(s + 1);
+                }
+            }
+            usleep(500);
+        }
+    });
+
+    if (!host.start()) return;
+    std::vector<int16_t> chunk(kFrame * 2);
+    const int64_t start = bench::nowNs();
+    for (int64_t pushed = 0; pushed < (int64_t)seconds * 96000;) {
+        for (int i = 0; i < kFrame; ++i) {
+            const double t = (double)(pushed / 2 + i) / 48000;
+            chunk[i * 2] = chunk[i * 2 + 1] =
+                    (int16_t)(8000 * std::sin(2 * M_PI * 440 * t) + 5000 * std::sin(2 * M_PI * 1330 * t));
+        }
+        host.push(chunk.data(), (int)chunk.size());
+        pushed += (int64_t)chunk.size();
+        const int64_t wait = start + pushed * 1000000000LL / 96000 - bench::nowNs();
+        if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+    // The last frames reach their deadline
+    std::this_thread::sleep_for(std::chrono::nanoseconds(kDeadlineNs + 100000000));
+    host.stop();
+    running = false;
+    network.join();
+    playout.join();
+    HostPipeline::Stats stats;
+    host.stats(&stats);
+
+    int64_t datagrams = 0, bytes = 0, dropped = 0, onTime = 0, late = 0, badDecode = 0, nackRecovered = 0;
+    double air65 = 0, air13 = 0;
+    for (int g = 0; g < guestCount; ++g) {
+        for (int n : relays[g].sizes) {
+            ++datagrams;
+            bytes += n;
+            air65 += airtimeUs(n, 65);
+            air13 += airtimeUs(n, 13);
+        }
+        dropped += relays[g].dropped;
+        onTime += guests[g].onTime;
+        late += guests[g].late;
+        badDecode += guests[g].badDecode;
+        nackRecovered += guests[g].rx->nackStats().recovered;
+        opus_decoder_destroy(guests[g].dec);
+        close(relays[g].in);
+        close(relays[g].out);
+    }
+    const double perGuest = (double)seconds * guestCount;   // per second of audio
+    std::printf("agg %d  %-6s  %5.1f pkt/s  %5.0f B/s  %4.0f B/pkt  airtime %4.2f%% @65  %5.2f%% @13 Mb/s  "
+                "dropped %4.2f%%  on time %7.3f%%  (nack %lld, bad %lld)  arrival p50 %4.1f  p99 %5.1f ms\n",
+                aggregate, channel.name, datagrams / perGuest, bytes / perGuest, (double)bytes / datagrams,
+                air65 / perGuest / 1e4, air13 / perGuest / 1e4, 100.0 * dropped / datagrams,
+                100.0 * onTime / (onTime + late), (long long)nackRecovered, (long long)badDecode,
+                bench::percentile(arrivalMs, 0.5), bench::percentile(arrivalMs, 0.99));
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = bench::intArg(argc, argv, 1, 20);
+    const int guests = bench::intArg(argc, argv, 2, 4);
+    const Channel channels[] = {{0, 0.5, "clean"}, {0.01, 0.5, "bursty"}};
+    std::printf("%d guests, %d s per run; bursty = Gilbert-Elliott, 1%% enter / 50%% leave\n", guests, seconds);
+    for (const Channel& c : channels) {
+        for (int aggregate = 1; aggregate <= 3; ++aggregate) run(aggregate, c, seconds, guests);
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include "futex.h"
+
+// Timing helpers for the host benches. Benches print their figures and exit 0; with a
+// short argument list they double as CTest smoke runs.
+namespace bench {
+
+inline int64_t nowNs() { return futex::monotonicNs(); }
+
+inline int64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// q in [0, 1]; sorts v
+inline double percentile(std::vector<double>& v, double q) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    const size_t i = std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5));
+    return v[i];
+}
+
+// argv[i] as an int, or fallback when absent
+inline int intArg(int argc, char** argv, int i, int fallback) {
+    return argc > i ? std::atoi(argv[i]) : fallback;
+}
+
+// Keeps the optimizer from discarding a result
+inline void keep(const void* p) { asm volatile("" : : "g"(p) : "memory"); }
+
+} // namespace bench
@@ -0,0 +1,170 @@
+// Guest recovery under burst loss: CPU per frame and quality per outcome.
+//
+// 20 ms stereo frames are encoded once through SimulcastEncoder (10% expected loss, so
+// LBRR is on, and 200 ms of DRED when weights are given), then dropped on a
+// Gilbert-Elliott channel and played back in order the way AudioReceiver does:
+// decode, else in-band FEC from the next packet, else DRED from the first packet
+// buffered after the gap, else PLC. Each output frame is compared with a lossless
+// decode of the same stream (SNR over the frame) and the playout thread's CPU time is
+// charged to its outcome.
+//
+// DRED needs a libopus built with it (WAVESYNCH_DRED) and the model's weights blob;
+// without them loadWeights() reports OPUS_UNIMPLEMENTED and no frame is DRED.
+//
+// burst_recovery_bench [frames] [weights_blob.bin]
+#include <opus.h>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "dnn_blob.h"
+#include "dred_recovery.h"
+#include "jitter_buffer.h"
+#include "playout_delay.h"
+#include "simulcast_encoder.h"
+
+namespace {
+constexpr int kFrame = 960;
+constexpr int kShorts = kFrame * 2;
+
+double snrDb(const int16_t* ref, const int16_t* x, int n) {
+    double signal = 0, error = 0;
+    for (int i = 0; i < n; ++i) {
+        const double d = (double)ref[i] - x[i];
+        signal += (double)ref[i] * ref[i];
+        error += d * d;
+    }
+    return 10 * std::log10((signal + 1) / (error + 1));
+}
+
+struct Channel {
+    double enterBad;
+    double leaveBad;   // 1 / mean burst length
+};
+
+void run(const std::vector<std::vector<uint8_t>>& packets, const Channel& channel, const DnnBlob* blob) {
+    const int frames = (int)packets.size();
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<char> lost(frames, 0);
+    bool bad = false;
+    int dropped = 0, burst = 0, longest = 0;
+    for (int i = 0; i < frames; ++i) {
+        bad = bad ? uniform(rng) >= channel.leaveBad : uniform(rng) < channel.enterBad;
+        lost[i] = bad && i > 10;
+        dropped += lost[i];
+        burst = lost[i] ? burst + 1 : 0;
+        longest = std::max(longest, burst);
+    }
+    JitterBuffer jb(4096, 1500);
+    for (int i = 0; i < frames; ++i) {
+        if (!lost[i]) jb.putDatagram(packets[i].data(), (int)packets[i].size(), nullptr);
+    }
+
+    int err = 0;
+    OpusDecoder* reference = opus_decoder_create(48000, 2, &err);
+    OpusDecoder* dec = opus_decoder_create(48000, 2, &err);
+    DredRecovery dred(48000);
+    if (blob && dred.loadWeights(blob->data(), blob->size()) == OPUS_OK) {
+        opus_decoder_ctl(dec, OPUS_SET_DNN_BLOB(blob->data(), blob->size()));
+    }
+
+    constexpr int kOutcomes = 4;
+    const char* names[kOutcomes] = {"decoded", "fec", "plc", "dred"};
+    int64_t cpuNs[kOutcomes] = {}, count[kOutcomes] = {};
+    double snr[kOutcomes] = {};
+    std::vector<int16_t> clean(kShorts), out(kShorts);
+    uint8_t payload[1500];
+    for (int i = 0; i < frames; ++i) {
+        if (opus_decode(reference, packets[i].data() + wspacket::kHeaderSize,
+                        (int)packets[i].size() - wspacket::kHeaderSize, clean.data(), kFrame, 0) != kFrame) {
+            std::printf("reference decode failed at %d\n", i);
+            break;
+        }
+        const int64_t t0 = bench::threadCpuNs();
+        PlayoutDelayController::Outcome outcome;
+        int n = jb.copyPayload(i, payload, sizeof payload, true);
+        if (n > 0) {
+            n = opus_decode(dec, payload, n, out.data(), kFrame, 0);
+            outcome = PlayoutDelayController::kDecoded;
+        } else if ((n = jb.copyPayload(i + 1, payload, sizeof payload, false)) > 0 &&
+                   opus_decode(dec, payload, n, out.data(), kFrame, 1) == kFrame) {
+            outcome = PlayoutDelayController::kFec;
+        } else if (dred.ok() && dred.recover(dec, jb, i, kFrame, out.data()) > 0) {
+            outcome = PlayoutDelayController::kDred;
+        } else {
+            n = opus_decode(dec, nullptr, 0, out.data(), kFrame, 0);
+            outcome = PlayoutDelayController::kPlc;
+        }
+        bench::keep(&n);
+        cpuNs[outcome] += bench::threadCpuNs() - t0;
+        ++count[outcome];
+        snr[outcome] += snrDb(clean.data(), out.data(), kShorts);
+    }
+    opus_decoder_destroy(reference);
+    opus_decoder_destroy(dec);
+
+    std::printf("loss %.1f%%, mean burst %.1f, longest %d frames\n", 100.0 * dropped / frames,
+                1 / channel.leaveBad, longest);
+    for (int k = 0; k < kOutcomes; ++k) {
+        if (count[k] == 0) continue;
+        std::printf("  %-8s %5lld frames  %6.1f us/frame  SNR vs lossless %6.1f dB\n", names[k],
+                    (long long)count[k], cpuNs[k] / 1e3 / count[k], snr[k] / count[k]);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 3000);
+    std::unique_ptr<DnnBlob> blob;
+    if (argc > 2) {
+        const char* why = nullptr;
+        blob.reset(DnnBlob::load(argv[2], &why));
+        if (!blob) std::printf("%s: %s\n", argv[2], why ? why : "cannot load");
+    }
+
+    SimulcastEncoder::Config cfg;
+    cfg.encodeShare = 0;
+    cfg.workerNice = 0;
+    cfg.lossPercent[0] = 10;
+    if (blob) {
+        cfg.dredFrames = 20;
+        cfg.dnnBlob = blob->data();
+        cfg.dnnBlobBytes = blob->size();
+    }
+    SimulcastEncoder enc(cfg);
+    if (!enc.ok()) return 1;
+    DredRecovery probe(48000);
+    const int rc = blob ? probe.loadWeights(blob->data(), blob->size()) : OPUS_UNIMPLEMENTED;
+    std::printf("DRED: %d x 10 ms per packet, decoder weights %s\n", enc.dredFrames(),
+                rc == OPUS_OK ? "loaded" : opus_strerror(rc));
+
+    // Music-like: two tones with vibrato over a little noise
+    std::vector<std::vector<uint8_t>> packets(frames);
+    std::vector<int16_t> pcm(kShorts);
+    std::mt19937 rng(3);
+    std::normal_distribution<double> gauss(0, 600);
+    int64_t encodeNs = 0;
+    for (int f = 0; f < frames; ++f) {
+        for (int i = 0; i < kFrame; ++i) {
+            const double t = (double)(f * kFrame + i) / 48000;
+            const double v = 7000 * std::sin(2 * M_PI * 330 * t + 2 * std::sin(2 * M_PI * 5 * t)) +
+                             4000 * std::sin(2 * M_PI * 990 * t) + gauss(rng);
+            pcm[i * 2] = (int16_t)v;
+            pcm[i * 2 + 1] = (int16_t)(0.8 * v);
+        }
+        const int64_t t0 = bench::threadCpuNs();
+        if (enc.encode(pcm.data(), f, (uint32_t)(f * kFrame), 0, 1) != 1) return 1;
+        encodeNs += bench::threadCpuNs() - t0;
+        packets[f].assign(enc.datagram(0), enc.datagram(0) + enc.length(0));
+    }
+    std::printf("encode %.1f us/frame\n", encodeNs / 1e3 / frames);
+
+    const Channel channels[] = {{0.02, 1.0}, {0.02, 1.0 / 3}, {0.01, 1.0 / 8}};
+    for (const Channel& c : channels) run(packets, c, blob.get());
+    return 0;
+}
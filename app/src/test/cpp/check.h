@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the host tests: a failed CHECK prints where and keeps going,
+// and the test's exit status (checkResult) tells CTest whether anything failed.
+namespace check {
+inline int& failures() {
+    static int n = 0;
+    return n;
+}
+inline int result(const char* test) {
+    if (failures() == 0) {
+        std::printf("%s: ok\n", test);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", test, failures());
+    return 1;
+}
+} // namespace check
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);  \
+            ++check::failures();                                                  \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                            \
+    do {                                                                          \
+        const long long va_ = (long long)(a), vb_ = (long long)(b);               \
+        if (va_ != vb_) {                                                         \
+            std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",         \
+                        __FILE__, __LINE__, #a, #b, va_, vb_);                    \
+            ++check::failures();                                                  \
+        }                                                                         \
+    } while (0)
@@ -0,0 +1,112 @@
+// What the direct ByteBuffer entry points save per 20 ms stereo frame.
+//
+// There is no JVM on the host, so this measures the native side of both paths: the
+// array API stages PCM and packets through the handle's scratch (the copies
+// GetShortArrayRegion / SetByteArrayRegion make), the direct API encodes and decodes
+// in caller memory. JNI call overhead itself is the same for both and not included.
+//
+// direct_buffer_bench [frames]
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <opus.h>
+#include <vector>
+
+#include "bench.h"
+
+namespace {
+constexpr int kRate = 48000;
+constexpr int kChannels = 2;
+constexpr int kFrame = 960;
+constexpr int kShorts = kFrame * kChannels;
+constexpr int kMaxPacket = 1500;
+
+struct Result {
+    double encodeNs;
+    double decodeNs;
+};
+
+Result run(bool staged, int frames, const std::vector<int16_t>& music) {
+    int err = 0;
+    OpusEncoder* enc = opus_encoder_create(kRate, kChannels, OPUS_APPLICATION_AUDIO, &err);
+    OpusDecoder* dec = opus_decoder_create(kRate, kChannels, &err);
+    opus_encoder_ctl(enc, OPUS_SET_BITRATE(128000));
+
+    // "Java" side buffers and the handle's scratch
+    std::vector<int16_t> callerPcm(kShorts), scratchPcm(kShorts), outPcm(kShorts);
+    std::vector<uint8_t> callerPacket(kMaxPacket), scratchPacket(kMaxPacket);
+
+    int64_t encodeNs = 0, decodeNs = 0;
+    for (int f = 0; f < frames; ++f) {
+        std::memcpy(callerPcm.data(), music.data() + (size_t)(f % 50) * kShorts, kShorts * 2);
+
+        int64_t t0 = bench::nowNs();
+        int len;
+        if (staged) {
+            std::memcpy(scratchPcm.data(), callerPcm.data(), kShorts * 2);
+            len = opus_encode(enc, scratchPcm.data(), kFrame, scratchPacket.data(), kMaxPacket);
+            std::memcpy(callerPacket.data(), scratchPacket.data(), (size_t)len);
+        } else {
+            len = opus_encode(enc, callerPcm.data(), kFrame, callerPacket.data(), kMaxPacket);
+        }
+        int64_t t1 = bench::nowNs();
+        encodeNs += t1 - t0;
+
+        t0 = bench::nowNs();
+        if (staged) {
+            std::memcpy(scratchPacket.data(), callerPacket.data(), (size_t)len);
+            const int n = opus_decode(dec, scratchPacket.data(), len, scratchPcm.data(), kFrame, 0);
+            std::memcpy(outPcm.data(), scratchPcm.data(), (size_t)n * kChannels * 2);
+        } else {
+            const int n = opus_decode(dec, callerPacket.data(), len, outPcm.data(), kFrame, 0);
+            bench::keep(&n);
+        }
+        t1 = bench::nowNs();
+        decodeNs += t1 - t0;
+        bench::keep(outPcm.data());
+    }
+    opus_encoder_destroy(enc);
+    opus_decoder_destroy(dec);
+    return {(double)encodeNs / frames, (double)decodeNs / frames};
+}
+
+// Cost of the copies alone, without Opus in between to hide them
+double copyNs(int frames) {
+    std::vector<int16_t> a(kShorts), b(kShorts);
+    std::vector<uint8_t> p(kMaxPacket), q(kMaxPacket);
+    const int64_t t0 = bench::nowNs();
+    for (int f = 0; f < frames * 100; ++f) {
+        a[0] = (int16_t)f;
+        std::memcpy(b.data(), a.data(), kShorts * 2);   // PCM in
+        std::memcpy(q.data(), p.data(), 320);           // packet out
+        std::memcpy(p.data(), q.data(), 320);           // packet in
+        std::memcpy(a.data(), b.data(), kShorts * 2);   // PCM out
+        bench::keep(a.data());
+    }
+    return (double)(bench::nowNs() - t0) / (frames * 100);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 5000);
+
+    std::vector<int16_t> music((size_t)50 * kShorts);
+    for (size_t i = 0; i < music.size() / kChannels; ++i) {
+        const double t = (double)i / kRate;
+        const double s = 0.3 * std::sin(2 * M_PI * 440 * t) + 0.2 * std::sin(2 * M_PI * 1250 * t);
+        music[i * 2] = (int16_t)(s * 32767);
+        music[i * 2 + 1] = (int16_t)(s * 0.8 * 32767);
+    }
+
+    run(false, frames / 10 + 1, music);   // warm up
+    const Result staged = run(true, frames, music);
+    const Result direct = run(false, frames, music);
+    const double copies = copyNs(frames);
+
+    std::printf("frames=%d (20 ms stereo, 128 kb/s)\n", frames);
+    std::printf("encode: staged %.0f ns  direct %.0f ns\n", staged.encodeNs, direct.encodeNs);
+    std::printf("decode: staged %.0f ns  direct %.0f ns\n", staged.decodeNs, direct.decodeNs);
+    std::printf("copies alone (PCM in/out + packet in/out): %.0f ns per frame, %.2f%% of encode+decode\n",
+                copies, 100.0 * copies / (direct.encodeNs + direct.decodeNs));
+    return 0;
+}
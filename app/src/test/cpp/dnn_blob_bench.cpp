@@ -0,0 +1,150 @@
+// DNN weights: DnnBlob's read-only mapping against reading the file onto
+// the heap.
+//
+// Writes a well-formed blob of `mb` MiB (records of 4 KiB to 200 KiB, the spread of
+// the real models) and, each in a fresh child process, warm (page cache hot) and cold
+// (pages dropped with POSIX_FADV_DONTNEED first):
+//   load   DnnBlob::load, or read() into an aligned heap buffer
+//   first  one pass over every weight, standing in for the first decode that runs
+//          every layer
+//   extra  eight more passes, standing in for more codecs handed the same weights
+// with RSS growth after each step (/proc/self/statm).
+//
+// dnn_blob_bench [mb]
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "dnn_blob.h"
+
+namespace {
+const char* const kPath = "dnn_blob_bench.bin";
+
+// Records as opus/dnn/nnet.h writes them: "DNNw", version, type, size, block size,
+// a 44-byte name, then the payload padded to the record size.
+bool writeBlob(int mb) {
+    FILE* f = std::fopen(kPath, "wb");
+    if (!f) return false;
+    std::mt19937 rng(25);
+    const int sizes[] = {4096, 65536, 12000, 200000};
+    std::vector<uint8_t> payload;
+    long total = 0;
+    for (int i = 0; total < (long)mb << 20; ++i) {
+        const int size = sizes[i % 4];
+        const int block = (size + DnnBlob::kRecordBytes - 1) / DnnBlob::kRecordBytes * DnnBlob::kRecordBytes;
+        uint8_t head[DnnBlob::kRecordBytes] = {};
+        const int32_t fields[4] = {DnnBlob::kRecordVersion, 0, size, block};
+        std::memcpy(head, "DNNw", 4);
+        std::memcpy(head + 4, fields, sizeof fields);
+        std::snprintf(reinterpret_cast<char*>(head) + 20, 44, "layer%d", i);
+        payload.assign(block, 0);
+        for (int j = 0; j < size; ++j) payload[j] = (uint8_t)rng();
+        std::fwrite(head, 1, sizeof head, f);
+        std::fwrite(payload.data(), 1, payload.size(), f);
+        total += DnnBlob::kRecordBytes + block;
+    }
+    return std::fclose(f) == 0;
+}
+
+long rssKb() {
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void dropCache() {
+    const int fd = open(kPath, O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Reads every cache line once, as a forward pass reads every weight
+unsigned pass(const uint8_t* data, int size) {
+    unsigned sum = 0;
+    for (int i = 0; i < size; i += 64) sum += data[i];
+    return sum;
+}
+
+void measure(bool heap, bool cold) {
+    if (cold) dropCache();
+    const long rss0 = rssKb();
+    int64_t t0 = bench::nowNs();
+    const uint8_t* data = nullptr;
+    int size = 0;
+    DnnBlob* blob = nullptr;
+    if (heap) {
+        const int fd = open(kPath, O_RDONLY);
+        struct stat st {};
+        fstat(fd, &st);
+        size = (int)st.st_size;
+        uint8_t* p = static_cast<uint8_t*>(std::aligned_alloc(64, ((size_t)size + 63) / 64 * 64));
+        for (int done = 0; done < size;) {
+            const ssize_t n = read(fd, p + done, (size_t)(size - done));
+            if (n <= 0) break;
+            done += (int)n;
+        }
+        close(fd);
+        data = p;
+    } else {
+        blob = DnnBlob::load(kPath);
+        if (!blob) {
+            std::printf("DnnBlob::load failed\n");
+            return;
+        }
+        data = blob->data();
+        size = blob->size();
+    }
+    const double loadUs = (double)(bench::nowNs() - t0) / 1e3;
+    const long rss1 = rssKb();
+
+    t0 = bench::nowNs();
+    unsigned sum = pass(data, size);
+    const double firstUs = (double)(bench::nowNs() - t0) / 1e3;
+    const long rss2 = rssKb();
+
+    t0 = bench::nowNs();
+    for (int k = 0; k < 8; ++k) sum += pass(data, size);
+    const double extraUs = (double)(bench::nowNs() - t0) / 1e3 / 8;
+    const long rss3 = rssKb();
+    bench::keep(&sum);
+
+    std::printf("%-4s %-4s  load %6.0f us  +%5ld KB   first pass %5.0f us  +%5ld KB   extra %4.0f us  +%ld KB\n",
+                heap ? "heap" : "mmap", cold ? "cold" : "warm", loadUs, rss1 - rss0, firstUs, rss2 - rss0,
+                extraUs, (rss3 - rss2) / 8);
+    delete blob;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int mb = bench::intArg(argc, argv, 1, 4);
+    if (!writeBlob(mb)) return 1;
+    std::printf("%d MiB blob, RSS growth from before the load\n", mb);
+    for (bool heap : {false, true}) {
+        for (bool cold : {false, true}) {
+            std::fflush(stdout);
+            const pid_t child = fork();
+            if (child == 0) {
+                measure(heap, cold);
+                std::fflush(stdout);
+                _exit(0);
+            }
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return 1;
+        }
+    }
+    unlink(kPath);
+    return 0;
+}
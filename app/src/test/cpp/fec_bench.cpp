@@ -0,0 +1,139 @@
+// FEC cost and benefit.
+//
+// 1) GF(256) kernels over an MTU-sized block.
+// 2) Encode cost per group and decode cost for m losses, 332-byte media datagrams
+//    (a 128 kb/s 20 ms Opus frame plus header).
+// 3) Residual media loss behind each configuration on a 5% Gilbert-Elliott burst
+//    channel (p = 0.0175, r = 1/3) that drops parity as well.
+//
+// fec_bench [groups]
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "fec.h"
+#include "packet_codec.h"
+
+namespace {
+constexpr int kMedia = 332;
+
+struct Config {
+    int scheme, k, m;
+};
+const Config kConfigs[] = {{wsfec::kXor, 4, 1}, {wsfec::kXor, 8, 1}, {wsfec::kReedSolomon, 8, 2},
+                           {wsfec::kReedSolomon, 8, 4}, {wsfec::kReedSolomon, 16, 4}};
+
+const char* name(int scheme) { return scheme == wsfec::kXor ? "XOR" : "RS "; }
+
+void kernels(std::mt19937& rng) {
+    constexpr int kBlock = 1500;
+    constexpr int kRounds = 200000;
+    std::vector<uint8_t> a(kBlock), b(kBlock);
+    for (uint8_t& x : a) x = (uint8_t)rng();
+    for (uint8_t& x : b) x = (uint8_t)rng();
+
+    int64_t t0 = bench::nowNs();
+    for (int r = 0; r < kRounds; ++r) gf256::xorInto(a.data(), b.data(), kBlock);
+    double s = (bench::nowNs() - t0) / 1e9;
+    std::printf("xorInto     %7.0f MB/s\n", (double)kBlock * kRounds / s / 1e6);
+
+    t0 = bench::nowNs();
+    for (int r = 0; r < kRounds; ++r) gf256::mulAddInto(a.data(), b.data(), (uint8_t)(2 + (r & 127)), kBlock);
+    s = (bench::nowNs() - t0) / 1e9;
+    bench::keep(a.data());
+    std::printf("mulAddInto  %7.0f MB/s\n", (double)kBlock * kRounds / s / 1e6);
+}
+
+void groupCost(std::mt19937& rng, const Config& c, int groups) {
+    std::vector<std::vector<uint8_t>> media(c.k, std::vector<uint8_t>(kMedia));
+    for (int i = 0; i < c.k; ++i) {
+        for (uint8_t& x : media[i]) x = (uint8_t)rng();
+    }
+    FecEncoder enc;
+    enc.configure(c.scheme, c.k, c.m);
+    std::vector<std::vector<uint8_t>> parity;
+
+    const int64_t t0 = bench::nowNs();
+    for (int g = 0; g < groups; ++g) {
+        for (int i = 0; i < c.k; ++i) {
+            wspacket::writeHeader(media[i].data(), g * c.k + i, 0, 0);
+            const bool ready = enc.addMedia(media[i].data(), kMedia);
+            // Parity of group g - 1 is paced out behind group g's media
+            if (ready && g == groups - 1) parity.emplace_back(enc.parity(), enc.parity() + enc.parityLength());
+        }
+    }
+    const double encodeUs = (bench::nowNs() - t0) / 1e3 / groups;
+
+    // Rebuild the first m media packets of group groups - 2 from its m parities
+    const int32_t base = (groups - 2) * c.k;
+    constexpr int kDecodes = 2000;
+    int64_t decodeNs = 0;
+    int rebuilt = 0;
+    for (int r = 0; r < kDecodes; ++r) {
+        FecDecoder dec;
+        for (const std::vector<uint8_t>& p : parity) dec.onParity(p.data(), (int)p.size());
+        for (int i = c.m; i < c.k; ++i) {
+            wspacket::writeHeader(media[i].data(), base + i, 0, 0);
+            dec.onMedia(base + i, media[i].data(), kMedia);
+        }
+        const int64_t d0 = bench::nowNs();
+        rebuilt += dec.recover([](const uint8_t*, int) {});
+        decodeNs += bench::nowNs() - d0;
+    }
+    std::printf("%s k=%2d m=%d  overhead %3.0f%%  encode %6.2f us/group (%4.0f MB/s)  "
+                "rebuild %d lost %6.2f us (%d ok)\n",
+                name(c.scheme), c.k, c.m, 100.0 * c.m / c.k, encodeUs, kMedia * c.k / encodeUs,
+                c.m, decodeNs / 1e3 / kDecodes, rebuilt / kDecodes);
+}
+
+class GilbertElliott {
+public:
+    GilbertElliott(double p, double r, unsigned seed) : p_(p), r_(r), rng_(seed) {}
+
+    bool lost() {
+        const double u = uniform_(rng_);
+        bad_ = bad_ ? u >= r_ : u < p_;
+        return bad_;
+    }
+
+private:
+    double p_, r_;
+    bool bad_ = false;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_{0, 1};
+};
+
+void burstLoss(const Config& c, int frames) {
+    GilbertElliott channel(0.0175, 1.0 / 3, 9);
+    FecEncoder enc;
+    enc.configure(c.scheme, c.k, c.m);
+    FecDecoder dec;
+    uint8_t packet[kMedia] = {};
+    long lost = 0, rebuilt = 0;
+    for (int s = 0; s < frames; ++s) {
+        wspacket::writeHeader(packet, s, (uint32_t)s * 960, 0);
+        const bool ready = enc.addMedia(packet, kMedia);
+        if (channel.lost()) {
+            ++lost;
+        } else {
+            dec.onMedia(s, packet, kMedia);
+        }
+        if (ready && !channel.lost()) dec.onParity(enc.parity(), enc.parityLength());
+        rebuilt += dec.recover([](const uint8_t*, int) {});
+    }
+    std::printf("%s k=%2d m=%d  media loss %.2f%% -> residual %.2f%% (rebuilt %.1f%%)\n", name(c.scheme), c.k,
+                c.m, 100.0 * lost / frames, 100.0 * (lost - rebuilt) / frames, 100.0 * rebuilt / lost);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int groups = bench::intArg(argc, argv, 1, 20000);
+    std::mt19937 rng(1);
+    kernels(rng);
+    for (const Config& c : kConfigs) groupCost(rng, c, groups);
+    std::printf("5%% burst loss, %d frames:\n", groups * 9);
+    for (const Config& c : kConfigs) burstLoss(c, groups * 9);
+    return 0;
+}
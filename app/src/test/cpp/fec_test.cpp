@@ -0,0 +1,89 @@
+// FEC round trip: for XOR (m = 1) and Reed-Solomon (m up to 4) groups of
+// 2..16 packets of random lengths, any e <= m lost media packets are rebuilt
+// bit-exactly from any e parity packets; more losses than parity rebuild nothing.
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "fec.h"
+#include "packet_codec.h"
+
+namespace {
+std::mt19937 rng(1);
+
+// Returns media rebuilt, or -1 if anything came back wrong
+int roundTrip(int scheme, int k, int m, int erased, int parityGiven) {
+    FecEncoder enc;
+    CHECK(enc.configure(scheme, k, m));
+    FecDecoder dec;
+
+    std::vector<std::vector<uint8_t>> media(k), parity;
+    const int32_t base = (int32_t)(rng() % 100000);
+    for (int i = 0; i < k; ++i) {
+        media[i].resize(12 + rng() % 400);
+        for (uint8_t& b : media[i]) b = (uint8_t)rng();
+        wspacket::writeHeader(media[i].data(), base + i, (uint32_t)i * 960, 0);
+        if (enc.addMedia(media[i].data(), (int)media[i].size())) {
+            parity.emplace_back(enc.parity(), enc.parity() + enc.parityLength());
+        }
+    }
+    // Parity goes out paced behind the next group's media
+    for (int i = 0; i < k && (int)parity.size() < m; ++i) {
+        uint8_t filler[40] = {};
+        wspacket::writeHeader(filler, base + k + i, 0, 0);
+        if (enc.addMedia(filler, sizeof filler)) parity.emplace_back(enc.parity(), enc.parity() + enc.parityLength());
+    }
+    CHECK_EQ((int)parity.size(), m);
+
+    std::vector<int> order(k);
+    for (int i = 0; i < k; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<bool> lost(k, false);
+    for (int i = 0; i < erased; ++i) lost[order[i]] = true;
+
+    std::vector<int> parityOrder(parity.size());
+    for (size_t j = 0; j < parity.size(); ++j) parityOrder[j] = (int)j;
+    std::shuffle(parityOrder.begin(), parityOrder.end(), rng);
+    for (int j = 0; j < parityGiven && j < (int)parity.size(); ++j) {
+        const std::vector<uint8_t>& p = parity[parityOrder[j]];
+        dec.onParity(p.data(), (int)p.size());
+    }
+    for (int i = 0; i < k; ++i) {
+        if (!lost[i]) dec.onMedia(base + i, media[i].data(), (int)media[i].size());
+    }
+
+    int rebuilt = 0;
+    bool wrong = false;
+    dec.recover([&](const uint8_t* d, int len) {
+        wspacket::Header h{};
+        wspacket::parseHeader(d, len, &h);
+        const int i = h.seq - base;
+        if (i < 0 || i >= k || !lost[i] || len != (int)media[i].size() ||
+            std::memcmp(d, media[i].data(), (size_t)len) != 0) {
+            wrong = true;
+        } else {
+            ++rebuilt;
+        }
+    });
+    return wrong ? -1 : rebuilt;
+}
+} // namespace
+
+int main() {
+    for (int scheme : {wsfec::kXor, wsfec::kReedSolomon}) {
+        for (int k : {2, 4, 8, 16}) {
+            const int maxM = scheme == wsfec::kXor ? 1 : std::min(k, wsfec::kMaxM);
+            for (int m = 1; m <= maxM; ++m) {
+                for (int trial = 0; trial < 100; ++trial) {
+                    const int erased = 1 + (int)(rng() % m);
+                    CHECK_EQ(roundTrip(scheme, k, m, erased, erased), erased);
+                    // One parity short: nothing may come out, and nothing wrong
+                    CHECK_EQ(roundTrip(scheme, k, m, erased, erased - 1), 0);
+                }
+            }
+        }
+    }
+    return check::result("fec_test");
+}
@@ -0,0 +1,119 @@
+// FrameAggregator / wsaggregate round trip: real Opus frames go in as
+// per-frame datagrams, aggregates come out, and splitting them must give back the
+// exact datagrams that went in, with seq and pts per frame. Gaps in seq and flush()
+// send the held frames early; a lone frame goes out unchanged.
+#include <opus.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "frame_aggregator.h"
+
+namespace {
+constexpr int kFrame = 960;
+
+std::vector<std::vector<uint8_t>> encodeFrames(int count) {
+    int err = 0;
+    OpusEncoder* enc = opus_encoder_create(48000, 2, OPUS_APPLICATION_AUDIO, &err);
+    opus_encoder_ctl(enc, OPUS_SET_BITRATE(96000));
+    std::vector<std::vector<uint8_t>> datagrams;
+    std::vector<int16_t> pcm(kFrame * 2);
+    uint8_t packet[1500];
+    for (int f = 0; f < count; ++f) {
+        for (int i = 0; i < kFrame; ++i) {
+            const double t = (double)(f * kFrame + i) / 48000;
+            pcm[i * 2] = pcm[i * 2 + 1] = (int16_t)(9000 * std::sin(2 * M_PI * (300 + 40 * f) * t));
+        }
+        const int n = opus_encode(enc, pcm.data(), kFrame, packet, sizeof packet);
+        CHECK(n > 1);
+        std::vector<uint8_t> d(wspacket::kHeaderSize + n);
+        wspacket::writeHeader(d.data(), 1000 + f, 5000u + (uint32_t)(f * kFrame), 0);
+        std::memcpy(d.data() + wspacket::kHeaderSize, packet, n);
+        datagrams.push_back(std::move(d));
+    }
+    opus_encoder_destroy(enc);
+    return datagrams;
+}
+
+// Splits one datagram out of the aggregator into per-frame datagrams
+void split(const uint8_t* d, int length, std::vector<std::vector<uint8_t>>* out) {
+    wspacket::Header h{};
+    CHECK(wspacket::parseHeader(d, length, &h));
+    if (!(h.flags & wspacket::kFlagAggregate)) {
+        out->emplace_back(d, d + length);
+        return;
+    }
+    wsaggregate::Frames f;
+    const int count = wsaggregate::parse(d, length, &f);
+    CHECK(count >= 2 && count <= wsaggregate::kMaxFrames);
+    for (int i = 0; i < count; ++i) {
+        uint8_t frame[FrameAggregator::kMaxBytes];
+        const int n = wsaggregate::frameDatagram(f, i, frame);
+        out->emplace_back(frame, frame + n);
+    }
+}
+
+void roundTrip() {
+    const std::vector<std::vector<uint8_t>> in = encodeFrames(30);
+    for (int frames = 1; frames <= wsaggregate::kMaxFrames; ++frames) {
+        FrameAggregator agg;
+        CHECK(agg.ok());
+        agg.setFrames(frames);
+        std::vector<std::vector<uint8_t>> out;
+        int datagrams = 0;
+        for (const std::vector<uint8_t>& d : in) {
+            const int n = agg.add(d.data(), (int)d.size());
+            if (n > 0) {
+                split(agg.datagram(), n, &out);
+                ++datagrams;
+            }
+        }
+        const int n = agg.flush();
+        if (n > 0) {
+            split(agg.datagram(), n, &out);
+            ++datagrams;
+        }
+        CHECK_EQ(datagrams, (int)(in.size() + frames - 1) / frames);
+        CHECK_EQ(out.size(), in.size());
+        for (size_t i = 0; i < std::min(in.size(), out.size()); ++i) CHECK(in[i] == out[i]);
+    }
+}
+
+void gapsAndLoneFrames() {
+    const std::vector<std::vector<uint8_t>> in = encodeFrames(6);
+    FrameAggregator agg;
+    agg.setFrames(3);
+    std::vector<std::vector<uint8_t>> out;
+    CHECK_EQ(agg.add(in[0].data(), (int)in[0].size()), 0);
+    CHECK_EQ(agg.add(in[1].data(), (int)in[1].size()), 0);
+    // seq 1002 is missing: the two held frames go out as an aggregate, 1003 is held
+    int n = agg.add(in[3].data(), (int)in[3].size());
+    CHECK(n > 0);
+    split(agg.datagram(), n, &out);
+    CHECK_EQ(agg.held(), 1);
+    // A single held frame is flushed as the plain datagram it came in as
+    n = agg.flush();
+    CHECK_EQ(n, (int)in[3].size());
+    CHECK(std::memcmp(agg.datagram(), in[3].data(), n) == 0);
+    CHECK_EQ(agg.flush(), 0);
+
+    CHECK_EQ(out.size(), 2);
+    if (out.size() == 2) {
+        CHECK(out[0] == in[0]);
+        CHECK(out[1] == in[1]);
+    }
+
+    // Not an aggregate: plain media, a truncated header
+    wsaggregate::Frames f;
+    CHECK_EQ(wsaggregate::parse(in[0].data(), (int)in[0].size(), &f), -1);
+    CHECK_EQ(wsaggregate::parse(in[0].data(), 4, &f), -1);
+}
+} // namespace
+
+int main() {
+    roundTrip();
+    gapsAndLoneFrames();
+    return check::result("frame_aggregator_test");
+}
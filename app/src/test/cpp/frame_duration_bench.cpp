@@ -0,0 +1,132 @@
+// Latency and CPU per second of audio for each StreamProfile.
+//
+// Each of the six frame durations runs with OPUS_APPLICATION_AUDIO and with
+// RESTRICTED_LOWDELAY through the host encoder (SimulcastEncoder, one tier, 128 kb/s,
+// complexity 5, governor off) and a plain opus decoder. Reported per setting:
+//   delay   codec delay, measured as the lag that best aligns decoded with input PCM
+//   floor   frame fill + delay + p99 encode + p99 decode: the latency the pipeline adds
+//           before any network or playout buffering
+//   enc/dec thread CPU per second of audio
+//   bytes   mean datagram size including the 12-byte header, and datagrams per second
+//
+// frame_duration_bench [seconds]
+#include <opus.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "packet_codec.h"
+#include "simulcast_encoder.h"
+
+namespace {
+constexpr int kRate = 48000;
+constexpr int kMaxLag = kRate / 50;   // 20 ms, above any Opus delay
+
+// Band-limited noise with a slow envelope: no period for the alignment to lock onto
+std::vector<int16_t> signal(int seconds) {
+    std::vector<int16_t> pcm((size_t)kRate * 2 * seconds);
+    std::mt19937 rng(17);
+    std::normal_distribution<double> gauss(0, 1);
+    double lp = 0;
+    for (size_t i = 0; i < pcm.size() / 2; ++i) {
+        lp += (gauss(rng) - lp) * 0.3;
+        const double env = 0.6 + 0.4 * std::sin(2 * M_PI * 0.7 * i / kRate);
+        const double v = 9000 * env * lp;
+        pcm[i * 2] = (int16_t)v;
+        pcm[i * 2 + 1] = (int16_t)(v * 0.9);
+    }
+    return pcm;
+}
+
+// Lag (samples) of out behind in with the highest normalised correlation, left channel
+int bestLag(const std::vector<int16_t>& in, const std::vector<int16_t>& out) {
+    const size_t n = std::min(in.size(), out.size()) / 2 - kMaxLag;
+    const size_t start = kRate;   // skip the first second of encoder settling
+    const size_t len = std::min(n - start, (size_t)kRate);
+    int best = 0;
+    double bestScore = -1;
+    for (int lag = 0; lag <= kMaxLag; ++lag) {
+        double xy = 0, yy = 0;
+        for (size_t i = start; i < start + len; ++i) {
+            const double x = in[i * 2], y = out[(i + lag) * 2];
+            xy += x * y;
+            yy += y * y;
+        }
+        const double score = yy > 0 ? xy / std::sqrt(yy) : 0;
+        if (score > bestScore) {
+            bestScore = score;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+bool run(const std::vector<int16_t>& pcm, int seconds, int frameUs, bool lowDelay) {
+    const int frameSize = (int)((int64_t)kRate * frameUs / 1000000);
+    SimulcastEncoder::Config cfg;
+    cfg.frameSize = frameSize;
+    cfg.application = lowDelay ? OPUS_APPLICATION_RESTRICTED_LOWDELAY : OPUS_APPLICATION_AUDIO;
+    cfg.encodeShare = 0;
+    cfg.budgetUs = 1e9;
+    cfg.workerNice = 0;
+    SimulcastEncoder enc(cfg);
+    int err = 0;
+    OpusDecoder* dec = opus_decoder_create(kRate, 2, &err);
+    if (!enc.ok() || err != OPUS_OK) return false;
+
+    const int frames = (int)((int64_t)seconds * 1000000 / frameUs);
+    std::vector<int16_t> out((size_t)frames * frameSize * 2);
+    std::vector<double> encUs, decUs;
+    encUs.reserve(frames);
+    decUs.reserve(frames);
+    int64_t encCpu = 0, decCpu = 0, bytes = 0;
+    for (int f = 0; f < frames; ++f) {
+        int64_t c0 = bench::threadCpuNs();
+        const int r = enc.encode(&pcm[(size_t)f * frameSize * 2], f, (uint32_t)f * frameSize, 0, 1);
+        int64_t c1 = bench::threadCpuNs();
+        if (r != 1) {
+            std::printf("encode returned %d\n", r);
+            opus_decoder_destroy(dec);
+            return false;
+        }
+        bytes += enc.length(0);
+        const int n = opus_decode(dec, enc.datagram(0) + wspacket::kHeaderSize,
+                                  enc.length(0) - wspacket::kHeaderSize, &out[(size_t)f * frameSize * 2],
+                                  frameSize, 0);
+        const int64_t c2 = bench::threadCpuNs();
+        if (n != frameSize) {
+            std::printf("decode returned %d\n", n);
+            opus_decoder_destroy(dec);
+            return false;
+        }
+        encCpu += c1 - c0;
+        decCpu += c2 - c1;
+        encUs.push_back((double)(c1 - c0) / 1e3);
+        decUs.push_back((double)(c2 - c1) / 1e3);
+    }
+    opus_decoder_destroy(dec);
+
+    const double frameMs = frameUs / 1000.0;
+    const double delayMs = bestLag(pcm, out) * 1000.0 / kRate;
+    const double floorMs = frameMs + delayMs + (bench::percentile(encUs, 0.99) + bench::percentile(decUs, 0.99)) / 1e3;
+    std::printf("%4.1f ms %-8s  delay %4.1f ms  floor %5.1f ms  enc %5.1f ms/s  dec %5.1f ms/s  "
+                "%4lld B x %3d/s\n",
+                frameMs, lowDelay ? "lowdelay" : "audio", delayMs, floorMs, encCpu / 1e6 / seconds,
+                decCpu / 1e6 / seconds, (long long)(bytes / frames), 1000000 / frameUs);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = bench::intArg(argc, argv, 1, 30);
+    const std::vector<int16_t> pcm = signal(seconds + 1);
+    for (bool lowDelay : {false, true}) {
+        for (int frameUs : {2500, 5000, 10000, 20000, 40000, 60000}) {
+            if (!run(pcm, seconds, frameUs, lowDelay)) return 1;
+        }
+    }
+    return 0;
+}
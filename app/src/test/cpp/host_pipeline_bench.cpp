@@ -0,0 +1,208 @@
+// HostPipeline driven from a WAV file, as the capture thread drives it on a
+// phone: odd-sized chunks (1764 shorts, AudioRecord's 18.375 ms at 48 kHz stereo)
+// pushed into the frame assembler, then ring -> encode (3 tiers, governed) -> fan-out
+// to loopback guests on the pipeline's own threads.
+//
+// paced:  chunks arrive in real time (WavSource::pace); reports per-stage latency from
+//         the FrameTiming observer: frame complete -> dequeued -> encoded -> sent.
+// flood:  chunks are pushed as fast as the send thread keeps up (the ring held at most
+//         half full); reports the sustained frames per second.
+//
+// host_pipeline_bench [wav|-] [seconds] [guests] [frameSize]
+//   "-" (the default) synthesizes a two-tone-plus-noise stereo WAV next to the binary.
+#include <opus.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "host_pipeline.h"
+#include "wav_source.h"
+
+namespace {
+constexpr int kRate = 48000;
+constexpr int kChunkShorts = 1764;
+
+bool writeWav(const char* path, int seconds) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t shorts = (uint32_t)kRate * 2 * seconds;
+    auto w32 = [&](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto w16 = [&](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    w32(36 + 12 + shorts * 2);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    w32(16);
+    w16(1);
+    w16(2);
+    w32(kRate);
+    w32(kRate * 4);
+    w16(4);
+    w16(16);
+    // An unknown chunk before the data, as many encoders write
+    std::fwrite("LIST", 1, 4, f);
+    w32(4);
+    std::fwrite("INFO", 1, 4, f);
+    std::fwrite("data", 1, 4, f);
+    w32(shorts * 2);
+    std::mt19937 rng(20);
+    std::normal_distribution<double> gauss(0, 1500);
+    for (uint32_t i = 0; i < shorts; ++i) {
+        const double t = (double)(i / 2) / kRate;
+        const double v = 9000 * std::sin(2 * M_PI * 440 * t) + 6000 * std::sin(2 * M_PI * 1330 * t + (i & 1)) +
+                         gauss(rng);
+        w16((uint16_t)(int16_t)v);
+    }
+    return std::fclose(f) == 0;
+}
+
+struct Sink {
+    int fd = -1;
+    sockaddr_in addr{};
+    std::atomic<bool> stop{false};
+    std::atomic<long> datagrams{0};
+    std::thread thread;
+
+    bool open() {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) return false;
+        socklen_t len = sizeof addr;
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        const int big = 4 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &big, sizeof big);
+        const timeval tv{0, 100000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        thread = std::thread([this] {
+            uint8_t buf[2048];
+            while (!stop.load()) {
+                if (recv(fd, buf, sizeof buf, 0) > 0) ++datagrams;
+            }
+        });
+        return true;
+    }
+
+    ~Sink() {
+        stop = true;
+        if (thread.joinable()) thread.join();
+        if (fd >= 0) close(fd);
+    }
+};
+
+bool run(const char* wav, int seconds, int guests, int frameSize, bool paced) {
+    WavSource source;
+    if (!source.open(wav) || source.sampleRate() != kRate || source.channels() != 2) {
+        std::printf("%s: not a 48 kHz stereo 16-bit WAV\n", wav);
+        return false;
+    }
+    Sink sink;
+    if (!sink.open()) return false;
+
+    HostPipeline::Config cfg;
+    SimulcastEncoder::Config& e = cfg.encoder;
+    e.frameSize = frameSize;
+    e.application = OPUS_APPLICATION_AUDIO;
+    e.tiers = 3;
+    e.workerNice = 0;
+    e.budgetUs = frameSize * 1e6 / kRate * 0.4;
+    cfg.ringFrames = std::max(4, 320 * kRate / 1000 / frameSize);
+    cfg.sendNice = 0;
+    cfg.nackNice = 0;
+    HostPipeline pipeline(cfg);
+    if (!pipeline.ok()) {
+        std::printf("pipeline failed\n");
+        return false;
+    }
+
+    const int64_t totalShorts = (int64_t)seconds * kRate * 2;
+    const size_t frames = (size_t)(totalShorts / (frameSize * 2)) + 1;
+    std::vector<double> queueUs, encodeUs, sendUs, totalUs;
+    queueUs.reserve(frames);
+    encodeUs.reserve(frames);
+    sendUs.reserve(frames);
+    totalUs.reserve(frames);
+    std::atomic<long> sent{0};
+    pipeline.setObserver([&](const HostPipeline::FrameTiming& t) {
+        if (queueUs.size() < frames) {
+            queueUs.push_back((double)(t.dequeuedNs - t.readyNs) / 1e3);
+            encodeUs.push_back((double)(t.encodedNs - t.dequeuedNs) / 1e3);
+            sendUs.push_back((double)(t.sentNs - t.encodedNs) / 1e3);
+            totalUs.push_back((double)(t.sentNs - t.readyNs) / 1e3);
+        }
+        sent.fetch_add(1, std::memory_order_release);
+    });
+
+    std::vector<const uint8_t*> ips(guests, reinterpret_cast<const uint8_t*>(&sink.addr.sin_addr));
+    std::vector<int> lens(guests, 4), ports(guests, ntohs(sink.addr.sin_port));
+    pipeline.setTargets(ips.data(), lens.data(), ports.data(), guests);
+    if (!pipeline.start()) return false;
+
+    std::vector<int16_t> chunk(kChunkShorts);
+    int64_t pushed = 0;
+    const int64_t start = bench::nowNs();
+    while (pushed < totalShorts) {
+        const int n = source.read(chunk.data(), (int)std::min<int64_t>(kChunkShorts, totalShorts - pushed), true);
+        if (n <= 0) break;
+        pipeline.push(chunk.data(), n);
+        pushed += n;
+        if (paced) {
+            source.pace(pushed);
+        } else {
+            // Keep the ring at most half full: throughput is what the send thread
+            // sustains, not what overwriting throws away
+            const long assembled = (long)(pushed / pipeline.frameShorts());
+            while (assembled - sent.load(std::memory_order_acquire) > cfg.ringFrames / 2) std::this_thread::yield();
+        }
+    }
+    HostPipeline::Stats stats;
+    for (int i = 0; i < 200; ++i) {
+        pipeline.stats(&stats);
+        if (sent.load() >= (long)(pushed / pipeline.frameShorts()) - stats.overwritten) break;
+        usleep(10000);
+    }
+    const double wallS = (double)(bench::nowNs() - start) / 1e9;
+    pipeline.stop();
+    pipeline.stats(&stats);
+
+    const double audioS = (double)pushed / (kRate * 2);
+    std::printf("%s  frame %d  %d guests  %.0f s audio in %.2f s  %ld frames sent (%.1fx real time)  "
+                "overwritten %lld  datagrams %ld  complexity %d\n",
+                paced ? "paced" : "flood", frameSize, guests, audioS, wallS, sent.load(), audioS / wallS,
+                (long long)stats.overwritten, sink.datagrams.load(), stats.encodeTimes.complexity);
+    std::printf("  p50 / p99 / max us  queue %.0f / %.0f / %.0f  encode %.0f / %.0f / %.0f  "
+                "send %.0f / %.0f / %.0f  total %.0f / %.0f / %.0f\n",
+                bench::percentile(queueUs, 0.5), bench::percentile(queueUs, 0.99), bench::percentile(queueUs, 1),
+                bench::percentile(encodeUs, 0.5), bench::percentile(encodeUs, 0.99),
+                bench::percentile(encodeUs, 1), bench::percentile(sendUs, 0.5), bench::percentile(sendUs, 0.99),
+                bench::percentile(sendUs, 1), bench::percentile(totalUs, 0.5), bench::percentile(totalUs, 0.99),
+                bench::percentile(totalUs, 1));
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string wav = argc > 1 ? argv[1] : "-";
+    const int seconds = bench::intArg(argc, argv, 2, 20);
+    const int guests = bench::intArg(argc, argv, 3, 8);
+    const int frameSize = bench::intArg(argc, argv, 4, 960);
+    if (wav == "-") {
+        wav = "host_pipeline_bench.wav";
+        if (!writeWav(wav.c_str(), 10)) return 1;
+    }
+    for (bool paced : {true, false}) {
+        if (!run(wav.c_str(), seconds, guests, frameSize, paced)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// JitterBuffer against the structure it replaced: a mutex-guarded map of
+// heap-allocated payloads with a condition variable, as the Kotlin buffer was.
+//
+// 1) put / pop cost on one thread, packets arriving reordered.
+// 2) Handoff latency rx -> playout thread: the producer stamps each packet, paced at
+//    one per `periodUs`, and the consumer waits for seqs in order, as playout does.
+//    Latency runs from the later of the packet's put and the previous seq's pop, so
+//    time spent waiting for a reordered predecessor is not charged to the buffer.
+//
+// jitter_buffer_bench [packets] [periodUs]
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "jitter_buffer.h"
+
+namespace {
+constexpr int kPayload = 320;   // a 20 ms stereo frame at 128 kb/s
+
+class MutexBuffer {
+public:
+    bool put(int32_t seq, const uint8_t* payload, int length) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            packets_[seq].assign(payload, payload + length);
+        }
+        cv_.notify_all();
+        return true;
+    }
+
+    int copyPayload(int32_t seq, uint8_t* dst, int cap, bool remove) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = packets_.find(seq);
+        if (it == packets_.end()) return JitterBuffer::kMissing;
+        const int n = std::min(cap, (int)it->second.size());
+        std::memcpy(dst, it->second.data(), (size_t)n);
+        if (remove) packets_.erase(it);
+        return n;
+    }
+
+    bool waitForSeq(int32_t seq, int waitMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::milliseconds(waitMs),
+                            [&] { return packets_.count(seq) != 0; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<int32_t, std::vector<uint8_t>> packets_;
+};
+
+// Arrival order: 10% of packets swap with one up to 3 places later
+std::vector<int32_t> reordered(int count) {
+    std::vector<int32_t> order(count);
+    for (int i = 0; i < count; ++i) order[i] = i;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> u(0, 1);
+    for (int i = 0; i + 3 < count; ++i) {
+        if (u(rng) < 0.1) std::swap(order[i], order[i + 1 + (int)(u(rng) * 3)]);
+    }
+    return order;
+}
+
+template <typename Buffer>
+void singleThread(const char* name, Buffer& buffer, const std::vector<int32_t>& order) {
+    uint8_t payload[kPayload] = {};
+    uint8_t out[1500];
+    const int n = (int)order.size();
+    std::vector<double> putNs, popNs;
+    putNs.reserve(n);
+    popNs.reserve(n);
+
+    // Playout trails arrival by 8 packets, so reordered ones are in by the time they are due
+    constexpr int kLag = 8;
+    for (int i = 0; i < n + kLag; ++i) {
+        if (i < n) {
+            const int64_t t0 = bench::nowNs();
+            buffer.put(order[i], payload, kPayload);
+            putNs.push_back((double)(bench::nowNs() - t0));
+        }
+        if (i >= kLag) {
+            const int64_t t0 = bench::nowNs();
+            const int got = buffer.copyPayload(i - kLag, out, sizeof out, true);
+            popNs.push_back((double)(bench::nowNs() - t0));
+            bench::keep(&got);
+        }
+    }
+    std::printf("%-8s put  p50 %6.0f ns  p99 %6.0f ns | pop p50 %6.0f ns  p99 %6.0f ns\n", name,
+                bench::percentile(putNs, 0.5), bench::percentile(putNs, 0.99),
+                bench::percentile(popNs, 0.5), bench::percentile(popNs, 0.99));
+}
+
+template <typename Buffer>
+void handoff(const char* name, Buffer& buffer, const std::vector<int32_t>& order, int periodUs) {
+    const int n = (int)order.size();
+    std::vector<std::atomic<int64_t>> stamps(n);
+    std::thread producer([&] {
+        uint8_t payload[kPayload] = {};
+        int64_t next = bench::nowNs();
+        for (int i = 0; i < n; ++i) {
+            next += (int64_t)periodUs * 1000;
+            while (bench::nowNs() < next) std::this_thread::sleep_for(std::chrono::microseconds(20));
+            stamps[order[i]].store(bench::nowNs(), std::memory_order_release);
+            buffer.put(order[i], payload, kPayload);
+        }
+    });
+
+    uint8_t out[1500];
+    std::vector<double> latencyUs;
+    latencyUs.reserve(n);
+    int missed = 0;
+    int64_t lastPopNs = 0;
+    for (int s = 0; s < n; ++s) {
+        if (!buffer.waitForSeq(s, 50) || buffer.copyPayload(s, out, sizeof out, true) < 0) {
+            ++missed;
+            continue;
+        }
+        const int64_t now = bench::nowNs();
+        const int64_t ready = std::max(stamps[s].load(std::memory_order_acquire), lastPopNs);
+        latencyUs.push_back((double)(now - ready) / 1e3);
+        lastPopNs = now;
+    }
+    producer.join();
+    std::printf("%-8s handoff p50 %6.1f us  p99 %6.1f us  max %7.1f us  missed %d\n", name,
+                bench::percentile(latencyUs, 0.5), bench::percentile(latencyUs, 0.99),
+                bench::percentile(latencyUs, 1.0), missed);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int packets = bench::intArg(argc, argv, 1, 200000);
+    const int periodUs = bench::intArg(argc, argv, 2, 500);
+    const std::vector<int32_t> order = reordered(packets);
+
+    std::printf("packets=%d payload=%d B, 10%% reordered by up to 3\n", packets, kPayload);
+    {
+        JitterBuffer ring(512, 1500);
+        MutexBuffer map;
+        singleThread("ring", ring, order);
+        singleThread("mutex", map, order);
+    }
+
+    const int handoffPackets = std::min(packets, 20000);
+    const std::vector<int32_t> paced = reordered(handoffPackets);
+    std::printf("handoff: %d packets, one per %d us\n", handoffPackets, periodUs);
+    {
+        JitterBuffer ring(512, 1500);
+        MutexBuffer map;
+        handoff("ring", ring, paced, periodUs);
+        handoff("mutex", map, paced, periodUs);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// JitterBuffer: ordering, eviction, stale stragglers vs a sequence restart,
+// and payload integrity across the rx / playout threads.
+#include <cstring>
+#include <thread>
+
+#include "check.h"
+#include "jitter_buffer.h"
+
+namespace {
+uint8_t payload[1500];
+uint8_t out[1500];
+
+void basics() {
+    JitterBuffer jb(512, 1500);
+    CHECK(jb.put(5, payload, 10));
+    CHECK(jb.put(3, payload, 20));
+    CHECK(jb.put(7, payload, 30));
+    int32_t first = -1;
+    CHECK(jb.firstSeq(&first) && first == 3);
+    CHECK_EQ(jb.size(), 3);
+
+    CHECK_EQ(jb.copyPayload(3, out, sizeof out, true), 20);
+    CHECK_EQ(jb.size(), 2);
+    CHECK(jb.firstSeq(&first) && first == 5);
+    CHECK_EQ(jb.copyPayload(5, out, sizeof out, false), 10);
+    CHECK(jb.contains(5));
+    CHECK_EQ(jb.copyPayload(6, out, sizeof out, true), JitterBuffer::kMissing);
+
+    // A late packet below the current first
+    CHECK(jb.put(4, payload, 5));
+    CHECK(jb.firstSeq(&first) && first == 4);
+
+    jb.dropOlderThan(7);
+    CHECK_EQ(jb.size(), 1);
+    CHECK(jb.firstSeq(&first) && first == 7);
+
+    // One ring ahead overwrites the slot
+    CHECK(jb.put(7 + 512, payload, 1));
+    CHECK_EQ(jb.size(), 1);
+    CHECK(!jb.contains(7));
+    CHECK(jb.contains(7 + 512));
+
+    CHECK(!jb.put(600, payload, 1501));   // larger than a slot
+
+    jb.clear();
+    CHECK_EQ(jb.size(), 0);
+    CHECK(!jb.firstSeq(&first));
+}
+
+void staleStragglers() {
+    JitterBuffer jb(512, 1500);
+    for (int s = 1000; s < 1010; ++s) CHECK(jb.put(s, payload, 8));
+
+    // More than a ring behind head: dropped and counted, the buffer is left alone
+    CHECK(!jb.put(1000 - 600, payload, 8));
+    CHECK_EQ(jb.staleDropped(), 1);
+    CHECK_EQ(jb.size(), 10);
+    CHECK(jb.contains(1009));
+    CHECK(jb.put(1010, payload, 8));
+
+    // A current packet in between resets the run: no restart from scattered stragglers
+    for (int k = 0; k < 3; ++k) {
+        for (int i = 0; i < JitterBuffer::kRestartRun - 1; ++i) CHECK(!jb.put(100 + i, payload, 8));
+        CHECK(jb.put(1011 + k, payload, 8));
+    }
+    CHECK_EQ(jb.size(), 14);
+    CHECK_EQ(jb.staleDropped(), 1 + 3 * (JitterBuffer::kRestartRun - 1));
+
+    // A run of them is the host restarting from a low sequence: start over from it
+    for (int i = 0; i < JitterBuffer::kRestartRun - 1; ++i) CHECK(!jb.put(i, payload, 8));
+    CHECK(jb.put(JitterBuffer::kRestartRun - 1, payload, 8));
+    CHECK_EQ(jb.size(), 1);
+    CHECK(!jb.contains(1009));
+    CHECK(jb.contains(JitterBuffer::kRestartRun - 1));
+    CHECK(jb.put(JitterBuffer::kRestartRun, payload, 8));
+    CHECK_EQ(jb.size(), 2);
+}
+
+void threaded() {
+    constexpr int kCount = 20000;
+    JitterBuffer jb(512, 1500);
+    std::thread producer([&] {
+        uint8_t b[64];
+        for (int i = 0; i < kCount; ++i) {
+            std::memset(b, (uint8_t)i, sizeof b);
+            jb.put(i, b, sizeof b);
+            if (i % 8 == 0) std::this_thread::yield();
+        }
+    });
+    int got = 0, corrupt = 0;
+    for (int s = 0; s < kCount; ++s) {
+        if (!jb.waitForSeq(s, 50)) continue;
+        const int n = jb.copyPayload(s, out, sizeof out, true);
+        if (n != 64) continue;
+        ++got;
+        for (int k = 0; k < 64; ++k) {
+            if (out[k] != (uint8_t)s) {
+                ++corrupt;
+                break;
+            }
+        }
+    }
+    producer.join();
+    CHECK_EQ(corrupt, 0);
+    // Only packets overwritten while the consumer lagged a full ring may be missing
+    CHECK(got > kCount / 2);
+}
+} // namespace
+
+int main() {
+    basics();
+    staleStragglers();
+    threaded();
+    return check::result("jitter_buffer_test");
+}
@@ -0,0 +1,103 @@
+// Host send cost per frame in multicast mode stays flat from 1 to 100
+// receivers, against unicast fan-out (one sendmmsg entry per receiver).
+//
+// Receivers are loopback sockets that all joined 239.255.42.99 on 127.0.0.1 and share
+// one port (SO_REUSEADDR), so the kernel hands each a copy of every group datagram.
+// The sender is UdpSender configured as the host does for group delivery. Without a
+// multicast-capable loopback the group column reports 0% delivered.
+//
+// multicast_bench [frames]
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bench.h"
+#include "udp_sender.h"
+
+namespace {
+constexpr int kPacket = 300;
+const uint8_t kLoopback[4] = {127, 0, 0, 1};
+const uint8_t kGroup[4] = {239, 255, 42, 99};
+
+// Binds to `*port` (0: pick one and return it), joined to the group
+int groupReceiver(int* port) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons((uint16_t)*port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof a);
+    socklen_t len = sizeof a;
+    getsockname(fd, reinterpret_cast<sockaddr*>(&a), &len);
+    *port = ntohs(a.sin_port);
+    ip_mreq m{};
+    std::memcpy(&m.imr_multiaddr, kGroup, 4);
+    std::memcpy(&m.imr_interface, kLoopback, 4);
+    setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof m);
+    const int big = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &big, sizeof big);
+    return fd;
+}
+
+long drain(const std::vector<int>& fds) {
+    char buf[2048];
+    long got = 0;
+    for (int fd : fds) {
+        while (recv(fd, buf, sizeof buf, MSG_DONTWAIT) > 0) ++got;
+    }
+    return got;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 2000);
+    uint8_t packet[kPacket] = {};
+
+    std::printf("frames=%d, %d-byte datagrams\n", frames, kPacket);
+    for (int receivers : {1, 10, 50, 100}) {
+        int port = 0;
+        std::vector<int> fds(receivers);
+        for (int i = 0; i < receivers; ++i) fds[i] = groupReceiver(&port);
+
+        UdpSender group;
+        group.setGroupInterface(kLoopback);
+        const uint8_t* groupIp[1] = {kGroup};
+        const int groupLen[1] = {4};
+        const int groupPort[1] = {port};
+        group.setTargets(groupIp, groupLen, groupPort, 1);
+
+        // Unicast baseline: one datagram per receiver to the shared port. The kernel
+        // gives each to one of the sockets, so only its send cost is compared
+        UdpSender unicast;
+        std::vector<const uint8_t*> ips(receivers, kLoopback);
+        std::vector<int> lens(receivers, 4), ports(receivers, port), errors(receivers);
+        unicast.setTargets(ips.data(), lens.data(), ports.data(), receivers);
+
+        int64_t groupNs = 0, unicastNs = 0;
+        long delivered = 0;
+        int error = 0;
+        for (int f = 0; f < frames; ++f) {
+            int64_t t0 = bench::nowNs();
+            group.sendToAll(packet, kPacket, &error);
+            groupNs += bench::nowNs() - t0;
+            delivered += drain(fds);
+
+            t0 = bench::nowNs();
+            unicast.sendToAll(packet, kPacket, errors.data());
+            unicastNs += bench::nowNs() - t0;
+            drain(fds);
+        }
+        std::printf("receivers %3d  multicast send %6.1f us/frame (delivered %5.1f%%)  "
+                    "unicast sendmmsg %7.1f us/frame\n",
+                    receivers, groupNs / 1e3 / frames, 100.0 * delivered / ((double)frames * receivers),
+                    unicastNs / 1e3 / frames);
+        for (int fd : fds) close(fd);
+    }
+    return 0;
+}
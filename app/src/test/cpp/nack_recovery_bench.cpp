@@ -0,0 +1,119 @@
+// How much of a 5% burst loss the NACK / resend path recovers in time.
+//
+// In-process simulation of one guest on a 1 ms clock: the host stores every 20 ms
+// packet in a RetransmitCache and sends it; the guest's NackTracker sees arrivals and
+// emits NACKs; the host answers from the cache. Media, NACKs and resends each cross
+// their own Gilbert-Elliott channel (p = 0.0175, r = 1/3: 5% loss in bursts of 3
+// packets on average) with 2..12 ms of uniform one-way delay. A packet counts as
+// recovered if it arrives before its playout deadline (send time + the deadline).
+//
+// nack_recovery_bench [minutes]
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "nack_tracker.h"
+#include "packet_codec.h"
+#include "retransmit.h"
+
+namespace {
+class GilbertElliott {
+public:
+    GilbertElliott(double p, double r, unsigned seed) : p_(p), r_(r), rng_(seed) {}
+
+    bool lost() {
+        const double u = uniform_(rng_);
+        bad_ = bad_ ? u >= r_ : u < p_;
+        return bad_;
+    }
+
+private:
+    double p_, r_;
+    bool bad_ = false;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_{0, 1};
+};
+
+void run(int frames) {
+    GilbertElliott media(0.0175, 1.0 / 3, 1), nacks(0.0175, 1.0 / 3, 2), resends(0.0175, 1.0 / 3, 3);
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> delayMs(2.0, 12.0);
+
+    NackTracker tracker;
+    RetransmitCache cache(64, 1500);
+    std::multimap<double, int32_t> toGuest;
+    std::multimap<double, std::vector<wspacket::NackEntry>> toHost;
+    std::vector<double> arrivalMs(frames, -1);
+    uint8_t packet[64] = {};
+    uint8_t resent[1500];
+    long mediaLost = 0, resentCount = 0;
+
+    int32_t seq = 0;
+    for (int ms = 0; ms < frames * 20 + 1000; ++ms) {
+        const double t = ms;
+        if (ms % 20 == 0 && seq < frames) {
+            wspacket::writeHeader(packet, seq, (uint32_t)ms, 0);
+            cache.store(packet, 20);
+            if (media.lost()) {
+                ++mediaLost;
+            } else {
+                toGuest.emplace(t + delayMs(rng), seq);
+            }
+            ++seq;
+        }
+        while (!toGuest.empty() && toGuest.begin()->first <= t) {
+            const int32_t s = toGuest.begin()->second;
+            toGuest.erase(toGuest.begin());
+            if (arrivalMs[s] < 0) arrivalMs[s] = t;
+            tracker.onReceived(s, (int64_t)(t * 1e6));
+        }
+        while (!toHost.empty() && toHost.begin()->first <= t) {
+            const std::vector<wspacket::NackEntry> entries = toHost.begin()->second;
+            toHost.erase(toHost.begin());
+            for (const wspacket::NackEntry& e : entries) {
+                // The entry's seq plus one per bitmap bit
+                for (int b = -1; b < 32; ++b) {
+                    if (b >= 0 && !(e.bitmap & (1u << b))) continue;
+                    const int32_t s = e.seq + b + 1;
+                    if (cache.lookup(s, resent, sizeof resent) <= 0) continue;
+                    ++resentCount;
+                    if (!resends.lost()) toGuest.emplace(t + delayMs(rng), s);
+                }
+            }
+        }
+        wspacket::NackEntry entries[32];
+        const int n = tracker.collect((int64_t)(t * 1e6), entries, 32);
+        if (n > 0 && !nacks.lost()) {
+            toHost.emplace(t + delayMs(rng), std::vector<wspacket::NackEntry>(entries, entries + n));
+        }
+    }
+
+    const NackTracker::Stats& st = tracker.stats();
+    std::printf("media lost %.2f%%; NACK datagrams %ld, resends %ld (%.2f%% of media), abandoned %ld\n",
+                100.0 * mediaLost / frames, (long)st.nacksSent, resentCount, 100.0 * resentCount / frames,
+                (long)st.abandoned);
+    for (double deadlineMs : {100.0, 200.0, 400.0}) {
+        long missing = 0, late = 0;
+        for (int s = 0; s < frames; ++s) {
+            if (arrivalMs[s] < 0) {
+                ++missing;
+            } else if (arrivalMs[s] > s * 20.0 + deadlineMs) {
+                ++late;
+            }
+        }
+        std::printf("deadline %3.0f ms: residual loss %.3f%%, recovered in time %.1f%% (late %ld, never %ld)\n",
+                    deadlineMs, 100.0 * (missing + late) / frames,
+                    100.0 * (mediaLost - (missing + late)) / mediaLost, late, missing);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int minutes = bench::intArg(argc, argv, 1, 60);
+    const int frames = minutes * 60 * 50;
+    std::printf("%d min of 20 ms frames, 5%% Gilbert-Elliott burst loss on media, NACKs and resends\n", minutes);
+    run(frames);
+    return 0;
+}
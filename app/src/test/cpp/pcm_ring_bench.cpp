@@ -0,0 +1,165 @@
+// Capture -> send handoff: PcmRing against the path it replaced, a pool
+// and a queue of frame buffers as two ArrayBlockingQueues (each one lock with
+// notEmpty / notFull conditions), modelled here with std::mutex and
+// std::condition_variable.
+//
+// The producer is paced at one 20 ms stereo frame per `periodUs` (shortened so the
+// run is quick) and stamps each frame; the consumer blocks for the next frame and
+// measures stamp -> frame copied out. Run with a third thread spinning on the same
+// core(s) to see how each handoff behaves when the consumer has to be scheduled in.
+//
+// pcm_ring_bench [frames] [periodUs]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "pcm_ring.h"
+
+namespace {
+constexpr int kFrameShorts = 1920;
+
+template <typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity) : capacity_(capacity) {}
+
+    bool offer(T v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= capacity_) return false;
+        queue_.push_back(v);
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    bool poll(T* v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) return false;
+        *v = queue_.front();
+        queue_.pop_front();
+        return true;
+    }
+
+    bool take(T* v, int waitMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!notEmpty_.wait_for(lock, std::chrono::milliseconds(waitMs), [&] { return !queue_.empty(); })) {
+            return false;
+        }
+        *v = queue_.front();
+        queue_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::deque<T> queue_;
+    const size_t capacity_;
+};
+
+struct Buffer {
+    std::vector<int16_t> pcm = std::vector<int16_t>(kFrameShorts);
+    int64_t stampNs = 0;
+};
+
+void pace(int i, int64_t startNs, int periodUs) {
+    const int64_t due = startNs + (int64_t)i * periodUs * 1000;
+    for (int64_t now = bench::nowNs(); now < due; now = bench::nowNs()) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+    }
+}
+
+void report(const char* name, std::vector<double>& us) {
+    double sum = 0;
+    for (double x : us) sum += x;
+    const double mean = sum / us.size();
+    double var = 0;
+    for (double x : us) var += (x - mean) * (x - mean);
+    std::printf("  %-14s p50 %6.1f  p90 %6.1f  p99 %7.1f  p99.9 %7.1f  max %8.1f  sd %6.1f us\n", name,
+                bench::percentile(us, 0.5), bench::percentile(us, 0.9), bench::percentile(us, 0.99),
+                bench::percentile(us, 0.999), bench::percentile(us, 1.0), std::sqrt(var / us.size()));
+}
+
+void queues(const std::vector<int16_t>& src, int frames, int periodUs) {
+    BlockingQueue<Buffer*> pool(32), queue(16);
+    std::vector<Buffer> store(32);
+    for (Buffer& b : store) pool.offer(&b);
+    std::vector<double> us;
+    us.reserve(frames);
+    std::thread consumer([&] {
+        std::vector<int16_t> work(kFrameShorts);
+        for (int n = 0; n < frames;) {
+            Buffer* b;
+            if (!queue.take(&b, 100)) continue;
+            std::copy(b->pcm.begin(), b->pcm.end(), work.begin());
+            us.push_back((double)(bench::nowNs() - b->stampNs) / 1e3);
+            pool.offer(b);
+            ++n;
+        }
+    });
+    const int64_t start = bench::nowNs();
+    for (int i = 0; i < frames; ++i) {
+        pace(i, start, periodUs);
+        Buffer* b;
+        while (!pool.poll(&b)) std::this_thread::yield();
+        std::copy(src.begin(), src.end(), b->pcm.begin());
+        b->stampNs = bench::nowNs();
+        queue.offer(b);
+    }
+    consumer.join();
+    report("mutex queues", us);
+}
+
+void ring(const std::vector<int16_t>& src, int frames, int periodUs) {
+    PcmRing ring(16, kFrameShorts);
+    std::vector<double> us;
+    us.reserve(frames);
+    std::thread consumer([&] {
+        std::vector<int16_t> work(kFrameShorts);
+        for (int n = 0; n < frames;) {
+            PcmRing::Frame meta;
+            if (!ring.read(&meta, 100, [&](const int16_t* s) { std::copy(s, s + kFrameShorts, work.begin()); })) {
+                continue;
+            }
+            us.push_back((double)(bench::nowNs() - meta.readyNs) / 1e3);
+            ++n;
+        }
+    });
+    const int64_t start = bench::nowNs();
+    for (int i = 0; i < frames; ++i) {
+        pace(i, start, periodUs);
+        ring.write(src.data(), PcmRing::Frame{i, 0, bench::nowNs()});
+    }
+    consumer.join();
+    report("PcmRing", us);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 5000);
+    const int periodUs = bench::intArg(argc, argv, 2, 2000);
+    const std::vector<int16_t> src(kFrameShorts, 7);
+    for (bool busy : {false, true}) {
+        std::atomic<bool> quit{false};
+        std::thread spinner;
+        if (busy) {
+            spinner = std::thread([&] {
+                volatile long x = 0;
+                while (!quit.load(std::memory_order_relaxed)) x = x + 1;
+            });
+        }
+        std::printf("%d frames every %d us%s:\n", frames, periodUs, busy ? ", one busy thread" : "");
+        queues(src, frames, periodUs);
+        ring(src, frames, periodUs);
+        quit = true;
+        if (spinner.joinable()) spinner.join();
+    }
+    return 0;
+}
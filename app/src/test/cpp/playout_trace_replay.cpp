@@ -0,0 +1,125 @@
+// Replays an arrival trace through PlayoutDelayController and reports the
+// target it settles on and the underruns that target would have caused.
+//
+// The trace is CSV: seq,pts,arrival_ns, one line per received packet in arrival order
+// ('#' lines and a header are skipped; traces/ has a sample). Playout is modelled the
+// way the quantile is defined: frame seq is due at its send time plus the fastest
+// transit seen so far plus the current target delay. Arrivals up to that moment are
+// fed first; a frame that is not in by then is an underrun (PLC), a frame that never
+// arrives is a loss (PLC too).
+//
+// playout_trace_replay trace.csv [frameMs] [minFrames] [maxFrames] [initialFrames]
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "packet_codec.h"
+#include "playout_delay.h"
+
+namespace {
+struct Arrival {
+    int32_t seq;
+    uint32_t pts;
+    int64_t arrivalNs;
+};
+
+bool readTrace(const char* path, std::vector<Arrival>* out) {
+    FILE* f = std::fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    while (std::fgets(line, sizeof line, f)) {
+        long long seq, pts, at;
+        if (line[0] == '#' || std::sscanf(line, "%lld,%lld,%lld", &seq, &pts, &at) != 3) continue;
+        out->push_back({(int32_t)seq, (uint32_t)pts, (int64_t)at});
+    }
+    std::fclose(f);
+    return !out->empty();
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s trace.csv [frameMs] [minFrames] [maxFrames] [initialFrames]\n",
+                     argv[0]);
+        return 2;
+    }
+    std::vector<Arrival> trace;
+    if (!readTrace(argv[1], &trace)) {
+        std::fprintf(stderr, "%s: no arrivals\n", argv[1]);
+        return 1;
+    }
+
+    PlayoutDelayController::Config cfg;
+    cfg.frameMs = argc > 2 ? std::atof(argv[2]) : 20.0;
+    cfg.minFrames = argc > 3 ? std::atoi(argv[3]) : 4;
+    cfg.maxFrames = argc > 4 ? std::atoi(argv[4]) : 25;
+    cfg.initialFrames = argc > 5 ? std::atoi(argv[5]) : 10;
+    PlayoutDelayController controller(cfg);
+
+    int32_t firstSeq = trace[0].seq, lastSeq = trace[0].seq;
+    for (const Arrival& a : trace) {
+        firstSeq = std::min(firstSeq, a.seq);
+        lastSeq = std::max(lastSeq, a.seq);
+    }
+    const int frames = lastSeq - firstSeq + 1;
+    std::vector<int64_t> arrivedNs(frames, -1);
+    std::vector<double> sendMs(frames, 0);
+    for (const Arrival& a : trace) {
+        arrivedNs[a.seq - firstSeq] = a.arrivalNs;
+    }
+    // Send times from pts where known, else by frame count (lost packets)
+    const double ticksPerFrame = cfg.frameMs * wspacket::kPtsRate / 1000;
+    const uint32_t pts0 = trace[0].pts - (uint32_t)((trace[0].seq - firstSeq) * ticksPerFrame);
+    for (int i = 0; i < frames; ++i) sendMs[i] = i * cfg.frameMs;
+    for (const Arrival& a : trace) {
+        sendMs[a.seq - firstSeq] = (double)(int32_t)(a.pts - pts0) * 1000.0 / wspacket::kPtsRate;
+    }
+
+    size_t next = 0;
+    double minTransitMs = 1e18;
+    int late = 0, lost = 0, windowLate = 0, windowLost = 0;
+    double targetMsSum = 0;
+    const int reportEvery = std::max(1, (int)(10000 / cfg.frameMs));
+
+    std::printf("trace=%s frames=%d received=%zu frameMs=%.1f\n", argv[1], frames, trace.size(), cfg.frameMs);
+    std::printf("%8s %7s %8s %8s %8s %8s %6s %6s\n", "t_s", "target", "targetMs", "qDelayMs", "jitterMs",
+                "quantile", "late", "lost");
+    for (int i = 0; i < frames; ++i) {
+        // Feed arrivals until the frame's deadline under the target they produce
+        double dueMs = 0;
+        for (;;) {
+            dueMs = sendMs[i] + minTransitMs + controller.targetFrames() * cfg.frameMs;
+            if (next >= trace.size() || (double)trace[next].arrivalNs / 1e6 > dueMs) break;
+            const Arrival& a = trace[next++];
+            controller.onArrival(a.seq, a.pts, a.arrivalNs);
+            minTransitMs = std::min(minTransitMs, (double)a.arrivalNs / 1e6 - sendMs[a.seq - firstSeq]);
+        }
+
+        PlayoutDelayController::Outcome outcome = PlayoutDelayController::kDecoded;
+        if (arrivedNs[i] < 0) {
+            outcome = PlayoutDelayController::kPlc;
+            ++lost;
+            ++windowLost;
+        } else if ((double)arrivedNs[i] / 1e6 > dueMs) {
+            outcome = PlayoutDelayController::kPlc;
+            ++late;
+            ++windowLate;
+        }
+        const int target = controller.onFrame(outcome);
+        targetMsSum += target * cfg.frameMs;
+
+        if ((i + 1) % reportEvery == 0 || i + 1 == frames) {
+            std::printf("%8.1f %7d %8.0f %8.1f %8.2f %8.4f %6d %6d\n", (i + 1) * cfg.frameMs / 1000, target,
+                        target * cfg.frameMs, controller.quantileDelayMs(), controller.jitterMs(),
+                        controller.currentQuantile(), windowLate, windowLost);
+            windowLate = 0;
+            windowLost = 0;
+        }
+    }
+
+    std::printf("underruns: late %d (%.2f%%), lost %d (%.2f%%); mean target %.1f ms; final PLC rate %.4f\n",
+                late, 100.0 * late / frames, lost, 100.0 * lost / frames, targetMsSum / frames,
+                controller.plcRate());
+    return 0;
+}
@@ -0,0 +1,93 @@
+// AsyncResampler against two simulated clocks.
+//
+// The host clock sends a 20 ms packet every 960 of its own samples; the guest device
+// plays 48000 samples per second of its clock. The clocks differ by `skew` ppm. The
+// guest takes the next packet from the buffer whenever the device has played what it
+// produced so far, resamples it, and feeds the buffer depth (whole packets, as
+// JitterBuffer::size reports it) to the PI loop. Without correction the depth walks
+// off by 0.18 packets per hour per ppm; with it, depth must stay near the target and
+// the averaged correction must match the skew. Whole-packet depth makes the loop
+// hunt by a packet, so the average needs a long window: 20 minutes by default,
+// hours when given.
+//
+// resampler_drift_test [minutes per skew]
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "check.h"
+#include "resampler.h"
+
+namespace {
+constexpr int kFrame = 960;
+constexpr int kRate = 48000;
+constexpr double kTarget = 10;
+
+struct Result {
+    double meanPpm;     // correction averaged over the second half
+    double minDepth;    // after the first 5 minutes
+    double maxDepth;
+};
+
+Result run(double skewPpm, double minutes) {
+    AsyncResampler::Config cfg;
+    AsyncResampler resampler(cfg);
+    std::vector<int16_t> in(kFrame * 2), out((size_t)resampler.maxOutputFrames(kFrame) * 2);
+
+    // True time in seconds. Host packets arrive at k * hostPeriod (plus a fixed 200 ms
+    // transit that cancels out); the device plays at kRate / (1 + skew) true-time rate,
+    // i.e. the host is faster by skew.
+    const double hostPeriod = (double)kFrame / kRate;
+    const double devRate = kRate / (1 + skewPpm * 1e-6);
+    const long packets = (long)(minutes * 60 / hostPeriod);
+    const long settle = (long)(5 * 60 / hostPeriod);
+
+    double playedUntil = kTarget * hostPeriod;   // playout starts with the target buffered
+    double ppmSum = 0;
+    long ppmCount = 0;
+    Result r{0, 1e9, -1e9};
+    double phase = 0;
+    for (long k = 0; k < packets; ++k) {
+        for (int i = 0; i < kFrame; ++i) {
+            phase += 2 * M_PI * 1000.0 / kRate;
+            const auto v = (int16_t)(8000 * std::sin(phase));
+            in[i * 2] = v;
+            in[i * 2 + 1] = v;
+        }
+        const int n = resampler.process(in.data(), kFrame, out.data(), resampler.maxOutputFrames(kFrame));
+        if (n <= 0) {
+            CHECK(n > 0);
+            break;
+        }
+        playedUntil += n / devRate;
+
+        // Packets arrived by now, minus the k + 1 taken
+        const double depth = std::floor(playedUntil / hostPeriod) - (double)(k + 1);
+        resampler.trackDepth(depth, kTarget);
+        if (k >= settle) {
+            r.minDepth = std::min(r.minDepth, depth);
+            r.maxDepth = std::max(r.maxDepth, depth);
+        }
+        if (k >= packets / 2) {
+            ppmSum += resampler.ppm();
+            ++ppmCount;
+        }
+    }
+    r.meanPpm = ppmCount ? ppmSum / ppmCount : 0;
+    return r;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const double minutes = bench::intArg(argc, argv, 1, 20);
+    for (double skew : {-300.0, -80.0, 0.0, 80.0, 300.0}) {
+        const int64_t t0 = bench::nowNs();
+        const Result r = run(skew, minutes);
+        std::printf("skew %+6.0f ppm, %.0f min: mean correction %+8.2f ppm, depth [%.0f, %.0f] (%.1f s)\n",
+                    skew, minutes, r.meanPpm, r.minDepth, r.maxDepth, (bench::nowNs() - t0) / 1e9);
+        CHECK(std::fabs(r.meanPpm - skew) < 2.0);
+        CHECK(r.minDepth >= kTarget - 2 && r.maxDepth <= kTarget + 2);
+    }
+    return check::result("resampler_drift_test");
+}
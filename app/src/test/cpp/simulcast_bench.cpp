@@ -0,0 +1,85 @@
+// Simulcast tiers per core.
+//
+// Encodes the same 20 ms stereo music-like frame at 1..4 tiers (128/64/32/24 kb/s)
+// with the governor off, at complexity 2, 5 and 10. Reports encode() wall time per
+// frame, each tier's opus_encode thread CPU time, and the share of one core the whole
+// set takes in real time. Lower tiers are cheaper, so the marginal cost of adding a
+// tier is the number to budget with, not the tier-0 cost.
+//
+// simulcast_bench [frames]
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "simulcast_encoder.h"
+
+namespace {
+constexpr int kFrame = 960;
+constexpr double kFrameUs = 20000;
+constexpr int kWarmup = 50;
+
+std::vector<int16_t> music(int frames) {
+    std::vector<int16_t> pcm((size_t)kFrame * 2 * frames);
+    std::mt19937 rng(4);
+    std::normal_distribution<double> gauss(0, 800);
+    for (size_t i = 0; i < pcm.size() / 2; ++i) {
+        const double t = (double)i / 48000;
+        const double v = 8000 * std::sin(2 * M_PI * 220 * t) + 4000 * std::sin(2 * M_PI * 1330 * t) +
+                         2000 * std::sin(2 * M_PI * 5100 * t) + gauss(rng);
+        pcm[i * 2] = (int16_t)v;
+        pcm[i * 2 + 1] = (int16_t)(v * 0.8 + gauss(rng));
+    }
+    return pcm;
+}
+
+bool run(const std::vector<int16_t>& pcm, int frames, int complexity, int tiers) {
+    SimulcastEncoder::Config cfg;
+    cfg.complexity = complexity;
+    cfg.encodeShare = 0;
+    cfg.tiers = tiers;
+    cfg.budgetUs = 1e9;   // never shed
+    cfg.workerNice = 0;
+    SimulcastEncoder enc(cfg);
+    if (!enc.ok()) return false;
+
+    std::vector<double> wallUs;
+    double cpuUs[SimulcastEncoder::kMaxTiers] = {};
+    const uint32_t all = (1u << tiers) - 1;
+    for (int f = 0; f < frames; ++f) {
+        const int64_t t0 = bench::nowNs();
+        const int r = enc.encode(&pcm[(size_t)f * kFrame * 2], f, (uint32_t)f * kFrame, 0, all);
+        const int64_t t1 = bench::nowNs();
+        if (r != (int)all) {
+            std::printf("encode returned %d\n", r);
+            return false;
+        }
+        if (f < kWarmup) continue;
+        wallUs.push_back((double)(t1 - t0) / 1e3);
+        // Instantaneous per-tier CPU is not exposed; the smoothed value is close enough
+        // over a steady signal once warmed up.
+        for (int t = 0; t < tiers; ++t) cpuUs[t] += enc.stats().cpuUs[t];
+    }
+    std::printf("c=%-2d tiers=%d  wall p50 %5.0f us  p99 %5.0f us  cpu", complexity, tiers,
+                bench::percentile(wallUs, 0.5), bench::percentile(wallUs, 0.99));
+    double total = 0;
+    for (int t = 0; t < tiers; ++t) {
+        std::printf(" %4.0f", cpuUs[t] / wallUs.size());
+        total += cpuUs[t] / wallUs.size();
+    }
+    std::printf(" us  = %4.1f%% of a core\n", 100 * total / kFrameUs);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 1500) + kWarmup;
+    const std::vector<int16_t> pcm = music(frames);
+    for (int complexity : {2, 5, 10}) {
+        for (int tiers = 1; tiers <= SimulcastEncoder::kMaxTiers; ++tiers) {
+            if (!run(pcm, frames, complexity, tiers)) return 1;
+        }
+    }
+    return 0;
+}
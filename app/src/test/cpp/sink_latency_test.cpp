@@ -0,0 +1,146 @@
+// SinkLatency against SimulatedSink on a simulated clock.
+//
+// A playout loop writes 10 ms frames whenever the track buffer has room (a blocking
+// AudioTrack.write) and polls a position every 200 ms, as AudioReceiver does. For every
+// frame written, playsAtNs() is compared with the time the sink actually plays it.
+// Routes: the phone speaker (5 ms pulls, 20 ms device latency) and a Bluetooth A2DP
+// headset (20 ms or whole-buffer pulls, 180 ms, +80 ppm, +-3 ms timestamp jitter),
+// and a speaker -> headset route change halfway through.
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "check.h"
+#include "simulated_sink.h"
+#include "sink_latency.h"
+
+namespace {
+constexpr int64_t kMs = 1000000;
+constexpr int kFrame = 480;
+constexpr int64_t kPollNs = 200 * kMs;
+constexpr int64_t kSettleNs = 2000 * kMs;   // ignored after the start and a route change
+
+struct Result {
+    std::vector<double> errorMs;    // |playsAtNs - heard|, settled frames only
+    std::vector<double> latencyMs;  // estimate, every 100 ms once settled
+    std::vector<double> spreadMs;
+    double settledAfterMs = -1;     // route change -> first frame predicted within 2 ms
+    int64_t jumps = 0;
+    int64_t underruns = 0;
+};
+
+Result run(const SimulatedSink::Config& first, const SimulatedSink::Config* second, int64_t durationNs) {
+    SimulatedSink sink(first);
+    SinkLatency model(first.sampleRate);
+    std::deque<std::pair<int64_t, int64_t>> pending;   // (frame, predicted ns)
+    Result r;
+    const int64_t switchNs = second ? durationNs / 2 : durationNs;
+    bool switched = false;
+    int64_t lastPollNs = -kPollNs;
+    for (int64_t t = 0; t < durationNs; t += kMs) {
+        if (second && !switched && t >= switchNs) {
+            sink.reroute(*second, t);
+            switched = true;
+        }
+        sink.advance(t);
+        if (t - lastPollNs >= kPollNs) {
+            model.poll(sink, t);
+            lastPollNs = t;
+        }
+        while (sink.freeFrames() >= kFrame) {
+            pending.emplace_back(sink.framesWritten(), model.playsAtNs(sink.framesWritten(), t));
+            sink.write(nullptr, kFrame);
+        }
+
+        const int64_t sinceChange = switched ? t - switchNs : t;
+        const bool settled = sinceChange > kSettleNs;
+        int64_t heard;
+        while (!pending.empty() && sink.heardNs(pending.front().first, &heard)) {
+            const double error = std::fabs((double)(pending.front().second - heard)) / kMs;
+            if (settled) r.errorMs.push_back(error);
+            if (switched && r.settledAfterMs < 0 && error < 2.0) r.settledAfterMs = (double)sinceChange / kMs;
+            pending.pop_front();
+        }
+        SinkLatency::Estimate e;
+        if (settled && t % (100 * kMs) == 0 && model.estimate(&e)) {
+            r.latencyMs.push_back((double)e.latencyNs / kMs);
+            r.spreadMs.push_back((double)e.spreadNs / kMs);
+        }
+    }
+    SinkLatency::Estimate e;
+    model.estimate(&e);
+    r.jumps = e.jumps;
+    r.underruns = sink.underruns();
+    return r;
+}
+
+void print(const char* route, Result& r) {
+    std::printf("%-16s |playsAt - heard| p50 %.2f  p99 %.2f ms  latency %.1f ms  spread %.1f ms\n", route,
+                bench::percentile(r.errorMs, 0.5), bench::percentile(r.errorMs, 0.99),
+                bench::percentile(r.latencyMs, 0.5), bench::percentile(r.spreadMs, 0.5));
+}
+
+SimulatedSink::Config speaker() { return SimulatedSink::Config(); }
+
+SimulatedSink::Config headset() {
+    SimulatedSink::Config c;
+    c.burstFrames = 960;
+    c.deviceLatencyMs = 180;
+    c.ppm = 80;
+    c.positionJitterMs = 3;
+    return c;
+}
+
+void speakerRoute() {
+    Result r = run(speaker(), nullptr, 20000 * kMs);
+    print("speaker", r);
+    // Buffer (80 ms) + device (20 ms) less the half burst pulled on average
+    CHECK(std::fabs(bench::percentile(r.latencyMs, 0.5) - 95) < 3);
+    CHECK(bench::percentile(r.errorMs, 0.99) < 0.5);
+    CHECK_EQ(r.jumps, 0);
+    // Only the one at start, before the first write
+    CHECK(r.underruns <= 1);
+}
+
+void headsetRoute() {
+    Result r = run(headset(), nullptr, 20000 * kMs);
+    print("headset", r);
+    CHECK(std::fabs(bench::percentile(r.latencyMs, 0.5) - 260) < 5);
+    // The timestamps are only good to +-3 ms
+    CHECK(bench::percentile(r.errorMs, 0.99) < 4);
+    CHECK(r.underruns <= 1);
+
+    SimulatedSink::Config bursty = headset();
+    bursty.burstFrames = bursty.bufferFrames;
+    bursty.deviceLatencyMs = 150;
+    Result b = run(bursty, nullptr, 20000 * kMs);
+    print("headset, bursty", b);
+    // Whole-buffer pulls show up as spread, the cushion the jitter buffer must add
+    CHECK(bench::percentile(b.spreadMs, 0.5) > 30);
+    CHECK(bench::percentile(b.errorMs, 0.99) < 4);
+}
+
+void routeChange() {
+    const SimulatedSink::Config to = headset();
+    Result r = run(speaker(), &to, 40000 * kMs);
+    const double last = r.latencyMs.empty() ? 0 : r.latencyMs.back();
+    print("speaker -> bt", r);
+    std::printf("settled %.0f ms after the route change, %lld restarts\n", r.settledAfterMs, (long long)r.jumps);
+    CHECK(r.jumps >= 1);
+    CHECK(r.settledAfterMs >= 0 && r.settledAfterMs < 1000);
+    // The newest estimate is the headset's (print() sorted the samples). At +80 ppm the
+    // 200 ms polls drift against the 20 ms pulls, and the latency read moves by up to
+    // one pull when the phase crosses a pull; playsAtNs() does not, it extrapolates.
+    CHECK(std::fabs(last - 260) < 25);
+}
+} // namespace
+
+int main() {
+    speakerRoute();
+    headsetRoute();
+    routeChange();
+    return check::result("sink_latency_test");
+}
@@ -0,0 +1,154 @@
+// Steady-state encode/decode must not touch the native heap.
+//
+// malloc and friends are interposed for this executable and count calls while a
+// window is open. The Opus calls are the ones the encoder/decoder handles in
+// opus_encoder.cpp make per frame (encode, decode, in-band FEC, PLC), run on scratch
+// allocated once up front the same way; the handle functions themselves are JNI entry
+// points and cannot be called without a JVM. The guest units the decoder feeds from
+// (jitter buffer, time stretcher, resampler) are checked the same way.
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <opus.h>
+
+#include "check.h"
+#include "jitter_buffer.h"
+#include "resampler.h"
+#include "time_stretch.h"
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void* __libc_memalign(size_t, size_t);
+
+namespace {
+bool counting = false;
+int allocations = 0;
+
+void counted() {
+    if (counting) ++allocations;
+}
+} // namespace
+
+extern "C" void* malloc(size_t n) {
+    counted();
+    return __libc_malloc(n);
+}
+extern "C" void* calloc(size_t n, size_t size) {
+    counted();
+    return __libc_calloc(n, size);
+}
+extern "C" void* realloc(void* p, size_t n) {
+    counted();
+    return __libc_realloc(p, n);
+}
+extern "C" void* aligned_alloc(size_t align, size_t n) {
+    counted();
+    return __libc_memalign(align, n);
+}
+extern "C" int posix_memalign(void** out, size_t align, size_t n) {
+    counted();
+    *out = __libc_memalign(align, n);
+    return *out ? 0 : 12; // ENOMEM
+}
+
+namespace {
+constexpr int kRate = 48000;
+constexpr int kChannels = 2;
+constexpr int kFrame = 960;
+constexpr int kMaxFrame = 5760;
+constexpr int kMaxPacket = 1500;
+constexpr size_t kAlign = 64;
+
+void* scratch(size_t bytes) {
+    return std::aligned_alloc(kAlign, (bytes + kAlign - 1) & ~(kAlign - 1));
+}
+
+void fillTone(int16_t* pcm, int frame, int index) {
+    for (int i = 0; i < frame; ++i) {
+        const double t = (double)(index * frame + i) / kRate;
+        const auto s = (int16_t)(9000 * std::sin(2 * M_PI * 330 * t));
+        pcm[i * 2] = s;
+        pcm[i * 2 + 1] = s;
+    }
+}
+
+void codecPaths() {
+    int err = 0;
+    OpusEncoder* enc = opus_encoder_create(kRate, kChannels, OPUS_APPLICATION_AUDIO, &err);
+    OpusDecoder* dec = opus_decoder_create(kRate, kChannels, &err);
+    CHECK(enc && dec);
+    opus_encoder_ctl(enc, OPUS_SET_INBAND_FEC(1));
+    opus_encoder_ctl(enc, OPUS_SET_PACKET_LOSS_PERC(10));
+    auto* pcm = static_cast<opus_int16*>(scratch(kMaxFrame * kChannels * sizeof(opus_int16)));
+    auto* packet = static_cast<unsigned char*>(scratch(kMaxPacket));
+    auto* out = static_cast<opus_int16*>(scratch(kMaxFrame * kChannels * sizeof(opus_int16)));
+
+    // Warm up outside the window: first calls may set up lazily
+    for (int i = 0; i < 5; ++i) {
+        fillTone(pcm, kFrame, i);
+        const int len = opus_encode(enc, pcm, kFrame, packet, kMaxPacket);
+        CHECK(opus_decode(dec, packet, len, out, kFrame, 0) == kFrame);
+    }
+
+    counting = true;
+    allocations = 0;
+    for (int i = 5; i < 500; ++i) {
+        fillTone(pcm, kFrame, i);
+        const int len = opus_encode(enc, pcm, kFrame, packet, kMaxPacket);
+        if (len <= 0) {
+            CHECK(len > 0);
+            break;
+        }
+        if (i % 10 == 0) {
+            CHECK(opus_decode(dec, packet, len, out, kFrame, 1) == kFrame);   // FEC
+        } else if (i % 10 == 1) {
+            CHECK(opus_decode(dec, nullptr, 0, out, kFrame, 0) == kFrame);    // PLC
+        } else {
+            CHECK(opus_decode(dec, packet, len, out, kFrame, 0) == kFrame);
+        }
+    }
+    counting = false;
+    CHECK_EQ(allocations, 0);
+
+    std::free(pcm);
+    std::free(packet);
+    std::free(out);
+    opus_encoder_destroy(enc);
+    opus_decoder_destroy(dec);
+}
+
+void guestPaths() {
+    JitterBuffer jb(512, kMaxPacket);
+    TimeStretcher::Config sc;
+    TimeStretcher stretcher(sc);
+    AsyncResampler::Config rc;
+    AsyncResampler resampler(rc);
+    static int16_t pcm[kFrame * kChannels];
+    static int16_t stretched[2 * kFrame * kChannels];
+    static int16_t resampled[4 * kFrame * kChannels];
+    static uint8_t payload[kMaxPacket];
+
+    counting = true;
+    allocations = 0;
+    for (int i = 0; i < 500; ++i) {
+        std::memset(payload, i, 300);
+        jb.put(i, payload, 300);
+        CHECK_EQ(jb.copyPayload(i, payload, kMaxPacket, true), 300);
+        fillTone(pcm, kFrame, i);
+        const int n = (i & 1) ? stretcher.expand(pcm, kFrame, stretched, 2 * kFrame)
+                              : stretcher.compress(pcm, kFrame, stretched);
+        resampler.trackDepth(10 + (i % 3), 10);
+        resampler.process(stretched, n, resampled, 4 * kFrame);
+    }
+    counting = false;
+    CHECK_EQ(allocations, 0);
+}
+} // namespace
+
+int main() {
+    codecPaths();
+    guestPaths();
+    return check::result("steady_state_alloc_test");
+}
@@ -0,0 +1,264 @@
+// Inter-guest skew on loopback, end to end.
+//
+// A paced HostPipeline (one tier, resend port on) streams to three guests in this
+// process. Each guest has its own clock (offset and skew applied to CLOCK_MONOTONIC),
+// delays its clock requests and the replies it hears by exponential queueing with
+// occasional 40 ms bursts, and runs HostClock against the pipeline's NACK port exactly
+// as UdpReceiver does. Every 50 ms the main thread asks every guest when a recent
+// frame is due (presentationNs, 400 ms delay) and maps the answers back to true time.
+// The spread of those instants is the inter-guest skew; |due - (pts + delay)| is each
+// guest's own error.
+//
+// sync_skew_bench [seconds] [frameSize]
+#include <opus.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "clock_sync.h"
+#include "host_pipeline.h"
+#include "packet_codec.h"
+
+namespace {
+constexpr int64_t kDelayNs = 400000000;
+constexpr int kTruth = 1 << 16;
+constexpr double kWarmupS = 5;
+
+class Guest {
+public:
+    Guest(double skew, int64_t offsetNs, double queueingMs, unsigned seed)
+        : skew_(skew), offsetNs_(offsetNs), startNs_(bench::nowNs()), queueing_(1.0 / queueingMs), rng_(seed) {}
+
+    bool open() {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd_, reinterpret_cast<sockaddr*>(&a), sizeof a) != 0) return false;
+        socklen_t len = sizeof a;
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&a), &len);
+        port_ = ntohs(a.sin_port);
+        return true;
+    }
+
+    ~Guest() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    int port() const { return port_; }
+
+    // This guest's clock at monotonic time t, and back
+    int64_t guestAt(int64_t t) const { return t + offsetNs_ + (int64_t)((double)(t - startNs_) * skew_); }
+    int64_t trueAt(int64_t guestNs) const {
+        return startNs_ + (int64_t)((double)(guestNs - offsetNs_ - startNs_) / (1 + skew_));
+    }
+
+    // rx thread: media feeds the anchor (and, for the reference guest, the truth
+    // table); clock exchanges go to hostPort
+    void run(int hostPort, const std::atomic<bool>& stop, std::atomic<int64_t>* truth,
+             std::atomic<int32_t>* newest) {
+        sockaddr_in host{};
+        host.sin_family = AF_INET;
+        host.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        host.sin_port = htons(hostPort);
+        uint8_t buf[2048];
+        int64_t requestAt = -1, t1 = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            const int64_t now = bench::nowNs();
+            if (requestAt < 0 && clock.requestDue(guestAt(now))) {
+                t1 = guestAt(now);
+                clock.onRequestSent(t1);
+                requestAt = now + queueingNs();
+            }
+            if (requestAt >= 0 && now >= requestAt) {
+                uint8_t request[wspacket::kClockRequestSize];
+                const int len = wspacket::writeClockRequest(request, t1);
+                sendto(fd_, request, len, 0, reinterpret_cast<sockaddr*>(&host), sizeof host);
+                requestAt = -1;
+            }
+            // ppoll, not SO_RCVTIMEO: socket timeouts round up to a jiffy, which would
+            // hold queued requests back by milliseconds
+            const int64_t waitNs = requestAt >= 0 ? std::max<int64_t>(0, requestAt - bench::nowNs()) : 5000000;
+            pollfd pfd{fd_, POLLIN, 0};
+            const timespec ts{0, (long)waitNs};
+            if (ppoll(&pfd, 1, &ts, nullptr) <= 0) continue;
+            const ssize_t len = recv(fd_, buf, sizeof buf, MSG_DONTWAIT);
+            if (len <= 0) continue;
+            wspacket::ClockExchange c{};
+            if (wspacket::parseClock(buf, (int)len, &c) == wspacket::kClockReply) {
+                // Downlink queueing: the reply is heard later than it arrived
+                clock.onReply(c, guestAt(bench::nowNs() + queueingNs()));
+                continue;
+            }
+            wspacket::Header h{};
+            if (!wspacket::parseHeader(buf, (int)len, &h)) continue;
+            clock.onMedia(h.seq, h.pts);
+            if (truth) {
+                const int64_t nowTicks = wspacket::ptsTicks(bench::nowNs());
+                const int64_t ticks = nowTicks + (int32_t)(h.pts - (uint32_t)nowTicks);
+                truth[h.seq & (kTruth - 1)].store(wspacket::ptsNs(ticks), std::memory_order_relaxed);
+                newest->store(h.seq, std::memory_order_release);
+            }
+        }
+    }
+
+    double skew() const { return skew_; }
+
+    HostClock clock;
+
+private:
+    int64_t queueingNs() {
+        double ms = queueing_(rng_);
+        if (uniform_(rng_) < 0.03) ms += 40;
+        return (int64_t)(ms * 1e6);
+    }
+
+    const double skew_;
+    const int64_t offsetNs_;
+    const int64_t startNs_;
+    int fd_ = -1;
+    int port_ = 0;
+    std::exponential_distribution<double> queueing_;
+    std::uniform_real_distribution<double> uniform_{0, 1};
+    std::mt19937 rng_;
+};
+
+// A free UDP port for the pipeline's resend socket
+int freePort() {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof a);
+    socklen_t len = sizeof a;
+    getsockname(fd, reinterpret_cast<sockaddr*>(&a), &len);
+    close(fd);
+    return ntohs(a.sin_port);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = bench::intArg(argc, argv, 1, 60);
+    const int frameSize = bench::intArg(argc, argv, 2, 480);
+
+    HostPipeline::Config cfg;
+    cfg.encoder.frameSize = frameSize;
+    cfg.encoder.application = OPUS_APPLICATION_AUDIO;
+    cfg.encoder.budgetUs = frameSize * 1e6 / 48000 * 0.4;
+    cfg.encoder.workerNice = 0;
+    cfg.ringFrames = 32;
+    cfg.retransmitFrames = 64;
+    cfg.port = freePort();
+    cfg.sendNice = 0;
+    cfg.nackNice = 0;
+    HostPipeline pipeline(cfg);
+    if (!pipeline.ok() || !pipeline.retransmitEnabled()) {
+        std::printf("pipeline failed\n");
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Guest>> guests;
+    guests.emplace_back(new Guest(+80e-6, 3000000000LL, 1.0, 1));
+    guests.emplace_back(new Guest(-120e-6, -7500000000LL, 3.0, 2));
+    guests.emplace_back(new Guest(+35e-6, 123456789, 6.0, 3));
+    const int n = (int)guests.size();
+    static const uint8_t loopback[4] = {127, 0, 0, 1};
+    std::vector<const uint8_t*> ips(n, loopback);
+    std::vector<int> lens(n, 4), ports(n);
+    for (int i = 0; i < n; ++i) {
+        if (!guests[i]->open()) return 1;
+        ports[i] = guests[i]->port();
+    }
+    pipeline.setTargets(ips.data(), lens.data(), ports.data(), n);
+    if (!pipeline.start()) return 1;
+
+    // Host time of each seq's first sample, from guest 0's packets
+    std::unique_ptr<std::atomic<int64_t>[]> truth(new std::atomic<int64_t>[kTruth]);
+    for (int i = 0; i < kTruth; ++i) truth[i].store(0);
+    std::atomic<int32_t> newest{-1};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+        threads.emplace_back([&, i] {
+            guests[i]->run(cfg.port, stop, i == 0 ? truth.get() : nullptr, &newest);
+        });
+    }
+    std::thread capture([&] {
+        // A 440 Hz tone in 1764-short chunks, paced to real time
+        std::vector<int16_t> chunk(1764);
+        const int64_t start = bench::nowNs();
+        int64_t pushed = 0;
+        while (!stop.load() && pushed < (int64_t)seconds * 96000) {
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                chunk[i] = (int16_t)(8000 * std::sin(2 * M_PI * 440 * (double)((pushed + i) / 2) / 48000));
+            }
+            pipeline.push(chunk.data(), (int)chunk.size());
+            pushed += (int64_t)chunk.size();
+            const int64_t due = start + pushed * 1000000000LL / 96000;
+            const int64_t wait = due - bench::nowNs();
+            if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+        }
+    });
+
+    std::vector<double> earlyUs, spreadUs, errorUs;
+    const int64_t start = bench::nowNs();
+    while (bench::nowNs() - start < (int64_t)seconds * 1000000000LL) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const int32_t seq = newest.load(std::memory_order_acquire) - 5;
+        if (seq < 0) continue;
+        const int64_t hostNs = truth[seq & (kTruth - 1)].load(std::memory_order_relaxed);
+        std::vector<int64_t> due;
+        for (const std::unique_ptr<Guest>& g : guests) {
+            int64_t guestNs;
+            if (!g->clock.presentationNs(seq, frameSize, kDelayNs, &guestNs)) break;
+            due.push_back(g->trueAt(guestNs));
+        }
+        if ((int)due.size() != n || hostNs == 0) continue;
+        const auto range = std::minmax_element(due.begin(), due.end());
+        const double spread = (double)(*range.second - *range.first) / 1e3;
+        if (bench::nowNs() - start < (int64_t)(kWarmupS * 1e9)) {
+            earlyUs.push_back(spread);
+            continue;
+        }
+        spreadUs.push_back(spread);
+        for (int64_t t : due) errorUs.push_back(std::fabs((double)(t - (hostNs + kDelayNs))) / 1e3);
+    }
+    stop = true;
+    capture.join();
+    for (std::thread& t : threads) t.join();
+    pipeline.stop();
+    HostPipeline::Stats stats;
+    pipeline.stats(&stats);
+
+    std::printf("frame %d, %d guests, %d s, %lld clock replies\n", frameSize, n, seconds,
+                (long long)stats.nacks.clocks);
+    std::printf("  first %.0f s   spread p50 %5.0f  p99 %5.0f  max %5.0f us  (%zu samples)\n", kWarmupS,
+                bench::percentile(earlyUs, 0.5), bench::percentile(earlyUs, 0.99), bench::percentile(earlyUs, 1),
+                earlyUs.size());
+    std::printf("  after         spread p50 %5.0f  p99 %5.0f  max %5.0f us  (%zu samples)\n",
+                bench::percentile(spreadUs, 0.5), bench::percentile(spreadUs, 0.99),
+                bench::percentile(spreadUs, 1), spreadUs.size());
+    std::printf("  after         |due - true| p50 %5.0f  p99 %5.0f  max %5.0f us\n", bench::percentile(errorUs, 0.5),
+                bench::percentile(errorUs, 0.99), bench::percentile(errorUs, 1));
+    for (int i = 0; i < n; ++i) {
+        HostClock::Estimate e;
+        guests[i]->clock.estimate(&e);
+        std::printf("  guest %d  skew %+6.1f ppm, estimated %+6.1f  min rtt %.2f ms  exchanges %d  trusted %d\n", i,
+                    (1 / (1 + guests[i]->skew()) - 1) * 1e6, e.skewPpm, e.minDelayNs / 1e6, e.exchanges, e.trusted);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// WSOLA time stretch cost per 20 ms stereo frame.
+//
+// Every frame goes through expand() or compress(); the sample budget (maxRate) decides
+// which of them are actually stretched, the rest are copied through. Measured per
+// call on the calling thread's CPU clock, over a two-tone signal (periodic, the easy
+// case for the correlation search) and white noise (no period, the costly case).
+// Also reports the achieved rate and the largest sample-to-sample step, which would
+// show a click at a bad splice.
+//
+// time_stretch_bench [frames]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "time_stretch.h"
+
+namespace {
+constexpr int kFrame = 960;
+
+void run(const char* signal, bool noise, bool compress, int frames) {
+    TimeStretcher::Config cfg;
+    TimeStretcher stretcher(cfg);
+    std::vector<int16_t> in(kFrame * 2), out((size_t)stretcher.maxOutputFrames(kFrame) * 2);
+    std::mt19937 rng(9);
+    std::normal_distribution<double> gauss(0, 5000);
+    double ph1 = 0, ph2 = 0;
+    std::vector<double> us;
+    us.reserve(frames);
+    long produced = 0;
+    int maxStep = 0;
+    int16_t prev = 0;
+    bool havePrev = false;
+
+    for (int f = 0; f < frames; ++f) {
+        for (int i = 0; i < kFrame; ++i) {
+            int16_t v;
+            if (noise) {
+                v = (int16_t)std::max(-32000.0, std::min(32000.0, gauss(rng)));
+            } else {
+                ph1 += 2 * M_PI * 196 / 48000;
+                ph2 += 2 * M_PI * 523 / 48000;
+                v = (int16_t)(7000 * std::sin(ph1) + 4000 * std::sin(ph2));
+            }
+            in[i * 2] = v;
+            in[i * 2 + 1] = (int16_t)(v * 0.7);
+        }
+        const int64_t t0 = bench::threadCpuNs();
+        const int n = compress ? stretcher.compress(in.data(), kFrame, out.data())
+                               : stretcher.expand(in.data(), kFrame, out.data(), (int)out.size() / 2);
+        us.push_back((double)(bench::threadCpuNs() - t0) / 1e3);
+        produced += n;
+        if (!noise) {
+            for (int i = 0; i < n; ++i) {
+                if (havePrev) maxStep = std::max(maxStep, std::abs(out[i * 2] - prev));
+                prev = out[i * 2];
+                havePrev = true;
+            }
+        }
+    }
+    double sum = 0;
+    for (double u : us) sum += u;
+    const double mean = sum / frames;
+    std::printf("%-6s %-8s mean %6.1f us  p99 %6.1f us  max %6.1f us  (%.2f%% of 20 ms)  rate %.4f  stretched %lld",
+                signal, compress ? "compress" : "expand", mean, bench::percentile(us, 0.99),
+                bench::percentile(us, 1.0), mean / 200.0, (double)produced / ((double)frames * kFrame),
+                (long long)stretcher.stretchedFrames());
+    if (!noise) std::printf("  max step %d", maxStep);
+    std::printf("\n");
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 20000);
+    std::printf("frames=%d, 20 ms stereo at 48 kHz, maxRate 0.08\n", frames);
+    for (bool noise : {false, true}) {
+        for (bool compress : {false, true}) run(noise ? "noise" : "tones", noise, compress, frames);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Host fan-out cost per frame: one sendmmsg batch (UdpSender::sendToAll)
+// against one sendto per guest, to 10, 50 and 100 guests on loopback.
+//
+// Each guest is a bound loopback socket that is drained between frames, so every
+// send finds room. Times are wall time of the send call(s) per frame and the sending
+// thread's CPU time.
+//
+// udp_fanout_bench [frames]
+#include <arpa/inet.h>
+#include <cstdio>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bench.h"
+#include "udp_sender.h"
+
+namespace {
+constexpr int kPacket = 300;
+
+int loopbackReceiver(int* port) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof a);
+    socklen_t len = sizeof a;
+    getsockname(fd, reinterpret_cast<sockaddr*>(&a), &len);
+    const int big = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &big, sizeof big);
+    *port = ntohs(a.sin_port);
+    return fd;
+}
+
+int drain(const std::vector<int>& fds) {
+    char buf[2048];
+    int got = 0;
+    for (int fd : fds) {
+        while (recv(fd, buf, sizeof buf, MSG_DONTWAIT) > 0) ++got;
+    }
+    return got;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = bench::intArg(argc, argv, 1, 2000);
+    uint8_t packet[kPacket] = {};
+    static const uint8_t loopback[4] = {127, 0, 0, 1};
+
+    std::printf("frames=%d, %d-byte datagrams to loopback guests\n", frames, kPacket);
+    for (int guests : {10, 50, 100}) {
+        std::vector<int> fds(guests), ports(guests), lens(guests, 4), errors(guests);
+        std::vector<const uint8_t*> ips(guests, loopback);
+        for (int i = 0; i < guests; ++i) fds[i] = loopbackReceiver(&ports[i]);
+
+        UdpSender sender;
+        sender.setTargets(ips.data(), lens.data(), ports.data(), guests);
+        const int plain = socket(AF_INET6, SOCK_DGRAM, 0);
+
+        int64_t batchNs = 0, batchCpu = 0, loopNs = 0, loopCpu = 0;
+        long lostBatch = 0, lostLoop = 0;
+        for (int f = 0; f < frames; ++f) {
+            int64_t w = bench::nowNs(), c = bench::threadCpuNs();
+            sender.sendToAll(packet, kPacket, errors.data());
+            batchNs += bench::nowNs() - w;
+            batchCpu += bench::threadCpuNs() - c;
+            lostBatch += guests - drain(fds);
+
+            w = bench::nowNs();
+            c = bench::threadCpuNs();
+            for (int i = 0; i < guests; ++i) {
+                const sockaddr_in6& to = sender.target(i);
+                sendto(plain, packet, kPacket, 0, reinterpret_cast<const sockaddr*>(&to), sizeof to);
+            }
+            loopNs += bench::nowNs() - w;
+            loopCpu += bench::threadCpuNs() - c;
+            lostLoop += guests - drain(fds);
+        }
+        std::printf("guests %3d  sendmmsg %7.1f us (cpu %7.1f)  sendto loop %7.1f us (cpu %7.1f)  "
+                    "per guest %.2f / %.2f us  undelivered %ld / %ld\n",
+                    guests, batchNs / 1e3 / frames, batchCpu / 1e3 / frames, loopNs / 1e3 / frames,
+                    loopCpu / 1e3 / frames, batchNs / 1e3 / frames / guests, loopNs / 1e3 / frames / guests,
+                    lostBatch, lostLoop);
+        close(plain);
+        for (int fd : fds) close(fd);
+    }
+    return 0;
+}